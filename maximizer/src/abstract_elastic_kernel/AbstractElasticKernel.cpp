@@ -14,12 +14,18 @@ AbstractElasticKernel::AbstractElasticKernel() {
 	this->gridConfig = newParams;
 	this->name = "n/a";
 	this->memConsumption = 0;
+	this->problemSize = newParams.getNumTotalThreads();
+	this->bytesMoved = 0;
+	this->numOperations = 0;
 }
 
 AbstractElasticKernel::AbstractElasticKernel(const LaunchParameters& gridConfig, std::string name) {
 	this->gridConfig = gridConfig;
 	this->name = name;
 	this->memConsumption = 0;
+	this->problemSize = this->gridConfig.getNumTotalThreads();
+	this->bytesMoved = 0;
+	this->numOperations = 0;
 }
 
 AbstractElasticKernel::~AbstractElasticKernel() {
@@ -29,6 +35,22 @@ LaunchParameters AbstractElasticKernel::getLaunchParams() {
 	return this->gridConfig;
 }
 
+size_t AbstractElasticKernel::getProblemSize() {
+	return this->problemSize;
+}
+
+size_t AbstractElasticKernel::getBytesMoved() {
+	return (this->bytesMoved != 0) ? this->bytesMoved : this->getMemoryConsumption();
+}
+
+size_t AbstractElasticKernel::getNumOperations() {
+	return (this->numOperations != 0) ? this->numOperations : this->problemSize;
+}
+
+std::string AbstractElasticKernel::getName() {
+	return this->name;
+}
+
 void AbstractElasticKernel::setLaunchParams(LaunchParameters params) {
 	this->gridConfig = params;
 }
@@ -25,6 +25,9 @@ protected:
 	LaunchParameters gridConfig; // the configuration parameters
 	std::string name; // the name of the kernel
 	size_t memConsumption; // the total global memory consumption of the kernel
+	size_t problemSize; // the work items the threads of the kernel share, however many there are
+	size_t bytesMoved; // the bytes a run reads from and writes to global memory, 0 if the kernel does not say
+	size_t numOperations; // the arithmetic operations of a run, 0 if the kernel does not say
 
 public:
 	AbstractElasticKernel();
@@ -82,6 +85,34 @@ public:
 	 */
 	LaunchParameters getLaunchParams();
 
+	/**
+	 * Retrieves the number of work items (elements, options...) the threads of the kernel share. This
+	 * is what the grid is sized for; unless the kernel says otherwise, it is the number of threads
+	 * it was created with.
+	 * @return
+	 */
+	size_t getProblemSize();
+
+	/**
+	 * Retrieves the bytes a run of the kernel reads from and writes to global memory. Unless the
+	 * kernel says otherwise, it goes through its memory once.
+	 * @return
+	 */
+	size_t getBytesMoved();
+
+	/**
+	 * Retrieves the arithmetic operations of a run of the kernel, a fused multiply-add being two.
+	 * Unless the kernel says otherwise, it is one per work item.
+	 * @return
+	 */
+	size_t getNumOperations();
+
+	/**
+	 * Retrieves the name of the kernel
+	 * @return
+	 */
+	std::string getName();
+
 	friend std::ostream &operator<<(std::ostream &output, const AbstractElasticKernel &kernel);
 
 };
@@ -15,6 +15,14 @@
 #include "stddef.h"
 #include "stdio.h"
 #include <iostream>
+#include <cmath>
+
+/**
+ * Gives the dynamic shared memory a block of a kernel allocates for a number of threads per block,
+ * for kernels whose shared allocation grows with the block (a tile per block, a copy of a
+ * histogram per warp...)
+ */
+typedef size_t (*DynamicSharedMemFunction)(size_t threadsPerBlock);
 
 class LaunchParameters {
 
@@ -27,6 +35,10 @@ private:
 	size_t gridX;
 	size_t gridY;
 
+	// the dynamic shared memory per block, either fixed or as a function of the block size
+	size_t dynamicSharedMem;
+	DynamicSharedMemFunction dynamicSharedMemFunction;
+
 public:
 	/**
 	 * Default constructor just defaults everything to 1
@@ -37,6 +49,8 @@ public:
 		this->blockZ = 1;
 		this->gridX = 1;
 		this->gridY = 1;
+		this->dynamicSharedMem = 0;
+		this->dynamicSharedMemFunction = NULL;
 	}
 
 	/**
@@ -51,6 +65,8 @@ public:
 		this->blockZ = 1;
 		this->gridX = blksPerGrid;
 		this->gridY = 1;
+		this->dynamicSharedMem = 0;
+		this->dynamicSharedMemFunction = NULL;
 	}
 
 	/**
@@ -69,6 +85,8 @@ public:
 		this->blockZ = blockZ;
 		this->gridX = gridX;
 		this->gridY = gridY;
+		this->dynamicSharedMem = 0;
+		this->dynamicSharedMemFunction = NULL;
 	}
 
 	inline ~LaunchParameters() {
@@ -90,26 +108,140 @@ public:
 	}
 
 	/**
-	 * Setter for just the block number per grid
+	 * Setter for just the block number per grid. A two dimensional grid keeps its shape as well as it
+	 * can: X and Y are scaled by the same factor, and out of the shapes that round either of them down
+	 * or up and fit the other into the blocks, the one with the most blocks (and then the closest
+	 * aspect ratio) is kept, so that there are never more blocks than asked for.
 	 *
 	 * @param blocks num blocks per grid
 	 */
 	inline void setBlocks(size_t blocks) {
-		this->gridX = blocks;
-		this->gridY = 1;
+		size_t current = this->gridX * this->gridY;
+		if (this->gridY <= 1 || current == 0 || blocks == 0) {
+			this->gridX = blocks;
+			this->gridY = 1;
+			return;
+		}
+		if (blocks == current) {
+			return;
+		}
+		double factor = std::sqrt((double) blocks / (double) current);
+		double aspect = (double) this->gridY / (double) this->gridX;
+		double scaledX = this->gridX * factor;
+		double scaledY = this->gridY * factor;
+		// the rounded X or Y of every candidate shape, the other side is fitted into the blocks
+		double sides[4] = { std::floor(scaledX), std::ceil(scaledX), std::floor(scaledY), std::ceil(scaledY) };
+		size_t bestX = blocks;
+		size_t bestY = 1;
+		double bestSkew = 0;
+		for (int c = 0; c < 4; ++c) {
+			size_t side = (size_t) sides[c];
+			side = (side < 1) ? 1 : ((side > blocks) ? blocks : side);
+			size_t x = (c < 2) ? side : blocks / side;
+			size_t y = (c < 2) ? blocks / side : side;
+			double skew = std::fabs(std::log(((double) y / (double) x) / aspect));
+			if (c == 0 || x * y > bestX * bestY || (x * y == bestX * bestY && skew < bestSkew)) {
+				bestX = x;
+				bestY = y;
+				bestSkew = skew;
+			}
+		}
+		this->gridX = bestX;
+		this->gridY = bestY;
 	}
 
 	/**
-	 * Setter for the number of threads per block
+	 * Setter for the number of threads per block. The Y and Z dimensions of the block are kept when
+	 * the threads are a multiple of them, so only X changes; otherwise the block becomes one dimensional.
 	 *
 	 * @param threads num threads per block
 	 */
 	inline void setThreads(size_t threads) {
+		size_t slice = this->blockY * this->blockZ;
+		if (slice > 1 && threads % slice == 0) {
+			this->blockX = threads / slice;
+			return;
+		}
 		this->blockX = threads;
 		this->blockY = 1;
 		this->blockZ = 1;
 	}
 
+	/**
+	 * Tells whether the block has more than one dimension. The shape of such a block is usually
+	 * part of the algorithm (a tile), so it should not be changed by molding.
+	 * @return
+	 */
+	inline bool hasMultiDimensionalBlock() const {
+		return this->blockY > 1 || this->blockZ > 1;
+	}
+
+	/**
+	 * Tells whether the block or the grid has more than one dimension
+	 * @return
+	 */
+	inline bool isMultiDimensional() const {
+		return hasMultiDimensionalBlock() || this->gridY > 1;
+	}
+
+	/**
+	 * Sets a fixed amount of dynamic shared memory for every block
+	 *
+	 * @param bytes the dynamic shared memory per block
+	 */
+	inline void setDynamicSharedMem(size_t bytes) {
+		this->dynamicSharedMem = bytes;
+		this->dynamicSharedMemFunction = NULL;
+	}
+
+	/**
+	 * Makes the dynamic shared memory of a block depend on the number of threads in it, so it
+	 * follows the block size when the configuration is molded
+	 *
+	 * @param function gives the bytes for a number of threads per block
+	 */
+	inline void setDynamicSharedMem(DynamicSharedMemFunction function) {
+		this->dynamicSharedMem = 0;
+		this->dynamicSharedMemFunction = function;
+	}
+
+	/**
+	 * Retrieves the dynamic shared memory of a block of this launch config, which is what goes
+	 * into the third argument of the launch
+	 *
+	 * @return the bytes per block
+	 */
+	inline size_t getDynamicSharedMem() const {
+		return getDynamicSharedMem(this->blockX * this->blockY * this->blockZ);
+	}
+
+	/**
+	 * Retrieves the dynamic shared memory a block would have with another number of threads
+	 *
+	 * @param threadsPerBlock the number of threads per block
+	 * @return the bytes per block
+	 */
+	inline size_t getDynamicSharedMem(size_t threadsPerBlock) const {
+		if (this->dynamicSharedMemFunction != NULL) {
+			return this->dynamicSharedMemFunction(threadsPerBlock);
+		}
+		return this->dynamicSharedMem;
+	}
+
+	/**
+	 * Retrieves the fixed dynamic shared memory per block (0 when it is given by a function)
+	 */
+	inline size_t getFixedDynamicSharedMem() const {
+		return this->dynamicSharedMem;
+	}
+
+	/**
+	 * Retrieves the function that gives the dynamic shared memory, NULL when it is fixed
+	 */
+	inline DynamicSharedMemFunction getDynamicSharedMemFunction() const {
+		return this->dynamicSharedMemFunction;
+	}
+
 	/**
 	 * Retrieves the total number of threads for the whole launch config
 	 * @return
@@ -135,6 +267,9 @@ public:
 	// just used to print to an ostream..
 	inline friend std::ostream &operator<<(std::ostream &output, const LaunchParameters &pp) {
 		output << "[" << pp.blockX << " x " << pp.blockY << " x " << pp.blockZ << "] [" << pp.gridX << " x " << pp.gridY << "]";
+		if (pp.getDynamicSharedMem() > 0) {
+			output << " " << pp.getDynamicSharedMem() << "B smem";
+		}
 		return output;
 	}
 
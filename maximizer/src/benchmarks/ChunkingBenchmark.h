@@ -0,0 +1,537 @@
+/**
+ * ChunkingBenchmark.h
+ *
+ * A benchmark for the chunking path. The benchmark sweeps the number of threads, the divisor D,
+ * the breakpoint policy, the size of the sliding window, the number of lanes every thread
+ * fingerprints at the same time and the type of the input (random bytes,
+ * zeros, text or the contents of real files). For every configuration a number of warm-up runs
+ * is followed by a number of timed trials, out of which the median is reported as throughput in
+ * GB/s, cycles per byte and scaling efficiency with respect to the smallest thread count.
+ *
+ * With --numa the workers are pinned to CPUs, spread over the NUMA nodes in order, and the input
+ * is copied into a buffer in which every segment is first touched by the worker that chunks it.
+ * The number of nodes the workers span is reported, so the scaling across sockets can be seen.
+ *
+ * With --fragment-kb the input is also chunked as a list of iovecs of that size, without being
+ * copied into one buffer (see ScatterGatherChunker.h), by a single thread. Those rows are marked
+ * with "iov" in the thread column.
+ *
+ * With --fixed-kb the input is also cut into fixed-size blocks of those sizes, for which only the
+ * zero blocks are searched (see FixedBlockChunker.h). Those rows have the policy "fixed" and the
+ * block size in the D column.
+ *
+ * Usage: --chunking-benchmark [--threads=1,2,4] [--divisors=512] [--policies=free,tttd]
+ *                             [--windows=48] [--inputs=random,zeros,text,corpus,file:PATH]
+ *                             [--size-mb=256] [--trials=5] [--warmup=1] [--numa] [--lanes=1,4]
+ *                             [--fragment-kb=4] [--fixed-kb=4,64]
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Zahari Dichev <zaharidichev@gmail.com>
+ */
+
+#ifndef CHUNKINGBENCHMARK_H_
+#define CHUNKINGBENCHMARK_H_
+
+#include "../concrete_elastic_kernels/Chunking_elastic/CPU_code/HostChunker.h"
+#include "../concrete_elastic_kernels/Chunking_elastic/CPU_code/ScatterGatherChunker.h"
+#include "../concrete_elastic_kernels/Chunking_elastic/CPU_code/FixedBlockChunker.h"
+#include "../misc/WallClockTimer.h"
+#include "../misc/CorpusGenerator.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <boost/bind.hpp>
+#include <boost/function.hpp>
+
+/**
+ * All the dimensions that the benchmark sweeps through
+ */
+struct ChunkingBenchmarkConfig {
+	std::vector<int> threadCounts;
+	std::vector<int> divisors;
+	std::vector<int> windowSizes;
+	std::vector<int> laneCounts; // lanes per thread (see MultiLaneChunker.h)
+	std::vector<BreakpointPolicy> policies;
+	std::vector<std::string> inputs; // random, zeros, text, corpus or file:PATH
+	size_t inputSize; // size of the generated inputs in bytes
+	int trials;
+	int warmUpRuns;
+	bool numaPlacement; // pin the workers and place their segments on their nodes
+	size_t fragmentSize; // the size of the iovecs for the scatter-gather rows (0 for none)
+	std::vector<int> fixedBlockSizes; // the block sizes in KiB for the fixed-block rows
+};
+
+/**
+ * The measurements for a single configuration
+ */
+struct ChunkingBenchmarkResult {
+	double gbPerSecond;
+	double cyclesPerByte;
+	double scalingEfficiency;
+	size_t numChunks;
+};
+
+/**
+ * Splits a comma separated list of integers
+ *
+ * @param list the list as a string
+ * @return the numbers
+ */
+inline std::vector<int> parseBenchmarkIntList(const std::string& list) {
+	std::vector<int> result;
+	size_t from = 0;
+	while (from <= list.size()) {
+		size_t to = list.find(',', from);
+		if (to == std::string::npos) {
+			to = list.size();
+		}
+		if (to > from) {
+			result.push_back(atoi(list.substr(from, to - from).c_str()));
+		}
+		from = to + 1;
+	}
+	return result;
+}
+
+/**
+ * Splits a comma separated list of strings
+ *
+ * @param list the list as a string
+ * @return the items
+ */
+inline std::vector<std::string> parseBenchmarkStringList(const std::string& list) {
+	std::vector<std::string> result;
+	size_t from = 0;
+	while (from <= list.size()) {
+		size_t to = list.find(',', from);
+		if (to == std::string::npos) {
+			to = list.size();
+		}
+		if (to > from) {
+			result.push_back(list.substr(from, to - from));
+		}
+		from = to + 1;
+	}
+	return result;
+}
+
+/**
+ * Fills a buffer with pseudo random bytes. A xorshift generator is used since rand() is
+ * far too slow for hundreds of megabytes.
+ *
+ * @param buffer the buffer
+ * @param size the size of the buffer
+ */
+inline void fillWithRandomBytes(BYTE* buffer, size_t size) {
+	uint64_t state = 0x9E3779B97F4A7C15ULL;
+	for (size_t i = 0; i < size; ++i) {
+		state ^= state << 13;
+		state ^= state >> 7;
+		state ^= state << 17;
+		buffer[i] = (BYTE) (state >> 56);
+	}
+}
+
+/**
+ * Fills a buffer with text made out of a small vocabulary of words, separated by spaces,
+ * punctuation and new lines. This has the low entropy and the byte distribution of real text.
+ *
+ * @param buffer the buffer
+ * @param size the size of the buffer
+ */
+inline void fillWithText(BYTE* buffer, size_t size) {
+	static const char* words[] = { "the", "of", "and", "to", "in", "is", "that", "for", "it", "as", "was", "with", "be", "by", "on", "not",
+			"he", "this", "are", "or", "his", "from", "at", "which", "but", "have", "an", "had", "they", "you", "were", "their", "one", "all",
+			"we", "can", "her", "has", "there", "been", "if", "more", "when", "will", "would", "who", "so", "no", "kernel", "memory", "device",
+			"chunk", "fingerprint", "window", "scheduler", "occupancy", "stream", "buffer", "thread", "block" };
+	const size_t numWords = sizeof(words) / sizeof(words[0]);
+	uint64_t state = 0x2545F4914F6CDD1DULL;
+	size_t pos = 0;
+	int wordsInLine = 0;
+	while (pos < size) {
+		state ^= state << 13;
+		state ^= state >> 7;
+		state ^= state << 17;
+		const char* word = words[state % numWords];
+		for (const char* c = word; *c != 0 && pos < size; ++c) {
+			buffer[pos++] = (BYTE) *c;
+		}
+		if (pos < size) {
+			++wordsInLine;
+			if (wordsInLine > 12 && (state >> 32) % 4 == 0) {
+				buffer[pos++] = '.';
+				if (pos < size) {
+					buffer[pos++] = '\n';
+				}
+				wordsInLine = 0;
+			} else {
+				buffer[pos++] = ' ';
+			}
+		}
+	}
+}
+
+/**
+ * Creates the input for the benchmark
+ *
+ * @param input random, zeros, text, corpus or file:PATH
+ * @param size the size of the generated input (ignored for files)
+ * @param data the vector that gets the input
+ * @return false if the input could not be created
+ */
+inline bool createBenchmarkInput(const std::string& input, size_t size, std::vector<BYTE>& data) {
+	if (input.compare(0, 5, "file:") == 0) {
+		FILE* file = fopen(input.substr(5).c_str(), "rb");
+		if (file == NULL) {
+			fprintf(stderr, "Cannot open %s\n", input.substr(5).c_str());
+			return false;
+		}
+		fseek(file, 0, SEEK_END);
+		long fileSize = ftell(file);
+		fseek(file, 0, SEEK_SET);
+		data.resize(fileSize);
+		size_t read = (fileSize > 0) ? fread(&data[0], 1, fileSize, file) : 0;
+		fclose(file);
+		return read == (size_t) fileSize && fileSize > 0;
+	}
+
+	data.resize(size);
+	if (input == "random") {
+		fillWithRandomBytes(&data[0], size);
+	} else if (input == "zeros") {
+		memset(&data[0], 0, size);
+	} else if (input == "text") {
+		fillWithText(&data[0], size);
+	} else if (input == "corpus") {
+		CorpusGenerator generator(getDefaultCorpusConfig(1, size));
+		generator.generateBaseImage(&data[0]);
+	} else {
+		fprintf(stderr, "Unknown input type %s\n", input.c_str());
+		return false;
+	}
+	return true;
+}
+
+/**
+ * The body of a benchmark case: chunks the input once and fills the cuts
+ */
+typedef boost::function<void(std::vector<OFFSET_64>&)> ChunkingBenchmarkRun;
+
+/**
+ * Times a benchmark case. The body is run warmUpRuns times without measuring and then trials
+ * times. The median of the trials is reported.
+ *
+ * @param run the body of the case
+ * @param dataLen the length of the input
+ * @param trials the number of timed runs
+ * @param warmUpRuns the number of runs that are not timed
+ * @return the measurements (the scaling efficiency is filled in by the caller)
+ */
+inline ChunkingBenchmarkResult timeChunkingBenchmarkRuns(const ChunkingBenchmarkRun& run, OFFSET_64 dataLen, int trials, int warmUpRuns) {
+	std::vector<OFFSET_64> cuts;
+	for (int warmUp = 0; warmUp < warmUpRuns; ++warmUp) {
+		cuts.clear();
+		run(cuts);
+	}
+
+	std::vector<double> times;
+	std::vector<double> cycles;
+	WallClockTimer timer("chunkingBenchmark");
+	for (int trial = 0; trial < trials; ++trial) {
+		cuts.clear();
+		timer.start();
+		run(cuts);
+		times.push_back(timer.stop());
+		cycles.push_back((double) timer.getElapsedCycles());
+	}
+	std::sort(times.begin(), times.end());
+	std::sort(cycles.begin(), cycles.end());
+
+	ChunkingBenchmarkResult result;
+	result.gbPerSecond = ((double) dataLen / 1e9) / times[times.size() / 2];
+	result.cyclesPerByte = cycles[cycles.size() / 2] / (double) dataLen;
+	result.scalingEfficiency = 1.0;
+	result.numChunks = cuts.size();
+	return result;
+}
+
+/**
+ * Runs a single configuration of the benchmark, timed with timeChunkingBenchmarkRuns()
+ *
+ * @param data the input
+ * @param dataLen the length of the input
+ * @param rabin the Rabin data, initialized with the window size to be used
+ * @param ctx the chunking parameters
+ * @param policy the breakpoint policy
+ * @param threads the number of threads
+ * @param trials the number of timed runs
+ * @param warmUpRuns the number of runs that are not timed
+ * @param workerCpus if not NULL, the CPU every worker is pinned to
+ * @return the measurements (the scaling efficiency is filled in by the caller)
+ */
+inline ChunkingBenchmarkResult runChunkingBenchmarkCase(BYTE* data, OFFSET_64 dataLen, rabinData* rabin, const chunkingContext& ctx,
+		BreakpointPolicy policy, int threads, int trials, int warmUpRuns, const std::vector<int>* workerCpus = NULL) {
+	return timeChunkingBenchmarkRuns(boost::bind(&chunkDataOnHost, rabin, data, dataLen, boost::cref(ctx), policy, threads, _1, workerCpus), dataLen,
+			trials, warmUpRuns);
+}
+
+/**
+ * Runs a single configuration of the benchmark on the input cut into a list of iovecs, which is
+ * chunked by a single thread, timed with timeChunkingBenchmarkRuns()
+ *
+ * @param data the input
+ * @param dataLen the length of the input
+ * @param fragmentSize the size of every iovec (the last one can be shorter)
+ * @param rabin the Rabin data, initialized with the window size to be used
+ * @param ctx the chunking parameters
+ * @param policy the breakpoint policy
+ * @param trials the number of timed runs
+ * @param warmUpRuns the number of runs that are not timed
+ * @return the measurements
+ */
+inline ChunkingBenchmarkResult runScatterGatherBenchmarkCase(BYTE* data, OFFSET_64 dataLen, size_t fragmentSize, rabinData* rabin,
+		const chunkingContext& ctx, BreakpointPolicy policy, int trials, int warmUpRuns) {
+	std::vector<struct iovec> fragments;
+	for (OFFSET_64 offset = 0; offset < dataLen; offset += fragmentSize) {
+		struct iovec fragment;
+		fragment.iov_base = data + offset;
+		fragment.iov_len = std::min((OFFSET_64) fragmentSize, dataLen - offset);
+		fragments.push_back(fragment);
+	}
+	return timeChunkingBenchmarkRuns(
+			boost::bind(&chunkScatteredDataOnHost, rabin, &fragments[0], (int) fragments.size(), boost::cref(ctx), policy, _1), dataLen, trials,
+			warmUpRuns);
+}
+
+/**
+ * Runs a single configuration of the benchmark in fixed-size blocks, timed with
+ * timeChunkingBenchmarkRuns()
+ *
+ * @param data the input
+ * @param dataLen the length of the input
+ * @param blockSize the size of a block
+ * @param threads the number of threads
+ * @param trials the number of timed runs
+ * @param warmUpRuns the number of runs that are not timed
+ * @return the measurements (the scaling efficiency is filled in by the caller)
+ */
+inline ChunkingBenchmarkResult runFixedBlockBenchmarkCase(BYTE* data, OFFSET_64 dataLen, size_t blockSize, int threads, int trials,
+		int warmUpRuns) {
+	std::vector<word32> zeroBlocks;
+	return timeChunkingBenchmarkRuns(boost::bind(&chunkDataInFixedBlocks, data, dataLen, blockSize, threads, _1, boost::ref(zeroBlocks)), dataLen,
+			trials, warmUpRuns);
+}
+
+/**
+ * Parses the command line of the benchmark into a configuration
+ *
+ * @param argc number of arguments
+ * @param argv the arguments
+ * @param config the configuration to be filled
+ * @return false if an argument is not recognised
+ */
+inline bool parseChunkingBenchmarkArguments(int argc, char** argv, ChunkingBenchmarkConfig& config) {
+	config.threadCounts = parseBenchmarkIntList("1,2,4,8");
+	config.divisors = parseBenchmarkIntList("512");
+	config.windowSizes = parseBenchmarkIntList("48");
+	config.laneCounts.assign(1, getChunkingLanes());
+	config.policies.push_back(FREE_MODE);
+	config.policies.push_back(TTTD_MODE);
+	config.inputs = parseBenchmarkStringList("random,zeros,text,corpus");
+	config.inputSize = 256 * (1 << 20);
+	config.trials = 5;
+	config.warmUpRuns = 1;
+	config.numaPlacement = false;
+	config.fragmentSize = 0;
+
+	for (int i = 0; i < argc; ++i) {
+		std::string arg(argv[i]);
+		size_t eq = arg.find('=');
+		std::string key = arg.substr(0, eq);
+		std::string value = (eq == std::string::npos) ? "" : arg.substr(eq + 1);
+
+		if (key == "--threads") {
+			config.threadCounts = parseBenchmarkIntList(value);
+		} else if (key == "--divisors") {
+			config.divisors = parseBenchmarkIntList(value);
+		} else if (key == "--windows") {
+			config.windowSizes = parseBenchmarkIntList(value);
+		} else if (key == "--lanes") {
+			config.laneCounts = parseBenchmarkIntList(value);
+		} else if (key == "--inputs") {
+			config.inputs = parseBenchmarkStringList(value);
+		} else if (key == "--size-mb") {
+			config.inputSize = (size_t) atoi(value.c_str()) * (1 << 20);
+		} else if (key == "--trials") {
+			config.trials = atoi(value.c_str());
+		} else if (key == "--warmup") {
+			config.warmUpRuns = atoi(value.c_str());
+		} else if (key == "--fragment-kb") {
+			config.fragmentSize = (size_t) atoi(value.c_str()) << 10;
+		} else if (key == "--fixed-kb") {
+			config.fixedBlockSizes = parseBenchmarkIntList(value);
+		} else if (key == "--numa") {
+			config.numaPlacement = true;
+		} else if (key == "--policies") {
+			config.policies.clear();
+			std::vector<std::string> names = parseBenchmarkStringList(value);
+			for (size_t p = 0; p < names.size(); ++p) {
+				config.policies.push_back((names[p] == "tttd") ? TTTD_MODE : FREE_MODE);
+			}
+		} else {
+			fprintf(stderr, "Unknown argument %s\n", arg.c_str());
+			return false;
+		}
+	}
+
+	if (config.trials < 1) {
+		config.trials = 1;
+	}
+	for (size_t w = 0; w < config.windowSizes.size(); ++w) {
+		if (config.windowSizes[w] < 1 || config.windowSizes[w] > MAX_BUFFER_SIZE) {
+			fprintf(stderr, "Window sizes must be between 1 and %d\n", MAX_BUFFER_SIZE);
+			return false;
+		}
+	}
+	for (size_t t = 0; t < config.threadCounts.size(); ++t) {
+		if (config.threadCounts[t] < 1) {
+			fprintf(stderr, "Thread counts must be at least 1\n");
+			return false;
+		}
+	}
+	for (size_t l = 0; l < config.laneCounts.size(); ++l) {
+		int lanes = config.laneCounts[l];
+		if (lanes < 1 || lanes > MAX_CHUNKING_LANES || (lanes & (lanes - 1)) != 0) {
+			fprintf(stderr, "Lane counts must be powers of two up to %d\n", MAX_CHUNKING_LANES);
+			return false;
+		}
+	}
+	for (size_t b = 0; b < config.fixedBlockSizes.size(); ++b) {
+		if (config.fixedBlockSizes[b] < 1) {
+			fprintf(stderr, "Block sizes must be at least 1 KiB\n");
+			return false;
+		}
+	}
+	for (size_t d = 0; d < config.divisors.size(); ++d) {
+		if (config.divisors[d] < 2 || (config.divisors[d] & (config.divisors[d] - 1)) != 0) {
+			fprintf(stderr, "Divisors must be powers of two\n");
+			return false;
+		}
+	}
+	return !config.threadCounts.empty() && !config.laneCounts.empty();
+}
+
+/**
+ * Runs the whole sweep and prints a table with the results
+ *
+ * @param argc the number of arguments for the benchmark
+ * @param argv the arguments
+ * @return 0 on success
+ */
+inline int runChunkingBenchmark(int argc, char** argv) {
+	ChunkingBenchmarkConfig config;
+	if (!parseChunkingBenchmarkArguments(argc, argv, config)) {
+		return 1;
+	}
+	std::sort(config.threadCounts.begin(), config.threadCounts.end());
+
+	std::vector<NumaNode> topology = getNumaTopology();
+	if (config.numaPlacement) {
+		for (size_t n = 0; n < topology.size(); ++n) {
+			printf("NUMA node %d: %lu CPUs\n", topology[n].id, (unsigned long) topology[n].cpus.size());
+		}
+	}
+
+	printf("%-24s %-6s %4s %7s %5s %4s %5s %10s %10s %8s %10s\n", "input", "policy", "win", "D", "lanes", "thr", "nodes", "GB/s", "cycles/B",
+			"eff", "chunks");
+	ChunkingProfile profile = getActiveChunkingProfile();
+	for (size_t in = 0; in < config.inputs.size(); ++in) {
+		std::vector<BYTE> data;
+		if (!createBenchmarkInput(config.inputs[in], config.inputSize, data)) {
+			continue;
+		}
+		for (size_t w = 0; w < config.windowSizes.size(); ++w) {
+			rabinData rabin;
+			initWindowOfSize(&rabin, IRREDUCIBLE_POLY, config.windowSizes[w]);
+
+			for (size_t d = 0; d < config.divisors.size(); ++d) {
+				chunkingContext ctx;
+				ctx.D = config.divisors[d];
+				ctx.Ddash = config.divisors[d] / 2;
+				ctx.minThr = config.divisors[d] / 2;
+				ctx.maxThr = config.divisors[d] * 4;
+
+				for (size_t p = 0; p < config.policies.size(); ++p) {
+					for (size_t l = 0; l < config.laneCounts.size(); ++l) {
+						ChunkingProfile withLanes = profile;
+						withLanes.lanes = config.laneCounts[l];
+						setActiveChunkingProfile(withLanes);
+						double baseThroughput = 0;
+						for (size_t t = 0; t < config.threadCounts.size(); ++t) {
+							int threads = config.threadCounts[t];
+							ChunkingBenchmarkResult result;
+							int nodesUsed = 1;
+
+							if (config.numaPlacement) {
+								// lay the input out so that every worker reads its segment from its own node
+								std::vector<int> cpus = getWorkerCpus(topology, threads);
+								nodesUsed = countNodesUsed(topology, cpus);
+								BYTE* placed = allocateUntouchedBuffer(data.size());
+								if (placed == NULL) {
+									fprintf(stderr, "Cannot allocate the NUMA buffer\n");
+									setActiveChunkingProfile(profile);
+									return 1;
+								}
+								firstTouchSegments(placed, &data[0], data.size(), getAlignedWorkPerThread(data.size(), threads), cpus);
+								result = runChunkingBenchmarkCase(placed, data.size(), &rabin, ctx, config.policies[p], threads, config.trials,
+										config.warmUpRuns, &cpus);
+								releaseUntouchedBuffer(placed, data.size());
+							} else {
+								result = runChunkingBenchmarkCase(&data[0], data.size(), &rabin, ctx, config.policies[p], threads, config.trials,
+										config.warmUpRuns);
+							}
+							if (t == 0) {
+								baseThroughput = result.gbPerSecond / config.threadCounts[0];
+							}
+							result.scalingEfficiency = result.gbPerSecond / (baseThroughput * threads);
+
+							printf("%-24.24s %-6s %4d %7d %5d %4d %5d %10.3f %10.2f %8.2f %10lu\n", config.inputs[in].c_str(),
+									(config.policies[p] == FREE_MODE) ? "free" : "tttd", config.windowSizes[w], ctx.D, config.laneCounts[l], threads,
+									nodesUsed, result.gbPerSecond, result.cyclesPerByte, result.scalingEfficiency, (unsigned long) result.numChunks);
+						}
+						if (config.fragmentSize > 0) {
+							ChunkingBenchmarkResult result = runScatterGatherBenchmarkCase(&data[0], data.size(), config.fragmentSize, &rabin, ctx,
+									config.policies[p], config.trials, config.warmUpRuns);
+							printf("%-24.24s %-6s %4d %7d %5d %4s %5d %10.3f %10.2f %8.2f %10lu\n", config.inputs[in].c_str(),
+									(config.policies[p] == FREE_MODE) ? "free" : "tttd", config.windowSizes[w], ctx.D, config.laneCounts[l], "iov", 1,
+									result.gbPerSecond, result.cyclesPerByte, result.scalingEfficiency, (unsigned long) result.numChunks);
+						}
+					}
+				}
+			}
+		}
+		for (size_t b = 0; b < config.fixedBlockSizes.size(); ++b) {
+			size_t blockSize = (size_t) config.fixedBlockSizes[b] << 10;
+			double baseThroughput = 0;
+			for (size_t t = 0; t < config.threadCounts.size(); ++t) {
+				int threads = config.threadCounts[t];
+				ChunkingBenchmarkResult result = runFixedBlockBenchmarkCase(&data[0], data.size(), blockSize, threads, config.trials,
+						config.warmUpRuns);
+				if (t == 0) {
+					baseThroughput = result.gbPerSecond / config.threadCounts[0];
+				}
+				result.scalingEfficiency = result.gbPerSecond / (baseThroughput * threads);
+				printf("%-24.24s %-6s %4s %7lu %5s %4d %5d %10.3f %10.2f %8.2f %10lu\n", config.inputs[in].c_str(), "fixed", "-",
+						(unsigned long) blockSize, "-", threads, 1, result.gbPerSecond, result.cyclesPerByte, result.scalingEfficiency,
+						(unsigned long) result.numChunks);
+			}
+		}
+	}
+	setActiveChunkingProfile(profile);
+	return 0;
+}
+
+#endif /* CHUNKINGBENCHMARK_H_ */
@@ -0,0 +1,235 @@
+/**
+ * ChunkingTuner.h
+ *
+ * Measures how a chunking job should be split between threads on this machine and saves the
+ * result as the chunking profile (see ChunkingProfile.h), which getHostChunkingThreads() applies
+ * from then on. Three things are measured on generated corpus data:
+ *
+ * - the number of lanes: one thread chunks the input with 1, 2, 4, 8 and 16 lanes (see
+ *   MultiLaneChunker.h) and the fastest count is kept. It is measured first, since it changes how
+ *   fast a single thread is;
+ * - the number of threads: the whole input is chunked with 1, 2, 4, ... threads and the smallest
+ *   count that gets within 5% of the best throughput is kept, so adding threads that only contend
+ *   for memory bandwidth is avoided;
+ * - the minimum work per thread: for growing segment sizes, two segments are chunked by one thread
+ *   and then by two threads. The smallest segment for which the second thread gives a speed up of
+ *   at least 1.5 is kept. Below it, starting a thread and warming up the window at the segment
+ *   boundary cost more than the thread saves.
+ *
+ * Only the parallel part of chunking (finding the breakpoints) is timed, since extracting the cuts
+ * does not depend on the split. The block size is not measured, since it needs the device; it is
+ * kept as it is in the current profile.
+ *
+ * Usage: --tune-chunking [--size-mb=256] [--max-threads=N] [--trials=3] [--profile=PATH] [--dry-run]
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Zahari Dichev <zaharidichev@gmail.com>
+ */
+
+#ifndef CHUNKINGTUNER_H_
+#define CHUNKINGTUNER_H_
+
+#include "ChunkingBenchmark.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+#define TUNER_D 4096 // the divisors the deduplication uses, both bit field arrays are produced
+#define TUNER_DDASH 2048
+#define TUNER_MIN_SEGMENT 4096
+#define TUNER_MAX_SEGMENT (16 << 20)
+#define TUNER_REQUIRED_SPEEDUP 1.5
+#define TUNER_THREAD_TOLERANCE 0.95
+#define TUNER_LANES_INPUT (64 << 20)
+
+/**
+ * Times finding the breakpoints of a buffer and returns the median of a number of trials
+ *
+ * @param rabin the Rabin data
+ * @param data the buffer
+ * @param dataLen the length of the buffer
+ * @param threads the number of threads
+ * @param trials the number of timed runs (one more run warms up)
+ * @return the median time in seconds
+ */
+inline double timeBreakpointSearch(rabinData* rabin, BYTE* data, OFFSET_64 dataLen, int threads, int trials) {
+	size_t numWords = getSizeOfBitArray(dataLen);
+	std::vector<word32> breakpoints(numWords, 0);
+	std::vector<word32> backupBreakpoints(numWords, 0);
+	std::vector<double> times;
+	WallClockTimer timer("chunkingTuner");
+	for (int trial = 0; trial <= trials; ++trial) {
+		timer.start();
+		findBreakPointsOnHost(rabin, data, dataLen, &breakpoints[0], threads, TUNER_D, &backupBreakpoints[0], TUNER_DDASH);
+		double time = timer.stop();
+		if (trial > 0) {
+			times.push_back(time);
+		}
+	}
+	std::sort(times.begin(), times.end());
+	return times[times.size() / 2];
+}
+
+/**
+ * Finds the number of lanes with which a single thread chunks the fastest. The active profile is
+ * left with the lanes that were tried last.
+ *
+ * @param rabin the Rabin data
+ * @param data the input
+ * @param dataLen the length of the input
+ * @param trials the number of timed runs per count
+ * @return the number of lanes
+ */
+inline int tuneLanes(rabinData* rabin, BYTE* data, OFFSET_64 dataLen, int trials) {
+	ChunkingProfile profile = getActiveChunkingProfile();
+	int bestLanes = 1;
+	double best = 0;
+	for (int lanes = 1; lanes <= MAX_CHUNKING_LANES; lanes *= 2) {
+		profile.lanes = lanes;
+		setActiveChunkingProfile(profile);
+		double throughput = dataLen / timeBreakpointSearch(rabin, data, dataLen, 1, trials) / 1e9;
+		printf("  %4d lanes %10.3f GB/s\n", lanes, throughput);
+		if (throughput > best) {
+			best = throughput;
+			bestLanes = lanes;
+		}
+	}
+	return bestLanes;
+}
+
+/**
+ * Finds the number of threads beyond which chunking does not get meaningfully faster
+ *
+ * @param rabin the Rabin data
+ * @param data the input
+ * @param dataLen the length of the input
+ * @param maxThreads the largest count that is tried
+ * @param trials the number of timed runs per count
+ * @return the thread count
+ */
+inline int tuneMaxThreads(rabinData* rabin, BYTE* data, OFFSET_64 dataLen, int maxThreads, int trials) {
+	std::vector<int> counts;
+	for (int threads = 1; threads < maxThreads; threads *= 2) {
+		counts.push_back(threads);
+	}
+	counts.push_back(maxThreads);
+
+	std::vector<double> throughput(counts.size());
+	double best = 0;
+	for (size_t c = 0; c < counts.size(); ++c) {
+		throughput[c] = dataLen / timeBreakpointSearch(rabin, data, dataLen, counts[c], trials) / 1e9;
+		best = std::max(best, throughput[c]);
+		printf("  %4d threads %10.3f GB/s\n", counts[c], throughput[c]);
+	}
+	for (size_t c = 0; c < counts.size(); ++c) {
+		if (throughput[c] >= TUNER_THREAD_TOLERANCE * best) {
+			return counts[c];
+		}
+	}
+	return maxThreads;
+}
+
+/**
+ * Finds the smallest segment for which a thread of its own pays off
+ *
+ * @param rabin the Rabin data
+ * @param data the input (at least twice TUNER_MAX_SEGMENT bytes, or as much as there is)
+ * @param dataLen the length of the input
+ * @param trials the number of timed runs per size
+ * @return the minimum work per thread in bytes
+ */
+inline size_t tuneMinWorkPerThread(rabinData* rabin, BYTE* data, OFFSET_64 dataLen, int trials) {
+	size_t segment = TUNER_MIN_SEGMENT;
+	for (; segment <= TUNER_MAX_SEGMENT && 2 * (OFFSET_64) segment <= dataLen; segment *= 2) {
+		// small sizes are repeated, so that every measurement takes a while
+		int repeats = std::max(trials, (int) ((64 << 20) / (2 * segment)));
+		double single = timeBreakpointSearch(rabin, data, 2 * segment, 1, repeats);
+		double split = timeBreakpointSearch(rabin, data, 2 * segment, 2, repeats);
+		double speedUp = single / split;
+		printf("  %10lu bytes per thread: speed up %.2f\n", (unsigned long) segment, speedUp);
+		if (speedUp >= TUNER_REQUIRED_SPEEDUP) {
+			return segment;
+		}
+	}
+	return std::min(segment, (size_t) TUNER_MAX_SEGMENT);
+}
+
+/**
+ * Command line front end of the tuner
+ *
+ * @param argc the number of arguments
+ * @param argv the arguments
+ * @return 0 on success
+ */
+inline int runChunkingTuner(int argc, char** argv) {
+	size_t inputSize = 256 << 20;
+	int maxThreads = (int) boost::thread::hardware_concurrency();
+	int trials = 3;
+	std::string profilePath = getChunkingProfilePath();
+	bool dryRun = false;
+
+	for (int i = 0; i < argc; ++i) {
+		std::string arg(argv[i]);
+		if (arg.compare(0, 10, "--size-mb=") == 0) {
+			inputSize = (size_t) atoi(arg.c_str() + 10) << 20;
+		} else if (arg.compare(0, 14, "--max-threads=") == 0) {
+			maxThreads = atoi(arg.c_str() + 14);
+		} else if (arg.compare(0, 9, "--trials=") == 0) {
+			trials = atoi(arg.c_str() + 9);
+		} else if (arg.compare(0, 10, "--profile=") == 0) {
+			profilePath = arg.substr(10);
+		} else if (arg == "--dry-run") {
+			dryRun = true;
+		} else {
+			fprintf(stderr, "Usage: --tune-chunking [--size-mb=256] [--max-threads=N] [--trials=3] [--profile=PATH] [--dry-run]\n");
+			return 1;
+		}
+	}
+	if (maxThreads < 1) {
+		maxThreads = 1;
+	}
+	if (trials < 1) {
+		trials = 1;
+	}
+
+	std::vector<BYTE> data;
+	if (!createBenchmarkInput("corpus", std::max(inputSize, (size_t) 2 * TUNER_MAX_SEGMENT), data)) {
+		return 1;
+	}
+	rabinData rabin;
+	initWindow(&rabin, IRREDUCIBLE_POLY);
+
+	ChunkingProfile profile = getActiveChunkingProfile();
+	printf("lanes on %lu MiB:\n", (unsigned long) (std::min(inputSize, (size_t) TUNER_LANES_INPUT) >> 20));
+	profile.lanes = tuneLanes(&rabin, &data[0], std::min(inputSize, (size_t) TUNER_LANES_INPUT), trials);
+	setActiveChunkingProfile(profile);
+	printf("threads on %lu MiB:\n", (unsigned long) (inputSize >> 20));
+	profile.maxThreads = tuneMaxThreads(&rabin, &data[0], std::min((size_t) data.size(), inputSize), maxThreads, trials);
+	if (profile.maxThreads > 1) {
+		printf("segment sizes:\n");
+		profile.minWorkPerThread = tuneMinWorkPerThread(&rabin, &data[0], data.size(), trials);
+	}
+	profile.cpus = getDefaultChunkingProfile().cpus;
+	profile.tuned = true;
+	setActiveChunkingProfile(profile);
+
+	printf("min work per thread %lu bytes, max threads %d, %d lanes\n", (unsigned long) profile.minWorkPerThread, profile.maxThreads,
+			profile.lanes);
+	const size_t sizes[] = { 64 << 10, 1 << 20, 16 << 20, 256 << 20, (size_t) 4 << 30 };
+	for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); ++s) {
+		printf("  %12lu bytes -> %d threads\n", (unsigned long) sizes[s], getHostChunkingThreads(sizes[s], profile.cpus));
+	}
+
+	if (!dryRun) {
+		if (!saveChunkingProfile(profilePath, profile)) {
+			fprintf(stderr, "Cannot write %s\n", profilePath.c_str());
+			return 1;
+		}
+		printf("profile written to %s\n", profilePath.c_str());
+	}
+	return 0;
+}
+
+#endif /* CHUNKINGTUNER_H_ */
@@ -0,0 +1,177 @@
+/**
+ * LargeOffsetCheck.h
+ *
+ * Checks that the host chunking path gets the same breakpoints past 2 GiB, 4 GiB and 8 GiB as a
+ * serial run does. The input is a sparse buffer of the requested size (by default a little over
+ * 8 GiB) that is mostly pages that were never touched, which read as zeros and take no memory, with
+ * islands of random bytes spread over it, one on each of the 2^31, 2^32 and 2^33 offsets and one on
+ * the start of the segment of every worker. The breakpoints of the data are found once with a single
+ * thread in a single lane, and once with the threads and lanes of the check, and the cuts that the
+ * free mode and TTTD select from them are compared.
+ *
+ * Only one set of bit field arrays (an eighth of the input for each divisor) is kept at a time.
+ *
+ * Usage: --check-large-offsets [--size-mb=8224] [--threads=8] [--lanes=4] [--divisor=512]
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Zahari Dichev <zaharidichev@gmail.com>
+ */
+
+#ifndef LARGEOFFSETCHECK_H_
+#define LARGEOFFSETCHECK_H_
+
+#include "ChunkingBenchmark.h"
+#include "../misc/NumaPlacement.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+
+#define LARGE_OFFSET_ISLAND_SIZE (1 << 20)
+#define LARGE_OFFSET_ISLAND_STRIDE ((OFFSET_64) 256 << 20)
+
+/**
+ * Writes an island of random bytes centred on an offset, clipped to the buffer
+ *
+ * @param data the buffer
+ * @param dataLen the length of the buffer
+ * @param centre the offset the island is centred on
+ */
+inline void addRandomIsland(BYTE* data, OFFSET_64 dataLen, OFFSET_64 centre) {
+	OFFSET_64 start = centre - LARGE_OFFSET_ISLAND_SIZE / 2;
+	start = (start < 0) ? 0 : start;
+	OFFSET_64 end = std::min(start + LARGE_OFFSET_ISLAND_SIZE, dataLen);
+	if (end > start) {
+		fillWithRandomBytes(data + start, end - start);
+	}
+}
+
+/**
+ * Chunks the data with both policies out of a single pass
+ *
+ * @param rabin the Rabin data
+ * @param data the data
+ * @param dataLen the length of the data
+ * @param ctx the chunking parameters
+ * @param threads the number of threads
+ * @param freeCuts receives the cuts of the free mode
+ * @param tttdCuts receives the cuts of TTTD
+ */
+inline void chunkWithBothPolicies(rabinData* rabin, BYTE* data, OFFSET_64 dataLen, const chunkingContext& ctx, int threads,
+		std::vector<OFFSET_64>& freeCuts, std::vector<OFFSET_64>& tttdCuts) {
+	size_t numWords = getSizeOfBitArray(dataLen);
+	std::vector<word32> breakpoints(numWords, 0);
+	std::vector<word32> backupBreakpoints(numWords, 0);
+	findBreakPointsOnHost(rabin, data, dataLen, &breakpoints[0], threads, ctx.D, &backupBreakpoints[0], ctx.Ddash);
+	extractCutsFreeMode(&breakpoints[0], dataLen, freeCuts);
+	extractCutsTTTD(&breakpoints[0], &backupBreakpoints[0], dataLen, ctx.minThr, ctx.maxThr, tttdCuts);
+}
+
+/**
+ * Compares the cuts of a run with those of the serial run and prints the first difference
+ *
+ * @param name the name of the policy
+ * @param serial the cuts of the serial run
+ * @param parallel the cuts of the other run
+ * @return true if they are the same
+ */
+inline bool compareLargeOffsetCuts(const char* name, const std::vector<OFFSET_64>& serial, const std::vector<OFFSET_64>& parallel) {
+	size_t beyond4GiB = 0;
+	for (size_t i = 0; i < serial.size(); ++i) {
+		if (serial[i] > ((OFFSET_64) 1 << 32)) {
+			++beyond4GiB;
+		}
+	}
+	for (size_t i = 0; i < std::min(serial.size(), parallel.size()); ++i) {
+		if (serial[i] != parallel[i]) {
+			printf("%-5s differs at cut %lu: %lld serially, %lld in parallel\n", name, (unsigned long) i, (long long) serial[i],
+					(long long) parallel[i]);
+			return false;
+		}
+	}
+	if (serial.size() != parallel.size()) {
+		printf("%-5s differs: %lu cuts serially, %lu in parallel\n", name, (unsigned long) serial.size(), (unsigned long) parallel.size());
+		return false;
+	}
+	printf("%-5s %10lu cuts (%lu past 4 GiB), the same\n", name, (unsigned long) serial.size(), (unsigned long) beyond4GiB);
+	return true;
+}
+
+/**
+ * Runs the check
+ *
+ * @param argc the number of arguments for the check
+ * @param argv the arguments
+ * @return 0 if the breakpoints are the same, 1 otherwise
+ */
+inline int runLargeOffsetCheck(int argc, char** argv) {
+	OFFSET_64 dataLen = (OFFSET_64) 8224 << 20;
+	int threads = 8;
+	int lanes = 4;
+	int divisor = 512;
+	for (int i = 0; i < argc; ++i) {
+		std::string arg(argv[i]);
+		if (arg.compare(0, 10, "--size-mb=") == 0) {
+			dataLen = (OFFSET_64) atoll(arg.substr(10).c_str()) << 20;
+		} else if (arg.compare(0, 10, "--threads=") == 0) {
+			threads = atoi(arg.substr(10).c_str());
+		} else if (arg.compare(0, 8, "--lanes=") == 0) {
+			lanes = atoi(arg.substr(8).c_str());
+		} else if (arg.compare(0, 10, "--divisor=") == 0) {
+			divisor = atoi(arg.substr(10).c_str());
+		} else {
+			fprintf(stderr, "Usage: --check-large-offsets [--size-mb=8224] [--threads=8] [--lanes=4] [--divisor=512]\n");
+			return 1;
+		}
+	}
+	if (dataLen <= 0 || threads < 1 || lanes < 1 || divisor < 2 || (divisor & (divisor - 1)) != 0) {
+		fprintf(stderr, "The size and the threads must be positive, and the divisor a power of two\n");
+		return 1;
+	}
+
+	BYTE* data = allocateUntouchedBuffer(dataLen);
+	if (data == NULL) {
+		fprintf(stderr, "Cannot map a sparse buffer of %lld bytes\n", (long long) dataLen);
+		return 1;
+	}
+	for (OFFSET_64 offset = 0; offset < dataLen; offset += LARGE_OFFSET_ISLAND_STRIDE) {
+		addRandomIsland(data, dataLen, offset);
+	}
+	for (int shift = 31; shift <= 33; ++shift) {
+		addRandomIsland(data, dataLen, (OFFSET_64) 1 << shift);
+	}
+	OFFSET_64 workPerThread = getAlignedWorkPerThread(dataLen, threads);
+	for (int thrID = 1; thrID < threads; ++thrID) {
+		addRandomIsland(data, dataLen, (OFFSET_64) thrID * workPerThread);
+	}
+	addRandomIsland(data, dataLen, dataLen - LARGE_OFFSET_ISLAND_SIZE / 2);
+
+	rabinData rabin;
+	initWindowOfSize(&rabin, IRREDUCIBLE_POLY, 48);
+	chunkingContext ctx;
+	ctx.D = divisor;
+	ctx.Ddash = divisor / 2;
+	ctx.minThr = divisor / 2;
+	ctx.maxThr = divisor * 4;
+
+	ChunkingProfile profile = getActiveChunkingProfile();
+	ChunkingProfile serialProfile = profile;
+	serialProfile.lanes = 1;
+	ChunkingProfile parallelProfile = profile;
+	parallelProfile.lanes = lanes;
+
+	printf("%lld bytes, %d threads, %d lanes, D = %d\n", (long long) dataLen, threads, lanes, divisor);
+	std::vector<OFFSET_64> serialFree, serialTTTD, parallelFree, parallelTTTD;
+	setActiveChunkingProfile(serialProfile);
+	chunkWithBothPolicies(&rabin, data, dataLen, ctx, 1, serialFree, serialTTTD);
+	setActiveChunkingProfile(parallelProfile);
+	chunkWithBothPolicies(&rabin, data, dataLen, ctx, threads, parallelFree, parallelTTTD);
+	setActiveChunkingProfile(profile);
+	releaseUntouchedBuffer(data, dataLen);
+
+	bool same = compareLargeOffsetCuts("free", serialFree, parallelFree);
+	same = compareLargeOffsetCuts("tttd", serialTTTD, parallelTTTD) && same;
+	return same ? 0 : 1;
+}
+
+#endif /* LARGEOFFSETCHECK_H_ */
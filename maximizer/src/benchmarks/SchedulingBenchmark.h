@@ -0,0 +1,199 @@
+/**
+ * SchedulingBenchmark.h
+ *
+ * A benchmark for the scheduling path. A random workload of elastic kernels of all types is
+ * scheduled with every policy, and the time getGPUOccupancyForPolicy() takes is reported along
+ * with the number of times the runtime was asked for the device properties or the attributes of
+ * a kernel function. Every policy is timed twice: once with the answers of the runtime cached
+ * (see setDeviceQueryCaching()), and once asking the runtime every time, which is how the
+ * occupancy path used to work. The ratio of the two is the speedup of the cache.
+ *
+ * With a device profile (--device or ELASTIC_DEVICE_PROFILE) the runtime is never asked, so only
+ * the cached times are reported; those still show how the scheduling scales with the workload.
+ *
+ * Usage: --scheduling-benchmark [--kernels=100,1000,10000] [--device=NAME|PATH]
+ *                               [--policies=native,fair,fair-max-occ,min-queues,min-queues-max-occ,max-concurrency]
+ *                               [--trials=3] [--seed=1]
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Zahari Dichev <zaharidichev@gmail.com>
+ */
+
+#ifndef SCHEDULINGBENCHMARK_H_
+#define SCHEDULINGBENCHMARK_H_
+
+#include "../elastic_launcher/KernelScheduler.h"
+#include "../elastic_launcher/ElasticKernelMaker.h"
+#include "../occupancy_tools/DeviceProfiles.h"
+#include "../misc/WallClockTimer.h"
+#include "ChunkingBenchmark.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+#define NUM_SCHEDULING_POLICIES 6
+
+static const char* SCHEDULING_POLICY_NAMES[NUM_SCHEDULING_POLICIES] = { "native", "fair", "fair-max-occ", "min-queues",
+		"min-queues-max-occ", "max-concurrency" };
+
+/**
+ * The timings of a policy for a workload
+ */
+struct SchedulingBenchmarkResult {
+	double cachedMs; // the median over the trials
+	double uncachedMs;
+	size_t cachedQueries; // runtime queries of a single trial
+	size_t uncachedQueries;
+	GPUUtilization utilization;
+};
+
+/**
+ * Adds a random workload to a scheduler. The same seed gives the same workload.
+ *
+ * @param scheduler the scheduler
+ * @param numKernels the number of kernels
+ * @param seed the seed of the generator
+ */
+inline void addRandomWorkloadToScheduler(KernelScheduler& scheduler, int numKernels, unsigned int seed) {
+	srand(seed);
+	for (int i = 0; i < numKernels; ++i) {
+		KernelType type = (KernelType) (rand() % (FIXED_BLOCK_CHUNKING + 1));
+		size_t threadsPerBlock = 32 * (1 + rand() % 16);
+		size_t blocksPerGrid = (size_t) 1 << (rand() % 10);
+		size_t problemSize;
+		if (type == CHUNKING || type == FIXED_BLOCK_CHUNKING) {
+			problemSize = (size_t) 1 << (25 + rand() % 3); // 32 to 128 MiB of data
+		} else if (type == MATRIX_MULT) {
+			problemSize = 512 * (1 + rand() % 7); // the width of the matrices
+		} else if (type == SCALAR_PRODUCT) {
+			problemSize = 2048 * (1 + rand() % 16);
+		} else {
+			problemSize = 1000000 * (1 + rand() % 40);
+		}
+		char name[32];
+		snprintf(name, sizeof(name), "KERNEL__%d", i);
+		scheduler.addKernel(makeElasticKernel(threadsPerBlock, blocksPerGrid, type, name, problemSize));
+	}
+}
+
+/**
+ * Schedules a random workload with a policy a number of times
+ *
+ * @param policy the policy
+ * @param numKernels the number of kernels in the workload
+ * @param seed the seed of the workload
+ * @param trials the number of times
+ * @param queries receives the runtime queries of the last trial
+ * @param utilization receives the utilization the policy gives
+ * @return the median time in milliseconds
+ */
+inline double timeSchedulingPolicy(OptimizationPolicy policy, int numKernels, unsigned int seed, int trials, size_t& queries,
+		GPUUtilization& utilization) {
+	std::vector<double> times;
+	for (int t = 0; t < std::max(trials, 1); ++t) {
+		KernelScheduler scheduler;
+		addRandomWorkloadToScheduler(scheduler, numKernels, seed);
+		size_t queriesBefore = getNumRuntimeQueries();
+		WallClockTimer timer("scheduling");
+		timer.start();
+		utilization = scheduler.getGPUOccupancyForPolicy(policy);
+		times.push_back(timer.stop() * 1000.0);
+		queries = getNumRuntimeQueries() - queriesBefore;
+	}
+	std::sort(times.begin(), times.end());
+	return times[times.size() / 2];
+}
+
+/**
+ * Runs the benchmark with the arguments that follow --scheduling-benchmark
+ *
+ * @param argc the number of arguments
+ * @param argv the arguments
+ * @return 0 on success
+ */
+inline int runSchedulingBenchmark(int argc, char** argv) {
+	std::vector<int> kernelCounts;
+	kernelCounts.push_back(100);
+	kernelCounts.push_back(1000);
+	kernelCounts.push_back(10000);
+	std::vector<int> policies;
+	for (int p = 0; p < NUM_SCHEDULING_POLICIES; ++p) {
+		policies.push_back(p);
+	}
+	std::string device;
+	int trials = 3;
+	unsigned int seed = 1;
+
+	for (int i = 0; i < argc; ++i) {
+		std::string arg(argv[i]);
+		if (arg.compare(0, 10, "--kernels=") == 0) {
+			kernelCounts = parseBenchmarkIntList(arg.substr(10));
+		} else if (arg.compare(0, 9, "--device=") == 0) {
+			device = arg.substr(9);
+		} else if (arg.compare(0, 11, "--policies=") == 0) {
+			std::vector<std::string> names = parseBenchmarkStringList(arg.substr(11));
+			policies.clear();
+			for (size_t n = 0; n < names.size(); ++n) {
+				int p = 0;
+				while (p < NUM_SCHEDULING_POLICIES && names[n] != SCHEDULING_POLICY_NAMES[p]) {
+					++p;
+				}
+				if (p == NUM_SCHEDULING_POLICIES) {
+					fprintf(stderr, "Unknown policy %s\n", names[n].c_str());
+					return 1;
+				}
+				policies.push_back(p);
+			}
+		} else if (arg.compare(0, 9, "--trials=") == 0) {
+			trials = atoi(arg.substr(9).c_str());
+		} else if (arg.compare(0, 7, "--seed=") == 0) {
+			seed = (unsigned int) strtoul(arg.substr(7).c_str(), NULL, 10);
+		} else {
+			fprintf(stderr, "Usage: --scheduling-benchmark [--kernels=100,1000,10000] [--device=NAME|PATH]\n"
+					"                              [--policies=native,fair,fair-max-occ,min-queues,min-queues-max-occ,max-concurrency]\n"
+					"                              [--trials=3] [--seed=1]\n");
+			return 1;
+		}
+	}
+	if (!device.empty() && !setActiveDeviceProfile(device)) {
+		fprintf(stderr, "No device profile or valid profile file %s\n", device.c_str());
+		return 1;
+	}
+	bool offline = isOfflineDeviceProfile();
+	const cudaDeviceProp& props = getGPUConfiguration();
+	printf("Device: %s (%d SMs)%s\n", props.name, props.multiProcessorCount,
+			offline ? " [profile, the runtime is not asked so only the cached path is timed]" : "");
+	printf("%8s %-20s %12s %10s %12s %10s %8s %8s %8s\n", "kernels", "policy", "cached ms", "queries", "uncached ms", "queries", "speedup",
+			"compute", "storage");
+
+	for (size_t k = 0; k < kernelCounts.size(); ++k) {
+		for (size_t p = 0; p < policies.size(); ++p) {
+			OptimizationPolicy policy = (OptimizationPolicy) policies[p];
+			SchedulingBenchmarkResult result;
+			result.uncachedMs = 0;
+			result.uncachedQueries = 0;
+			if (!offline) {
+				setDeviceQueryCaching(false);
+				result.uncachedMs = timeSchedulingPolicy(policy, kernelCounts[k], seed, trials, result.uncachedQueries, result.utilization);
+			}
+			setDeviceQueryCaching(true);
+			result.cachedMs = timeSchedulingPolicy(policy, kernelCounts[k], seed, trials, result.cachedQueries, result.utilization);
+
+			if (offline) {
+				printf("%8d %-20s %12.3f %10lu %12s %10s %8s %8.4f %8.4f\n", kernelCounts[k], SCHEDULING_POLICY_NAMES[policies[p]], result.cachedMs,
+						(unsigned long) result.cachedQueries, "-", "-", "-", result.utilization.averageComputeOccupancy,
+						result.utilization.averageStorageOccupancy);
+			} else {
+				printf("%8d %-20s %12.3f %10lu %12.3f %10lu %7.1fx %8.4f %8.4f\n", kernelCounts[k], SCHEDULING_POLICY_NAMES[policies[p]],
+						result.cachedMs, (unsigned long) result.cachedQueries, result.uncachedMs, (unsigned long) result.uncachedQueries,
+						result.uncachedMs / std::max(result.cachedMs, 0.001), result.utilization.averageComputeOccupancy,
+						result.utilization.averageStorageOccupancy);
+			}
+		}
+	}
+	return 0;
+}
+
+#endif /* SCHEDULINGBENCHMARK_H_ */
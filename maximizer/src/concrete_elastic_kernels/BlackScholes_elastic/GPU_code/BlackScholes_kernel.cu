@@ -10,6 +10,7 @@
  */
 #include "Kernel_Starter_BS.h"
 #include <helper_cuda.h>        // helper functions CUDA error checking and initialization
+#include "../../../occupancy_tools/DeviceProfiles.h"
 
 ///////////////////////////////////////////////////////////////////////////////
 // Polynomial approximation of cumulative normal distribution function
@@ -83,10 +84,12 @@ void startBSKernel(size_t threads, size_t blocks, float* callResults, float* put
 	getLastCudaError("BlackScholesGPU() execution failed\n");
 
 }
-cudaFuncAttributes getBSKernelProperties() {
-
+static cudaFuncAttributes queryBSKernelProperties() {
 	cudaFuncAttributes attributes;
 	cudaFuncGetAttributes(&attributes, BlackScholesGPU);
 	return attributes;
+}
 
+cudaFuncAttributes getBSKernelProperties() {
+	return getKernelAttributes("BlackScholesGPU", queryBSKernelProperties);
 }
@@ -17,8 +17,11 @@ ElasticBSPricer::ElasticBSPricer() :
 ElasticBSPricer::ElasticBSPricer(LaunchParameters &launchConfig, std::string name, int numOptions) :
 		AbstractElasticKernel(launchConfig, name) {
 	this->numOptions = numOptions;
+	this->problemSize = numOptions; // the threads stride over the options
 	this->optionSize = sizeof(float) * numOptions;
 	this->memConsumption = 5 * this->optionSize;
+	this->bytesMoved = 5 * (size_t) this->optionSize; // three inputs read and two results written, once
+	this->numOperations = (size_t) OPS_PER_OPTION * numOptions;
 }
 
 void ElasticBSPricer::initKernel() {
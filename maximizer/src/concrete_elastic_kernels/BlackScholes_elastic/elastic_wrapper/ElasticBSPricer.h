@@ -29,6 +29,7 @@ private:
 	const  static int OPT_SZ = OPT_N * sizeof(float);
 	const static float RISKFREE = 0.02f;
 	const  static float VOLATILITY = 0.30f;
+	const static int OPS_PER_OPTION = 60; // a square root, a logarithm, three exponentials, two CNDs and the arithmetic around them
 	float RandFloat(float low, float high);
 	int numOptions;
 	int optionSize;
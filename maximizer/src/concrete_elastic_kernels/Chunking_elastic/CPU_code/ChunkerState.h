@@ -0,0 +1,148 @@
+/**
+ * ChunkerState.h
+ *
+ * The state of the rolling fingerprint at some position of a stream of data: the fingerprint
+ * itself, the content of the sliding window and how many bytes have been consumed. Whoever
+ * holds the state can continue chunking from that position without having the preceding data,
+ * which is what is needed to hand the work over to another thread, process or machine. For that
+ * purpose the state can be serialised into a flat buffer and read back.
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Zahari Dichev <zaharidichev@gmail.com>
+ */
+
+#ifndef CHUNKERSTATE_H_
+#define CHUNKERSTATE_H_
+
+#include "cuda_runtime.h"
+#include "../GPU_code/DedupDefines.h"
+#include "../GPU_code/rabin_fingerprint/RabinFingerprint.h"
+#include <string.h>
+#include <vector>
+
+#define CHUNKER_STATE_MAGIC 0x43485354 // "CHST"
+
+/**
+ * Everything that is needed to continue fingerprinting a stream
+ */
+struct chunkerState {
+	POLY_64 fingerprint; // the fingerprint of the window
+	OFFSET_64 position; // the number of bytes of the stream consumed so far
+	byteBuffer window; // the last winSize bytes
+};
+
+/**
+ * Initializes the state for the start of a stream
+ *
+ * @param state the state
+ * @param rabin the Rabin data (only the window size is used)
+ */
+inline void initChunkerState(chunkerState* state, const rabinData* rabin) {
+	state->fingerprint = 0;
+	state->position = 0;
+	initBufferOfSize(&state->window, rabin->winSize);
+}
+
+/**
+ * Pushes bytes through the fingerprint without looking for breakpoints. This is what the
+ * warm-up of a segment amounts to.
+ *
+ * @param state the state
+ * @param rabin the Rabin data
+ * @param data the bytes
+ * @param length how many bytes
+ */
+inline void advanceChunkerState(chunkerState* state, rabinData* rabin, const BYTE* data, size_t length) {
+	for (size_t i = 0; i < length; ++i) {
+		state->fingerprint = update(rabin, data[i], state->fingerprint, &state->window);
+	}
+	state->position += length;
+}
+
+/**
+ * Compares two states. Two states built by pushing the same last winSize bytes are equal.
+ *
+ * @param a the first state
+ * @param b the second state
+ * @return true if continuing from either one gives the same fingerprints
+ */
+inline bool chunkerStatesMatch(const chunkerState& a, const chunkerState& b) {
+	if (a.fingerprint != b.fingerprint || a.position != b.position || a.window.size != b.window.size) {
+		return false;
+	}
+	// compare the content of the windows in the order in which the bytes were pushed
+	for (int i = 1; i <= a.window.size; ++i) {
+		if (a.window.buf[(a.window.bufptr + i) % a.window.size] != b.window.buf[(b.window.bufptr + i) % b.window.size]) {
+			return false;
+		}
+	}
+	return true;
+}
+
+/**
+ * Serialises the state into a buffer. The byte order is that of the host, so the state can only
+ * be exchanged between machines of the same endianness.
+ *
+ * @param state the state
+ * @param out the vector to which the serialised state is appended
+ */
+inline void serializeChunkerState(const chunkerState& state, std::vector<BYTE>& out) {
+	uint32_t magic = CHUNKER_STATE_MAGIC;
+	int32_t winSize = state.window.size;
+	int32_t bufptr = state.window.bufptr;
+	BYTE full = state.window.ifFull ? 1 : 0;
+
+	size_t offset = out.size();
+	out.resize(offset + sizeof(magic) + sizeof(winSize) + sizeof(bufptr) + 1 + winSize + sizeof(POLY_64) + sizeof(OFFSET_64));
+	BYTE* ptr = &out[offset];
+	memcpy(ptr, &magic, sizeof(magic));
+	ptr += sizeof(magic);
+	memcpy(ptr, &winSize, sizeof(winSize));
+	ptr += sizeof(winSize);
+	memcpy(ptr, &bufptr, sizeof(bufptr));
+	ptr += sizeof(bufptr);
+	*ptr++ = full;
+	memcpy(ptr, state.window.buf, winSize);
+	ptr += winSize;
+	memcpy(ptr, &state.fingerprint, sizeof(POLY_64));
+	ptr += sizeof(POLY_64);
+	memcpy(ptr, &state.position, sizeof(OFFSET_64));
+}
+
+/**
+ * Reads a state back from a buffer
+ *
+ * @param data the buffer
+ * @param length the length of the buffer
+ * @param state receives the state
+ * @return the number of bytes consumed, or 0 if the buffer does not hold a valid state
+ */
+inline size_t deserializeChunkerState(const BYTE* data, size_t length, chunkerState* state) {
+	uint32_t magic;
+	int32_t winSize;
+	int32_t bufptr;
+	size_t header = sizeof(magic) + sizeof(winSize) + sizeof(bufptr) + 1;
+	if (length < header) {
+		return 0;
+	}
+	memcpy(&magic, data, sizeof(magic));
+	memcpy(&winSize, data + sizeof(magic), sizeof(winSize));
+	memcpy(&bufptr, data + sizeof(magic) + sizeof(winSize), sizeof(bufptr));
+	if (magic != CHUNKER_STATE_MAGIC || winSize <= 0 || winSize > MAX_BUFFER_SIZE || bufptr < 0 || bufptr >= winSize) {
+		return 0;
+	}
+	size_t total = header + winSize + sizeof(POLY_64) + sizeof(OFFSET_64);
+	if (length < total) {
+		return 0;
+	}
+
+	initBufferOfSize(&state->window, winSize);
+	state->window.bufptr = bufptr;
+	state->window.ifFull = data[header - 1] != 0;
+	memcpy(state->window.buf, data + header, winSize);
+	memcpy(&state->fingerprint, data + header + winSize, sizeof(POLY_64));
+	memcpy(&state->position, data + header + winSize + sizeof(POLY_64), sizeof(OFFSET_64));
+	return total;
+}
+
+#endif /* CHUNKERSTATE_H_ */
@@ -0,0 +1,628 @@
+/**
+ * DistributedChunker.h
+ *
+ * Chunking of a single file by several worker processes. The file is split into byte ranges and
+ * every worker fingerprints its own range (after warming up the window with the bytes that precede
+ * it) and sends back the positions where D and D' matched. Those positions are all that depends on
+ * the data; everything that depends on what came before (the two thresholds two divisors selection)
+ * is done by the coordinator, which feeds the candidates of all the workers in order through the
+ * same selection that is used by a single process. The cuts are therefore identical to those of a
+ * single process run.
+ *
+ * Workers talk to the coordinator over a Unix domain socket. The coordinator can fork the workers
+ * itself or wait for workers that were started separately (with --chunking-worker), as long as they
+ * can read the same file. Every worker also reports the chunker state at the start and at the end of
+ * its range, which the coordinator uses to check that neighbouring ranges agree at the seam.
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Zahari Dichev <zaharidichev@gmail.com>
+ */
+
+#ifndef DISTRIBUTEDCHUNKER_H_
+#define DISTRIBUTEDCHUNKER_H_
+
+#include "HostChunker.h"
+#include "ChunkerState.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <string>
+#include <vector>
+
+#define DISTRIBUTED_TASK_MAGIC 0x44544b31 // "DTK1"
+#define DISTRIBUTED_RESULT_MAGIC 0x44525331 // "DRS1"
+#define DEFAULT_ACCEPT_TIMEOUT 60 // seconds
+
+/**
+ * What the coordinator sends to a worker. The path of the file follows the message.
+ */
+struct distributedTaskMessage {
+	uint32_t magic;
+	int32_t worker; // the index of the worker (and of its range)
+	OFFSET_64 start; // the range of the file that the worker chunks
+	OFFSET_64 end;
+	int32_t D;
+	int32_t Ddash; // 0 when only D breakpoints are needed
+	int32_t winSize;
+	int32_t threads; // how many threads the worker may use
+	uint32_t pathLength;
+};
+
+/**
+ * What a worker sends back. It is followed by the D positions, the D' positions and the two
+ * serialised chunker states (at the start and at the end of the range).
+ */
+struct distributedResultMessage {
+	uint32_t magic;
+	int32_t worker;
+	int32_t status; // 0 on success
+	OFFSET_64 start;
+	OFFSET_64 end;
+	uint64_t numMain;
+	uint64_t numBackup;
+	uint32_t stateBytes;
+};
+
+/**
+ * The results of one worker, as kept by the coordinator
+ */
+struct distributedRangeResult {
+	OFFSET_64 start;
+	OFFSET_64 end;
+	std::vector<OFFSET_64> mainPositions;
+	std::vector<OFFSET_64> backupPositions;
+	chunkerState startState;
+	chunkerState endState;
+};
+
+/**
+ * The parameters of a distributed run
+ */
+struct distributedChunkingConfig {
+	std::string path; // the file to be chunked
+	std::string socketPath; // where the coordinator listens
+	int workers; // the number of ranges (and workers)
+	int threadsPerWorker;
+	bool spawnWorkers; // fork the workers, rather than wait for external ones
+	int acceptTimeout; // how many seconds to wait for the next worker to connect
+	chunkingContext ctx;
+	BreakpointPolicy policy;
+	int winSize;
+};
+
+/**
+ * Sends a whole buffer over a socket
+ *
+ * @return false if the connection broke
+ */
+inline bool sendAll(int fd, const void* data, size_t length) {
+	const char* ptr = (const char*) data;
+	while (length > 0) {
+		ssize_t sent = send(fd, ptr, length, 0);
+		if (sent < 0 && errno == EINTR) {
+			continue;
+		}
+		if (sent <= 0) {
+			return false;
+		}
+		ptr += sent;
+		length -= sent;
+	}
+	return true;
+}
+
+/**
+ * Receives exactly length bytes from a socket
+ *
+ * @return false if the connection broke before that
+ */
+inline bool receiveAll(int fd, void* data, size_t length) {
+	char* ptr = (char*) data;
+	while (length > 0) {
+		ssize_t received = recv(fd, ptr, length, 0);
+		if (received < 0 && errno == EINTR) {
+			continue;
+		}
+		if (received <= 0) {
+			return false;
+		}
+		ptr += received;
+		length -= received;
+	}
+	return true;
+}
+
+/**
+ * Reads a range of a file
+ *
+ * @return false if the range could not be read
+ */
+inline bool readFileRange(const std::string& path, OFFSET_64 start, OFFSET_64 end, std::vector<BYTE>& data) {
+	FILE* file = fopen(path.c_str(), "rb");
+	if (file == NULL) {
+		return false;
+	}
+	data.resize(end - start);
+	bool ok = fseeko(file, start, SEEK_SET) == 0;
+	if (ok && end > start) {
+		ok = fread(&data[0], 1, end - start, file) == (size_t) (end - start);
+	}
+	fclose(file);
+	return ok;
+}
+
+/**
+ * Builds the chunker state at a position of the data, the same way the warm-up does it
+ *
+ * @param rabin the Rabin data
+ * @param data the data, starting at dataStart in the file
+ * @param dataStart the offset of data in the file
+ * @param position the position at which the state is wanted (at least dataStart + winSize, or 0 to winSize)
+ * @param state receives the state
+ */
+inline void buildChunkerStateAt(rabinData* rabin, const BYTE* data, OFFSET_64 dataStart, OFFSET_64 position, chunkerState* state) {
+	OFFSET_64 warmUpStart = position - rabin->winSize;
+	if (warmUpStart < 0) {
+		warmUpStart = 0;
+	}
+	initChunkerState(state, rabin);
+	state->position = warmUpStart;
+	advanceChunkerState(state, rabin, data + (warmUpStart - dataStart), position - warmUpStart);
+}
+
+/**
+ * Collects the positions of all the set bits of a bit field array within a range
+ *
+ * @param breakpoints the bit field array
+ * @param from the first position of interest
+ * @param to the position after the last one of interest
+ * @param base added to every position that is collected
+ * @param positions the vector into which the positions are added
+ */
+inline void collectBreakpointPositions(bitFieldArray breakpoints, OFFSET_64 from, OFFSET_64 to, OFFSET_64 base,
+		std::vector<OFFSET_64>& positions) {
+	for (size_t word = from / 32; word < getSizeOfBitArray(to); ++word) {
+		word32 bits = breakpoints[word];
+		while (bits != 0) {
+			int bit = __builtin_clz(bits);
+			bits &= ~(0x80000000u >> bit);
+			OFFSET_64 pos = (OFFSET_64) word * 32 + bit;
+			if (pos >= from && pos < to) {
+				positions.push_back(base + pos);
+			}
+		}
+	}
+}
+
+/**
+ * Does the work of a worker: chunks a range of the file and collects the positions of the candidates
+ *
+ * @param task the task received from the coordinator
+ * @param path the file
+ * @param result receives the positions and the states
+ * @return false if the file could not be read
+ */
+inline bool processDistributedTask(const distributedTaskMessage& task, const std::string& path, distributedRangeResult& result) {
+	result.start = task.start;
+	result.end = task.end;
+
+	// read the range together with the bytes needed to warm up the window
+	OFFSET_64 warmUpStart = (task.start > task.winSize) ? task.start - task.winSize : 0;
+	std::vector<BYTE> data;
+	if (!readFileRange(path, warmUpStart, task.end, data)) {
+		return false;
+	}
+
+	rabinData rabin;
+	initWindowOfSize(&rabin, IRREDUCIBLE_POLY, task.winSize);
+	buildChunkerStateAt(&rabin, data.empty() ? NULL : &data[0], warmUpStart, task.start, &result.startState);
+	buildChunkerStateAt(&rabin, data.empty() ? NULL : &data[0], warmUpStart, task.end, &result.endState);
+	if (task.end <= task.start) {
+		return true;
+	}
+
+	OFFSET_64 length = data.size();
+	size_t numWords = getSizeOfBitArray(length);
+	std::vector<word32> breakpoints(numWords, 0);
+	std::vector<word32> backupBreakpoints((task.Ddash > 0) ? numWords : 0, 0);
+	findBreakPointsOnHost(&rabin, &data[0], length, &breakpoints[0], getHostChunkingThreads(length, task.threads), task.D,
+			(task.Ddash > 0) ? &backupBreakpoints[0] : NULL, task.Ddash);
+
+	// the bytes of the warm-up belong to the previous range, so their breakpoints are not reported
+	collectBreakpointPositions(&breakpoints[0], task.start - warmUpStart, length, warmUpStart, result.mainPositions);
+	if (task.Ddash > 0) {
+		collectBreakpointPositions(&backupBreakpoints[0], task.start - warmUpStart, length, warmUpStart, result.backupPositions);
+	}
+	return true;
+}
+
+/**
+ * The main function of a worker process. It connects to the coordinator, receives its task,
+ * does the work and sends back the result.
+ *
+ * @param socketPath the socket on which the coordinator listens
+ * @return 0 on success
+ */
+inline int runChunkingWorker(const std::string& socketPath) {
+	int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (fd < 0) {
+		return 1;
+	}
+	sockaddr_un address;
+	memset(&address, 0, sizeof(address));
+	address.sun_family = AF_UNIX;
+	strncpy(address.sun_path, socketPath.c_str(), sizeof(address.sun_path) - 1);
+	if (connect(fd, (sockaddr*) &address, sizeof(address)) != 0) {
+		fprintf(stderr, "Cannot connect to %s\n", socketPath.c_str());
+		close(fd);
+		return 1;
+	}
+
+	distributedTaskMessage task;
+	if (!receiveAll(fd, &task, sizeof(task)) || task.magic != DISTRIBUTED_TASK_MAGIC) {
+		close(fd);
+		return 1;
+	}
+	std::string path(task.pathLength, '\0');
+	if (task.pathLength > 0 && !receiveAll(fd, &path[0], task.pathLength)) {
+		close(fd);
+		return 1;
+	}
+
+	distributedRangeResult result;
+	bool ok = processDistributedTask(task, path, result);
+
+	std::vector<BYTE> states;
+	serializeChunkerState(result.startState, states);
+	serializeChunkerState(result.endState, states);
+
+	distributedResultMessage message;
+	memset(&message, 0, sizeof(message));
+	message.magic = DISTRIBUTED_RESULT_MAGIC;
+	message.worker = task.worker;
+	message.status = ok ? 0 : 1;
+	message.start = task.start;
+	message.end = task.end;
+	message.numMain = ok ? result.mainPositions.size() : 0;
+	message.numBackup = ok ? result.backupPositions.size() : 0;
+	message.stateBytes = ok ? states.size() : 0;
+
+	bool sent = sendAll(fd, &message, sizeof(message));
+	if (sent && message.numMain > 0) {
+		sent = sendAll(fd, &result.mainPositions[0], message.numMain * sizeof(OFFSET_64));
+	}
+	if (sent && message.numBackup > 0) {
+		sent = sendAll(fd, &result.backupPositions[0], message.numBackup * sizeof(OFFSET_64));
+	}
+	if (sent && message.stateBytes > 0) {
+		sent = sendAll(fd, &states[0], states.size());
+	}
+	close(fd);
+	return (ok && sent) ? 0 : 1;
+}
+
+/**
+ * Receives the result of a worker
+ *
+ * @param fd the connection to the worker
+ * @param result receives the result
+ * @param worker receives the index of the worker
+ * @return false if the worker failed or the connection broke
+ */
+inline bool receiveDistributedResult(int fd, distributedRangeResult& result, int* worker) {
+	distributedResultMessage message;
+	if (!receiveAll(fd, &message, sizeof(message)) || message.magic != DISTRIBUTED_RESULT_MAGIC || message.status != 0) {
+		return false;
+	}
+	*worker = message.worker;
+	result.start = message.start;
+	result.end = message.end;
+	result.mainPositions.resize(message.numMain);
+	result.backupPositions.resize(message.numBackup);
+	if (message.numMain > 0 && !receiveAll(fd, &result.mainPositions[0], message.numMain * sizeof(OFFSET_64))) {
+		return false;
+	}
+	if (message.numBackup > 0 && !receiveAll(fd, &result.backupPositions[0], message.numBackup * sizeof(OFFSET_64))) {
+		return false;
+	}
+	std::vector<BYTE> states(message.stateBytes);
+	if (message.stateBytes == 0 || !receiveAll(fd, &states[0], states.size())) {
+		return false;
+	}
+	size_t consumed = deserializeChunkerState(&states[0], states.size(), &result.startState);
+	return consumed > 0 && deserializeChunkerState(&states[consumed], states.size() - consumed, &result.endState) > 0;
+}
+
+/**
+ * Stitches the results of all the ranges into the final cuts. The ranges have to be in order.
+ *
+ * @param results the results of the ranges
+ * @param dataLen the length of the file
+ * @param ctx the thresholds
+ * @param policy the policy
+ * @param cuts receives the cut offsets
+ * @return false if two neighbouring ranges do not agree on the chunker state at their seam
+ */
+inline bool stitchDistributedResults(const std::vector<distributedRangeResult>& results, OFFSET_64 dataLen, const chunkingContext& ctx,
+		BreakpointPolicy policy, std::vector<OFFSET_64>& cuts) {
+	for (size_t r = 1; r < results.size(); ++r) {
+		if (results[r - 1].end != results[r].start || !chunkerStatesMatch(results[r - 1].endState, results[r].startState)) {
+			fprintf(stderr, "Ranges %lu and %lu do not agree at offset %lld\n", (unsigned long) r - 1, (unsigned long) r,
+					(long long) results[r].start);
+			return false;
+		}
+	}
+
+	if (policy == FREE_MODE) {
+		for (size_t r = 0; r < results.size(); ++r) {
+			for (size_t i = 0; i < results[r].mainPositions.size(); ++i) {
+				cuts.push_back(results[r].mainPositions[i] + 1);
+			}
+		}
+		if (cuts.empty() || cuts.back() != dataLen) {
+			cuts.push_back(dataLen);
+		}
+		return true;
+	}
+
+	tttdSelector selector;
+	initTTTDSelector(&selector, ctx.minThr, ctx.maxThr, &cuts);
+	for (size_t r = 0; r < results.size(); ++r) {
+		// merge the two sorted lists of candidates of the range
+		const std::vector<OFFSET_64>& main = results[r].mainPositions;
+		const std::vector<OFFSET_64>& backup = results[r].backupPositions;
+		size_t m = 0, b = 0;
+		while (m < main.size() || b < backup.size()) {
+			if (b == backup.size() || (m < main.size() && main[m] <= backup[b])) {
+				if (b < backup.size() && backup[b] == main[m]) {
+					++b; // both divisors matched at the same position
+				}
+				addTTTDCandidate(&selector, main[m++], true);
+			} else {
+				addTTTDCandidate(&selector, backup[b++], false);
+			}
+		}
+	}
+	finishTTTDSelection(&selector, dataLen);
+	return true;
+}
+
+/**
+ * Waits for the next worker to connect
+ *
+ * @param listener the listening socket
+ * @param timeout how many seconds to wait
+ * @return the connection, or -1 if no worker connected in time
+ */
+inline int acceptWorker(int listener, int timeout) {
+	pollfd request;
+	request.fd = listener;
+	request.events = POLLIN;
+	request.revents = 0;
+	int ready;
+	do {
+		ready = poll(&request, 1, timeout * 1000);
+	} while (ready < 0 && errno == EINTR);
+	if (ready <= 0) {
+		return -1;
+	}
+	return accept(listener, NULL, NULL);
+}
+
+/**
+ * Chunks a file by using a number of worker processes. The run fails if a worker does not connect
+ * within the accept timeout.
+ *
+ * @param config the parameters of the run
+ * @param cuts receives the cut offsets
+ * @return false if something went wrong
+ */
+inline bool chunkFileDistributed(const distributedChunkingConfig& config, std::vector<OFFSET_64>& cuts) {
+	struct stat fileStat;
+	if (stat(config.path.c_str(), &fileStat) != 0) {
+		fprintf(stderr, "Cannot stat %s\n", config.path.c_str());
+		return false;
+	}
+	OFFSET_64 dataLen = fileStat.st_size;
+	if (dataLen == 0 || config.workers < 1) {
+		return false;
+	}
+
+	int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+	sockaddr_un address;
+	memset(&address, 0, sizeof(address));
+	address.sun_family = AF_UNIX;
+	strncpy(address.sun_path, config.socketPath.c_str(), sizeof(address.sun_path) - 1);
+	unlink(config.socketPath.c_str());
+	if (listener < 0 || ::bind(listener, (sockaddr*) &address, sizeof(address)) != 0 || listen(listener, config.workers) != 0) {
+		fprintf(stderr, "Cannot listen on %s\n", config.socketPath.c_str());
+		if (listener >= 0) {
+			close(listener);
+		}
+		return false;
+	}
+	signal(SIGPIPE, SIG_IGN); // a dead worker should not take the coordinator with it
+
+	std::vector<pid_t> children;
+	if (config.spawnWorkers) {
+		for (int w = 0; w < config.workers; ++w) {
+			pid_t pid = fork();
+			if (pid == 0) {
+				close(listener);
+				_exit(runChunkingWorker(config.socketPath));
+			}
+			if (pid > 0) {
+				children.push_back(pid);
+			}
+		}
+	}
+
+	// hand out the ranges in the order in which the workers connect
+	OFFSET_64 rangeSize = (dataLen + config.workers - 1) / config.workers;
+	std::vector<int> connections;
+	bool ok = true;
+	for (int w = 0; w < config.workers && ok; ++w) {
+		int fd = acceptWorker(listener, config.acceptTimeout);
+		if (fd < 0) {
+			fprintf(stderr, "No worker connected within %d seconds\n", config.acceptTimeout);
+			ok = false;
+			break;
+		}
+		connections.push_back(fd);
+
+		distributedTaskMessage task;
+		memset(&task, 0, sizeof(task));
+		task.magic = DISTRIBUTED_TASK_MAGIC;
+		task.worker = w;
+		task.start = std::min((OFFSET_64) w * rangeSize, dataLen);
+		task.end = std::min(task.start + rangeSize, dataLen);
+		task.D = config.ctx.D;
+		task.Ddash = (config.policy == TTTD_MODE) ? config.ctx.Ddash : 0;
+		task.winSize = config.winSize;
+		task.threads = config.threadsPerWorker;
+		task.pathLength = config.path.size();
+		ok = sendAll(fd, &task, sizeof(task)) && sendAll(fd, config.path.c_str(), config.path.size());
+	}
+
+	std::vector<distributedRangeResult> results(config.workers);
+	for (size_t c = 0; c < connections.size() && ok; ++c) {
+		distributedRangeResult result;
+		int worker = -1;
+		ok = receiveDistributedResult(connections[c], result, &worker) && worker >= 0 && worker < config.workers;
+		if (ok) {
+			results[worker] = result;
+		}
+	}
+
+	for (size_t c = 0; c < connections.size(); ++c) {
+		close(connections[c]);
+	}
+	close(listener);
+	unlink(config.socketPath.c_str());
+	for (size_t c = 0; c < children.size(); ++c) {
+		if (!ok) {
+			kill(children[c], SIGTERM); // a worker that never got a range would wait forever
+		}
+		int status;
+		waitpid(children[c], &status, 0);
+	}
+
+	if (!ok) {
+		fprintf(stderr, "A worker failed\n");
+		return false;
+	}
+	return stitchDistributedResults(results, dataLen, config.ctx, config.policy, cuts);
+}
+
+/**
+ * Command line front end of the coordinator.
+ *
+ * Usage: --distributed-chunking FILE [--workers=4] [--threads=1] [--socket=/tmp/chunking.sock]
+ *                               [--policy=tttd|free] [--external] [--verify] [--accept-timeout=60]
+ *
+ * With --external the coordinator does not fork the workers, but waits for workers started
+ * with --chunking-worker --connect=SOCKET. With --verify the file is also chunked by a single
+ * process and the cuts are compared. The coordinator gives up if a worker does not connect within
+ * --accept-timeout seconds.
+ *
+ * @param argc the number of arguments
+ * @param argv the arguments
+ * @return 0 on success
+ */
+inline int runDistributedChunking(int argc, char** argv) {
+	distributedChunkingConfig config;
+	config.socketPath = "/tmp/chunking.sock";
+	config.workers = 4;
+	config.threadsPerWorker = 1;
+	config.spawnWorkers = true;
+	config.acceptTimeout = DEFAULT_ACCEPT_TIMEOUT;
+	config.policy = TTTD_MODE;
+	config.winSize = WIN_SIZE;
+	memset(&config.ctx, 0, sizeof(chunkingContext));
+	config.ctx.D = 512;
+	config.ctx.Ddash = 256;
+	config.ctx.minThr = 256;
+	config.ctx.maxThr = 2048;
+	bool verify = false;
+
+	for (int i = 0; i < argc; ++i) {
+		std::string arg(argv[i]);
+		if (arg.compare(0, 10, "--workers=") == 0) {
+			config.workers = atoi(arg.c_str() + 10);
+		} else if (arg.compare(0, 10, "--threads=") == 0) {
+			config.threadsPerWorker = atoi(arg.c_str() + 10);
+		} else if (arg.compare(0, 9, "--socket=") == 0) {
+			config.socketPath = arg.substr(9);
+		} else if (arg == "--policy=free") {
+			config.policy = FREE_MODE;
+		} else if (arg == "--policy=tttd") {
+			config.policy = TTTD_MODE;
+		} else if (arg.compare(0, 17, "--accept-timeout=") == 0) {
+			config.acceptTimeout = atoi(arg.c_str() + 17);
+		} else if (arg == "--external") {
+			config.spawnWorkers = false;
+		} else if (arg == "--verify") {
+			verify = true;
+		} else {
+			config.path = arg;
+		}
+	}
+	if (config.path.empty() || config.workers < 1 || config.threadsPerWorker < 1 || config.acceptTimeout < 1) {
+		fprintf(stderr, "Usage: --distributed-chunking FILE [--workers=N] [--threads=N] [--socket=PATH] [--policy=tttd|free] [--external] [--verify]\n"
+				"                              [--accept-timeout=SECONDS]\n");
+		return 1;
+	}
+
+	std::vector<OFFSET_64> cuts;
+	if (!chunkFileDistributed(config, cuts)) {
+		return 1;
+	}
+	printf("%lu chunks from %d workers\n", (unsigned long) cuts.size(), config.workers);
+
+	if (verify) {
+		std::vector<BYTE> data;
+		struct stat fileStat;
+		if (stat(config.path.c_str(), &fileStat) != 0 || !readFileRange(config.path, 0, fileStat.st_size, data)) {
+			return 1;
+		}
+		rabinData rabin;
+		initWindowOfSize(&rabin, IRREDUCIBLE_POLY, config.winSize);
+		std::vector<OFFSET_64> reference;
+		chunkDataOnHost(&rabin, &data[0], data.size(), config.ctx, config.policy, 1, reference);
+		bool same = reference == cuts;
+		printf("single process run: %lu chunks, %s\n", (unsigned long) reference.size(), same ? "identical" : "DIFFERENT");
+		return same ? 0 : 1;
+	}
+	return 0;
+}
+
+/**
+ * Command line front end of a worker that was started separately from the coordinator.
+ *
+ * Usage: --chunking-worker [--connect=/tmp/chunking.sock]
+ *
+ * @param argc the number of arguments
+ * @param argv the arguments
+ * @return 0 on success
+ */
+inline int runChunkingWorkerMode(int argc, char** argv) {
+	std::string socketPath = "/tmp/chunking.sock";
+	for (int i = 0; i < argc; ++i) {
+		std::string arg(argv[i]);
+		if (arg.compare(0, 10, "--connect=") == 0) {
+			socketPath = arg.substr(10);
+		}
+	}
+	return runChunkingWorker(socketPath);
+}
+
+#endif /* DISTRIBUTEDCHUNKER_H_ */
@@ -0,0 +1,221 @@
+/**
+ * FixedBlockChunker.h
+ *
+ * Chunking in fixed-size blocks, for data such as VM images and databases whose writes are aligned
+ * to blocks anyway: content defined boundaries would only find the block edges again, at the cost
+ * of a rolling fingerprint per byte. Here no fingerprint is computed at all. Every block of
+ * blockSize bytes (the last one can be shorter) is a chunk, and the only pass over the data finds
+ * the blocks that are all zeros, so the digest stage does not have to hash them (see
+ * computeChunkDigests()). The zero test reads the block with SIMD loads and stops at the first
+ * non-zero vector, so blocks with data cost a few loads and zero blocks cost one read at memory
+ * bandwidth.
+ *
+ * The zero blocks are returned in a bit field array with one bit per block (in the same layout as
+ * the breakpoints), which is also what the fixed-block kernel on the device produces.
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Zahari Dichev <zaharidichev@gmail.com>
+ */
+
+#ifndef FIXEDBLOCKCHUNKER_H_
+#define FIXEDBLOCKCHUNKER_H_
+
+#include "cuda_runtime.h"
+#include <stdio.h>
+#include "../GPU_code/DedupDefines.h"
+#include "../GPU_code/BitFieldArray.h"
+#include "../GPU_code/ResourceManagement.h"
+#include "MultiLaneChunker.h"
+#include <string.h>
+#include <vector>
+#include <algorithm>
+#include <boost/thread.hpp>
+#include <boost/bind.hpp>
+
+#if defined(__SSE2__) && !defined(__CUDACC__)
+#include <emmintrin.h>
+#endif
+
+/**
+ * Tells whether a piece of memory is all zeros, 8 bytes at a time
+ */
+inline bool isZeroBlockScalar(const BYTE* data, size_t length) {
+	size_t pos = 0;
+	for (; pos + sizeof(uint64_t) <= length; pos += sizeof(uint64_t)) {
+		uint64_t word;
+		memcpy(&word, data + pos, sizeof(uint64_t));
+		if (word != 0) {
+			return false;
+		}
+	}
+	for (; pos < length; ++pos) {
+		if (data[pos] != 0) {
+			return false;
+		}
+	}
+	return true;
+}
+
+#if defined(__SSE2__) && !defined(__CUDACC__)
+
+/**
+ * Tells whether a piece of memory is all zeros, 64 bytes at a time
+ */
+inline bool isZeroBlockSSE2(const BYTE* data, size_t length) {
+	const __m128i zero = _mm_setzero_si128();
+	size_t pos = 0;
+	for (; pos + 64 <= length; pos += 64) {
+		__m128i a = _mm_loadu_si128((const __m128i *) (data + pos));
+		__m128i b = _mm_loadu_si128((const __m128i *) (data + pos + 16));
+		__m128i c = _mm_loadu_si128((const __m128i *) (data + pos + 32));
+		__m128i d = _mm_loadu_si128((const __m128i *) (data + pos + 48));
+		__m128i any = _mm_or_si128(_mm_or_si128(a, b), _mm_or_si128(c, d));
+		if (_mm_movemask_epi8(_mm_cmpeq_epi8(any, zero)) != 0xFFFF) {
+			return false;
+		}
+	}
+	return isZeroBlockScalar(data + pos, length - pos);
+}
+
+#endif
+
+#ifdef MULTILANE_AVX2
+
+/**
+ * Tells whether a piece of memory is all zeros, 128 bytes at a time
+ */
+__attribute__((target("avx2"))) inline bool isZeroBlockAVX2(const BYTE* data, size_t length) {
+	size_t pos = 0;
+	for (; pos + 128 <= length; pos += 128) {
+		__m256i a = _mm256_loadu_si256((const __m256i *) (data + pos));
+		__m256i b = _mm256_loadu_si256((const __m256i *) (data + pos + 32));
+		__m256i c = _mm256_loadu_si256((const __m256i *) (data + pos + 64));
+		__m256i d = _mm256_loadu_si256((const __m256i *) (data + pos + 96));
+		__m256i any = _mm256_or_si256(_mm256_or_si256(a, b), _mm256_or_si256(c, d));
+		if (!_mm256_testz_si256(any, any)) {
+			return false;
+		}
+	}
+	return isZeroBlockScalar(data + pos, length - pos);
+}
+
+#endif
+
+/**
+ * Tells whether a piece of memory is all zeros, with the widest vectors the CPU has
+ *
+ * @param data the first byte
+ * @param length the number of bytes
+ * @return true if every byte is zero
+ */
+inline bool isZeroBlock(const BYTE* data, size_t length) {
+#ifdef MULTILANE_AVX2
+	if (isAVX2Available()) {
+		return isZeroBlockAVX2(data, length);
+	}
+#endif
+#if defined(__SSE2__) && !defined(__CUDACC__)
+	return isZeroBlockSSE2(data, length);
+#else
+	return isZeroBlockScalar(data, length);
+#endif
+}
+
+/**
+ * Returns the number of blocks a piece of data is split into
+ */
+inline size_t getNumFixedBlocks(OFFSET_64 dataLen, size_t blockSize) {
+	return (size_t) ((dataLen + blockSize - 1) / blockSize);
+}
+
+/**
+ * Finds the zero blocks in a range of blocks. This is what every thread runs in findZeroBlocksOnHost().
+ * The range starts at a multiple of 32 blocks, so the thread writes whole words of the array.
+ */
+inline void findZeroBlocksInRange(const BYTE* data, OFFSET_64 dataLen, size_t blockSize, bitFieldArray zeroBlocks, size_t fromBlock,
+		size_t toBlock) {
+	for (size_t wordStart = fromBlock; wordStart < toBlock; wordStart += BITS_PER_WORD) {
+		word32 word = 0;
+		size_t wordEnd = std::min(wordStart + BITS_PER_WORD, toBlock);
+		for (size_t block = wordStart; block < wordEnd; ++block) {
+			OFFSET_64 start = (OFFSET_64) block * blockSize;
+			if (isZeroBlock(data + start, (size_t) std::min((OFFSET_64) blockSize, dataLen - start))) {
+				setReverseBit(&word, (int) (block - wordStart));
+			}
+		}
+		setWord(wordStart / BITS_PER_WORD, word, zeroBlocks);
+	}
+}
+
+/**
+ * Finds the blocks of a piece of data that are all zeros by using a number of threads
+ *
+ * @param data the data
+ * @param dataLen the length of the data
+ * @param blockSize the size of a block
+ * @param zeroBlocks the bit field array that receives one bit per block (getSizeOfBitArray(number of blocks) words)
+ * @param threadsUsed the number of threads
+ */
+inline void findZeroBlocksOnHost(const BYTE* data, OFFSET_64 dataLen, size_t blockSize, bitFieldArray zeroBlocks, int threadsUsed) {
+	size_t numBlocks = getNumFixedBlocks(dataLen, blockSize);
+	size_t blocksPerThread = (size_t) getAlignedWorkPerThread(numBlocks, std::max(threadsUsed, 1));
+	if (blocksPerThread == 0) {
+		blocksPerThread = BITS_PER_WORD;
+	}
+	boost::thread_group workers;
+	for (size_t from = 0; from < numBlocks; from += blocksPerThread) {
+		size_t to = std::min(from + blocksPerThread, numBlocks);
+		if (to == numBlocks) {
+			// the calling thread takes the last range itself
+			findZeroBlocksInRange(data, dataLen, blockSize, zeroBlocks, from, to);
+			break;
+		}
+		workers.create_thread(boost::bind(&findZeroBlocksInRange, data, dataLen, blockSize, zeroBlocks, from, to));
+	}
+	workers.join_all();
+}
+
+/**
+ * Cuts a piece of data into blocks of a fixed size and finds the ones that are all zeros
+ *
+ * @param data the data
+ * @param dataLen the length of the data
+ * @param blockSize the size of a block (the last block can be shorter)
+ * @param threadsUsed the number of threads for finding the zero blocks
+ * @param cuts the vector into which the cut offsets are added
+ * @param zeroBlocks receives one bit per block, set for the blocks that are all zeros
+ */
+inline void chunkDataInFixedBlocks(const BYTE* data, OFFSET_64 dataLen, size_t blockSize, int threadsUsed, std::vector<OFFSET_64>& cuts,
+		std::vector<word32>& zeroBlocks) {
+	size_t numBlocks = getNumFixedBlocks(dataLen, blockSize);
+	cuts.reserve(cuts.size() + numBlocks);
+	for (OFFSET_64 end = blockSize; end < dataLen; end += blockSize) {
+		cuts.push_back(end);
+	}
+	if (dataLen > 0) {
+		cuts.push_back(dataLen);
+	}
+	zeroBlocks.assign(getSizeOfBitArray(numBlocks), 0);
+	if (numBlocks > 0) {
+		findZeroBlocksOnHost(data, dataLen, blockSize, &zeroBlocks[0], threadsUsed);
+	}
+}
+
+/**
+ * Groups fixed blocks into super chunks of a fixed number of blocks
+ *
+ * @param numBlocks the number of blocks
+ * @param blocksPerSuperChunk the number of blocks in a super chunk (the last one can have fewer)
+ * @param superChunkEnds the vector into which the index of the last block of every super chunk is added
+ */
+inline void extractFixedSuperChunks(size_t numBlocks, size_t blocksPerSuperChunk, std::vector<size_t>& superChunkEnds) {
+	blocksPerSuperChunk = std::max(blocksPerSuperChunk, (size_t) 1);
+	for (size_t end = blocksPerSuperChunk; end < numBlocks; end += blocksPerSuperChunk) {
+		superChunkEnds.push_back(end - 1);
+	}
+	if (numBlocks > 0) {
+		superChunkEnds.push_back(numBlocks - 1);
+	}
+}
+
+#endif /* FIXEDBLOCKCHUNKER_H_ */
@@ -0,0 +1,472 @@
+/**
+ * HostChunker.h
+ *
+ * This file contains a host (CPU) implementation of the content defined chunking that is
+ * performed by the findBreakPointsFreeMode() kernel. The data is split into segments, one
+ * per worker thread, and every thread fingerprints its own segment using exactly the same
+ * Rabin routines that are used on the device. The breakpoints are stored in the same bit
+ * field array layout, so the results of the host and the device can be compared bit by bit.
+ *
+ * Apart from the free mode, the file also provides the second (sequential) pass that is
+ * needed for the two thresholds two divisors (TTTD) scheme, for which the chunkingContext
+ * already carries D, D', the minimum and the maximum threshold.
+ *
+ * The same rolling pass can also test the fingerprints against a larger divisor, which gives a
+ * second level of boundaries that groups consecutive chunks into super chunks. The super chunks are
+ * made from the chunks that were emitted, so a super chunk always ends where a chunk ends. With
+ * powers of two for both divisors every super chunk breakpoint is also a chunk breakpoint, but under
+ * TTTD the minimum threshold can drop a chunk breakpoint, and a super chunk breakpoint at the same
+ * position is then dropped with it rather than moved to the next cut.
+ *
+ * A worker can split its segment further into lanes that are fingerprinted at the same time (see
+ * MultiLaneChunker.h). The number of lanes comes from the chunking profile.
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Zahari Dichev <zaharidichev@gmail.com>
+ */
+
+#ifndef HOSTCHUNKER_H_
+#define HOSTCHUNKER_H_
+
+#include "cuda_runtime.h"
+#include "../GPU_code/DedupDefines.h"
+#include "../GPU_code/rabin_fingerprint/RabinFingerprint.h"
+#include "../GPU_code/BitFieldArray.h"
+#include "../GPU_code/ResourceManagement.h"
+#include "../../../misc/NumaPlacement.h"
+#include "MultiLaneChunker.h"
+#include <boost/thread.hpp>
+#include <boost/bind.hpp>
+#include <vector>
+#include <algorithm>
+
+/**
+ * The policy that is used in order to turn fingerprints into chunk boundaries
+ */
+enum BreakpointPolicy {
+	/**
+	 * Every position where the fingerprint modulo D equals D - 1 is a boundary
+	 */
+	FREE_MODE,
+	/**
+	 * Two thresholds two divisors. Boundaries are searched with D and, as a backup, with D'
+	 * and chunks are kept between a minimum and a maximum size
+	 */
+	TTTD_MODE
+};
+
+/**
+ * Everything a single host worker needs in order to fingerprint its segment of the data
+ */
+struct hostChunkingTask {
+	rabinData* rabin; // the push/pop tables and the irreducible polynomial
+	BYTE* data; // the whole data (not only the segment)
+	threadBounds bounds; // the segment of the data that belongs to the worker
+	int D; // the main divisor
+	int Ddash; // the backup divisor (only used when backupResults is not NULL)
+	bitFieldArray results; // breakpoints found with D
+	bitFieldArray backupResults; // breakpoints found with D' (can be NULL)
+	int superD; // the super chunk divisor (only used when superResults is not NULL)
+	bitFieldArray superResults; // super chunk breakpoints (can be NULL)
+	int cpu; // the CPU the worker is pinned to (-1 for no pinning)
+	int lanes; // the number of lanes the segment is fingerprinted in (1 for a single pass)
+};
+
+/**
+ * Fingerprints a segment of the data on the host in a single pass and marks all the breakpoints
+ * in the bit field arrays. This mirrors chunkDataFreeMode(), with the difference that the segment
+ * is always expected to start on a 32 byte boundary, so no two workers ever write the same word.
+ * Every segment apart from the first one warms up the sliding window with the bytes that precede
+ * it, so the result does not depend on the way data is split between workers.
+ *
+ * @param task the description of the segment and where to put the results
+ */
+inline void chunkSegmentSeriallyOnHost(const hostChunkingTask& task) {
+	byteBuffer b;
+	initBufferOfSize(&b, task.rabin->winSize);
+	POLY_64 fingerprint = 0;
+
+	if (task.bounds.start != 0) {
+		// warm up the window so the first fingerprints in the segment are the same as in a serial run
+		OFFSET_64 warmUpStart = task.bounds.start - task.rabin->winSize;
+		for (OFFSET_64 var = (warmUpStart < 0) ? 0 : warmUpStart; var < task.bounds.start; ++var) {
+			fingerprint = update(task.rabin, task.data[var], fingerprint, &b);
+		}
+	}
+
+	word32 partialBreakPoints = 0;
+	word32 partialBackupBreakPoints = 0;
+	word32 partialSuperBreakPoints = 0;
+	for (OFFSET_64 pos = task.bounds.start; pos < task.bounds.end; ++pos) {
+		fingerprint = update(task.rabin, task.data[pos], fingerprint, &b);
+
+		if (bitMod(fingerprint, task.D) == (uint64_t) (task.D - 1)) {
+			setReverseBit(&partialBreakPoints, pos % 32);
+		}
+		if (task.backupResults != NULL && bitMod(fingerprint, task.Ddash) == (uint64_t) (task.Ddash - 1)) {
+			setReverseBit(&partialBackupBreakPoints, pos % 32);
+		}
+		if (task.superResults != NULL && bitMod(fingerprint, task.superD) == (uint64_t) (task.superD - 1)) {
+			setReverseBit(&partialSuperBreakPoints, pos % 32);
+		}
+
+		if ((pos + 1) % 32 == 0) {
+			setWord(pos / 32, partialBreakPoints, task.results);
+			partialBreakPoints = 0;
+			if (task.backupResults != NULL) {
+				setWord(pos / 32, partialBackupBreakPoints, task.backupResults);
+				partialBackupBreakPoints = 0;
+			}
+			if (task.superResults != NULL) {
+				setWord(pos / 32, partialSuperBreakPoints, task.superResults);
+				partialSuperBreakPoints = 0;
+			}
+		}
+	}
+
+	if (task.bounds.end % 32 != 0) {
+		// flush the last word, which is only partially filled
+		setWord(task.bounds.end / 32, partialBreakPoints, task.results);
+		if (task.backupResults != NULL) {
+			setWord(task.bounds.end / 32, partialBackupBreakPoints, task.backupResults);
+		}
+		if (task.superResults != NULL) {
+			setWord(task.bounds.end / 32, partialSuperBreakPoints, task.superResults);
+		}
+	}
+}
+
+/**
+ * Fingerprints a segment of the data on the host and marks all the breakpoints in the bit field
+ * arrays. With more than one lane, the bulk of the segment is cut into task.lanes lanes of equal
+ * length that are fingerprinted together; the first MAX_BUFFER_SIZE bytes of the data (where the
+ * window is not full yet) and whatever does not divide evenly into the lanes are done in a single
+ * pass. The result is the same as that of a single pass over the whole segment.
+ *
+ * @param task the description of the segment and where to put the results
+ */
+inline void chunkSegmentOnHost(hostChunkingTask task) {
+	if (task.cpu >= 0) {
+		pinCurrentThreadToCpu(task.cpu);
+	}
+
+	OFFSET_64 bodyStart = std::max(task.bounds.start, (OFFSET_64) MAX_BUFFER_SIZE);
+	OFFSET_64 laneLength = (task.bounds.end > bodyStart) ? (task.bounds.end - bodyStart) / task.lanes / 32 * 32 : 0;
+	if (task.lanes <= 1 || laneLength < MIN_LANE_LENGTH) {
+		chunkSegmentSeriallyOnHost(task);
+		return;
+	}
+
+	OFFSET_64 bodyEnd = bodyStart + laneLength * task.lanes;
+	hostChunkingTask piece = task;
+	if (bodyStart > task.bounds.start) {
+		piece.bounds.end = bodyStart;
+		chunkSegmentSeriallyOnHost(piece);
+	}
+
+	const BYTE* laneData[MAX_CHUNKING_LANES];
+	size_t laneWords[MAX_CHUNKING_LANES];
+	for (int lane = 0; lane < task.lanes; ++lane) {
+		laneData[lane] = task.data + bodyStart + lane * laneLength;
+		laneWords[lane] = (bodyStart + lane * laneLength) / 32;
+	}
+	laneTargets targets;
+	targets.mask = task.D - 1;
+	targets.backupMask = task.Ddash - 1;
+	targets.superMask = task.superD - 1;
+	targets.results = task.results;
+	targets.backupResults = task.backupResults;
+	targets.superResults = task.superResults;
+	fingerprintLanes(task.rabin, laneData, laneWords, task.lanes, laneLength, targets);
+
+	if (bodyEnd < task.bounds.end) {
+		piece.bounds.start = bodyEnd;
+		piece.bounds.end = task.bounds.end;
+		chunkSegmentSeriallyOnHost(piece);
+	}
+}
+
+/**
+ * Finds all the breakpoints in a piece of data on the host by using a number of threads.
+ * The result is written in a bit field array of getSizeOfBitArray(dataLen) words, exactly
+ * as the device does it.
+ *
+ * @param rabin the initialized Rabin data
+ * @param data the data to be chunked
+ * @param dataLen the length of the data
+ * @param results the bit field array for breakpoints found with D
+ * @param threadsUsed the number of worker threads
+ * @param D the main divisor
+ * @param backupResults the bit field array for breakpoints found with D' (can be NULL)
+ * @param Ddash the backup divisor
+ * @param superResults the bit field array for super chunk breakpoints (can be NULL)
+ * @param superD the super chunk divisor
+ * @param workerCpus if not NULL, the CPU every worker is pinned to (see getWorkerCpus())
+ */
+inline void findBreakPointsOnHost(rabinData* rabin, BYTE* data, OFFSET_64 dataLen, bitFieldArray results, int threadsUsed, int D,
+		bitFieldArray backupResults = NULL, int Ddash = 0, bitFieldArray superResults = NULL, int superD = 0,
+		const std::vector<int>* workerCpus = NULL) {
+
+	OFFSET_64 workPerThread = getAlignedWorkPerThread(dataLen, threadsUsed);
+	boost::thread_group workers;
+
+	// the calling thread works too, so its affinity is restored once it is done
+	cpu_set_t callerAffinity;
+	bool restoreAffinity = workerCpus != NULL && pthread_getaffinity_np(pthread_self(), sizeof(cpu_set_t), &callerAffinity) == 0;
+
+	for (int thrID = 0; thrID < threadsUsed; ++thrID) {
+		hostChunkingTask task;
+		task.rabin = rabin;
+		task.data = data;
+		task.bounds.start = (OFFSET_64) thrID * workPerThread;
+		task.bounds.end = (thrID == threadsUsed - 1) ? dataLen : task.bounds.start + workPerThread;
+		task.D = D;
+		task.Ddash = Ddash;
+		task.results = results;
+		task.backupResults = backupResults;
+		task.superD = superD;
+		task.superResults = superResults;
+		task.cpu = (workerCpus != NULL && thrID < (int) workerCpus->size()) ? (*workerCpus)[thrID] : -1;
+		task.lanes = getChunkingLanes();
+
+		if (task.bounds.start >= dataLen) {
+			break; // not enough data to give something to every worker
+		}
+		if (task.bounds.end > dataLen) {
+			task.bounds.end = dataLen;
+		}
+
+		if (thrID == threadsUsed - 1 || task.bounds.end == dataLen) {
+			// the calling thread takes the last segment itself
+			chunkSegmentOnHost(task);
+			break;
+		}
+		workers.create_thread(boost::bind(&chunkSegmentOnHost, task));
+	}
+	workers.join_all();
+	if (restoreAffinity) {
+		pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &callerAffinity);
+	}
+}
+
+/**
+ * Walks through the bit field array and extracts the offsets at which chunks end. A breakpoint
+ * at position pos means that the chunk ends right after the byte at pos, therefore the cut
+ * offset is pos + 1. The end of the data is always the last cut.
+ *
+ * @param breakpoints the bit field array
+ * @param dataLen the length of the data
+ * @param cuts the vector into which the cut offsets are added
+ */
+inline void extractCutsFreeMode(bitFieldArray breakpoints, OFFSET_64 dataLen, std::vector<OFFSET_64>& cuts) {
+	size_t numWords = getSizeOfBitArray(dataLen);
+	for (size_t word = 0; word < numWords; ++word) {
+		word32 bits = breakpoints[word];
+		while (bits != 0) {
+			// the first position of the word is stored in the most significant bit
+			int bit = __builtin_clz(bits);
+			bits &= ~(0x80000000u >> bit);
+			OFFSET_64 pos = (OFFSET_64) word * 32 + bit;
+			if (pos < dataLen) {
+				cuts.push_back(pos + 1);
+			}
+		}
+	}
+	if (cuts.empty() || cuts.back() != dataLen) {
+		cuts.push_back(dataLen);
+	}
+}
+
+/**
+ * The state of the sequential part of the two thresholds two divisors algorithm. The candidates
+ * (positions where D or D' matched) are fed one by one, in increasing order, so the selection
+ * can be done over bit field arrays as well as over candidates that come from several places.
+ */
+struct tttdSelector {
+	OFFSET_64 chunkStart; // where the current chunk starts
+	OFFSET_64 backupCut; // the last D' cut in the current chunk (-1 if none)
+	int minThr; // the minimum chunk size
+	int maxThr; // the maximum chunk size
+	std::vector<OFFSET_64>* cuts; // where the selected cuts go
+};
+
+/**
+ * Initializes the selector
+ *
+ * @param selector the selector
+ * @param minThr the minimum chunk size
+ * @param maxThr the maximum chunk size
+ * @param cuts the vector into which the cut offsets are added
+ */
+inline void initTTTDSelector(tttdSelector* selector, int minThr, int maxThr, std::vector<OFFSET_64>* cuts) {
+	selector->chunkStart = 0;
+	selector->backupCut = -1;
+	selector->minThr = minThr;
+	selector->maxThr = maxThr;
+	selector->cuts = cuts;
+}
+
+/**
+ * Cuts as long as the current chunk would become larger than the maximum before reaching pos
+ */
+inline void enforceTTTDMaximum(tttdSelector* selector, OFFSET_64 pos) {
+	while (pos + 1 - selector->chunkStart > selector->maxThr) {
+		selector->cuts->push_back((selector->backupCut != -1) ? selector->backupCut : selector->chunkStart + selector->maxThr);
+		selector->chunkStart = selector->cuts->back();
+		selector->backupCut = -1;
+	}
+}
+
+/**
+ * Feeds a candidate to the selector. If no D breakpoint is found before reaching maxThr, the last D'
+ * one is used and if there is not one of those either, the chunk is simply cut at maxThr.
+ *
+ * @param selector the selector
+ * @param pos the position of the candidate (larger than that of all the previous ones)
+ * @param isMain whether D matched at that position (otherwise only D' did)
+ */
+inline void addTTTDCandidate(tttdSelector* selector, OFFSET_64 pos, bool isMain) {
+	// if we went past the maximum without a D breakpoint, we need to cut before going on
+	enforceTTTDMaximum(selector, pos);
+	if (pos + 1 - selector->chunkStart < selector->minThr) {
+		return; // the chunk would be too small
+	}
+
+	if (isMain) {
+		selector->cuts->push_back(pos + 1);
+		selector->chunkStart = pos + 1;
+		selector->backupCut = -1;
+	} else {
+		selector->backupCut = pos + 1; // remember it in case we reach the maximum
+	}
+}
+
+/**
+ * Finishes the selection once all the candidates have been fed. The end of the data is always the last cut.
+ *
+ * @param selector the selector
+ * @param dataLen the length of the data
+ */
+inline void finishTTTDSelection(tttdSelector* selector, OFFSET_64 dataLen) {
+	enforceTTTDMaximum(selector, dataLen - 1);
+	if (selector->cuts->empty() || selector->cuts->back() != dataLen) {
+		selector->cuts->push_back(dataLen);
+	}
+}
+
+/**
+ * This is the sequential part of the two thresholds two divisors algorithm. Given the breakpoints
+ * that were found with D and D', the function selects the cuts so that no chunk is smaller than
+ * minThr or larger than maxThr.
+ *
+ * @param breakpoints the bit field array with breakpoints for D
+ * @param backupBreakpoints the bit field array with breakpoints for D'
+ * @param dataLen the length of the data
+ * @param minThr the minimum chunk size
+ * @param maxThr the maximum chunk size
+ * @param cuts the vector into which the cut offsets are added
+ */
+inline void extractCutsTTTD(bitFieldArray breakpoints, bitFieldArray backupBreakpoints, OFFSET_64 dataLen, int minThr, int maxThr,
+		std::vector<OFFSET_64>& cuts) {
+	tttdSelector selector;
+	initTTTDSelector(&selector, minThr, maxThr, &cuts);
+	size_t numWords = getSizeOfBitArray(dataLen);
+
+	for (size_t word = 0; word < numWords; ++word) {
+		// only positions where at least one of the divisors matched are interesting
+		word32 candidates = breakpoints[word] | backupBreakpoints[word];
+		while (candidates != 0) {
+			int bit = __builtin_clz(candidates);
+			candidates &= ~(0x80000000u >> bit);
+			OFFSET_64 pos = (OFFSET_64) word * 32 + bit;
+			if (pos >= dataLen) {
+				break;
+			}
+			addTTTDCandidate(&selector, pos, getBit(pos, breakpoints));
+		}
+	}
+	finishTTTDSelection(&selector, dataLen);
+}
+
+/**
+ * Chunks a piece of data on the host with the specified policy and returns the cut offsets
+ *
+ * @param rabin the initialized Rabin data
+ * @param data the data
+ * @param dataLen the length of the data
+ * @param ctx the chunking parameters (D, D', the thresholds)
+ * @param policy the policy to be applied
+ * @param threadsUsed the number of threads for the parallel part
+ * @param cuts the vector into which the cut offsets are added
+ * @param workerCpus if not NULL, the CPU every worker is pinned to (see getWorkerCpus())
+ */
+inline void chunkDataOnHost(rabinData* rabin, BYTE* data, OFFSET_64 dataLen, const chunkingContext& ctx, BreakpointPolicy policy,
+		int threadsUsed, std::vector<OFFSET_64>& cuts, const std::vector<int>* workerCpus = NULL) {
+	size_t numWords = getSizeOfBitArray(dataLen);
+	std::vector<word32> breakpoints(numWords, 0);
+
+	if (policy == FREE_MODE) {
+		findBreakPointsOnHost(rabin, data, dataLen, &breakpoints[0], threadsUsed, ctx.D, NULL, 0, NULL, 0, workerCpus);
+		extractCutsFreeMode(&breakpoints[0], dataLen, cuts);
+	} else {
+		std::vector<word32> backupBreakpoints(numWords, 0);
+		findBreakPointsOnHost(rabin, data, dataLen, &breakpoints[0], threadsUsed, ctx.D, &backupBreakpoints[0], ctx.Ddash, NULL, 0, workerCpus);
+		extractCutsTTTD(&breakpoints[0], &backupBreakpoints[0], dataLen, ctx.minThr, ctx.maxThr, cuts);
+	}
+}
+
+/**
+ * Groups the chunks into super chunks. A super chunk ends with every chunk whose last byte has its
+ * bit set in the super chunk bit field array. So that a missing boundary does not create one huge
+ * super chunk, a super chunk is also closed when it reaches a maximum number of chunks.
+ *
+ * @param cuts the cut offsets of the chunks
+ * @param superBreakpoints the bit field array with super chunk breakpoints
+ * @param maxChunksPerSuperChunk the maximum number of chunks in a super chunk
+ * @param superChunkEnds the vector into which the index (in cuts) of the last chunk of every super chunk is added
+ */
+inline void extractSuperChunks(const std::vector<OFFSET_64>& cuts, bitFieldArray superBreakpoints, size_t maxChunksPerSuperChunk,
+		std::vector<size_t>& superChunkEnds) {
+	size_t chunksInSuperChunk = 0;
+	for (size_t chunk = 0; chunk < cuts.size(); ++chunk) {
+		++chunksInSuperChunk;
+		if (chunk == cuts.size() - 1 || chunksInSuperChunk == maxChunksPerSuperChunk || getBit(cuts[chunk] - 1, superBreakpoints)) {
+			superChunkEnds.push_back(chunk);
+			chunksInSuperChunk = 0;
+		}
+	}
+}
+
+/**
+ * Chunks a piece of data on the host and groups the chunks into super chunks. Both levels of
+ * boundaries come out of the same pass over the data.
+ *
+ * @param rabin the initialized Rabin data
+ * @param data the data
+ * @param dataLen the length of the data
+ * @param ctx the chunking parameters (D, D', the thresholds)
+ * @param policy the policy to be applied
+ * @param threadsUsed the number of threads for the parallel part
+ * @param superD the super chunk divisor (a power of two that is larger than D)
+ * @param maxChunksPerSuperChunk the maximum number of chunks in a super chunk
+ * @param cuts the vector into which the cut offsets are added
+ * @param superChunkEnds the vector into which the index of the last chunk of every super chunk is added
+ */
+inline void chunkDataOnHostWithSuperChunks(rabinData* rabin, BYTE* data, OFFSET_64 dataLen, const chunkingContext& ctx, BreakpointPolicy policy,
+		int threadsUsed, int superD, size_t maxChunksPerSuperChunk, std::vector<OFFSET_64>& cuts, std::vector<size_t>& superChunkEnds) {
+	size_t numWords = getSizeOfBitArray(dataLen);
+	std::vector<word32> breakpoints(numWords, 0);
+	std::vector<word32> backupBreakpoints(numWords, 0);
+	std::vector<word32> superBreakpoints(numWords, 0);
+
+	findBreakPointsOnHost(rabin, data, dataLen, &breakpoints[0], threadsUsed, ctx.D, (policy == TTTD_MODE) ? &backupBreakpoints[0] : NULL,
+			ctx.Ddash, &superBreakpoints[0], superD);
+	if (policy == FREE_MODE) {
+		extractCutsFreeMode(&breakpoints[0], dataLen, cuts);
+	} else {
+		extractCutsTTTD(&breakpoints[0], &backupBreakpoints[0], dataLen, ctx.minThr, ctx.maxThr, cuts);
+	}
+	extractSuperChunks(cuts, &superBreakpoints[0], maxChunksPerSuperChunk, superChunkEnds);
+}
+
+#endif /* HOSTCHUNKER_H_ */
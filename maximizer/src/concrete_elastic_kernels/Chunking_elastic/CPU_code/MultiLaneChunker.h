@@ -0,0 +1,292 @@
+/**
+ * MultiLaneChunker.h
+ *
+ * A rolling fingerprint is a chain of dependent table lookups, so a single one cannot use more
+ * than a fraction of what a core can issue. The functions here fingerprint several independent
+ * lanes (equal, 32 byte aligned pieces of a worker's segment) at the same time: the lanes do not
+ * depend on each other, so their lookups overlap. With AVX2 four lanes share a vector register
+ * and the push and pop tables are read with gathers; without it the lanes are interleaved in
+ * scalar code, which still lets the core overlap the chains. Every lane warms up on the bytes
+ * that precede it, exactly as every worker does, so the breakpoints are identical to those of a
+ * single pass.
+ *
+ * The winSize bytes before every lane must be readable and belong to the data, so the window is
+ * always full and the byte that leaves it is simply read from the data; no ring buffer is needed.
+ * The lanes do not have to lie in the same buffer.
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Zahari Dichev <zaharidichev@gmail.com>
+ */
+
+#ifndef MULTILANECHUNKER_H_
+#define MULTILANECHUNKER_H_
+
+#include "cuda_runtime.h"
+#include "../GPU_code/DedupDefines.h"
+#include "../GPU_code/rabin_fingerprint/RabinFingerprint.h"
+#include "../GPU_code/BitFieldArray.h"
+#include "../GPU_code/ChunkingProfile.h"
+#include <string.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__)) && !defined(__CUDACC__)
+#define MULTILANE_AVX2 1
+#include <immintrin.h>
+#endif
+
+#define MIN_LANE_LENGTH 4096 // shorter lanes are not worth their warm-up
+
+/**
+ * The breakpoint tests applied to every fingerprint and where their results go
+ */
+struct laneTargets {
+	POLY_64 mask; // D - 1
+	POLY_64 backupMask; // D' - 1
+	POLY_64 superMask; // the super chunk divisor - 1
+	bitFieldArray results;
+	bitFieldArray backupResults; // can be NULL
+	bitFieldArray superResults; // can be NULL
+};
+
+/**
+ * Builds the fingerprint of the winSize bytes that precede a lane
+ *
+ * @param rabin the Rabin data
+ * @param lane the first byte of the lane
+ * @return the fingerprint
+ */
+inline POLY_64 warmUpLane(rabinData* rabin, const BYTE* lane) {
+	// the window starts out empty, so nothing leaves it during the warm-up
+	POLY_64 fingerprint = 0;
+	for (const BYTE* byte = lane - rabin->winSize; byte < lane; ++byte) {
+		fingerprint = pushAByte(fingerprint, rabin, *byte);
+	}
+	return fingerprint;
+}
+
+/**
+ * Writes the breakpoint words of every lane once 32 positions have been processed
+ */
+inline void flushLaneWords(const size_t* laneWords, int lanes, OFFSET_64 processed, const laneTargets& targets, word32* partial,
+		word32* partialBackup, word32* partialSuper) {
+	for (int lane = 0; lane < lanes; ++lane) {
+		size_t word = laneWords[lane] + processed / 32 - 1;
+		setWord(word, partial[lane], targets.results);
+		partial[lane] = 0;
+		if (targets.backupResults != NULL) {
+			setWord(word, partialBackup[lane], targets.backupResults);
+			partialBackup[lane] = 0;
+		}
+		if (targets.superResults != NULL) {
+			setWord(word, partialSuper[lane], targets.superResults);
+			partialSuper[lane] = 0;
+		}
+	}
+}
+
+/**
+ * Fingerprints LANES lanes interleaved in scalar code
+ *
+ * @param rabin the Rabin data
+ * @param laneData the first byte of every lane
+ * @param laneWords the word of the bit field arrays that gets the first 32 positions of every lane
+ * @param laneLength the length of every lane (a multiple of 32)
+ * @param targets the breakpoint tests and the bit field arrays
+ */
+template<int LANES> void fingerprintLanesScalar(rabinData* rabin, const BYTE* const * laneData, const size_t* laneWords, OFFSET_64 laneLength,
+		const laneTargets& targets) {
+	POLY_64 fingerprint[LANES];
+	const BYTE* in[LANES];
+	const BYTE* out[LANES];
+	word32 partial[LANES], partialBackup[LANES], partialSuper[LANES];
+	for (int lane = 0; lane < LANES; ++lane) {
+		fingerprint[lane] = warmUpLane(rabin, laneData[lane]);
+		in[lane] = laneData[lane];
+		out[lane] = in[lane] - rabin->winSize;
+		partial[lane] = partialBackup[lane] = partialSuper[lane] = 0;
+	}
+	const POLY_64* popTable = rabin->popTable;
+	const POLY_64* pushTable = rabin->pushTable;
+	const int shift = rabin->shift;
+	const POLY_64 mask = targets.mask;
+	const POLY_64 backupMask = targets.backupMask;
+	const POLY_64 superMask = targets.superMask;
+	const bool backup = targets.backupResults != NULL;
+	const bool super = targets.superResults != NULL;
+
+	for (OFFSET_64 pos = 0; pos < laneLength; ++pos) {
+		int bit = 31 - (int) (pos % 32);
+		for (int lane = 0; lane < LANES; ++lane) {
+			POLY_64 f = fingerprint[lane] ^ popTable[out[lane][pos]];
+			f = ((f << 8) | in[lane][pos]) ^ pushTable[f >> shift];
+			fingerprint[lane] = f;
+			if ((f & mask) == mask) {
+				partial[lane] |= 1u << bit;
+			}
+			if (backup && (f & backupMask) == backupMask) {
+				partialBackup[lane] |= 1u << bit;
+			}
+			if (super && (f & superMask) == superMask) {
+				partialSuper[lane] |= 1u << bit;
+			}
+		}
+		if (bit == 0) {
+			flushLaneWords(laneWords, LANES, pos + 1, targets, partial, partialBackup, partialSuper);
+		}
+	}
+}
+
+#ifdef MULTILANE_AVX2
+
+/**
+ * Sets the bits of the lanes whose fingerprint passed a test
+ *
+ * @param hits one bit per lane of a vector
+ * @param firstLane the lane of the lowest bit
+ * @param bit the bit of the position in the word
+ * @param partial the words of all the lanes
+ */
+inline void setLaneHits(int hits, int firstLane, int bit, word32* partial) {
+	while (hits != 0) {
+		int lane = __builtin_ctz(hits);
+		partial[firstLane + lane] |= 1u << bit;
+		hits &= hits - 1;
+	}
+}
+
+/**
+ * Fingerprints 4 * VECTORS lanes with AVX2, four lanes per vector register. The bytes of every lane
+ * are loaded 8 at a time and shifted out one by one.
+ *
+ * @param rabin the Rabin data
+ * @param laneData the first byte of every lane
+ * @param laneWords the word of the bit field arrays that gets the first 32 positions of every lane
+ * @param laneLength the length of every lane (a multiple of 32)
+ * @param targets the breakpoint tests and the bit field arrays
+ */
+template<int VECTORS> __attribute__((target("avx2"))) void fingerprintLanesAVX2(rabinData* rabin, const BYTE* const * laneData,
+		const size_t* laneWords, OFFSET_64 laneLength, const laneTargets& targets) {
+	const int LANES = 4 * VECTORS;
+	__m256i fingerprint[VECTORS];
+	word32 partial[LANES], partialBackup[LANES], partialSuper[LANES];
+	for (int v = 0; v < VECTORS; ++v) {
+		fingerprint[v] = _mm256_set_epi64x(warmUpLane(rabin, laneData[4 * v + 3]), warmUpLane(rabin, laneData[4 * v + 2]),
+				warmUpLane(rabin, laneData[4 * v + 1]), warmUpLane(rabin, laneData[4 * v]));
+	}
+	memset(partial, 0, sizeof(partial));
+	memset(partialBackup, 0, sizeof(partialBackup));
+	memset(partialSuper, 0, sizeof(partialSuper));
+
+	const long long* popTable = (const long long*) rabin->popTable;
+	const long long* pushTable = (const long long*) rabin->pushTable;
+	const __m128i shift = _mm_cvtsi32_si128(rabin->shift);
+	const __m256i byteMask = _mm256_set1_epi64x(0xff);
+	const __m256i mask = _mm256_set1_epi64x(targets.mask);
+	const __m256i backupMask = _mm256_set1_epi64x(targets.backupMask);
+	const __m256i superMask = _mm256_set1_epi64x(targets.superMask);
+	const bool backup = targets.backupResults != NULL;
+	const bool super = targets.superResults != NULL;
+	const int winSize = rabin->winSize;
+
+	for (OFFSET_64 pos = 0; pos < laneLength; pos += 8) {
+		__m256i in[VECTORS];
+		__m256i out[VECTORS];
+		for (int v = 0; v < VECTORS; ++v) {
+			long long word[8];
+			for (int l = 0; l < 4; ++l) {
+				memcpy(&word[l], laneData[4 * v + l] + pos, 8);
+				memcpy(&word[4 + l], laneData[4 * v + l] + pos - winSize, 8);
+			}
+			in[v] = _mm256_set_epi64x(word[3], word[2], word[1], word[0]);
+			out[v] = _mm256_set_epi64x(word[7], word[6], word[5], word[4]);
+		}
+
+		for (int k = 0; k < 8; ++k) {
+			int bit = 31 - (int) ((pos + k) % 32);
+			for (int v = 0; v < VECTORS; ++v) {
+				__m256i f = _mm256_xor_si256(fingerprint[v], _mm256_i64gather_epi64(popTable, _mm256_and_si256(out[v], byteMask), 8));
+				__m256i index = _mm256_srl_epi64(f, shift);
+				f = _mm256_or_si256(_mm256_slli_epi64(f, 8), _mm256_and_si256(in[v], byteMask));
+				f = _mm256_xor_si256(f, _mm256_i64gather_epi64(pushTable, index, 8));
+				fingerprint[v] = f;
+				in[v] = _mm256_srli_epi64(in[v], 8);
+				out[v] = _mm256_srli_epi64(out[v], 8);
+
+				// breakpoints are rare, so the bits are only set when a lane has one
+				int hits = _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpeq_epi64(_mm256_and_si256(f, mask), mask)));
+				if (hits != 0) {
+					setLaneHits(hits, 4 * v, bit, partial);
+				}
+				if (backup) {
+					hits = _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpeq_epi64(_mm256_and_si256(f, backupMask), backupMask)));
+					if (hits != 0) {
+						setLaneHits(hits, 4 * v, bit, partialBackup);
+					}
+				}
+				if (super) {
+					hits = _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpeq_epi64(_mm256_and_si256(f, superMask), superMask)));
+					if (hits != 0) {
+						setLaneHits(hits, 4 * v, bit, partialSuper);
+					}
+				}
+			}
+		}
+		if ((pos + 8) % 32 == 0) {
+			flushLaneWords(laneWords, LANES, pos + 8, targets, partial, partialBackup, partialSuper);
+		}
+	}
+}
+
+/**
+ * Tells whether the AVX2 path can be used on this CPU
+ */
+inline bool isAVX2Available() {
+	static const bool available = __builtin_cpu_supports("avx2");
+	return available;
+}
+
+#endif
+
+/**
+ * Fingerprints a number of lanes, with AVX2 when the CPU has it and in scalar code otherwise
+ *
+ * @param rabin the Rabin data
+ * @param laneData the first byte of every lane
+ * @param laneWords the word of the bit field arrays that gets the first 32 positions of every lane
+ * @param lanes the number of lanes (2, 4, 8 or 16)
+ * @param laneLength the length of every lane (a multiple of 32)
+ * @param targets the breakpoint tests and the bit field arrays
+ */
+inline void fingerprintLanes(rabinData* rabin, const BYTE* const * laneData, const size_t* laneWords, int lanes, OFFSET_64 laneLength,
+		const laneTargets& targets) {
+#ifdef MULTILANE_AVX2
+	if (lanes >= 4 && isAVX2Available()) {
+		switch (lanes) {
+		case 4:
+			fingerprintLanesAVX2<1>(rabin, laneData, laneWords, laneLength, targets);
+			return;
+		case 8:
+			fingerprintLanesAVX2<2>(rabin, laneData, laneWords, laneLength, targets);
+			return;
+		default:
+			fingerprintLanesAVX2<4>(rabin, laneData, laneWords, laneLength, targets);
+			return;
+		}
+	}
+#endif
+	switch (lanes) {
+	case 2:
+		fingerprintLanesScalar<2>(rabin, laneData, laneWords, laneLength, targets);
+		break;
+	case 4:
+		fingerprintLanesScalar<4>(rabin, laneData, laneWords, laneLength, targets);
+		break;
+	case 8:
+		fingerprintLanesScalar<8>(rabin, laneData, laneWords, laneLength, targets);
+		break;
+	default:
+		fingerprintLanesScalar<16>(rabin, laneData, laneWords, laneLength, targets);
+		break;
+	}
+}
+
+#endif /* MULTILANECHUNKER_H_ */
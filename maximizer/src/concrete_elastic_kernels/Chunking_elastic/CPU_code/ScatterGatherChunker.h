@@ -0,0 +1,308 @@
+/**
+ * ScatterGatherChunker.h
+ *
+ * Chunking of data that is not contiguous in memory, such as the buffers of a network receive
+ * ring or the extents of a file in the page cache, given as a list of iovecs. Rather than copying
+ * everything into one buffer, the data is fingerprinted where it lies: a chunkerState carries the
+ * fingerprint and the content of the window from one buffer to the next, so a window that spans
+ * the edge between two buffers (or several small ones) gives the same fingerprint as it would in
+ * contiguous data. Only the first winSize bytes of every buffer go through the window; after that
+ * the byte that leaves the window is read straight from the buffer.
+ *
+ * Large buffers are cut into pieces of at most SCATTER_PIECE_SIZE bytes. Consecutive pieces of at
+ * least MIN_SCATTER_LANE_PIECE bytes are fingerprinted together as the lanes of the multi-lane
+ * chunker (see MultiLaneChunker.h), as many at a time as the chunking profile has lanes. Every lane
+ * starts MAX_BUFFER_SIZE bytes into its piece, so the window before it lies in the piece; those first
+ * bytes and whatever a lane does not cover are done in a single pass, in stream order.
+ *
+ * The stream can be fed in any number of calls, as the buffers arrive; nothing is kept pointing into
+ * the buffers once a call returns. Cuts are reported as offsets in the logical stream (the
+ * concatenation of all the buffers) and they are the same as those chunkDataOnHost() finds in the
+ * concatenated data.
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Zahari Dichev <zaharidichev@gmail.com>
+ */
+
+#ifndef SCATTERGATHERCHUNKER_H_
+#define SCATTERGATHERCHUNKER_H_
+
+#include "HostChunker.h"
+#include "ChunkerState.h"
+#include "MultiLaneChunker.h"
+#include <sys/uio.h>
+#include <vector>
+#include <algorithm>
+
+#define SCATTER_PIECE_SIZE (64 << 10) // buffers are cut into pieces of at most this size
+#define MIN_SCATTER_LANE_PIECE 1024 // smaller pieces are not worth a lane
+
+/**
+ * The state of chunking a stream that is fed piece by piece
+ */
+struct streamChunker {
+	rabinData* rabin; // the push/pop tables and the window size
+	chunkerState state; // the fingerprint and the window at the end of what has been fed
+	chunkingContext ctx; // D, D' and the thresholds
+	BreakpointPolicy policy;
+	tttdSelector selector; // selects the cuts (and holds the vector they go into)
+	int lanes; // the number of pieces fingerprinted together
+	std::vector<word32> laneBreakpoints; // the D breakpoints found in the lanes
+	std::vector<word32> laneBackupBreakpoints; // the D' breakpoints found in the lanes
+};
+
+/**
+ * Initializes the chunker for the start of a stream
+ *
+ * @param chunker the chunker
+ * @param rabin the initialized Rabin data
+ * @param ctx the chunking parameters (D, D', the thresholds)
+ * @param policy the policy to be applied
+ * @param cuts the vector into which the cut offsets are added
+ */
+inline void initStreamChunker(streamChunker* chunker, rabinData* rabin, const chunkingContext& ctx, BreakpointPolicy policy,
+		std::vector<OFFSET_64>* cuts) {
+	chunker->rabin = rabin;
+	initChunkerState(&chunker->state, rabin);
+	chunker->ctx = ctx;
+	chunker->policy = policy;
+	initTTTDSelector(&chunker->selector, ctx.minThr, ctx.maxThr, cuts);
+	chunker->lanes = getChunkingLanes();
+}
+
+/**
+ * Hands a position where D or D' matched over to the selection of cuts
+ *
+ * @param chunker the chunker
+ * @param pos the position in the stream
+ * @param isMain whether D matched at that position (otherwise only D' did)
+ */
+inline void addStreamCandidate(streamChunker* chunker, OFFSET_64 pos, bool isMain) {
+	if (chunker->policy == TTTD_MODE) {
+		addTTTDCandidate(&chunker->selector, pos, isMain);
+	} else if (isMain) {
+		chunker->selector.cuts->push_back(pos + 1);
+	}
+}
+
+/**
+ * Tests a fingerprint against D and D' and hands the position over if either of them matched
+ */
+inline void testStreamFingerprint(streamChunker* chunker, OFFSET_64 pos, POLY_64 fingerprint) {
+	bool isMain = bitMod(fingerprint, chunker->ctx.D) == (uint64_t) (chunker->ctx.D - 1);
+	if (isMain || (chunker->policy == TTTD_MODE && bitMod(fingerprint, chunker->ctx.Ddash) == (uint64_t) (chunker->ctx.Ddash - 1))) {
+		addStreamCandidate(chunker, pos, isMain);
+	}
+}
+
+/**
+ * Returns a mask that a fingerprint has to match before it is worth testing. D and D' are powers
+ * of two, so the smaller of the two matches whenever the larger one does.
+ */
+inline POLY_64 getStreamCandidateMask(const streamChunker* chunker) {
+	int divisor = chunker->ctx.D;
+	if (chunker->policy == TTTD_MODE && chunker->ctx.Ddash < divisor) {
+		divisor = chunker->ctx.Ddash;
+	}
+	return divisor - 1;
+}
+
+/**
+ * Fingerprints a range of a piece whose window lies entirely in the piece
+ *
+ * @param chunker the chunker
+ * @param piece the piece
+ * @param from the first position of the range (at least winSize)
+ * @param to the position after the range
+ * @param fingerprint the fingerprint before the range
+ * @param base the position of the piece in the stream
+ * @return the fingerprint after the range
+ */
+inline POLY_64 scanStreamRange(streamChunker* chunker, const BYTE* piece, size_t from, size_t to, POLY_64 fingerprint, OFFSET_64 base) {
+	const POLY_64* popTable = chunker->rabin->popTable;
+	const POLY_64* pushTable = chunker->rabin->pushTable;
+	const int shift = chunker->rabin->shift;
+	const BYTE* out = piece - chunker->rabin->winSize;
+	const POLY_64 mask = getStreamCandidateMask(chunker);
+	for (size_t i = from; i < to; ++i) {
+		fingerprint ^= popTable[out[i]];
+		fingerprint = ((fingerprint << 8) | piece[i]) ^ pushTable[fingerprint >> shift];
+		if ((fingerprint & mask) == mask) {
+			testStreamFingerprint(chunker, base + i, fingerprint);
+		}
+	}
+	return fingerprint;
+}
+
+/**
+ * Chunks the next piece of the stream in a single pass
+ *
+ * @param chunker the chunker
+ * @param data the piece
+ * @param length the length of the piece
+ */
+inline void chunkStreamPiece(streamChunker* chunker, const BYTE* data, size_t length) {
+	rabinData* rabin = chunker->rabin;
+	chunkerState& state = chunker->state;
+	const POLY_64 mask = getStreamCandidateMask(chunker);
+
+	// the window still holds bytes of the previous pieces
+	size_t edge = std::min(length, (size_t) rabin->winSize);
+	POLY_64 fingerprint = state.fingerprint;
+	for (size_t i = 0; i < edge; ++i) {
+		fingerprint = update(rabin, data[i], fingerprint, &state.window);
+		if ((fingerprint & mask) == mask) {
+			testStreamFingerprint(chunker, state.position + i, fingerprint);
+		}
+	}
+
+	if (length > edge) {
+		fingerprint = scanStreamRange(chunker, data, edge, length, fingerprint, state.position);
+		// leave the last winSize bytes of the piece in the window, for the next piece
+		for (size_t i = length - rabin->winSize; i < length; ++i) {
+			push(data[i], &state.window);
+		}
+	}
+	state.fingerprint = fingerprint;
+	state.position += length;
+}
+
+/**
+ * Chunks consecutive pieces of the stream by fingerprinting them as lanes
+ *
+ * @param chunker the chunker
+ * @param pieces the pieces (chunker->lanes of them, each at least MIN_SCATTER_LANE_PIECE bytes)
+ * @param count the number of pieces
+ */
+inline void chunkStreamPiecesInLanes(streamChunker* chunker, const struct iovec* pieces, int count) {
+	rabinData* rabin = chunker->rabin;
+	const size_t laneOffset = MAX_BUFFER_SIZE;
+	size_t laneLength = pieces[0].iov_len;
+	for (int p = 1; p < count; ++p) {
+		laneLength = std::min(laneLength, pieces[p].iov_len);
+	}
+	laneLength = (laneLength - laneOffset) / 32 * 32;
+	size_t wordsPerLane = laneLength / 32;
+
+	const BYTE* laneData[MAX_CHUNKING_LANES];
+	size_t laneWords[MAX_CHUNKING_LANES];
+	for (int p = 0; p < count; ++p) {
+		laneData[p] = (const BYTE*) pieces[p].iov_base + laneOffset;
+		laneWords[p] = p * wordsPerLane;
+	}
+	chunker->laneBreakpoints.resize(count * wordsPerLane);
+	chunker->laneBackupBreakpoints.resize((chunker->policy == TTTD_MODE) ? count * wordsPerLane : 0);
+	laneTargets targets;
+	targets.mask = chunker->ctx.D - 1;
+	targets.backupMask = chunker->ctx.Ddash - 1;
+	targets.superMask = 0;
+	targets.results = &chunker->laneBreakpoints[0];
+	targets.backupResults = (chunker->policy == TTTD_MODE) ? &chunker->laneBackupBreakpoints[0] : NULL;
+	targets.superResults = NULL;
+	fingerprintLanes(rabin, laneData, laneWords, count, laneLength, targets);
+
+	// hand the breakpoints over in stream order, piece by piece
+	for (int p = 0; p < count; ++p) {
+		const BYTE* piece = (const BYTE*) pieces[p].iov_base;
+		size_t length = pieces[p].iov_len;
+		chunkStreamPiece(chunker, piece, laneOffset);
+		OFFSET_64 base = chunker->state.position - laneOffset;
+
+		for (size_t word = 0; word < wordsPerLane; ++word) {
+			word32 main = chunker->laneBreakpoints[laneWords[p] + word];
+			word32 candidates = main | ((chunker->policy == TTTD_MODE) ? chunker->laneBackupBreakpoints[laneWords[p] + word] : 0);
+			while (candidates != 0) {
+				int bit = __builtin_clz(candidates);
+				candidates &= ~(0x80000000u >> bit);
+				addStreamCandidate(chunker, base + laneOffset + word * 32 + bit, (main & (0x80000000u >> bit)) != 0);
+			}
+		}
+
+		size_t tail = laneOffset + laneLength;
+		if (tail < length) {
+			scanStreamRange(chunker, piece, tail, length, warmUpLane(rabin, piece + tail), base);
+		}
+		// the state at the end of the piece only depends on its last winSize bytes
+		initChunkerState(&chunker->state, rabin);
+		advanceChunkerState(&chunker->state, rabin, piece + length - rabin->winSize, rabin->winSize);
+		chunker->state.position = base + length;
+	}
+}
+
+/**
+ * Chunks pieces that were held back to be fingerprinted as lanes, one after the other
+ */
+inline void flushStreamPieces(streamChunker* chunker, const struct iovec* pieces, int count) {
+	for (int p = 0; p < count; ++p) {
+		chunkStreamPiece(chunker, (const BYTE*) pieces[p].iov_base, pieces[p].iov_len);
+	}
+}
+
+/**
+ * Chunks the next buffers of the stream
+ *
+ * @param chunker the chunker
+ * @param buffers the buffers, in stream order (empty ones are skipped)
+ * @param count the number of buffers
+ */
+inline void chunkStreamIovecs(streamChunker* chunker, const struct iovec* buffers, int count) {
+	struct iovec pending[MAX_CHUNKING_LANES];
+	int numPending = 0;
+	for (int b = 0; b < count; ++b) {
+		const BYTE* data = (const BYTE*) buffers[b].iov_base;
+		size_t left = buffers[b].iov_len;
+		while (left > 0) {
+			// a remainder too small for a lane of its own stays with the piece before it
+			size_t length = (left < SCATTER_PIECE_SIZE + MIN_SCATTER_LANE_PIECE) ? left : SCATTER_PIECE_SIZE;
+			if (chunker->lanes > 1 && length >= MIN_SCATTER_LANE_PIECE) {
+				pending[numPending].iov_base = (void*) data;
+				pending[numPending].iov_len = length;
+				if (++numPending == chunker->lanes) {
+					chunkStreamPiecesInLanes(chunker, pending, numPending);
+					numPending = 0;
+				}
+			} else {
+				flushStreamPieces(chunker, pending, numPending);
+				numPending = 0;
+				chunkStreamPiece(chunker, data, length);
+			}
+			data += length;
+			left -= length;
+		}
+	}
+	flushStreamPieces(chunker, pending, numPending);
+}
+
+/**
+ * Finishes the stream. The end of the stream is always the last cut.
+ *
+ * @param chunker the chunker
+ */
+inline void finishStreamChunker(streamChunker* chunker) {
+	OFFSET_64 streamLength = chunker->state.position;
+	if (chunker->policy == TTTD_MODE) {
+		finishTTTDSelection(&chunker->selector, streamLength);
+	} else if (chunker->selector.cuts->empty() || chunker->selector.cuts->back() != streamLength) {
+		chunker->selector.cuts->push_back(streamLength);
+	}
+}
+
+/**
+ * Chunks data that is given as a list of buffers on the host, without copying it into one buffer
+ *
+ * @param rabin the initialized Rabin data
+ * @param buffers the buffers, in stream order
+ * @param count the number of buffers
+ * @param ctx the chunking parameters (D, D', the thresholds)
+ * @param policy the policy to be applied
+ * @param cuts the vector into which the cut offsets (in the concatenation of the buffers) are added
+ */
+inline void chunkScatteredDataOnHost(rabinData* rabin, const struct iovec* buffers, int count, const chunkingContext& ctx,
+		BreakpointPolicy policy, std::vector<OFFSET_64>& cuts) {
+	streamChunker chunker;
+	initStreamChunker(&chunker, rabin, ctx, policy, &cuts);
+	chunkStreamIovecs(&chunker, buffers, count);
+	finishStreamChunker(&chunker);
+}
+
+#endif /* SCATTERGATHERCHUNKER_H_ */
@@ -23,6 +23,8 @@ using namespace boost;
 typedef u_int32_t* bitFieldArray;
 typedef u_int32_t word32;
 
+#define BITS_PER_WORD 32 // every byte of the data is represented by a single bit
+
 /**
  * Calculates the length of a bitField array that is needed for a piece of data of a specified length
  * @param dataLn the length of the data in bytes
@@ -30,7 +32,7 @@ typedef u_int32_t word32;
  */
 
 inline __host__ size_t getSizeOfBitArray(size_t dataLn) {
-	return (dataLn % sizeof(word32) == 0) ? dataLn / sizeof(word32) : (dataLn / sizeof(word32)) + 1;
+	return (dataLn % BITS_PER_WORD == 0) ? dataLn / BITS_PER_WORD : (dataLn / BITS_PER_WORD) + 1;
 
 }
 /**
@@ -82,7 +84,7 @@ inline __host__ bitFieldArray downloadBitFieldArrayFromDevice(size_t size, bitFi
  * @param word the word to be placed
  * @param array a pointer to the array
  */
-inline __device__ __host__ void setWord(int pos, word32 word, bitFieldArray array) {
+inline __device__ __host__ void setWord(size_t pos, word32 word, bitFieldArray array) {
 	array[pos] = word;
 }
 
@@ -100,7 +102,7 @@ inline __host__ void destroyBitFieldArray(bitFieldArray array) {
  * @param x the index
  */
 inline __device__ __host__ void setBit(word32* word, int x) {
-	(*word) |= 1 << x;
+	(*word) |= 1u << x;
 }
 
 /**
@@ -122,9 +124,9 @@ inline __device__ __host__ void setReverseBit(word32* word, int x) {
  */
 inline __device__ __host__ bool getBit(size_t pos, bitFieldArray array) {
 	size_t sizeOfword = sizeof(word32) * 8;
-	int posInArray = (pos) / sizeOfword;
+	size_t posInArray = (pos) / sizeOfword;
 	int bitIndex = (sizeOfword - 1) - (pos % sizeOfword);
-	return (array[posInArray] & (1 << bitIndex));
+	return (array[posInArray] & (1u << bitIndex));
 
 }
 
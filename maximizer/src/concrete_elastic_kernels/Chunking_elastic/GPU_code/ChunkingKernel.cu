@@ -25,17 +25,25 @@ __device__ int getThrID() {
 	return blockIdx.x * blockDim.x + threadIdx.x;
 }
 
-__device__ void getThreadBounds(threadBounds* bounds, int dataLn, int threadsUsed, int thrID, int workPerThr) {
+__device__ void getThreadBounds(threadBounds* bounds, OFFSET_64 dataLn, int threadsUsed, int thrID, OFFSET_64 workPerThr) {
 
-	bounds->start = thrID * workPerThr;
+	bounds->start = (OFFSET_64) thrID * workPerThr;
 
 	//ACCOUTN FOR ANY LEFTOVER DATA THAT CANNOT BE DISTRIBUTED ;)
-	bounds->end = (thrID == threadsUsed - 1) ? bounds->end = dataLn : bounds->start + workPerThr;
+	bounds->end = (thrID == threadsUsed - 1) ? dataLn : bounds->start + workPerThr;
+
+	// work per thread is rounded up, so the last threads might be left with less (or nothing)
+	if (bounds->end > dataLn) {
+		bounds->end = dataLn;
+	}
+	if (bounds->start > bounds->end) {
+		bounds->start = bounds->end;
+	}
 
 }
 
-__global__ void findBreakPointsFreeMode(rabinData* deviceRabin, BYTE* data, int dataLen, bitFieldArray results, int threadsUsed, int workPerThread,
-		int divisor) {
+__global__ void findBreakPointsFreeMode(rabinData* deviceRabin, BYTE* data, OFFSET_64 dataLen, bitFieldArray results, int threadsUsed,
+		OFFSET_64 workPerThread, int divisor) {
 
 	int thrID = getThrID();
 
@@ -47,12 +55,14 @@ __global__ void findBreakPointsFreeMode(rabinData* deviceRabin, BYTE* data, int
 		getThreadBounds(&dataBounds, dataLen, threadsUsed, thrID, workPerThread);
 
 
-		chunkDataFreeMode(deviceRabin, data, dataBounds, divisor, results, threadsUsed);
+		if (dataBounds.start < dataBounds.end) {
+			chunkDataFreeMode(deviceRabin, data, dataBounds, divisor, results, threadsUsed);
+		}
 	}
 }
 
-void startCreateBreakpointsKernel(int blocksSize, int numBlocks, rabinData* deviceRabin, BYTE* deviceData, int dataLen, bitFieldArray results,
-		int threadsUsed, int workPerThread, int D, cudaStream_t stream) {
+void startCreateBreakpointsKernel(int blocksSize, int numBlocks, rabinData* deviceRabin, BYTE* deviceData, OFFSET_64 dataLen, bitFieldArray results,
+		int threadsUsed, OFFSET_64 workPerThread, int D, cudaStream_t stream) {
 	cudaDeviceSetLimit(cudaLimitPrintfFifoSize, 5242880);
 
 
@@ -63,14 +73,90 @@ void startCreateBreakpointsKernel(int blocksSize, int numBlocks, rabinData* devi
 	//cudaThreadSynchronize();
 }
 
-int __host__ getSizeOfBPArray(int dataLn, int minThreshold) {
+/**
+ * Tells whether a block of the data is all zeros. Blocks that start at a multiple of 16 bytes are
+ * read 16 bytes at a time.
+ */
+__device__ bool isZeroBlockOnDevice(const BYTE* block, OFFSET_64 length) {
+	OFFSET_64 pos = 0;
+	if (((size_t) block & 15) == 0) {
+		const uint4* vectors = (const uint4*) block;
+		for (; pos + 16 <= length; pos += 16) {
+			uint4 vector = vectors[pos / 16];
+			if ((vector.x | vector.y | vector.z | vector.w) != 0) {
+				return false;
+			}
+		}
+	}
+	for (; pos < length; ++pos) {
+		if (block[pos] != 0) {
+			return false;
+		}
+	}
+	return true;
+}
+
+/**
+ * Cuts the data into blocks of a fixed size: the last byte of every block is marked as a
+ * breakpoint and the blocks that are all zeros get their bit set in zeroBlocks. No fingerprints
+ * are computed. Every thread takes a multiple of 32 blocks, so it owns the words it writes.
+ */
+__global__ void findFixedBlocks(BYTE* data, OFFSET_64 dataLen, OFFSET_64 blockSize, bitFieldArray results, bitFieldArray zeroBlocks,
+		int threadsUsed, OFFSET_64 blocksPerThread) {
+
+	int thrID = getThrID();
+
+	if (thrID < threadsUsed) {
+		OFFSET_64 numBlocks = (dataLen + blockSize - 1) / blockSize;
+		threadBounds blockBounds;
+		getThreadBounds(&blockBounds, numBlocks, threadsUsed, thrID, blocksPerThread);
+
+		for (OFFSET_64 wordStart = blockBounds.start; wordStart < blockBounds.end; wordStart += BITS_PER_WORD) {
+			word32 zeroWord = 0;
+			OFFSET_64 wordEnd = min(wordStart + BITS_PER_WORD, blockBounds.end);
+			for (OFFSET_64 block = wordStart; block < wordEnd; ++block) {
+				OFFSET_64 start = block * blockSize;
+				OFFSET_64 end = min(start + blockSize, dataLen);
+				if (isZeroBlockOnDevice(data + start, end - start)) {
+					setReverseBit(&zeroWord, (int) (block - wordStart));
+				}
+				setReverseBit(&results[(end - 1) / BITS_PER_WORD], (int) ((end - 1) % BITS_PER_WORD));
+			}
+			setWord(wordStart / BITS_PER_WORD, zeroWord, zeroBlocks);
+		}
+	}
+}
+
+void startFixedBlocksKernel(int blocksSize, int numBlocks, BYTE* deviceData, OFFSET_64 dataLen, OFFSET_64 blockSize, bitFieldArray results,
+		bitFieldArray zeroBlocks, int threadsUsed, OFFSET_64 blocksPerThread, cudaStream_t stream) {
+
+	findFixedBlocks<<<numBlocks, blocksSize,0,stream>>>(deviceData, dataLen, blockSize, results, zeroBlocks, threadsUsed, blocksPerThread);
+
+	gpuErrchk(cudaGetLastError());
+}
+
+size_t __host__ getSizeOfBPArray(size_t dataLn, size_t minThreshold) {
 	return (dataLn % minThreshold == 0) ? dataLn / minThreshold : (dataLn / minThreshold) + 1;
 }
 
- cudaFuncAttributes getChunkingKernelProperties() {
+static cudaFuncAttributes queryChunkingKernelProperties() {
 	cudaFuncAttributes attributes;
 	cudaFuncGetAttributes(&attributes, findBreakPointsFreeMode);
 	return attributes;
 }
 
+cudaFuncAttributes getChunkingKernelProperties() {
+	return getKernelAttributes("findBreakPointsFreeMode", queryChunkingKernelProperties);
+}
+
+static cudaFuncAttributes queryFixedBlocksKernelProperties() {
+	cudaFuncAttributes attributes;
+	cudaFuncGetAttributes(&attributes, findFixedBlocks);
+	return attributes;
+}
+
+cudaFuncAttributes getFixedBlocksKernelProperties() {
+	return getKernelAttributes("findFixedBlocks", queryFixedBlocksKernelProperties);
+}
+
 #endif /* CHUNKINGKERNEL_CU_ */
@@ -0,0 +1,163 @@
+/**
+ * ChunkingProfile.h
+ *
+ * The machine specific parameters for splitting a chunking job between threads, as measured by
+ * the chunking tuner (--tune-chunking): the smallest segment for which another thread pays off
+ * (thread start-up and the warm-up of the window at every segment boundary are not free), the
+ * number of threads beyond which chunking stops getting faster, the number of lanes every thread
+ * fingerprints at the same time and the block size. The profile is
+ * a small key=value text file. It is read once, the first time the parameters are needed, from
+ * the path in ELASTIC_CHUNKING_PROFILE or from ~/.elastic_chunking_profile. A profile that was
+ * written on a machine with a different number of CPUs is ignored.
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Zahari Dichev <zaharidichev@gmail.com>
+ */
+
+#ifndef CHUNKINGPROFILE_H_
+#define CHUNKINGPROFILE_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <string>
+
+#define MIN_WORK_PER_THREAD 262144
+#define DEFAULT_BLOCK_SIZE 160
+#define DEFAULT_CHUNKING_LANES 4
+#define MAX_CHUNKING_LANES 16
+
+/**
+ * How to split a chunking job
+ */
+struct ChunkingProfile {
+	size_t minWorkPerThread; // the smallest amount of data that is worth a thread of its own
+	int maxThreads; // the number of host threads that is never worth exceeding (0 for no limit)
+	int lanes; // the number of lanes every host thread fingerprints at the same time (1, 2, 4, 8 or 16)
+	int blockSize; // the number of threads per block on the device
+	int cpus; // the number of CPUs of the machine the profile was measured on
+	bool tuned; // false when these are just the defaults
+};
+
+/**
+ * Returns the parameters used when there is no profile
+ *
+ * @return the profile
+ */
+inline ChunkingProfile getDefaultChunkingProfile() {
+	ChunkingProfile profile;
+	profile.minWorkPerThread = MIN_WORK_PER_THREAD;
+	profile.maxThreads = 0;
+	profile.lanes = DEFAULT_CHUNKING_LANES;
+	profile.blockSize = DEFAULT_BLOCK_SIZE;
+	profile.cpus = (int) sysconf(_SC_NPROCESSORS_ONLN);
+	profile.tuned = false;
+	return profile;
+}
+
+/**
+ * Returns the path of the profile
+ *
+ * @return ELASTIC_CHUNKING_PROFILE if it is set, ~/.elastic_chunking_profile otherwise
+ */
+inline std::string getChunkingProfilePath() {
+	const char* path = getenv("ELASTIC_CHUNKING_PROFILE");
+	if (path != NULL && path[0] != '\0') {
+		return std::string(path);
+	}
+	const char* home = getenv("HOME");
+	return std::string((home != NULL) ? home : ".") + "/.elastic_chunking_profile";
+}
+
+/**
+ * Reads a profile
+ *
+ * @param path the path of the profile
+ * @param profile receives the profile (keys that are missing keep their default values)
+ * @return false if the file cannot be read or does not contain valid values
+ */
+inline bool loadChunkingProfile(const std::string& path, ChunkingProfile& profile) {
+	FILE* file = fopen(path.c_str(), "r");
+	if (file == NULL) {
+		return false;
+	}
+	profile = getDefaultChunkingProfile();
+	profile.cpus = 0;
+	char line[256];
+	while (fgets(line, sizeof(line), file) != NULL) {
+		char* value = strchr(line, '=');
+		if (line[0] == '#' || value == NULL) {
+			continue;
+		}
+		*value++ = '\0';
+		if (strcmp(line, "min_work_per_thread") == 0) {
+			profile.minWorkPerThread = strtoul(value, NULL, 10);
+		} else if (strcmp(line, "max_threads") == 0) {
+			profile.maxThreads = atoi(value);
+		} else if (strcmp(line, "lanes") == 0) {
+			profile.lanes = atoi(value);
+		} else if (strcmp(line, "block_size") == 0) {
+			profile.blockSize = atoi(value);
+		} else if (strcmp(line, "cpus") == 0) {
+			profile.cpus = atoi(value);
+		}
+	}
+	fclose(file);
+	profile.tuned = true;
+	return profile.minWorkPerThread > 0 && profile.maxThreads >= 0 && profile.lanes > 0 && profile.blockSize > 0 && profile.cpus > 0;
+}
+
+/**
+ * Writes a profile
+ *
+ * @param path the path of the profile
+ * @param profile the profile
+ * @return false if the file cannot be written
+ */
+inline bool saveChunkingProfile(const std::string& path, const ChunkingProfile& profile) {
+	FILE* file = fopen(path.c_str(), "w");
+	if (file == NULL) {
+		return false;
+	}
+	fprintf(file, "# written by --tune-chunking\n");
+	fprintf(file, "cpus=%d\n", profile.cpus);
+	fprintf(file, "min_work_per_thread=%lu\n", (unsigned long) profile.minWorkPerThread);
+	fprintf(file, "max_threads=%d\n", profile.maxThreads);
+	fprintf(file, "lanes=%d\n", profile.lanes);
+	fprintf(file, "block_size=%d\n", profile.blockSize);
+	return fclose(file) == 0;
+}
+
+/**
+ * Reads the profile from its default path, falling back to the defaults
+ *
+ * @return the profile
+ */
+inline ChunkingProfile readMachineChunkingProfile() {
+	ChunkingProfile defaults = getDefaultChunkingProfile();
+	ChunkingProfile profile;
+	if (loadChunkingProfile(getChunkingProfilePath(), profile) && profile.cpus == defaults.cpus) {
+		return profile;
+	}
+	return defaults;
+}
+
+/**
+ * Returns the profile in use, which is read on the first call
+ */
+inline ChunkingProfile& getActiveChunkingProfile() {
+	static ChunkingProfile active = readMachineChunkingProfile();
+	return active;
+}
+
+/**
+ * Replaces the profile in use (the file is not touched)
+ *
+ * @param profile the new profile
+ */
+inline void setActiveChunkingProfile(const ChunkingProfile& profile) {
+	getActiveChunkingProfile() = profile;
+}
+
+#endif /* CHUNKINGPROFILE_H_ */
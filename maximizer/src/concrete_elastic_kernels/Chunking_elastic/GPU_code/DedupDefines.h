@@ -14,6 +14,8 @@
  * Constants
  */
 #define WIN_SIZE 48
+#define IRREDUCIBLE_POLY 0xbfe6b8a5bf378d83 // the irreducible polynomial used for fingerprinting
+#define DEFAULT_FIXED_BLOCK_SIZE 4096 // the size of a chunk in the FIXED_BLOCKS mode
 
 /*
  * Typedefs
@@ -22,9 +24,18 @@
 typedef unsigned char BYTE;
 typedef uint64_t POLY_64;
 typedef uint64_t INT_64;
+typedef int64_t OFFSET_64; // offsets into (and lengths of) data, which can be well over 2 GiB
 
 //typedef Polynomial_128 POLY_128;
 
+/*
+ * How the data is cut into chunks
+ */
+enum ChunkingMode {
+	CONTENT_DEFINED, // boundaries where the Rabin fingerprint hits the divisor
+	FIXED_BLOCKS // every block of a fixed size is a chunk, no fingerprints are computed
+};
+
 
 
 /*aliases to be used for readability*/
@@ -10,9 +10,14 @@
 #include "DedupDefines.h"
 #include "rabin_fingerprint/RabinData.h"
 #include "BitFieldArray.h"
-extern "C" void startCreateBreakpointsKernel(int blocksSize, int numBlocks, rabinData* deviceRabin, BYTE* deviceData, int dataLen, bitFieldArray results,
-		int threadsUsed, int workPerThread, int D, cudaStream_t stream);
+extern "C" void startCreateBreakpointsKernel(int blocksSize, int numBlocks, rabinData* deviceRabin, BYTE* deviceData, OFFSET_64 dataLen,
+		bitFieldArray results, int threadsUsed, OFFSET_64 workPerThread, int D, cudaStream_t stream);
 
 extern "C"  cudaFuncAttributes getChunkingKernelProperties();
 
+extern "C" void startFixedBlocksKernel(int blocksSize, int numBlocks, BYTE* deviceData, OFFSET_64 dataLen, OFFSET_64 blockSize,
+		bitFieldArray results, bitFieldArray zeroBlocks, int threadsUsed, OFFSET_64 blocksPerThread, cudaStream_t stream);
+
+extern "C" cudaFuncAttributes getFixedBlocksKernelProperties();
+
 #endif /* KERNELSTARTER_CH_H_ */
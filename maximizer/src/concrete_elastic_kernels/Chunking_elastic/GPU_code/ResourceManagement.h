@@ -14,15 +14,24 @@
 #include "../../../misc/Macros.h"
 #include "cuda_runtime.h"
 #include "rabin_fingerprint/RabinFingerprint.h"
+#include "BitFieldArray.h"
+#include "ChunkingProfile.h"
 #ifndef FUNKYFUNKS_H_
 #define FUNKYFUNKS_H_
 
-#define MIN_WORK_PER_THREAD 262144
+/**
+ * Returns the determined minimum work per thread in terms of data length in bytes, as the chunking
+ * profile of the machine has it (see ChunkingProfile.h, which falls back to MIN_WORK_PER_THREAD)
+ * @return the minimum work per thread
+ */
+inline size_t getMinWorkPerThread() {
+	return getActiveChunkingProfile().minWorkPerThread;
+}
 
 inline chunkingContext* initChunkingContextOnDevice(size_t minThr, size_t maxThr, size_t breakpointsPerThread, size_t sizeOfBreakpointsArray) {
 
 	chunkingContext ctx;
-	ctx.workPerThread = MIN_WORK_PER_THREAD;
+	ctx.workPerThread = getMinWorkPerThread();
 	ctx.D = 512;
 	ctx.Ddash = 256;
 	ctx.minThr = minThr;
@@ -78,7 +87,7 @@ inline void downloadBreakpointsBufferFromDevice(int* breakpointsBuffer_d, int* b
  * @param minThreshold the minimum threshold of a chunks size
  * @return the maximum number of breakpoints that can be found in the data.
  */
-inline int getSizeOFBreakpointsArray(int dataLn, int minThreshold) {
+inline size_t getSizeOFBreakpointsArray(size_t dataLn, size_t minThreshold) {
 	return (dataLn % minThreshold == 0) ? (dataLn / minThreshold) + 1: (dataLn / minThreshold) + 2;
 
 }
@@ -101,11 +110,16 @@ inline rabinData* allocateDeviceRabinData(POLY_64 irreduciblePolynomial) {
 }
 
 /**
- * Returns the determined minimum work per thread in terms of data length in bytes
- * @return the minimum work per thread
+ * Returns the number of lanes every host thread fingerprints at the same time, taken from the
+ * chunking profile and rounded down to a power of two of at most MAX_CHUNKING_LANES
+ * @return the number of lanes
  */
-inline size_t getMinWorkPerThread() {
-	return MIN_WORK_PER_THREAD;
+inline int getChunkingLanes() {
+	int lanes = 1;
+	while (lanes * 2 <= getActiveChunkingProfile().lanes && lanes * 2 <= MAX_CHUNKING_LANES) {
+		lanes *= 2;
+	}
+	return lanes;
 }
 
 /**
@@ -149,8 +163,12 @@ inline rabinData* initRabinDataOnDevice(POLY_64 irrPoly) {
 	return deviceData;
 
 }
+/**
+ * Returns the number of threads per block, which is 160 unless the machine has a chunking profile
+ * @return the block size
+ */
 inline int getBlockSize() {
-	return 160;
+	return getActiveChunkingProfile().blockSize;
 }
 inline int getNumBlocks(int threadsNeeded) {
 	int blockSize = getBlockSize();
@@ -171,11 +189,41 @@ inline int getNumBlocks(int threadsNeeded) {
  * @param minWorkPerThread the minimum length of the data that each thread is allocated
  * @return the number of threads needed to perform the job
  */
-inline int getNumNeededThreads(int dataLn, int minWorkPerThread) {
-	//int minWorkPerThread = 262144;
+inline int getNumNeededThreads(size_t dataLn, size_t minWorkPerThread) {
+	size_t threads = (dataLn <= minWorkPerThread) ? 1 : dataLn / minWorkPerThread;
+	return (int) threads;
+}
+
+/**
+ * Determines how many threads to use for chunking a piece of data on the host, given how many are
+ * available. The number never exceeds the point beyond which the chunking profile of the machine
+ * found no more speed up.
+ *
+ * @param dataLn the length of the data in bytes
+ * @param availableThreads the number of threads that may be used
+ * @return the number of threads to use
+ */
+inline int getHostChunkingThreads(size_t dataLn, int availableThreads) {
+	int needed = getNumNeededThreads(dataLn, getMinWorkPerThread());
+	int maxThreads = getActiveChunkingProfile().maxThreads;
+	if (maxThreads > 0 && needed > maxThreads) {
+		needed = maxThreads;
+	}
+	return (needed < availableThreads) ? needed : availableThreads;
+}
 
-	//return (dataLn % minSizePerThread != 0) ? (dataLn / minSizePerThread + 1) : dataLn / minSizePerThread;
-	return (dataLn <= getMinWorkPerThread()) ? 1 : dataLn / minWorkPerThread;
+/**
+ * Determines how much data each thread gets when a job is split between a number of threads. The
+ * amount is rounded up to a multiple of 32 bytes, so that every thread covers whole words of the bit
+ * field array and no two threads ever write into the same word. The last thread gets whatever is left.
+ *
+ * @param dataLn the length of the data in bytes
+ * @param threadsUsed the number of threads
+ * @return the length of the data that each thread is allocated
+ */
+inline OFFSET_64 getAlignedWorkPerThread(OFFSET_64 dataLn, int threadsUsed) {
+	OFFSET_64 workPerThread = dataLn / threadsUsed;
+	return ((workPerThread + BITS_PER_WORD - 1) / BITS_PER_WORD) * BITS_PER_WORD;
 }
 
 /**
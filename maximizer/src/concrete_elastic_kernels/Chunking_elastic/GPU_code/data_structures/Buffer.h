@@ -23,6 +23,7 @@
 #define BUFFER_H_
 
 #define BUFFER_SIZE 48
+#define MAX_BUFFER_SIZE 64
 typedef unsigned char BYTE;
 
 /**
@@ -34,8 +35,9 @@ typedef unsigned char BYTE;
  */
 typedef struct {
 	int bufptr;
+	int size; // the number of bytes in the window (at most MAX_BUFFER_SIZE)
 	bool ifFull;
-	unsigned char buf[BUFFER_SIZE];
+	unsigned char buf[MAX_BUFFER_SIZE];
 } byteBuffer;
 
 /**
@@ -47,6 +49,15 @@ typedef struct {
  */
 __host__ __device__ void initBuffer(byteBuffer* buf);
 
+/**
+ * Same as initBuffer(), but allows the size of the window to be specified. This is
+ * used when experimenting with window sizes other than the default one.
+ *
+ * @param buf pointer to the buffer
+ * @param size the size of the window (no more than MAX_BUFFER_SIZE)
+ */
+__host__ __device__ void initBufferOfSize(byteBuffer* buf, int size);
+
 /**
  * Resets the buffer to its initial position. Same as initBuffer(), but different
  * name for readability purposes.
@@ -80,13 +91,17 @@ __host__  __device__ BYTE push(BYTE b, byteBuffer* buf);
 
 
 inline __host__ __device__  void initBuffer(byteBuffer* buf) {
+	initBufferOfSize(buf, BUFFER_SIZE);
+}
+
+inline __host__ __device__  void initBufferOfSize(byteBuffer* buf, int size) {
 
 
 
 	// cannot do that within a CUDA kernel...
 	//memset(buf->buf, 0, BUFFER_SIZE);
 
-	for (int i = 0; i < BUFFER_SIZE; ++i) {
+	for (int i = 0; i < MAX_BUFFER_SIZE; ++i) {
 		//  this little... thing caused me so much trouble... !
 		buf->buf[i] = 0;
 	}
@@ -94,6 +109,7 @@ inline __host__ __device__  void initBuffer(byteBuffer* buf) {
 	// setting the pointer to the beginning of the array
 
 	buf->bufptr = 0;
+	buf->size = size;
 	buf->ifFull = 0;
 }
 
@@ -105,7 +121,7 @@ inline __host__ __device__ void resetBuffer(byteBuffer* buf)
 }
 
 
-inline  __device__  bool isFull(byteBuffer* buf) {
+inline __host__ __device__  bool isFull(byteBuffer* buf) {
 	/*
 	 * simply trusting that push will set the full toggle to
 	 * true when the buffer is indeed full
@@ -113,9 +129,9 @@ inline  __device__  bool isFull(byteBuffer* buf) {
 	return buf->ifFull;
 }
 
-inline __device__  unsigned char push(BYTE b, byteBuffer* buf) {
+inline __host__ __device__  unsigned char push(BYTE b, byteBuffer* buf) {
 
-	if (++buf->bufptr >= BUFFER_SIZE) {
+	if (++buf->bufptr >= buf->size) {
 		/*
 		 * if the buffer is full, wet the pointer to
 		 * point to the first elements pushed
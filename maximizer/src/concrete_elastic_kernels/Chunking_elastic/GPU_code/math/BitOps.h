@@ -46,7 +46,7 @@ inline __host__ __device__ int getLastSetBit(uint64_t number) {
 	return -1;
 }
 
-inline __device__ uint64_t bitMod(uint64_t x, uint64_t d) {
+inline __host__ __device__ uint64_t bitMod(uint64_t x, uint64_t d) {
 	return x & (d - 1);
 }
 
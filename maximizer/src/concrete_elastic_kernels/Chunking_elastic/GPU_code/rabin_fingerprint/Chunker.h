@@ -20,7 +20,7 @@ __device__ int getID() {
 	return blockIdx.x * blockDim.x + threadIdx.x;
 }
 
-__device__ void addBreakPointsInBitArray(bitFieldArray field, u_int32_t breakpoints, int pos) {
+__device__ void addBreakPointsInBitArray(bitFieldArray field, u_int32_t breakpoints, size_t pos) {
 	field[pos] = breakpoints;
 }
 
@@ -28,13 +28,13 @@ __device__ inline void chunkDataFreeMode(rabinData* deviceRabin, BYTE* data, thr
 
 	// create and initialize the local window buffer
 	byteBuffer b;
-	initBuffer(&b);
+	initBufferOfSize(&b, deviceRabin->winSize);
 
 	POLY_64 fingerprint = 0; // the fingerprint that will be used
 
-	if (getID() != 0) {
+	if (bounds.start != 0) {
 
-		for (int var = bounds.start - 48; var < bounds.start; ++var) {
+		for (OFFSET_64 var = bounds.start - deviceRabin->winSize; var < bounds.start; ++var) {
 			fingerprint = update(deviceRabin, data[var], fingerprint, &b);
 
 		}
@@ -44,7 +44,7 @@ __device__ inline void chunkDataFreeMode(rabinData* deviceRabin, BYTE* data, thr
 	//first phase
 
 	u_int32_t partialBreakPoints = 0;
-	for (int pos = bounds.start; pos < bounds.end; ++pos) {
+	for (OFFSET_64 pos = bounds.start; pos < bounds.end; ++pos) {
 		fingerprint = update(deviceRabin, data[pos], fingerprint, &b);
 
 		if (bitMod(fingerprint, D) == D - 1) {
@@ -52,14 +52,18 @@ __device__ inline void chunkDataFreeMode(rabinData* deviceRabin, BYTE* data, thr
 			setReverseBit(&partialBreakPoints, pos % 32);
 		}
 
-		if ((pos + 1) % 32 == 0 && pos != 0) {
+		if ((pos + 1) % 32 == 0) {
 
 			addBreakPointsInBitArray(results, partialBreakPoints, pos / 32);
 			partialBreakPoints = 0;
 		}
 	}
 
-	addBreakPointsInBitArray(results, partialBreakPoints, (bounds.end - 1) / 32);
+	// the bounds start on a word boundary (see getAlignedWorkPerThread()), so only the end can leave a
+	// partially filled word behind. If the end is aligned, that word has already been written above.
+	if (bounds.end % 32 != 0) {
+		addBreakPointsInBitArray(results, partialBreakPoints, bounds.end / 32);
+	}
 
 }
 
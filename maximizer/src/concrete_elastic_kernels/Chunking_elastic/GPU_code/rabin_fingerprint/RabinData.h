@@ -16,12 +16,13 @@ typedef struct {
 	POLY_64 popTable[256]; // mod lookupTable
 	POLY_64 pushTable[256]; // push lookupTable
 	int shift; // size of shift when adding a byte
+	int winSize; // size of the sliding window in bytes
 } rabinData;
 
 
 typedef struct threadBounds {
-	int start;
-	int end;
+	OFFSET_64 start;
+	OFFSET_64 end;
 } threadBounds;
 
 typedef struct chunkingContext {
@@ -29,8 +30,8 @@ typedef struct chunkingContext {
 	int Ddash;
 	int minThr;
 	int maxThr;
-	int workPerThread;
-	int sizeOfBreakpointsArray;
+	OFFSET_64 workPerThread;
+	OFFSET_64 sizeOfBreakpointsArray;
 	int BpreakpointsPerThread;
 
 } chunkingContext;
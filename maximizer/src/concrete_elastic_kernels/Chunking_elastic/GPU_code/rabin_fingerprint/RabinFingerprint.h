@@ -56,6 +56,16 @@
  */
 __host__  void initWindow(rabinData* window, POLY_64 PT);
 
+/**
+ * Same as initWindow(), but with a sliding window of a specified size rather than
+ * the default WIN_SIZE. The size cannot be larger than MAX_BUFFER_SIZE.
+ *
+ * @param window the struct that holds the data for the fingerprint
+ * @param PT the irreducible polynomial that will be used for modding the fingerprint
+ * @param winSize the size of the sliding window in bytes
+ */
+__host__  void initWindowOfSize(rabinData* window, POLY_64 PT, int winSize);
+
 /**
  * Precomputes the results of pushing and popping bytes so that we do not have to
  * do it every single type we update the fingerprint. This trick is borrowed from
@@ -112,7 +122,12 @@ __host__ __device__ POLY_64 update(rabinData* data, BYTE m, POLY_64 fingerprint,
 
 
 inline  __host__  void initWindow(rabinData* window, POLY_64 PT) {
+	initWindowOfSize(window, PT, WIN_SIZE);
+}
+
+inline  __host__  void initWindowOfSize(rabinData* window, POLY_64 PT, int winSize) {
 	window->Irreducble_PT = PT; // set the internal variable to the irreducible poly
+	window->winSize = winSize;
 	precomputeTables(window);
 }
 
@@ -131,7 +146,7 @@ inline  __host__  void initWindow(rabinData* window, POLY_64 PT) {
 	}
 	//printf("\n");
 	INT_64 sizeshift = 1;
-	for (INT_64 i = 1; i < WIN_SIZE; i++)
+	for (int i = 1; i < fingerprintData->winSize; i++)
 		sizeshift = pushAByte(sizeshift, fingerprintData, (BYTE) 0);
 	for (INT_64 i = 0; i < 256; i++) {
 		fingerprintData->popTable[i] = polyModmult(i, sizeshift,
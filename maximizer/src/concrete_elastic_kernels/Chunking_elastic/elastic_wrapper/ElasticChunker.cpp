@@ -6,15 +6,24 @@
  */
 
 #include "ElasticChunker.h"
+#include "../../../misc/CorpusGenerator.h"
 
 ElasticChunker::ElasticChunker() :
-		AbstractElasticKernel(), dataSize(67108864), rabinData_d(0), dataBuffer_d(0), results_d(0) {
-	this->memConsumption = (sizeof(BYTE) * dataSize) + sizeof(rabinData) + (getSizeOfBitArray(dataSize) * 4);
+		AbstractElasticKernel(), dataSize(67108864), rabinData_d(0), dataBuffer_d(0), results_d(0), zeroBlocks_d(0), mode(CONTENT_DEFINED),
+				blockSize(DEFAULT_FIXED_BLOCK_SIZE) {
+	this->memConsumption = (sizeof(BYTE) * dataSize) + sizeof(rabinData) + (getSizeOfBitArray(dataSize) * sizeof(word32));
 }
 
-ElasticChunker::ElasticChunker(LaunchParameters &launchConfig, std::string name, int dataSize) :
-		AbstractElasticKernel(launchConfig, name), dataSize(dataSize), rabinData_d(0), dataBuffer_d(0), results_d(0) {
-	this->memConsumption = (sizeof(BYTE) * dataSize) + sizeof(rabinData) + (getSizeOfBitArray(dataSize) * 16);
+ElasticChunker::ElasticChunker(LaunchParameters &launchConfig, std::string name, size_t dataSize, ChunkingMode mode, size_t blockSize) :
+		AbstractElasticKernel(launchConfig, name), dataSize(dataSize), rabinData_d(0), dataBuffer_d(0), results_d(0), zeroBlocks_d(0), mode(mode),
+				blockSize(blockSize) {
+	this->memConsumption = (sizeof(BYTE) * dataSize) + sizeof(rabinData) + (getSizeOfBitArray(dataSize) * sizeof(word32));
+	if (mode == FIXED_BLOCKS) {
+		this->memConsumption += getSizeOfBitArray(getNumBlocks()) * sizeof(word32);
+	}
+	this->bytesMoved = this->memConsumption;
+	// a step of the rolling fingerprint per byte, or a comparison per byte when looking for zero blocks
+	this->numOperations = dataSize * ((mode == FIXED_BLOCKS) ? 1 : FINGERPRINT_OPS_PER_BYTE);
 
 }
 
@@ -25,33 +34,50 @@ ElasticChunker::~ElasticChunker() {
 void ElasticChunker::initKernel() {
 
 	BYTE* hostBuffer = (BYTE*) malloc(sizeof(BYTE) * dataSize);
-	srand(2);
-	for (int var = 0; var < dataSize; ++var) {
-		hostBuffer[var] = (BYTE) rand() % 256;
-	}
+	// every chunker gets its own data (seeded by its name), which contains duplicate and compressible content
+	CorpusGenerator generator(getDefaultCorpusConfig(hashCorpusName(this->name), dataSize));
+	generator.generateBaseImage(hostBuffer);
 
 	CUDA_CHECK_RETURN(cudaMalloc(&dataBuffer_d, sizeof(BYTE) * dataSize));
 	CUDA_CHECK_RETURN(cudaMemcpy(dataBuffer_d, hostBuffer, dataSize * sizeof(BYTE), cudaMemcpyHostToDevice));
 
 	rabinData hostData;
 
-	initWindow(&hostData, 0xbfe6b8a5bf378d83);
+	initWindow(&hostData, IRREDUCIBLE_POLY);
 	CUDA_CHECK_RETURN(cudaMalloc((void** ) &rabinData_d, sizeof(rabinData)));
 	CUDA_CHECK_RETURN(cudaMemcpy(rabinData_d, &hostData, sizeof(rabinData), cudaMemcpyHostToDevice));
 
-	int numberOfBitWordsNeeded = getSizeOfBitArray(dataSize);
+	size_t numberOfBitWordsNeeded = getSizeOfBitArray(dataSize);
 	this->results_d = createBitFieldArrayOnDevice(numberOfBitWordsNeeded);
+	if (this->mode == FIXED_BLOCKS) {
+		this->zeroBlocks_d = createBitFieldArrayOnDevice(getSizeOfBitArray(getNumBlocks()));
+	}
 	free(hostBuffer);
 }
 
+size_t ElasticChunker::getNumBlocks() {
+	return (this->dataSize + this->blockSize - 1) / this->blockSize;
+}
+
 cudaFuncAttributes ElasticChunker::getKernelProperties() {
+	if (this->mode == FIXED_BLOCKS) {
+		return getFixedBlocksKernelProperties();
+	}
 	return getChunkingKernelProperties();
 }
 
 void ElasticChunker::runKernel(cudaStream_t& streamToRunIn) {
 	size_t totalNumThreads = this->gridConfig.getNumTotalThreads();
 
-	size_t workPerThread = this->dataSize / totalNumThreads;
+	if (this->mode == FIXED_BLOCKS) {
+		// every thread takes whole words of blocks, no fingerprints are computed
+		OFFSET_64 blocksPerThread = getAlignedWorkPerThread(getNumBlocks(), totalNumThreads);
+		startFixedBlocksKernel(gridConfig.getThreadsPerBlock(), gridConfig.getBlocksPerGrid(), this->dataBuffer_d, dataSize, blockSize,
+				this->results_d, this->zeroBlocks_d, totalNumThreads, blocksPerThread, streamToRunIn);
+		return;
+	}
+
+	OFFSET_64 workPerThread = getAlignedWorkPerThread(this->dataSize, totalNumThreads);
 
 	startCreateBreakpointsKernel(gridConfig.getThreadsPerBlock(), gridConfig.getBlocksPerGrid(), this->rabinData_d, this->dataBuffer_d, dataSize,
 			this->results_d, totalNumThreads, workPerThread, 512, streamToRunIn);
@@ -65,4 +91,7 @@ void ElasticChunker::freeResources() {
 	freeCudaResource(this->dataBuffer_d);
 	freeCudaResource(this->rabinData_d);
 	freeCudaResource(this->results_d);
+	if (this->zeroBlocks_d != 0) {
+		freeCudaResource(this->zeroBlocks_d);
+	}
 }
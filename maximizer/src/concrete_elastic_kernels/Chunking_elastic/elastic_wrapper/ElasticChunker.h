@@ -16,16 +16,23 @@
 #include <cuda_runtime.h>
 #include <driver_types.h>
 
+#define FINGERPRINT_OPS_PER_BYTE 8 // the table lookups, shifts and xors that take a byte in and out of the window
+
 
 class ElasticChunker: public AbstractElasticKernel {
 private:
 	BYTE* dataBuffer_d;
 	rabinData* rabinData_d;
 	bitFieldArray results_d;
+	bitFieldArray zeroBlocks_d; // one bit per block in the FIXED_BLOCKS mode
 	size_t dataSize;
+	ChunkingMode mode;
+	size_t blockSize;
+	size_t getNumBlocks();
 public:
 	ElasticChunker();
-	ElasticChunker(LaunchParameters &launchConfig, std::string name, int dataSize);
+	ElasticChunker(LaunchParameters &launchConfig, std::string name, size_t dataSize, ChunkingMode mode = CONTENT_DEFINED,
+			size_t blockSize = DEFAULT_FIXED_BLOCK_SIZE);
 	virtual ~ElasticChunker();
 	void initKernel();
 	void runKernel(cudaStream_t &streamToRunIn);
@@ -45,8 +45,12 @@ extern "C" void startMMKernel(size_t threads, size_t blocks, float* d_M, float*
 
 }
 
-extern "C" cudaFuncAttributes getMMKernelProperties() {
+static cudaFuncAttributes queryMMKernelProperties() {
 	cudaFuncAttributes attributes;
 	cudaFuncGetAttributes(&attributes, MatrixMulKernel);
 	return attributes;
 }
+
+extern "C" cudaFuncAttributes getMMKernelProperties() {
+	return getKernelAttributes("MatrixMulKernel", queryMMKernelProperties);
+}
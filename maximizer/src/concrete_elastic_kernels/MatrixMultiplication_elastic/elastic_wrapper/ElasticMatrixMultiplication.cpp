@@ -17,6 +17,8 @@ ElasticMatrixMultiplication::ElasticMatrixMultiplication(LaunchParameters& launc
 		AbstractElasticKernel(launchConfig, name) {
 	this->matrixWidth = matrixSize;
 	this->memConsumption = matrixWidth * matrixWidth * sizeof(float) * 3;
+	this->bytesMoved = this->memConsumption; // the rows and columns are read again from the caches, not the memory
+	this->numOperations = 2 * (size_t) matrixWidth * matrixWidth * matrixWidth; // a multiply-add per element and step
 
 }
 
@@ -11,6 +11,7 @@
 
 #include "Kernel_Starter_SP.h"
 #include "cuda_runtime.h"
+#include "../../../occupancy_tools/DeviceProfiles.h"
 
 ///////////////////////////////////////////////////////////////////////////////
 // On G80-class hardware 24-bit multiplication takes 4 clocks per warp
@@ -82,12 +83,14 @@ extern "C" void startSPKernel(size_t threads, size_t blocks, float *d_C, float *
 }
 
 
-cudaFuncAttributes getSPKernelProperties() {
-
-		cudaFuncAttributes attributes;
-		cudaFuncGetAttributes(&attributes, scalarProdGPU);
-		return attributes;
+static cudaFuncAttributes querySPKernelProperties() {
+	cudaFuncAttributes attributes;
+	cudaFuncGetAttributes(&attributes, scalarProdGPU);
+	return attributes;
+}
 
+cudaFuncAttributes getSPKernelProperties() {
+	return getKernelAttributes("scalarProdGPU", querySPKernelProperties);
 }
 
 
@@ -21,6 +21,8 @@ ElasticScalarProduct::ElasticScalarProduct(LaunchParameters& launchConfig, std::
 	this->dataSize = VECTOR_N * numElems * sizeof(float);
 	this->dataN = VECTOR_N * numElems;
 	this->memConsumption = (this->dataSize * 2) + RESULT_SZ;
+	this->bytesMoved = this->memConsumption;
+	this->numOperations = 2 * (size_t) this->dataN; // a multiply-add per pair of elements
 
 }
 
@@ -13,6 +13,7 @@
 
 // For the CUDA runtime routines (prefixed with "cuda_")
 #include <cuda_runtime.h>
+#include "../../../occupancy_tools/DeviceProfiles.h"
 
 __global__ void addVectors(int *A, int *B, int numElements, int workPerThread, int totalThreads) {
 	int id = blockDim.x * blockIdx.x + threadIdx.x;
@@ -35,10 +36,14 @@ void startAddVectorsKernel(size_t threads, size_t blocks, int *A, int *B, int nu
 
 }
 
-cudaFuncAttributes getVectorAddKernelProperties() {
+static cudaFuncAttributes queryVectorAddKernelProperties() {
 	cudaFuncAttributes attributes;
 	cudaFuncGetAttributes(&attributes, addVectors);
 	return attributes;
 }
 
+cudaFuncAttributes getVectorAddKernelProperties() {
+	return getKernelAttributes("addVectors", queryVectorAddKernelProperties);
+}
+
 #endif /* VECTORADDITIONKERNEL_CUH_ */
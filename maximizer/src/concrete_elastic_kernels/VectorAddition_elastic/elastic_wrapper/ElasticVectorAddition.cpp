@@ -20,7 +20,10 @@ ElasticVectorAddition::ElasticVectorAddition() :
 ElasticVectorAddition::ElasticVectorAddition(LaunchParameters& launchConfig, std::string name, int numElems) :
 		AbstractElasticKernel(launchConfig, name) {
 	this->numElems = numElems;
+	this->problemSize = numElems; // every thread adds a share of the elements
 	this->memConsumption = (sizeof(int) * this->numElems) * 2;
+	this->bytesMoved = (sizeof(int) * this->numElems) * 3; // both vectors read, the sum written over the second
+	this->numOperations = numElems;
 
 }
 
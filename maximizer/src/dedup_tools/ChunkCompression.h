@@ -0,0 +1,372 @@
+/**
+ * ChunkCompression.h
+ *
+ * Compression of unique chunks before they are placed in containers. There is a built-in LZ77
+ * codec in the style of LZ4 (a single pass with a hash table of recent 4 byte sequences, byte
+ * aligned output, no entropy coding), which is fast enough to keep up with chunking, and zlib
+ * when the code is built with USE_ZLIB. Chunks that would not shrink are stored raw: a large chunk
+ * is first tried on a small sample, so that already compressed data does not pay for a full
+ * compression attempt, and a chunk whose compressed form does not save enough is kept as is. (The
+ * byte entropy of a sample is not used for this, since data built of repeated random strings has
+ * nearly the entropy of random data but still compresses well.)
+ * Chunks are compressed in batches by a number of threads.
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Zahari Dichev <zaharidichev@gmail.com>
+ */
+
+#ifndef CHUNKCOMPRESSION_H_
+#define CHUNKCOMPRESSION_H_
+
+#include "../concrete_elastic_kernels/Chunking_elastic/GPU_code/DedupDefines.h"
+#include <string.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <boost/thread.hpp>
+#include <boost/bind.hpp>
+#ifdef USE_ZLIB
+#include <zlib.h>
+#endif
+
+#define LZ_HASH_LOG 12
+#define LZ_MIN_MATCH 4
+#define LZ_MAX_OFFSET 65535
+#define TRIAL_SAMPLE_SIZE 2048 // chunks larger than twice this are first tried on a sample of this size
+#define MIN_COMPRESSION_GAIN 16 // a compressed chunk has to be at least 1/16 smaller than the raw one
+
+/**
+ * The codec a chunk is stored with
+ */
+enum ChunkCodec {
+	CODEC_NONE = 0, CODEC_LZ = 1, CODEC_ZLIB = 2
+};
+
+/**
+ * Returns the name of a codec
+ *
+ * @param codec the codec
+ * @return the name
+ */
+inline const char* getCodecName(ChunkCodec codec) {
+	switch (codec) {
+	case CODEC_LZ:
+		return "lz";
+	case CODEC_ZLIB:
+		return "zlib";
+	default:
+		return "none";
+	}
+}
+
+/**
+ * Parses the name of a codec
+ *
+ * @param name the name ("none", "lz" or "zlib")
+ * @param codec receives the codec
+ * @return false if the name is unknown or the codec was not built in
+ */
+inline bool parseCodecName(const std::string& name, ChunkCodec& codec) {
+	if (name == "none") {
+		codec = CODEC_NONE;
+	} else if (name == "lz") {
+		codec = CODEC_LZ;
+#ifdef USE_ZLIB
+	} else if (name == "zlib") {
+		codec = CODEC_ZLIB;
+#endif
+	} else {
+		return false;
+	}
+	return true;
+}
+
+/**
+ * Reads four bytes without alignment requirements
+ */
+inline uint32_t readLZSequence(const BYTE* data) {
+	uint32_t sequence;
+	memcpy(&sequence, data, sizeof(sequence));
+	return sequence;
+}
+
+/**
+ * Writes the extension bytes of a length that did not fit in its 4 bits of the token
+ *
+ * @return false if the output is full
+ */
+inline bool writeLZLength(size_t length, BYTE* out, size_t& outPos, size_t capacity) {
+	while (length >= 255) {
+		if (outPos >= capacity) {
+			return false;
+		}
+		out[outPos++] = 255;
+		length -= 255;
+	}
+	if (outPos >= capacity) {
+		return false;
+	}
+	out[outPos++] = (BYTE) length;
+	return true;
+}
+
+/**
+ * Writes a sequence: a token, the literals and, unless this is the last sequence, a match
+ *
+ * @return false if the output is full
+ */
+inline bool writeLZSequence(const BYTE* literals, size_t literalLength, size_t offset, size_t matchLength, BYTE* out, size_t& outPos,
+		size_t capacity) {
+	if (outPos >= capacity) {
+		return false;
+	}
+	size_t matchCode = (matchLength > 0) ? matchLength - LZ_MIN_MATCH : 0;
+	size_t token = outPos++;
+	out[token] = (BYTE) ((std::min(literalLength, (size_t) 15) << 4) | std::min(matchCode, (size_t) 15));
+	if (literalLength >= 15 && !writeLZLength(literalLength - 15, out, outPos, capacity)) {
+		return false;
+	}
+	if (outPos + literalLength > capacity) {
+		return false;
+	}
+	memcpy(out + outPos, literals, literalLength);
+	outPos += literalLength;
+	if (matchLength == 0) {
+		return true;
+	}
+	if (outPos + 2 > capacity) {
+		return false;
+	}
+	out[outPos++] = (BYTE) (offset & 0xff);
+	out[outPos++] = (BYTE) (offset >> 8);
+	return matchCode < 15 || writeLZLength(matchCode - 15, out, outPos, capacity);
+}
+
+/**
+ * Compresses a buffer with the built-in LZ codec
+ *
+ * @param data the buffer
+ * @param length the length of the buffer
+ * @param out the output
+ * @param capacity the size of the output
+ * @return the compressed size or 0 if it does not fit in the output
+ */
+inline size_t compressLZ(const BYTE* data, size_t length, BYTE* out, size_t capacity) {
+	uint32_t table[1 << LZ_HASH_LOG];
+	memset(table, 0, sizeof(table));
+	size_t outPos = 0;
+	size_t anchor = 0;
+	size_t pos = 0;
+
+	while (pos + LZ_MIN_MATCH <= length) {
+		uint32_t sequence = readLZSequence(data + pos);
+		uint32_t hash = (sequence * 2654435761U) >> (32 - LZ_HASH_LOG);
+		size_t candidate = table[hash];
+		table[hash] = pos;
+		if (candidate < pos && pos - candidate <= LZ_MAX_OFFSET && readLZSequence(data + candidate) == sequence) {
+			size_t matchLength = LZ_MIN_MATCH;
+			while (pos + matchLength < length && data[candidate + matchLength] == data[pos + matchLength]) {
+				++matchLength;
+			}
+			if (!writeLZSequence(data + anchor, pos - anchor, pos - candidate, matchLength, out, outPos, capacity)) {
+				return 0;
+			}
+			pos += matchLength;
+			anchor = pos;
+		} else {
+			// move faster through data that does not match
+			pos += 1 + ((pos - anchor) >> 6);
+		}
+	}
+	if (!writeLZSequence(data + anchor, length - anchor, 0, 0, out, outPos, capacity)) {
+		return 0;
+	}
+	return outPos;
+}
+
+/**
+ * Reads the extension bytes of a length
+ *
+ * @return false if the input ends first
+ */
+inline bool readLZLength(const BYTE* in, size_t inLength, size_t& inPos, size_t& length) {
+	BYTE next;
+	do {
+		if (inPos >= inLength) {
+			return false;
+		}
+		next = in[inPos++];
+		length += next;
+	} while (next == 255);
+	return true;
+}
+
+/**
+ * Decompresses a buffer compressed with compressLZ()
+ *
+ * @param in the compressed data
+ * @param inLength the length of the compressed data
+ * @param out the output
+ * @param outLength the exact size of the decompressed data
+ * @return false if the compressed data is corrupt
+ */
+inline bool decompressLZ(const BYTE* in, size_t inLength, BYTE* out, size_t outLength) {
+	size_t inPos = 0;
+	size_t outPos = 0;
+	while (inPos < inLength) {
+		BYTE token = in[inPos++];
+		size_t literalLength = token >> 4;
+		if (literalLength == 15 && !readLZLength(in, inLength, inPos, literalLength)) {
+			return false;
+		}
+		if (inPos + literalLength > inLength || outPos + literalLength > outLength) {
+			return false;
+		}
+		memcpy(out + outPos, in + inPos, literalLength);
+		inPos += literalLength;
+		outPos += literalLength;
+		if (inPos == inLength) {
+			break; // the last sequence has no match
+		}
+
+		if (inPos + 2 > inLength) {
+			return false;
+		}
+		size_t offset = in[inPos] | (in[inPos + 1] << 8);
+		inPos += 2;
+		size_t matchLength = token & 15;
+		if (matchLength == 15 && !readLZLength(in, inLength, inPos, matchLength)) {
+			return false;
+		}
+		matchLength += LZ_MIN_MATCH;
+		if (offset == 0 || offset > outPos || outPos + matchLength > outLength) {
+			return false;
+		}
+		// byte by byte, since the match may overlap the bytes it produces
+		for (size_t i = 0; i < matchLength; ++i, ++outPos) {
+			out[outPos] = out[outPos - offset];
+		}
+	}
+	return outPos == outLength;
+}
+
+/**
+ * Compresses a chunk, falling back to storing it raw when that is not worth it
+ *
+ * @param codec the preferred codec
+ * @param data the chunk
+ * @param length the length of the chunk
+ * @param out receives the compressed chunk (left empty when the chunk is stored raw)
+ * @return the codec that was actually used
+ */
+inline ChunkCodec compressChunk(ChunkCodec codec, const BYTE* data, size_t length, std::vector<BYTE>& out) {
+	out.clear();
+	if (codec == CODEC_NONE || length < 64) {
+		return CODEC_NONE;
+	}
+	size_t limit = length - length / MIN_COMPRESSION_GAIN;
+	if (length > 2 * TRIAL_SAMPLE_SIZE) {
+		// a sample has less history to match against than the whole chunk, so it only has to shrink at all
+		BYTE trial[TRIAL_SAMPLE_SIZE];
+		if (compressLZ(data + (length - TRIAL_SAMPLE_SIZE) / 2, TRIAL_SAMPLE_SIZE, trial, TRIAL_SAMPLE_SIZE - 1) == 0) {
+			return CODEC_NONE;
+		}
+	}
+	size_t compressed = 0;
+	if (codec == CODEC_LZ) {
+		out.resize(limit);
+		compressed = compressLZ(data, length, &out[0], limit);
+#ifdef USE_ZLIB
+	} else if (codec == CODEC_ZLIB) {
+		uLongf destLength = compressBound(length);
+		out.resize(destLength);
+		if (compress2(&out[0], &destLength, data, length, Z_BEST_SPEED) == Z_OK && destLength < limit) {
+			compressed = destLength;
+		}
+#endif
+	}
+	if (compressed == 0) {
+		out.clear();
+		return CODEC_NONE;
+	}
+	out.resize(compressed);
+	return codec;
+}
+
+/**
+ * Decompresses a chunk
+ *
+ * @param codec the codec the chunk was stored with
+ * @param in the stored chunk
+ * @param storedLength the stored length
+ * @param out the output
+ * @param length the length of the chunk
+ * @return false if the chunk cannot be decompressed
+ */
+inline bool decompressChunk(ChunkCodec codec, const BYTE* in, size_t storedLength, BYTE* out, size_t length) {
+	switch (codec) {
+	case CODEC_NONE:
+		if (storedLength != length) {
+			return false;
+		}
+		memcpy(out, in, length);
+		return true;
+	case CODEC_LZ:
+		return decompressLZ(in, storedLength, out, length);
+#ifdef USE_ZLIB
+	case CODEC_ZLIB: {
+		uLongf destLength = length;
+		return uncompress(out, &destLength, in, storedLength) == Z_OK && destLength == length;
+	}
+#endif
+	default:
+		return false;
+	}
+}
+
+/**
+ * A chunk after the compression stage
+ */
+struct CompressedChunk {
+	ChunkCodec codec; // CODEC_NONE when the chunk is stored raw
+	std::vector<BYTE> data; // the compressed chunk (empty when stored raw)
+};
+
+/**
+ * Compresses a range of chunks. This is what every thread runs in compressChunks().
+ */
+inline void compressChunkRange(ChunkCodec codec, const std::vector<const BYTE*>* chunks, const std::vector<size_t>* lengths,
+		std::vector<CompressedChunk>* compressed, size_t from, size_t to) {
+	for (size_t chunk = from; chunk < to; ++chunk) {
+		(*compressed)[chunk].codec = compressChunk(codec, (*chunks)[chunk], (*lengths)[chunk], (*compressed)[chunk].data);
+	}
+}
+
+/**
+ * Compresses a batch of chunks by using a number of threads
+ *
+ * @param codec the preferred codec
+ * @param chunks the start of every chunk
+ * @param lengths the length of every chunk
+ * @param threadsUsed the number of threads
+ * @param compressed receives one compressed chunk per chunk
+ */
+inline void compressChunks(ChunkCodec codec, const std::vector<const BYTE*>& chunks, const std::vector<size_t>& lengths, int threadsUsed,
+		std::vector<CompressedChunk>& compressed) {
+	compressed.resize(chunks.size());
+	size_t chunksPerThread = chunks.size() / threadsUsed + 1;
+	boost::thread_group workers;
+	for (size_t from = 0; from < chunks.size(); from += chunksPerThread) {
+		size_t to = std::min(from + chunksPerThread, chunks.size());
+		if (to == chunks.size()) {
+			// the calling thread takes the last range itself
+			compressChunkRange(codec, &chunks, &lengths, &compressed, from, to);
+			break;
+		}
+		workers.create_thread(boost::bind(&compressChunkRange, codec, &chunks, &lengths, &compressed, from, to));
+	}
+	workers.join_all();
+}
+
+#endif /* CHUNKCOMPRESSION_H_ */
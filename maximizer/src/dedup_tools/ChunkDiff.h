@@ -0,0 +1,560 @@
+/**
+ * ChunkDiff.h
+ *
+ * Chunk level differencing of two versions of a file, meant for synchronising files between
+ * hosts. The receiver chunks its (old) version and sends the manifest, which is just the list of
+ * chunk digests and offsets. The sender chunks the new version, looks every chunk up in a hash map
+ * built out of the manifest and emits a patch that contains only the chunks the receiver does not
+ * have, together with a recipe for reassembling the new version out of the old file and the patch.
+ * Since content defined chunking resynchronises right after an edit, a mostly unchanged file gives
+ * a patch that is not much larger than the edits themselves.
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Zahari Dichev <zaharidichev@gmail.com>
+ */
+
+#ifndef CHUNKDIFF_H_
+#define CHUNKDIFF_H_
+
+#include "DedupPipeline.h"
+#include "ChunkDigest.h"
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <string>
+#include <vector>
+#include <boost/unordered_map.hpp>
+
+#define MANIFEST_MAGIC 0x4d414e32 // "MAN2"
+#define PATCH_MAGIC 0x50415432 // "PAT2"
+#define MAX_STORED_OFFSET (~(uint64_t) 0 >> 1) // the largest stored value that fits an OFFSET_64
+
+/**
+ * A chunk of a file
+ */
+struct ManifestEntry {
+	ChunkDigest digest;
+	OFFSET_64 offset;
+	uint32_t length;
+};
+
+/**
+ * The list of chunks of a file
+ */
+struct ChunkManifest {
+	OFFSET_64 fileSize;
+	std::vector<ManifestEntry> entries;
+};
+
+/**
+ * Where a piece of the new file comes from
+ */
+enum RecipeSource {
+	FROM_OLD_FILE, FROM_PATCH
+};
+
+/**
+ * A piece of the new file. Neighbouring chunks that come from neighbouring places are merged
+ * into a single operation.
+ */
+struct RecipeOperation {
+	uint32_t source; // a RecipeSource
+	OFFSET_64 offset; // the offset in the old file or in the data of the patch
+	OFFSET_64 length;
+};
+
+/**
+ * A patch: the recipe, the data of the chunks that are new and the digest of the manifest of the
+ * new file (see computeManifestDigest()), which is used to check the result once the patch is applied
+ */
+struct ChunkPatch {
+	OFFSET_64 newFileSize;
+	ChunkDigest newFileDigest;
+	std::vector<RecipeOperation> recipe;
+	std::vector<BYTE> data;
+};
+
+/**
+ * A read only memory mapping of a whole file
+ */
+struct MappedFile {
+	BYTE* data;
+	OFFSET_64 size;
+};
+
+/**
+ * Maps a file into memory
+ *
+ * @param path the path of the file
+ * @param file receives the mapping
+ * @return false if the file could not be mapped
+ */
+inline bool mapFile(const std::string& path, MappedFile& file) {
+	file.data = NULL;
+	file.size = 0;
+	int fd = open(path.c_str(), O_RDONLY);
+	if (fd < 0) {
+		fprintf(stderr, "Cannot open %s\n", path.c_str());
+		return false;
+	}
+	struct stat fileStat;
+	if (fstat(fd, &fileStat) != 0) {
+		close(fd);
+		return false;
+	}
+	file.size = fileStat.st_size;
+	if (file.size > 0) {
+		void* mapping = mmap(NULL, file.size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (mapping == MAP_FAILED) {
+			close(fd);
+			return false;
+		}
+		madvise(mapping, file.size, MADV_SEQUENTIAL);
+		file.data = (BYTE*) mapping;
+	}
+	close(fd);
+	return true;
+}
+
+/**
+ * Releases a mapping created with mapFile()
+ *
+ * @param file the mapping
+ */
+inline void unmapFile(MappedFile& file) {
+	if (file.data != NULL) {
+		munmap(file.data, file.size);
+		file.data = NULL;
+	}
+}
+
+/**
+ * Chunks a buffer and computes the digests of all its chunks
+ *
+ * @param rabin the initialized Rabin data
+ * @param data the buffer
+ * @param dataLen the length of the buffer
+ * @param config the chunking parameters
+ * @param manifest receives the chunks
+ */
+inline void buildChunkManifest(rabinData* rabin, BYTE* data, OFFSET_64 dataLen, const DedupConfig& config, ChunkManifest& manifest) {
+	manifest.fileSize = dataLen;
+	manifest.entries.clear();
+	if (dataLen == 0) {
+		return;
+	}
+	std::vector<OFFSET_64> cuts;
+	std::vector<word32> zeroChunks;
+	if (config.mode == FIXED_BLOCKS) {
+		chunkDataInFixedBlocks(data, dataLen, config.blockSize, config.threads, cuts, zeroChunks);
+	} else {
+		chunkDataOnHost(rabin, data, dataLen, config.ctx, config.policy, getHostChunkingThreads(dataLen, config.threads), cuts);
+	}
+	std::vector<ChunkDigest> digests;
+	computeChunkDigests(data, cuts, config.threads, digests, zeroChunks.empty() ? NULL : &zeroChunks[0]);
+
+	manifest.entries.resize(cuts.size());
+	for (size_t c = 0; c < cuts.size(); ++c) {
+		manifest.entries[c].digest = digests[c];
+		manifest.entries[c].offset = (c == 0) ? 0 : cuts[c - 1];
+		manifest.entries[c].length = cuts[c] - manifest.entries[c].offset;
+	}
+}
+
+/**
+ * Computes the digest of a whole file out of its manifest: the SHA-1 of the digests and the lengths
+ * of its chunks, in order. The chunk digests are already computed in parallel, so this takes a pass
+ * over the manifest instead of another pass over the data.
+ *
+ * @param manifest the manifest of the file
+ * @return the digest
+ */
+inline ChunkDigest computeManifestDigest(const ChunkManifest& manifest) {
+	const size_t entrySize = DIGEST_SIZE + 4;
+	std::vector<BYTE> entries(manifest.entries.size() * entrySize);
+	for (size_t e = 0; e < manifest.entries.size(); ++e) {
+		BYTE* entry = &entries[e * entrySize];
+		memcpy(entry, manifest.entries[e].digest.bytes, DIGEST_SIZE);
+		for (int b = 0; b < 4; ++b) {
+			entry[DIGEST_SIZE + b] = (BYTE) (manifest.entries[e].length >> (8 * b));
+		}
+	}
+	return computeChunkDigest(entries.empty() ? NULL : &entries[0], entries.size());
+}
+
+/**
+ * Appends an operation to a recipe, merging it with the last one if they are contiguous
+ */
+inline void appendRecipeOperation(std::vector<RecipeOperation>& recipe, RecipeSource source, OFFSET_64 offset, OFFSET_64 length) {
+	if (!recipe.empty()) {
+		RecipeOperation& last = recipe.back();
+		if (last.source == (uint32_t) source && last.offset + last.length == offset) {
+			last.length += length;
+			return;
+		}
+	}
+	RecipeOperation operation;
+	operation.source = source;
+	operation.offset = offset;
+	operation.length = length;
+	recipe.push_back(operation);
+}
+
+/**
+ * Creates the patch that turns the old version of a file into the new one
+ *
+ * @param oldManifest the manifest of the old version
+ * @param newData the new version
+ * @param newManifest the manifest of the new version
+ * @param patch receives the patch
+ */
+inline void createChunkPatch(const ChunkManifest& oldManifest, const BYTE* newData, const ChunkManifest& newManifest, ChunkPatch& patch) {
+	boost::unordered_map<ChunkDigest, OFFSET_64> oldChunks(oldManifest.entries.size());
+	for (size_t e = 0; e < oldManifest.entries.size(); ++e) {
+		oldChunks.insert(std::make_pair(oldManifest.entries[e].digest, oldManifest.entries[e].offset));
+	}
+	// chunks that repeat within the new version go into the patch only once
+	boost::unordered_map<ChunkDigest, OFFSET_64> patchChunks;
+
+	patch.newFileSize = newManifest.fileSize;
+	patch.newFileDigest = computeManifestDigest(newManifest);
+	patch.recipe.clear();
+	patch.data.clear();
+
+	for (size_t e = 0; e < newManifest.entries.size(); ++e) {
+		const ManifestEntry& entry = newManifest.entries[e];
+		boost::unordered_map<ChunkDigest, OFFSET_64>::const_iterator old = oldChunks.find(entry.digest);
+		if (old != oldChunks.end()) {
+			appendRecipeOperation(patch.recipe, FROM_OLD_FILE, old->second, entry.length);
+			continue;
+		}
+		boost::unordered_map<ChunkDigest, OFFSET_64>::const_iterator inPatch = patchChunks.find(entry.digest);
+		if (inPatch != patchChunks.end()) {
+			appendRecipeOperation(patch.recipe, FROM_PATCH, inPatch->second, entry.length);
+			continue;
+		}
+		OFFSET_64 patchOffset = patch.data.size();
+		patch.data.insert(patch.data.end(), newData + entry.offset, newData + entry.offset + entry.length);
+		patchChunks.insert(std::make_pair(entry.digest, patchOffset));
+		appendRecipeOperation(patch.recipe, FROM_PATCH, patchOffset, entry.length);
+	}
+}
+
+/**
+ * Applies a patch to the old version of a file. The result is checked by chunking it with the
+ * parameters the patch was created with and comparing the digest of its manifest.
+ *
+ * @param rabin the initialized Rabin data
+ * @param config the chunking parameters
+ * @param oldData the old version
+ * @param oldSize the size of the old version
+ * @param patch the patch
+ * @param output receives the new version
+ * @return false if the patch does not fit the old file or the result does not match the digest
+ */
+inline bool applyChunkPatch(rabinData* rabin, const DedupConfig& config, const BYTE* oldData, OFFSET_64 oldSize, const ChunkPatch& patch,
+		std::vector<BYTE>& output) {
+	// every operation is checked before anything is allocated, in a form that cannot overflow
+	OFFSET_64 dataSize = patch.data.size();
+	OFFSET_64 total = 0;
+	for (size_t o = 0; o < patch.recipe.size(); ++o) {
+		const RecipeOperation& operation = patch.recipe[o];
+		OFFSET_64 sourceSize = operation.source == FROM_OLD_FILE ? oldSize : dataSize;
+		if (operation.source != FROM_OLD_FILE && operation.source != FROM_PATCH) {
+			return false;
+		}
+		if (operation.offset < 0 || operation.length < 0 || operation.length > sourceSize
+				|| operation.offset > sourceSize - operation.length) {
+			return false;
+		}
+		if (operation.length > patch.newFileSize - total) {
+			return false;
+		}
+		total += operation.length;
+	}
+	if (total != patch.newFileSize) {
+		return false;
+	}
+	output.resize(patch.newFileSize);
+	OFFSET_64 written = 0;
+	for (size_t o = 0; o < patch.recipe.size(); ++o) {
+		const RecipeOperation& operation = patch.recipe[o];
+		if (operation.length == 0) {
+			continue;
+		}
+		const BYTE* source = operation.source == FROM_OLD_FILE ? oldData : &patch.data[0];
+		memcpy(&output[0] + written, source + operation.offset, operation.length);
+		written += operation.length;
+	}
+	ChunkManifest outputManifest;
+	buildChunkManifest(rabin, output.empty() ? NULL : &output[0], output.size(), config, outputManifest);
+	return computeManifestDigest(outputManifest) == patch.newFileDigest;
+}
+
+/**
+ * Writes an unsigned integer into a file in little endian byte order
+ *
+ * @param file the file
+ * @param value the value
+ * @param size the number of bytes to write
+ * @return false on failure
+ */
+inline bool writeLittleEndian(FILE* file, uint64_t value, size_t size) {
+	unsigned char bytes[8];
+	for (size_t b = 0; b < size; ++b) {
+		bytes[b] = (unsigned char) (value >> (8 * b));
+	}
+	return fwrite(bytes, 1, size, file) == size;
+}
+
+/**
+ * Reads an unsigned integer written with writeLittleEndian()
+ *
+ * @param file the file
+ * @param value receives the value
+ * @param size the number of bytes to read
+ * @return false on failure
+ */
+inline bool readLittleEndian(FILE* file, uint64_t& value, size_t size) {
+	unsigned char bytes[8];
+	if (fread(bytes, 1, size, file) != size) {
+		return false;
+	}
+	value = 0;
+	for (size_t b = 0; b < size; ++b) {
+		value |= (uint64_t) bytes[b] << (8 * b);
+	}
+	return true;
+}
+
+/**
+ * Writes a manifest into a file. Every field is written on its own in little endian byte order, so
+ * the file does not depend on the padding of the structures: the magic (4 bytes), the size of the
+ * file (8), the number of entries (8) and then the digest (20), the offset (8) and the length (4) of
+ * every entry.
+ *
+ * @param path the path of the file
+ * @param manifest the manifest
+ * @return false on failure
+ */
+inline bool writeChunkManifest(const std::string& path, const ChunkManifest& manifest) {
+	FILE* file = fopen(path.c_str(), "wb");
+	if (file == NULL) {
+		return false;
+	}
+	bool ok = writeLittleEndian(file, MANIFEST_MAGIC, 4) && writeLittleEndian(file, manifest.fileSize, 8)
+			&& writeLittleEndian(file, manifest.entries.size(), 8);
+	for (size_t e = 0; ok && e < manifest.entries.size(); ++e) {
+		const ManifestEntry& entry = manifest.entries[e];
+		ok = fwrite(entry.digest.bytes, 1, DIGEST_SIZE, file) == DIGEST_SIZE && writeLittleEndian(file, entry.offset, 8)
+				&& writeLittleEndian(file, entry.length, 4);
+	}
+	fclose(file);
+	return ok;
+}
+
+/**
+ * Reads a manifest from a file
+ *
+ * @param path the path of the file
+ * @param manifest receives the manifest
+ * @return false on failure
+ */
+inline bool readChunkManifest(const std::string& path, ChunkManifest& manifest) {
+	FILE* file = fopen(path.c_str(), "rb");
+	if (file == NULL) {
+		return false;
+	}
+	uint64_t magic = 0;
+	uint64_t fileSize = 0;
+	uint64_t count = 0;
+	bool ok = readLittleEndian(file, magic, 4) && magic == MANIFEST_MAGIC && readLittleEndian(file, fileSize, 8)
+			&& readLittleEndian(file, count, 8) && fileSize <= MAX_STORED_OFFSET;
+	manifest.fileSize = fileSize;
+	manifest.entries.clear();
+	for (uint64_t e = 0; ok && e < count; ++e) {
+		ManifestEntry entry;
+		uint64_t offset = 0;
+		uint64_t length = 0;
+		ok = fread(entry.digest.bytes, 1, DIGEST_SIZE, file) == DIGEST_SIZE && readLittleEndian(file, offset, 8)
+				&& readLittleEndian(file, length, 4) && offset <= MAX_STORED_OFFSET;
+		entry.offset = offset;
+		entry.length = length;
+		manifest.entries.push_back(entry);
+	}
+	fclose(file);
+	return ok;
+}
+
+/**
+ * Writes a patch into a file. As with the manifest, every field is written on its own in little
+ * endian byte order: the magic (4 bytes), the size of the new file (8), its digest (20), the number
+ * of recipe operations (8), the size of the data (8), the source (4), the offset (8) and the length
+ * (8) of every operation and then the data.
+ *
+ * @param path the path of the file
+ * @param patch the patch
+ * @return false on failure
+ */
+inline bool writeChunkPatch(const std::string& path, const ChunkPatch& patch) {
+	FILE* file = fopen(path.c_str(), "wb");
+	if (file == NULL) {
+		return false;
+	}
+	uint64_t dataSize = patch.data.size();
+	bool ok = writeLittleEndian(file, PATCH_MAGIC, 4) && writeLittleEndian(file, patch.newFileSize, 8)
+			&& fwrite(patch.newFileDigest.bytes, 1, DIGEST_SIZE, file) == DIGEST_SIZE && writeLittleEndian(file, patch.recipe.size(), 8)
+			&& writeLittleEndian(file, dataSize, 8);
+	for (size_t o = 0; ok && o < patch.recipe.size(); ++o) {
+		const RecipeOperation& operation = patch.recipe[o];
+		ok = writeLittleEndian(file, operation.source, 4) && writeLittleEndian(file, operation.offset, 8)
+				&& writeLittleEndian(file, operation.length, 8);
+	}
+	if (ok && dataSize > 0) {
+		ok = fwrite(&patch.data[0], 1, dataSize, file) == dataSize;
+	}
+	fclose(file);
+	return ok;
+}
+
+/**
+ * Reads a patch from a file
+ *
+ * @param path the path of the file
+ * @param patch receives the patch
+ * @return false on failure
+ */
+inline bool readChunkPatch(const std::string& path, ChunkPatch& patch) {
+	FILE* file = fopen(path.c_str(), "rb");
+	if (file == NULL) {
+		return false;
+	}
+	uint64_t magic = 0;
+	uint64_t newFileSize = 0;
+	uint64_t operations = 0;
+	uint64_t dataSize = 0;
+	bool ok = readLittleEndian(file, magic, 4) && magic == PATCH_MAGIC && readLittleEndian(file, newFileSize, 8)
+			&& fread(patch.newFileDigest.bytes, 1, DIGEST_SIZE, file) == DIGEST_SIZE && readLittleEndian(file, operations, 8)
+			&& readLittleEndian(file, dataSize, 8);
+	// the data can not be larger than what is left of the file
+	struct stat status;
+	ok = ok && newFileSize <= MAX_STORED_OFFSET && fstat(fileno(file), &status) == 0
+			&& dataSize <= (uint64_t) status.st_size - (uint64_t) ftell(file);
+	patch.newFileSize = newFileSize;
+	patch.recipe.clear();
+	for (uint64_t o = 0; ok && o < operations; ++o) {
+		RecipeOperation operation;
+		uint64_t source = 0;
+		uint64_t offset = 0;
+		uint64_t length = 0;
+		ok = readLittleEndian(file, source, 4) && readLittleEndian(file, offset, 8) && readLittleEndian(file, length, 8)
+				&& (source == FROM_OLD_FILE || source == FROM_PATCH) && offset <= MAX_STORED_OFFSET && length <= MAX_STORED_OFFSET;
+		operation.source = source;
+		operation.offset = offset;
+		operation.length = length;
+		patch.recipe.push_back(operation);
+	}
+	if (ok) {
+		patch.data.resize(dataSize);
+		ok = dataSize == 0 || fread(&patch.data[0], 1, dataSize, file) == dataSize;
+	}
+	fclose(file);
+	return ok;
+}
+
+/**
+ * Command line front end of the diff tool.
+ *
+ * Usage: --chunk-diff manifest FILE MANIFEST_OUT
+ *        --chunk-diff diff OLD_MANIFEST NEW_FILE PATCH_OUT
+ *        --chunk-diff apply OLD_FILE PATCH NEW_FILE_OUT
+ *
+ * @param argc the number of arguments
+ * @param argv the arguments
+ * @return 0 on success
+ */
+inline int runChunkDiff(int argc, char** argv) {
+	std::string command((argc > 0) ? argv[0] : "");
+	if (argc != ((command == "manifest") ? 3 : 4)) {
+		fprintf(stderr, "Usage: --chunk-diff manifest FILE MANIFEST_OUT\n"
+				"       --chunk-diff diff OLD_MANIFEST NEW_FILE PATCH_OUT\n"
+				"       --chunk-diff apply OLD_FILE PATCH NEW_FILE_OUT\n");
+		return 1;
+	}
+	int threads = (int) boost::thread::hardware_concurrency();
+	DedupConfig config = getDefaultDedupConfig((threads > 0) ? threads : 1);
+	rabinData rabin;
+	initWindow(&rabin, IRREDUCIBLE_POLY);
+
+	if (command == "manifest") {
+		MappedFile file;
+		if (!mapFile(argv[1], file)) {
+			return 1;
+		}
+		ChunkManifest manifest;
+		buildChunkManifest(&rabin, file.data, file.size, config, manifest);
+		unmapFile(file);
+		if (!writeChunkManifest(argv[2], manifest)) {
+			fprintf(stderr, "Cannot write %s\n", argv[2]);
+			return 1;
+		}
+		printf("%lu chunks\n", (unsigned long) manifest.entries.size());
+		return 0;
+	}
+
+	if (command == "diff") {
+		ChunkManifest oldManifest;
+		if (!readChunkManifest(argv[1], oldManifest)) {
+			fprintf(stderr, "Cannot read the manifest %s\n", argv[1]);
+			return 1;
+		}
+		MappedFile file;
+		if (!mapFile(argv[2], file)) {
+			return 1;
+		}
+		ChunkManifest newManifest;
+		ChunkPatch patch;
+		buildChunkManifest(&rabin, file.data, file.size, config, newManifest);
+		createChunkPatch(oldManifest, file.data, newManifest, patch);
+		unmapFile(file);
+		if (!writeChunkPatch(argv[3], patch)) {
+			fprintf(stderr, "Cannot write %s\n", argv[3]);
+			return 1;
+		}
+		printf("%lu chunks, %lu recipe operations, %lu bytes of new data (%.2f%% of the file)\n", (unsigned long) newManifest.entries.size(),
+				(unsigned long) patch.recipe.size(), (unsigned long) patch.data.size(),
+				(patch.newFileSize > 0) ? 100.0 * patch.data.size() / patch.newFileSize : 0.0);
+		return 0;
+	}
+
+	if (command == "apply") {
+		ChunkPatch patch;
+		if (!readChunkPatch(argv[2], patch)) {
+			fprintf(stderr, "Cannot read the patch %s\n", argv[2]);
+			return 1;
+		}
+		MappedFile file;
+		if (!mapFile(argv[1], file)) {
+			return 1;
+		}
+		std::vector<BYTE> output;
+		bool ok = applyChunkPatch(&rabin, config, file.data, file.size, patch, output);
+		unmapFile(file);
+		if (!ok) {
+			fprintf(stderr, "The patch does not apply to %s\n", argv[1]);
+			return 1;
+		}
+		if (!writeWholeFile(argv[3], output)) {
+			return 1;
+		}
+		return 0;
+	}
+
+	fprintf(stderr, "Unknown command %s\n", command.c_str());
+	return 1;
+}
+
+#endif /* CHUNKDIFF_H_ */
@@ -0,0 +1,136 @@
+/**
+ * ChunkDigest.h
+ *
+ * The digest that identifies the content of a chunk. Two chunks with the same digest are
+ * treated as duplicates, therefore a cryptographic hash (SHA-1) is used. The file also
+ * provides the hashing function needed for using digests as keys in unordered maps and a
+ * function for computing the digests of all the chunks of a buffer in parallel, which skips the
+ * chunks already known to be all zeros.
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Zahari Dichev <zaharidichev@gmail.com>
+ */
+
+#ifndef CHUNKDIGEST_H_
+#define CHUNKDIGEST_H_
+
+#include "../concrete_elastic_kernels/Chunking_elastic/GPU_code/DedupDefines.h"
+#include <string.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <boost/thread.hpp>
+#include <boost/bind.hpp>
+#include "openssl/sha.h"
+#include "../concrete_elastic_kernels/Chunking_elastic/GPU_code/BitFieldArray.h"
+
+#define DIGEST_SIZE SHA_DIGEST_LENGTH
+
+struct ChunkDigest {
+	unsigned char bytes[DIGEST_SIZE];
+
+	bool operator==(const ChunkDigest& other) const {
+		return memcmp(this->bytes, other.bytes, DIGEST_SIZE) == 0;
+	}
+
+	bool operator!=(const ChunkDigest& other) const {
+		return !(*this == other);
+	}
+
+	bool operator<(const ChunkDigest& other) const {
+		return memcmp(this->bytes, other.bytes, DIGEST_SIZE) < 0;
+	}
+};
+
+/**
+ * Hashes a digest for unordered containers. The digest is already uniformly distributed,
+ * so its first bytes are good enough.
+ *
+ * @param digest the digest
+ * @return the hash
+ */
+inline std::size_t hash_value(const ChunkDigest& digest) {
+	std::size_t hash;
+	memcpy(&hash, digest.bytes, sizeof(hash));
+	return hash;
+}
+
+/**
+ * Computes the digest of a chunk
+ *
+ * @param data the start of the chunk
+ * @param length the length of the chunk
+ * @return the digest
+ */
+inline ChunkDigest computeChunkDigest(const BYTE* data, size_t length) {
+	ChunkDigest digest;
+	SHA1(data, length, digest.bytes);
+	return digest;
+}
+
+/**
+ * Computes the digests of a range of chunks. This is what every thread runs in computeChunkDigests().
+ * A zero chunk is hashed only if the previous zero chunk of the range had a different length.
+ */
+inline void computeChunkDigestRange(const BYTE* data, const std::vector<OFFSET_64>* cuts, std::vector<ChunkDigest>* digests, size_t from,
+		size_t to, bitFieldArray zeroChunks) {
+	ChunkDigest zeroDigest;
+	OFFSET_64 zeroDigestLength = -1;
+	for (size_t chunk = from; chunk < to; ++chunk) {
+		OFFSET_64 start = (chunk == 0) ? 0 : (*cuts)[chunk - 1];
+		OFFSET_64 length = (*cuts)[chunk] - start;
+		if (zeroChunks != NULL && getBit(chunk, zeroChunks)) {
+			if (length != zeroDigestLength) {
+				zeroDigest = computeChunkDigest(data + start, length);
+				zeroDigestLength = length;
+			}
+			(*digests)[chunk] = zeroDigest;
+			continue;
+		}
+		(*digests)[chunk] = computeChunkDigest(data + start, length);
+	}
+}
+
+/**
+ * Computes the digests of all the chunks in a buffer by using a number of threads
+ *
+ * @param data the buffer
+ * @param cuts the cut offsets of the chunks (the end of every chunk)
+ * @param threadsUsed the number of threads
+ * @param digests the vector that receives one digest per chunk
+ * @param zeroChunks if not NULL, one bit per chunk that is set for the chunks that are all zeros (see
+ *        chunkDataInFixedBlocks()); those are not hashed one by one
+ */
+inline void computeChunkDigests(const BYTE* data, const std::vector<OFFSET_64>& cuts, int threadsUsed, std::vector<ChunkDigest>& digests,
+		bitFieldArray zeroChunks = NULL) {
+	digests.resize(cuts.size());
+	size_t chunksPerThread = cuts.size() / threadsUsed + 1;
+	boost::thread_group workers;
+	for (size_t from = 0; from < cuts.size(); from += chunksPerThread) {
+		size_t to = std::min(from + chunksPerThread, cuts.size());
+		if (to == cuts.size()) {
+			// the calling thread takes the last range itself
+			computeChunkDigestRange(data, &cuts, &digests, from, to, zeroChunks);
+			break;
+		}
+		workers.create_thread(boost::bind(&computeChunkDigestRange, data, &cuts, &digests, from, to, zeroChunks));
+	}
+	workers.join_all();
+}
+
+/**
+ * Returns the hexadecimal representation of a digest
+ *
+ * @param digest the digest
+ * @return the string
+ */
+inline std::string digestToHex(const ChunkDigest& digest) {
+	char hex[DIGEST_SIZE * 2 + 1];
+	for (int i = 0; i < DIGEST_SIZE; ++i) {
+		sprintf(hex + i * 2, "%02x", digest.bytes[i]);
+	}
+	return std::string(hex);
+}
+
+#endif /* CHUNKDIGEST_H_ */
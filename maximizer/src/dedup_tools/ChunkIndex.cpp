@@ -0,0 +1,117 @@
+/**
+ * ChunkIndex.cpp
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Zahari Dichev <zaharidichev@gmail.com>
+ */
+
+#include "ChunkIndex.h"
+
+ChunkIndex::ChunkIndex(const ContainerStore* store, size_t cachedContainers) :
+		store(store), cachedContainers(cachedContainers) {
+	memset(&this->statistics, 0, sizeof(IndexStatistics));
+	if (this->cachedContainers == 0) {
+		this->cachedContainers = 1;
+	}
+}
+
+ChunkIndex::~ChunkIndex() {
+}
+
+bool ChunkIndex::touchContainer(ContainerID id) {
+	boost::unordered_map<ContainerID, std::list<ContainerID>::iterator>::iterator position = this->cachePositions.find(id);
+	if (position != this->cachePositions.end()) {
+		// already cached, just move it to the front
+		this->recentlyUsed.splice(this->recentlyUsed.begin(), this->recentlyUsed, position->second);
+		return false;
+	}
+
+	if (this->recentlyUsed.size() == this->cachedContainers) {
+		// evict the least recently used container together with all its digests
+		ContainerID victim = this->recentlyUsed.back();
+		const std::vector<ChunkDigest>& digests = this->store->getContainerDigests(victim);
+		for (std::vector<ChunkDigest>::const_iterator it = digests.begin(); it != digests.end(); ++it) {
+			this->cache.erase(*it);
+		}
+		this->cachePositions.erase(victim);
+		this->recentlyUsed.pop_back();
+	}
+	this->recentlyUsed.push_front(id);
+	this->cachePositions[id] = this->recentlyUsed.begin();
+	return true;
+}
+
+void ChunkIndex::loadContainer(ContainerID id) {
+	const std::vector<ChunkDigest>& digests = this->store->getContainerDigests(id);
+	const std::vector<ChunkLocation>& locations = this->store->getContainerLocations(id);
+	for (size_t i = 0; i < digests.size(); ++i) {
+		this->cache[digests[i]] = locations[i];
+	}
+}
+
+void ChunkIndex::prefetchContainer(ContainerID id) {
+	if (!touchContainer(id)) {
+		return;
+	}
+	++this->statistics.prefetches;
+	loadContainer(id);
+}
+
+bool ChunkIndex::lookupRepresentative(const ChunkDigest& representative) {
+	boost::unordered_map<ChunkDigest, ContainerID>::iterator it = this->representatives.find(representative);
+	if (it == this->representatives.end()) {
+		return false;
+	}
+	++this->statistics.representativeHits;
+	prefetchContainer(it->second);
+	return true;
+}
+
+bool ChunkIndex::lookup(const ChunkDigest& digest, ChunkLocation& location) {
+	++this->statistics.lookups;
+
+	boost::unordered_map<ChunkDigest, ChunkLocation>::iterator cached = this->cache.find(digest);
+	if (cached != this->cache.end()) {
+		++this->statistics.cacheHits;
+		location = cached->second;
+		touchContainer(location.container);
+		return true;
+	}
+
+	// not in memory, so this is the expensive path
+	++this->statistics.fullIndexLookups;
+	boost::unordered_map<ChunkDigest, ChunkLocation>::iterator indexed = this->fullIndex.find(digest);
+	if (indexed == this->fullIndex.end()) {
+		return false;
+	}
+	++this->statistics.fullIndexHits;
+	location = indexed->second;
+	prefetchContainer(location.container);
+	return true;
+}
+
+void ChunkIndex::insert(const ChunkDigest& digest, const ChunkLocation& location) {
+	this->fullIndex[digest] = location;
+	if (touchContainer(location.container)) {
+		// the open container was evicted (or is new), so the chunks it already holds have to come back with it,
+		// or a later prefetch would find it cached with only the chunks added since
+		loadContainer(location.container);
+	}
+	this->cache[digest] = location;
+}
+
+void ChunkIndex::insertRepresentative(const ChunkDigest& representative, ContainerID container) {
+	this->representatives.insert(std::make_pair(representative, container));
+}
+
+size_t ChunkIndex::getNumChunks() const {
+	return this->fullIndex.size();
+}
+
+size_t ChunkIndex::getNumRepresentatives() const {
+	return this->representatives.size();
+}
+
+const IndexStatistics& ChunkIndex::getStatistics() const {
+	return this->statistics;
+}
@@ -0,0 +1,127 @@
+/**
+ * ChunkIndex.h
+ *
+ * The index that maps chunk digests to the place where the chunks are stored. It has three parts:
+ *
+ * - the full index, which knows about every chunk. This is the part that would live on disk in a
+ *   real system, so every lookup in it is counted as an expensive one;
+ * - the representative index, which is small enough to be kept in memory. It maps the
+ *   representative digest of every super chunk (its smallest digest) to the container in which
+ *   the super chunk was placed;
+ * - a cache of whole containers. When a super chunk representative is found, or a chunk is found
+ *   in the full index, the digests of its whole container are prefetched, so the chunks that
+ *   follow are found in memory.
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Zahari Dichev <zaharidichev@gmail.com>
+ */
+
+#ifndef CHUNKINDEX_H_
+#define CHUNKINDEX_H_
+
+#include "ChunkDigest.h"
+#include "ContainerStore.h"
+#include <list>
+#include <boost/unordered_map.hpp>
+
+/**
+ * Counters that show how well the index does
+ */
+struct IndexStatistics {
+	size_t lookups; // all the lookups
+	size_t cacheHits; // lookups answered by the container cache
+	size_t fullIndexLookups; // lookups that had to go to the full index
+	size_t fullIndexHits; // lookups in the full index that found the chunk
+	size_t representativeHits; // super chunks whose representative was known
+	size_t prefetches; // containers loaded into the cache
+};
+
+class ChunkIndex {
+private:
+	const ContainerStore* store;
+	boost::unordered_map<ChunkDigest, ChunkLocation> fullIndex;
+	boost::unordered_map<ChunkDigest, ContainerID> representatives;
+
+	// the container cache, with the least recently used container at the back of the list
+	size_t cachedContainers;
+	std::list<ContainerID> recentlyUsed;
+	boost::unordered_map<ContainerID, std::list<ContainerID>::iterator> cachePositions;
+	boost::unordered_map<ChunkDigest, ChunkLocation> cache;
+
+	IndexStatistics statistics;
+
+	/**
+	 * Marks a container as the most recently used one, adding it to the cache if needed and
+	 * evicting the least recently used container if the cache is full
+	 *
+	 * @param id the container
+	 * @return true if the container was not in the cache
+	 */
+	bool touchContainer(ContainerID id);
+
+	/**
+	 * Puts the digests of all the chunks of a container into the cache
+	 *
+	 * @param id the container
+	 */
+	void loadContainer(ContainerID id);
+
+public:
+	/**
+	 * Creates an empty index
+	 *
+	 * @param store the store whose containers are prefetched
+	 * @param cachedContainers how many containers the cache holds
+	 */
+	ChunkIndex(const ContainerStore* store, size_t cachedContainers = 64);
+
+	/**
+	 * Loads the digests of a whole container into the cache
+	 *
+	 * @param id the container
+	 */
+	void prefetchContainer(ContainerID id);
+
+	/**
+	 * Looks up the representative of a super chunk. If it is known, the container in which
+	 * the super chunk was placed is prefetched.
+	 *
+	 * @param representative the representative digest
+	 * @return true if the representative was found
+	 */
+	bool lookupRepresentative(const ChunkDigest& representative);
+
+	/**
+	 * Looks up a chunk, first in the cache and then in the full index. A hit in the full index
+	 * prefetches the container of the chunk.
+	 *
+	 * @param digest the digest of the chunk
+	 * @param location receives the location of the chunk if it is found
+	 * @return true if the chunk is a duplicate
+	 */
+	bool lookup(const ChunkDigest& digest, ChunkLocation& location);
+
+	/**
+	 * Adds a new chunk to the index (and to the cache, since the open container is the hottest one)
+	 *
+	 * @param digest the digest of the chunk
+	 * @param location where the chunk was stored
+	 */
+	void insert(const ChunkDigest& digest, const ChunkLocation& location);
+
+	/**
+	 * Adds the representative of a super chunk
+	 *
+	 * @param representative the representative digest
+	 * @param container the container in which the super chunk was placed
+	 */
+	void insertRepresentative(const ChunkDigest& representative, ContainerID container);
+
+	size_t getNumChunks() const;
+	size_t getNumRepresentatives() const;
+	const IndexStatistics& getStatistics() const;
+
+	virtual ~ChunkIndex();
+};
+
+#endif /* CHUNKINDEX_H_ */
@@ -0,0 +1,136 @@
+/**
+ * ContainerStore.cpp
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Zahari Dichev <zaharidichev@gmail.com>
+ */
+
+#include "ContainerStore.h"
+#include <stdio.h>
+
+ContainerStore::ContainerStore(size_t containerCapacity, bool keepData) :
+		containerCapacity(containerCapacity), keepData(keepData), storedBytes(0), uncompressedBytes(0) {
+}
+
+ContainerStore::~ContainerStore() {
+}
+
+void ContainerStore::openNewContainer() {
+	this->seal();
+	Container container;
+	container.id = this->containers.size();
+	container.size = 0;
+	container.sealed = false;
+	this->containers.push_back(container);
+}
+
+void ContainerStore::beginSuperChunk(size_t superChunkSize) {
+	if (this->containers.empty() || this->containers.back().sealed) {
+		openNewContainer();
+		return;
+	}
+	Container& open = this->containers.back();
+	// a super chunk that does not fit even in an empty container is simply spread over several
+	if (open.size > 0 && open.size + superChunkSize > this->containerCapacity) {
+		openNewContainer();
+	}
+}
+
+ChunkLocation ContainerStore::addChunk(const ChunkDigest& digest, const BYTE* data, size_t length) {
+	return addCompressedChunk(digest, data, length, length, CODEC_NONE);
+}
+
+ChunkLocation ContainerStore::addCompressedChunk(const ChunkDigest& digest, const BYTE* stored, size_t storedLength, size_t length,
+		ChunkCodec codec) {
+	if (this->containers.empty() || this->containers.back().sealed
+			|| (this->containers.back().size > 0 && this->containers.back().size + storedLength > this->containerCapacity)) {
+		openNewContainer();
+	}
+	Container& open = this->containers.back();
+
+	ChunkLocation location;
+	location.container = open.id;
+	location.offset = open.size;
+	location.length = length;
+	location.storedLength = storedLength;
+	location.codec = codec;
+
+	open.digests.push_back(digest);
+	open.locations.push_back(location);
+	if (this->keepData) {
+		open.data.insert(open.data.end(), stored, stored + storedLength);
+	}
+	open.size += storedLength;
+	this->storedBytes += storedLength;
+	this->uncompressedBytes += length;
+	return location;
+}
+
+const std::vector<ChunkDigest>& ContainerStore::getContainerDigests(ContainerID id) const {
+	return this->containers[id].digests;
+}
+
+const std::vector<ChunkLocation>& ContainerStore::getContainerLocations(ContainerID id) const {
+	return this->containers[id].locations;
+}
+
+bool ContainerStore::readChunk(const ChunkLocation& location, BYTE* out) const {
+	if (!this->keepData || location.container >= this->containers.size()) {
+		return false;
+	}
+	const Container& container = this->containers[location.container];
+	if ((size_t) location.offset + location.storedLength > container.data.size()) {
+		return false;
+	}
+	return decompressChunk((ChunkCodec) location.codec, &container.data[location.offset], location.storedLength, out, location.length);
+}
+
+bool ContainerStore::readContainerRange(ContainerID id, size_t offset, size_t length, BYTE* out) const {
+	if (!this->keepData || id >= this->containers.size() || offset + length > this->containers[id].data.size()) {
+		return false;
+	}
+	memcpy(out, &this->containers[id].data[offset], length);
+	return true;
+}
+
+bool ContainerStore::saveContainers(const std::string& directory) const {
+	if (!this->keepData) {
+		return false;
+	}
+	for (size_t c = 0; c < this->containers.size(); ++c) {
+		const std::vector<BYTE>& data = this->containers[c].data;
+		FILE* file = fopen(getContainerFileName(directory, c).c_str(), "wb");
+		if (file == NULL) {
+			return false;
+		}
+		size_t written = data.empty() ? 0 : fwrite(&data[0], 1, data.size(), file);
+		if (fclose(file) != 0 || written != data.size()) {
+			return false;
+		}
+	}
+	return true;
+}
+
+std::string ContainerStore::getContainerFileName(const std::string& directory, ContainerID id) {
+	char name[32];
+	snprintf(name, sizeof(name), "/%08u.container", id);
+	return directory + name;
+}
+
+void ContainerStore::seal() {
+	if (!this->containers.empty()) {
+		this->containers.back().sealed = true;
+	}
+}
+
+size_t ContainerStore::getNumContainers() const {
+	return this->containers.size();
+}
+
+OFFSET_64 ContainerStore::getStoredBytes() const {
+	return this->storedBytes;
+}
+
+OFFSET_64 ContainerStore::getUncompressedBytes() const {
+	return this->uncompressedBytes;
+}
@@ -0,0 +1,172 @@
+/**
+ * ContainerStore.h
+ *
+ * Unique chunks are not stored one by one but are packed into containers of a fixed capacity,
+ * in the order in which they are first seen (after the compression stage, so the capacity is in
+ * stored bytes). Since chunks that were written together tend to be read (and deduplicated
+ * against) together, a whole container worth of chunk digests can be prefetched into the index
+ * cache at once. Placement is done per super chunk: the new chunks of
+ * a super chunk are kept in the same container whenever they fit in one.
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Zahari Dichev <zaharidichev@gmail.com>
+ */
+
+#ifndef CONTAINERSTORE_H_
+#define CONTAINERSTORE_H_
+
+#include "ChunkDigest.h"
+#include "ChunkCompression.h"
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+typedef uint32_t ContainerID;
+
+/**
+ * Where a chunk is stored
+ */
+struct ChunkLocation {
+	ContainerID container; // the container that holds the chunk
+	uint32_t offset; // the offset of the chunk in the data section of the container
+	uint32_t length; // the length of the chunk
+	uint32_t storedLength; // the number of bytes the chunk takes in the container
+	uint32_t codec; // the ChunkCodec the chunk is stored with
+};
+
+/**
+ * A container consists of a metadata section (the digests of the chunks and their locations with
+ * the codec and the stored size of every chunk, in order) and a data section (the stored chunks
+ * themselves, one after the other). The metadata section is only kept in memory; saveContainers()
+ * writes the data section alone, and the codec and the stored size of a saved chunk come from the
+ * ChunkLocation in the recipe of the file it belongs to.
+ */
+struct Container {
+	ContainerID id;
+	std::vector<ChunkDigest> digests;
+	std::vector<ChunkLocation> locations;
+	std::vector<BYTE> data;
+	size_t size; // the number of stored bytes in the container (also when the data is not kept)
+	bool sealed; // no more chunks are added to a sealed container
+};
+
+class ContainerStore {
+private:
+	std::vector<Container> containers; // the last one is the open container
+	size_t containerCapacity; // the capacity of a container in bytes
+	bool keepData; // whether the chunk data is kept or only the metadata
+	OFFSET_64 storedBytes; // the total stored size of all the chunks in the store
+	OFFSET_64 uncompressedBytes; // the total size of all the chunks before compression
+
+	/**
+	 * Seals the open container (if any) and opens a new one
+	 */
+	void openNewContainer();
+
+public:
+	/**
+	 * Creates an empty store
+	 *
+	 * @param containerCapacity the capacity of each container in bytes
+	 * @param keepData when false only the metadata is kept, which is enough for measuring deduplication
+	 */
+	ContainerStore(size_t containerCapacity = 4194304, bool keepData = true);
+
+	/**
+	 * Announces that the chunks of a new super chunk are about to be added. If they do not fit into
+	 * what is left of the open container, a new one is opened so the super chunk is not split.
+	 *
+	 * @param superChunkSize the size of the super chunk (or an upper bound of its new data)
+	 */
+	void beginSuperChunk(size_t superChunkSize);
+
+	/**
+	 * Adds a chunk to the open container
+	 *
+	 * @param digest the digest of the chunk
+	 * @param data the chunk data
+	 * @param length the length of the chunk
+	 * @return where the chunk was stored
+	 */
+	ChunkLocation addChunk(const ChunkDigest& digest, const BYTE* data, size_t length);
+
+	/**
+	 * Adds a chunk that has already gone through the compression stage to the open container
+	 *
+	 * @param digest the digest of the chunk
+	 * @param stored the chunk as it is to be stored
+	 * @param storedLength the length of the stored chunk
+	 * @param length the length of the chunk before compression
+	 * @param codec the codec the chunk was compressed with
+	 * @return where the chunk was stored
+	 */
+	ChunkLocation addCompressedChunk(const ChunkDigest& digest, const BYTE* stored, size_t storedLength, size_t length, ChunkCodec codec);
+
+	/**
+	 * Returns the digests of all the chunks in a container, which is what gets prefetched into the index cache
+	 *
+	 * @param id the container
+	 * @return the digests in the order in which the chunks are stored
+	 */
+	const std::vector<ChunkDigest>& getContainerDigests(ContainerID id) const;
+
+	/**
+	 * Returns the locations of all the chunks in a container, in the same order as getContainerDigests()
+	 *
+	 * @param id the container
+	 * @return the locations
+	 */
+	const std::vector<ChunkLocation>& getContainerLocations(ContainerID id) const;
+
+	/**
+	 * Copies a chunk out of the store, decompressing it if needed
+	 *
+	 * @param location the location of the chunk
+	 * @param out the buffer that receives the chunk (at least location.length bytes)
+	 * @return false if the data is not kept, the location is not valid or the chunk cannot be decompressed
+	 */
+	bool readChunk(const ChunkLocation& location, BYTE* out) const;
+
+	/**
+	 * Copies a contiguous range of the data section of a container
+	 *
+	 * @param id the container
+	 * @param offset the start of the range
+	 * @param length the length of the range
+	 * @param out the buffer that receives the range
+	 * @return false if the data is not kept or the range is not valid
+	 */
+	bool readContainerRange(ContainerID id, size_t offset, size_t length, BYTE* out) const;
+
+	/**
+	 * Writes the data section of every container into its own file in a directory (see
+	 * getContainerFileName()). The metadata does not have to be saved, since the recipes of the
+	 * stored data hold the complete location of every chunk.
+	 *
+	 * @param directory an existing directory
+	 * @return false if the data is not kept or a file could not be written
+	 */
+	bool saveContainers(const std::string& directory) const;
+
+	/**
+	 * Returns the name of the file that saveContainers() writes a container into
+	 *
+	 * @param directory the directory
+	 * @param id the container
+	 * @return the path of the file
+	 */
+	static std::string getContainerFileName(const std::string& directory, ContainerID id);
+
+	/**
+	 * Seals the open container. Nothing more is added to it.
+	 */
+	void seal();
+
+	size_t getNumContainers() const;
+	OFFSET_64 getStoredBytes() const;
+	OFFSET_64 getUncompressedBytes() const;
+
+	virtual ~ContainerStore();
+};
+
+#endif /* CONTAINERSTORE_H_ */
@@ -0,0 +1,625 @@
+/**
+ * DedupPipeline.h
+ *
+ * Puts the pieces of deduplication together: the data is chunked on the host (chunks and super
+ * chunks in a single pass), the chunks are hashed and every super chunk is then deduplicated
+ * against the index. The representative of a super chunk is looked up first, so that a hit
+ * prefetches the container that most likely holds the rest of the super chunk. The new chunks of
+ * a super chunk are compressed as a batch by a number of threads and are placed in containers
+ * per super chunk.
+ *
+ * In the FIXED_BLOCKS mode the data is cut into blocks of blockSize bytes instead (see
+ * FixedBlockChunker.h), super chunks are runs of superD / blockSize blocks and the blocks that
+ * are all zeros are not hashed one by one.
+ *
+ * Instead of the index, a sparse index (see SparseIndex.h) can be used when the digests of the data
+ * do not fit into memory. Every super chunk is then deduplicated against the few segments the
+ * sparse index selects for it.
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Zahari Dichev <zaharidichev@gmail.com>
+ */
+
+#ifndef DEDUPPIPELINE_H_
+#define DEDUPPIPELINE_H_
+
+#include "../concrete_elastic_kernels/Chunking_elastic/CPU_code/HostChunker.h"
+#include "../concrete_elastic_kernels/Chunking_elastic/CPU_code/FixedBlockChunker.h"
+#include "ChunkDigest.h"
+#include "ContainerStore.h"
+#include "ChunkIndex.h"
+#include "SparseIndex.h"
+#include "ChunkCompression.h"
+#include "RestoreEngine.h"
+#include "../misc/WallClockTimer.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+#include <boost/shared_ptr.hpp>
+
+/**
+ * The parameters of the deduplication
+ */
+struct DedupConfig {
+	ChunkingMode mode;
+	size_t blockSize; // the size of a chunk in the FIXED_BLOCKS mode
+	chunkingContext ctx; // D, D' and the thresholds
+	BreakpointPolicy policy;
+	int threads; // the number of threads used for hashing and compression, and at most for chunking
+	int superD; // the divisor used for super chunk boundaries
+	size_t maxChunksPerSuperChunk;
+	ChunkCodec codec; // the codec new chunks are compressed with
+};
+
+/**
+ * The results of deduplicating some data
+ */
+struct DedupStatistics {
+	OFFSET_64 logicalBytes; // all the data that was seen
+	OFFSET_64 uniqueBytes; // the data that had to be stored
+	OFFSET_64 storedBytes; // the unique data after compression
+	size_t chunks;
+	size_t uniqueChunks;
+	size_t superChunks;
+	size_t rawChunks; // unique chunks stored without compression
+	size_t zeroChunks; // chunks that were all zeros and were not hashed
+};
+
+/**
+ * Returns a configuration for content defined chunks of about 4 KiB and super chunks of about 256
+ * chunks, compressed with the built-in LZ codec
+ *
+ * @param threads the number of threads
+ * @return the configuration
+ */
+inline DedupConfig getDefaultDedupConfig(int threads) {
+	DedupConfig config;
+	config.mode = CONTENT_DEFINED;
+	config.blockSize = DEFAULT_FIXED_BLOCK_SIZE;
+	memset(&config.ctx, 0, sizeof(chunkingContext));
+	config.ctx.D = 4096;
+	config.ctx.Ddash = 2048;
+	config.ctx.minThr = 2048;
+	config.ctx.maxThr = 16384;
+	config.policy = TTTD_MODE;
+	config.threads = threads;
+	config.superD = config.ctx.D * 256;
+	config.maxChunksPerSuperChunk = 1024;
+	config.codec = CODEC_LZ;
+	return config;
+}
+
+/**
+ * Returns the representative of a super chunk, which is the smallest digest in it
+ *
+ * @param digests the digests of all the chunks
+ * @param first the index of the first chunk of the super chunk
+ * @param last the index of the last chunk of the super chunk
+ * @return the representative
+ */
+inline const ChunkDigest& getSuperChunkRepresentative(const std::vector<ChunkDigest>& digests, size_t first, size_t last) {
+	size_t smallest = first;
+	for (size_t chunk = first + 1; chunk <= last; ++chunk) {
+		if (digests[chunk] < digests[smallest]) {
+			smallest = chunk;
+		}
+	}
+	return digests[smallest];
+}
+
+/**
+ * Cuts a buffer into chunks and super chunks with the mode of the configuration
+ *
+ * @param rabin the initialized Rabin data (not used for fixed blocks)
+ * @param data the buffer
+ * @param dataLen the length of the buffer
+ * @param config the deduplication parameters
+ * @param cuts the vector into which the cut offsets are added
+ * @param superChunkEnds the vector into which the index of the last chunk of every super chunk is added
+ * @param zeroChunks receives one bit per chunk that is all zeros, or nothing if those are not known
+ */
+inline void chunkBufferForDedup(rabinData* rabin, BYTE* data, OFFSET_64 dataLen, const DedupConfig& config, std::vector<OFFSET_64>& cuts,
+		std::vector<size_t>& superChunkEnds, std::vector<word32>& zeroChunks) {
+	if (config.mode == FIXED_BLOCKS) {
+		chunkDataInFixedBlocks(data, dataLen, config.blockSize, config.threads, cuts, zeroChunks);
+		size_t blocksPerSuperChunk = std::min(std::max(config.superD / config.blockSize, (size_t) 1), config.maxChunksPerSuperChunk);
+		extractFixedSuperChunks(cuts.size(), blocksPerSuperChunk, superChunkEnds);
+	} else {
+		chunkDataOnHostWithSuperChunks(rabin, data, dataLen, config.ctx, config.policy, getHostChunkingThreads(dataLen, config.threads), config.superD,
+				config.maxChunksPerSuperChunk, cuts, superChunkEnds);
+		zeroChunks.clear();
+	}
+}
+
+/**
+ * Counts the bits that are set in a bit field array
+ */
+inline size_t countSetBits(const std::vector<word32>& array) {
+	size_t count = 0;
+	for (size_t word = 0; word < array.size(); ++word) {
+		count += __builtin_popcount(array[word]);
+	}
+	return count;
+}
+
+/**
+ * Finds the chunks of a super chunk that an index does not know. A chunk that is repeated within
+ * the super chunk is new only the first time it appears.
+ *
+ * @param index the index (a ChunkIndex or a SparseIndex)
+ * @param digests the digests of all the chunks
+ * @param first the index of the first chunk of the super chunk
+ * @param last the index of the last chunk of the super chunk
+ * @param locations receives the location of every chunk of the super chunk the index knows
+ * @param newChunkOf receives, for every chunk of the super chunk, its position in newChunks (-1 if the chunk is known)
+ * @param newChunks receives the index of every new chunk
+ */
+template<typename Index> void findNewChunks(Index& index, const std::vector<ChunkDigest>& digests, size_t first, size_t last,
+		std::vector<ChunkLocation>& locations, std::vector<int>& newChunkOf, std::vector<size_t>& newChunks) {
+	locations.assign(last - first + 1, ChunkLocation());
+	newChunkOf.assign(last - first + 1, -1);
+	boost::unordered_map<ChunkDigest, size_t> pending;
+	for (size_t chunk = first; chunk <= last; ++chunk) {
+		if (index.lookup(digests[chunk], locations[chunk - first])) {
+			continue;
+		}
+		boost::unordered_map<ChunkDigest, size_t>::iterator seen = pending.find(digests[chunk]);
+		if (seen != pending.end()) {
+			newChunkOf[chunk - first] = seen->second;
+		} else {
+			newChunkOf[chunk - first] = newChunks.size();
+			pending.insert(std::make_pair(digests[chunk], newChunks.size()));
+			newChunks.push_back(chunk);
+		}
+	}
+}
+
+/**
+ * Compresses the new chunks of a super chunk as a batch and adds them to the store
+ *
+ * @param data the buffer
+ * @param cuts the cut offsets of all the chunks
+ * @param digests the digests of all the chunks
+ * @param newChunks the index of every new chunk
+ * @param config the deduplication parameters
+ * @param store the store where the chunks go
+ * @param superChunkSize if not 0, the store is told that a super chunk of this size begins
+ * @param statistics the counters that are updated
+ * @param newLocations receives where every new chunk was stored
+ */
+inline void storeNewChunks(BYTE* data, const std::vector<OFFSET_64>& cuts, const std::vector<ChunkDigest>& digests,
+		const std::vector<size_t>& newChunks, const DedupConfig& config, ContainerStore& store, size_t superChunkSize, DedupStatistics& statistics,
+		std::vector<ChunkLocation>& newLocations) {
+	newLocations.resize(newChunks.size());
+	if (newChunks.empty()) {
+		return;
+	}
+	std::vector<const BYTE*> chunkData(newChunks.size());
+	std::vector<size_t> chunkLengths(newChunks.size());
+	for (size_t n = 0; n < newChunks.size(); ++n) {
+		OFFSET_64 start = (newChunks[n] == 0) ? 0 : cuts[newChunks[n] - 1];
+		chunkData[n] = data + start;
+		chunkLengths[n] = cuts[newChunks[n]] - start;
+	}
+	std::vector<CompressedChunk> compressed;
+	compressChunks(config.codec, chunkData, chunkLengths, config.threads, compressed);
+
+	if (superChunkSize > 0) {
+		store.beginSuperChunk(superChunkSize);
+	}
+	for (size_t n = 0; n < newChunks.size(); ++n) {
+		if (compressed[n].codec == CODEC_NONE) {
+			newLocations[n] = store.addChunk(digests[newChunks[n]], chunkData[n], chunkLengths[n]);
+			++statistics.rawChunks;
+		} else {
+			newLocations[n] = store.addCompressedChunk(digests[newChunks[n]], &compressed[n].data[0], compressed[n].data.size(), chunkLengths[n],
+					compressed[n].codec);
+		}
+		statistics.uniqueBytes += chunkLengths[n];
+		statistics.storedBytes += newLocations[n].storedLength;
+		++statistics.uniqueChunks;
+	}
+}
+
+/**
+ * Deduplicates a buffer against the index, storing the chunks that are new
+ *
+ * @param rabin the initialized Rabin data
+ * @param data the buffer
+ * @param dataLen the length of the buffer
+ * @param config the deduplication parameters
+ * @param index the index
+ * @param store the store where new chunks go
+ * @param statistics the counters that are updated
+ * @param recipe if not NULL, receives the location of every chunk of the buffer in order
+ */
+inline void deduplicateBuffer(rabinData* rabin, BYTE* data, OFFSET_64 dataLen, const DedupConfig& config, ChunkIndex& index,
+		ContainerStore& store, DedupStatistics& statistics, std::vector<ChunkLocation>* recipe = NULL) {
+	if (dataLen == 0) {
+		return;
+	}
+	std::vector<OFFSET_64> cuts;
+	std::vector<size_t> superChunkEnds;
+	std::vector<word32> zeroChunks;
+	chunkBufferForDedup(rabin, data, dataLen, config, cuts, superChunkEnds, zeroChunks);
+
+	std::vector<ChunkDigest> digests;
+	computeChunkDigests(data, cuts, config.threads, digests, zeroChunks.empty() ? NULL : &zeroChunks[0]);
+	statistics.zeroChunks += countSetBits(zeroChunks);
+
+	size_t first = 0;
+	for (size_t s = 0; s < superChunkEnds.size(); ++s) {
+		size_t last = superChunkEnds[s];
+		OFFSET_64 superStart = (first == 0) ? 0 : cuts[first - 1];
+
+		const ChunkDigest& representative = getSuperChunkRepresentative(digests, first, last);
+		bool knownSuperChunk = index.lookupRepresentative(representative);
+
+		std::vector<ChunkLocation> locations;
+		std::vector<int> newChunkOf;
+		std::vector<size_t> newChunks;
+		findNewChunks(index, digests, first, last, locations, newChunkOf, newChunks);
+
+		std::vector<ChunkLocation> newLocations;
+		storeNewChunks(data, cuts, digests, newChunks, config, store, knownSuperChunk ? 0 : cuts[last] - superStart, statistics, newLocations);
+		for (size_t n = 0; n < newChunks.size(); ++n) {
+			index.insert(digests[newChunks[n]], newLocations[n]);
+			locations[newChunks[n] - first] = newLocations[n];
+		}
+
+		ContainerID superChunkContainer = 0;
+		for (size_t chunk = first; chunk <= last; ++chunk) {
+			if (newChunkOf[chunk - first] >= 0) {
+				locations[chunk - first] = locations[newChunks[newChunkOf[chunk - first]] - first];
+			}
+			if (digests[chunk] == representative) {
+				superChunkContainer = locations[chunk - first].container;
+			}
+			if (recipe != NULL) {
+				recipe->push_back(locations[chunk - first]);
+			}
+			++statistics.chunks;
+		}
+
+		if (!knownSuperChunk) {
+			index.insertRepresentative(representative, superChunkContainer);
+		}
+		++statistics.superChunks;
+		first = last + 1;
+	}
+	statistics.logicalBytes += dataLen;
+}
+
+/**
+ * Deduplicates a buffer against a sparse index, storing the chunks that are not in the champions of
+ * their super chunk
+ *
+ * @param rabin the initialized Rabin data
+ * @param data the buffer
+ * @param dataLen the length of the buffer
+ * @param config the deduplication parameters
+ * @param index the sparse index
+ * @param store the store where new chunks go
+ * @param statistics the counters that are updated
+ * @param recipe if not NULL, receives the location of every chunk of the buffer in order
+ */
+inline void deduplicateBufferSparse(rabinData* rabin, BYTE* data, OFFSET_64 dataLen, const DedupConfig& config, SparseIndex& index,
+		ContainerStore& store, DedupStatistics& statistics, std::vector<ChunkLocation>* recipe = NULL) {
+	if (dataLen == 0) {
+		return;
+	}
+	std::vector<OFFSET_64> cuts;
+	std::vector<size_t> superChunkEnds;
+	std::vector<word32> zeroChunks;
+	chunkBufferForDedup(rabin, data, dataLen, config, cuts, superChunkEnds, zeroChunks);
+
+	std::vector<ChunkDigest> digests;
+	computeChunkDigests(data, cuts, config.threads, digests, zeroChunks.empty() ? NULL : &zeroChunks[0]);
+	statistics.zeroChunks += countSetBits(zeroChunks);
+
+	size_t first = 0;
+	for (size_t s = 0; s < superChunkEnds.size(); ++s) {
+		size_t last = superChunkEnds[s];
+		OFFSET_64 superStart = (first == 0) ? 0 : cuts[first - 1];
+		index.selectChampions(digests, first, last);
+
+		std::vector<ChunkLocation> locations;
+		std::vector<int> newChunkOf;
+		std::vector<size_t> newChunks;
+		findNewChunks(index, digests, first, last, locations, newChunkOf, newChunks);
+
+		std::vector<ChunkLocation> newLocations;
+		storeNewChunks(data, cuts, digests, newChunks, config, store, cuts[last] - superStart, statistics, newLocations);
+		for (size_t chunk = first; chunk <= last; ++chunk) {
+			if (newChunkOf[chunk - first] >= 0) {
+				locations[chunk - first] = newLocations[newChunkOf[chunk - first]];
+			}
+			if (recipe != NULL) {
+				recipe->push_back(locations[chunk - first]);
+			}
+			++statistics.chunks;
+		}
+
+		// the manifest of the super chunk refers to duplicates where they already are
+		index.addSegment(digests, locations, first);
+		++statistics.superChunks;
+		first = last + 1;
+	}
+	statistics.logicalBytes += dataLen;
+}
+
+/**
+ * Reads a whole file into memory
+ *
+ * @param path the path of the file
+ * @param data the vector that receives the content
+ * @return false if the file could not be read
+ */
+inline bool readWholeFile(const std::string& path, std::vector<BYTE>& data) {
+	FILE* file = fopen(path.c_str(), "rb");
+	if (file == NULL) {
+		fprintf(stderr, "Cannot open %s\n", path.c_str());
+		return false;
+	}
+	fseek(file, 0, SEEK_END);
+	long fileSize = ftell(file);
+	fseek(file, 0, SEEK_SET);
+	data.resize(fileSize);
+	size_t read = (fileSize > 0) ? fread(&data[0], 1, fileSize, file) : 0;
+	fclose(file);
+	return read == (size_t) fileSize;
+}
+
+/**
+ * Writes a buffer into a file, replacing its content
+ *
+ * @param path the path of the file
+ * @param data the content
+ * @return false if the file could not be written
+ */
+inline bool writeWholeFile(const std::string& path, const std::vector<BYTE>& data) {
+	FILE* file = fopen(path.c_str(), "wb");
+	if (file == NULL) {
+		fprintf(stderr, "Cannot open %s\n", path.c_str());
+		return false;
+	}
+	size_t written = data.empty() ? 0 : fwrite(&data[0], 1, data.size(), file);
+	return (fclose(file) == 0) && written == data.size();
+}
+
+/**
+ * Deduplicates a list of files against a full index without storing anything, which is the
+ * reference a sparse index is compared with
+ *
+ * @param rabin the initialized Rabin data
+ * @param files the files, in order
+ * @param config the deduplication parameters
+ * @param statistics receives the results
+ * @return false if a file could not be read
+ */
+inline bool deduplicateWithFullIndex(rabinData* rabin, const std::vector<std::string>& files, DedupConfig config, DedupStatistics& statistics) {
+	config.codec = CODEC_NONE; // only the unique bytes are compared
+	ContainerStore store(4194304, false);
+	ChunkIndex index(&store);
+	memset(&statistics, 0, sizeof(DedupStatistics));
+	std::vector<BYTE> data;
+	for (size_t f = 0; f < files.size(); ++f) {
+		if (!readWholeFile(files[f], data)) {
+			return false;
+		}
+		deduplicateBuffer(rabin, data.empty() ? NULL : &data[0], data.size(), config, index, store, statistics);
+	}
+	return true;
+}
+
+/**
+ * Command line front end that deduplicates a list of files (in order) and reports how well
+ * deduplication and the index do. With --store the containers and the recipe of every file
+ * (file_N.recipe, N being the position of the file in the list) are written into a directory,
+ * from which the files can be restored with --restore.
+ *
+ * With --fixed-kb the files are cut into blocks of that size instead of content defined chunks.
+ * With --sparse-mb a sparse index whose hooks take at most that many MiB is used instead of the
+ * full index, and the loss of deduplication is reported against a full index on the same files.
+ * The manifests of its segments go into segments.manifest in the --store directory, or into a
+ * temporary file without one.
+ *
+ * Usage: --dedup [--threads=N] [--cache=64] [--super-factor=256] [--codec=lz] [--fixed-kb=4] [--store=DIR]
+ *                [--sparse-mb=64] [--sampling-bits=6] [--champions=4] FILE...
+ *
+ * @param argc the number of arguments
+ * @param argv the arguments
+ * @return 0 on success
+ */
+inline int runDedupReport(int argc, char** argv) {
+	int threads = (int) boost::thread::hardware_concurrency();
+	DedupConfig config = getDefaultDedupConfig((threads > 0) ? threads : 1);
+	size_t cachedContainers = 64;
+	bool sparse = false;
+	SparseIndexConfig sparseConfig = getDefaultSparseIndexConfig();
+	std::string storeDirectory;
+	std::vector<std::string> files;
+
+	for (int i = 0; i < argc; ++i) {
+		std::string arg(argv[i]);
+		if (arg.compare(0, 10, "--threads=") == 0) {
+			config.threads = atoi(arg.c_str() + 10);
+		} else if (arg.compare(0, 8, "--cache=") == 0) {
+			cachedContainers = atol(arg.c_str() + 8);
+		} else if (arg.compare(0, 15, "--super-factor=") == 0) {
+			config.superD = config.ctx.D * atoi(arg.c_str() + 15);
+		} else if (arg.compare(0, 8, "--codec=") == 0) {
+			if (!parseCodecName(arg.substr(8), config.codec)) {
+				fprintf(stderr, "Unknown codec %s\n", arg.c_str() + 8);
+				return 1;
+			}
+		} else if (arg.compare(0, 11, "--fixed-kb=") == 0) {
+			config.mode = FIXED_BLOCKS;
+			config.blockSize = (size_t) atoi(arg.c_str() + 11) << 10;
+		} else if (arg.compare(0, 8, "--store=") == 0) {
+			storeDirectory = arg.substr(8);
+		} else if (arg.compare(0, 12, "--sparse-mb=") == 0) {
+			sparse = true;
+			sparseConfig.memoryLimit = (size_t) atoi(arg.c_str() + 12) << 20;
+		} else if (arg.compare(0, 16, "--sampling-bits=") == 0) {
+			sparseConfig.samplingBits = atoi(arg.c_str() + 16);
+		} else if (arg.compare(0, 12, "--champions=") == 0) {
+			sparseConfig.maxChampions = atoi(arg.c_str() + 12);
+		} else {
+			files.push_back(arg);
+		}
+	}
+	if (files.empty() || config.threads < 1 || config.blockSize == 0) {
+		fprintf(stderr, "Usage: --dedup [--threads=N] [--cache=64] [--super-factor=256] [--codec=lz] [--fixed-kb=4] [--store=DIR]\n"
+				"               [--sparse-mb=64] [--sampling-bits=6] [--champions=4] FILE...\n");
+		return 1;
+	}
+
+	rabinData rabin;
+	initWindow(&rabin, IRREDUCIBLE_POLY);
+	ContainerStore store(4194304, !storeDirectory.empty());
+	ChunkIndex index(&store, cachedContainers);
+	// the sparse index creates its manifest file, so it only exists in sparse mode
+	boost::shared_ptr<SparseIndex> sparseIndex;
+	if (sparse) {
+		sparseIndex.reset(new SparseIndex(sparseConfig, storeDirectory));
+	}
+	DedupStatistics statistics;
+	memset(&statistics, 0, sizeof(DedupStatistics));
+
+	std::vector<BYTE> data;
+	for (size_t f = 0; f < files.size(); ++f) {
+		if (!readWholeFile(files[f], data)) {
+			return 1;
+		}
+		std::vector<ChunkLocation> recipe;
+		if (sparse) {
+			deduplicateBufferSparse(&rabin, data.empty() ? NULL : &data[0], data.size(), config, *sparseIndex, store, statistics, &recipe);
+		} else {
+			deduplicateBuffer(&rabin, data.empty() ? NULL : &data[0], data.size(), config, index, store, statistics, &recipe);
+		}
+		if (!storeDirectory.empty()) {
+			char name[32];
+			snprintf(name, sizeof(name), "/file_%lu.recipe", (unsigned long) f);
+			if (!writeRecipe(storeDirectory + name, recipe)) {
+				fprintf(stderr, "Cannot write the recipe of %s\n", files[f].c_str());
+				return 1;
+			}
+		}
+	}
+	if (sparse && !sparseIndex->isGood()) {
+		fprintf(stderr, "Cannot write or read back the segment manifests\n");
+		return 1;
+	}
+	if (!storeDirectory.empty()) {
+		store.seal();
+		if (!store.saveContainers(storeDirectory)) {
+			fprintf(stderr, "Cannot write the containers into %s\n", storeDirectory.c_str());
+			return 1;
+		}
+	}
+
+	printf("logical bytes      %lld\n", (long long) statistics.logicalBytes);
+	printf("unique bytes       %lld\n", (long long) statistics.uniqueBytes);
+	printf("dedup ratio        %.3f\n", (statistics.uniqueBytes > 0) ? (double) statistics.logicalBytes / statistics.uniqueBytes : 0.0);
+	printf("stored bytes       %lld (%s)\n", (long long) statistics.storedBytes, getCodecName(config.codec));
+	printf("compression ratio  %.3f\n", (statistics.storedBytes > 0) ? (double) statistics.uniqueBytes / statistics.storedBytes : 0.0);
+	printf("raw chunks         %lu\n", (unsigned long) statistics.rawChunks);
+	printf("chunks             %lu (%lu unique)\n", (unsigned long) statistics.chunks, (unsigned long) statistics.uniqueChunks);
+	if (config.mode == FIXED_BLOCKS) {
+		printf("zero blocks        %lu (%lu bytes each)\n", (unsigned long) statistics.zeroChunks, (unsigned long) config.blockSize);
+	}
+	printf("super chunks       %lu\n", (unsigned long) statistics.superChunks);
+	printf("containers         %lu\n", (unsigned long) store.getNumContainers());
+	if (sparse) {
+		const SparseIndexStatistics& sparseStatistics = sparseIndex->getStatistics();
+		printf("hooks              %lu in %lu KiB, one digest in %lu sampled (downsampled %lu times)\n", (unsigned long) sparseIndex->getNumHooks(),
+				(unsigned long) (sparseIndex->getHookMemory() >> 10), 1ul << sparseIndex->getSamplingBits(), (unsigned long) sparseStatistics.downsamples);
+		printf("segments           %lu, %.2f champions per super chunk\n", (unsigned long) sparseIndex->getNumSegments(),
+				(sparseStatistics.superChunks > 0) ? (double) sparseStatistics.champions / sparseStatistics.superChunks : 0.0);
+		printf("manifests          %lu KiB in the file, %lu KiB read back in %lu loads, %lu KiB resident\n",
+				(unsigned long) (sparseIndex->getManifestFileSize() >> 10), (unsigned long) (sparseStatistics.manifestBytesRead >> 10),
+				(unsigned long) sparseStatistics.manifestLoads, (unsigned long) (sparseIndex->getResidentManifestMemory() >> 10));
+		printf("champion hits      %lu of %lu lookups\n", (unsigned long) sparseStatistics.hits, (unsigned long) sparseStatistics.lookups);
+
+		DedupStatistics reference;
+		if (!deduplicateWithFullIndex(&rabin, files, config, reference)) {
+			return 1;
+		}
+		double ratio = (statistics.uniqueBytes > 0) ? (double) statistics.logicalBytes / statistics.uniqueBytes : 0.0;
+		double referenceRatio = (reference.uniqueBytes > 0) ? (double) reference.logicalBytes / reference.uniqueBytes : 0.0;
+		printf("full index         %lld unique bytes, dedup ratio %.3f\n", (long long) reference.uniqueBytes, referenceRatio);
+		printf("dedup ratio loss   %.2f%%\n", (referenceRatio > 0) ? 100.0 * (1.0 - ratio / referenceRatio) : 0.0);
+		return 0;
+	}
+	const IndexStatistics& indexStatistics = index.getStatistics();
+	printf("cache hits         %lu of %lu lookups\n", (unsigned long) indexStatistics.cacheHits, (unsigned long) indexStatistics.lookups);
+	printf("full index lookups %lu (%lu hits)\n", (unsigned long) indexStatistics.fullIndexLookups, (unsigned long) indexStatistics.fullIndexHits);
+	printf("representative hits %lu, prefetches %lu\n", (unsigned long) indexStatistics.representativeHits,
+			(unsigned long) indexStatistics.prefetches);
+	return 0;
+}
+
+/**
+ * Command line front end that restores a file that was stored with --dedup --store=DIR
+ *
+ * Usage: --restore [--threads=N] [--window=MiB] [--read-ahead=N] DIR RECIPE OUTPUT
+ *
+ * @param argc the number of arguments
+ * @param argv the arguments
+ * @return 0 on success
+ */
+inline int runRestore(int argc, char** argv) {
+	int threads = (int) boost::thread::hardware_concurrency();
+	RestoreConfig config = getDefaultRestoreConfig((threads > 0) ? threads : 1);
+	std::vector<std::string> paths;
+
+	for (int i = 0; i < argc; ++i) {
+		std::string arg(argv[i]);
+		if (arg.compare(0, 10, "--threads=") == 0) {
+			config.threads = atoi(arg.c_str() + 10);
+		} else if (arg.compare(0, 9, "--window=") == 0) {
+			config.windowSize = (size_t) atoi(arg.c_str() + 9) << 20;
+		} else if (arg.compare(0, 13, "--read-ahead=") == 0) {
+			config.readAhead = atoi(arg.c_str() + 13);
+		} else {
+			paths.push_back(arg);
+		}
+	}
+	if (paths.size() != 3 || config.threads < 1 || config.windowSize == 0) {
+		fprintf(stderr, "Usage: --restore [--threads=N] [--window=MiB] [--read-ahead=N] DIR RECIPE OUTPUT\n");
+		return 1;
+	}
+
+	std::vector<ChunkLocation> recipe;
+	if (!readRecipe(paths[1], recipe)) {
+		fprintf(stderr, "Cannot read the recipe %s\n", paths[1].c_str());
+		return 1;
+	}
+	FILE* output = fopen(paths[2].c_str(), "wb");
+	if (output == NULL) {
+		fprintf(stderr, "Cannot open %s\n", paths[2].c_str());
+		return 1;
+	}
+	DirectoryContainerSource source(paths[0]);
+	RestoreEngine engine(&source, config);
+	WallClockTimer timer("restore");
+	timer.start();
+	bool ok = engine.restore(recipe, output);
+	ok = (fclose(output) == 0) && ok;
+	double seconds = timer.stop();
+	if (!ok) {
+		fprintf(stderr, "The restore failed\n");
+		return 1;
+	}
+
+	const RestoreStatistics& statistics = engine.getStatistics();
+	printf("restored bytes     %lld in %.3f s (%.1f MiB/s)\n", (long long) statistics.restoredBytes, seconds,
+			(seconds > 0) ? statistics.restoredBytes / seconds / (1 << 20) : 0.0);
+	printf("chunks             %lu in %lu windows\n", (unsigned long) statistics.chunks, (unsigned long) statistics.windows);
+	printf("container reads    %lu, %lld bytes fetched\n", (unsigned long) statistics.containerReads, (long long) statistics.fetchedBytes);
+	return 0;
+}
+
+#endif /* DEDUPPIPELINE_H_ */
@@ -0,0 +1,427 @@
+/**
+ * DedupScanner.cpp
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Zahari Dichev <zaharidichev@gmail.com>
+ */
+
+#include "DedupScanner.h"
+#include "../misc/WallClockTimer.h"
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <string.h>
+#include <algorithm>
+#include <boost/bind.hpp>
+
+DedupScanner::DedupScanner(const ScanConfig& config) :
+		config(config), pendingTasks(0) {
+	if (this->config.threads < 1) {
+		this->config.threads = 1;
+	}
+	initWindow(&this->rabin, IRREDUCIBLE_POLY);
+}
+
+DedupScanner::~DedupScanner() {
+}
+
+void DedupScanner::pushTask(int worker, const scanTask& task, bool counted) {
+	if (!counted) {
+		boost::mutex::scoped_lock guard(this->pendingLock);
+		++this->pendingTasks;
+	}
+	{
+		boost::mutex::scoped_lock guard(this->workers[worker]->lock);
+		this->workers[worker]->tasks.push_back(task);
+	}
+	this->workAvailable.notify_one();
+}
+
+bool DedupScanner::takeTask(int worker, scanTask& task) {
+	{
+		scanWorker& self = *this->workers[worker];
+		boost::mutex::scoped_lock guard(self.lock);
+		if (!self.tasks.empty()) {
+			task = self.tasks.back();
+			self.tasks.pop_back();
+			return true;
+		}
+	}
+	// the oldest task of another thread is the one most likely to produce more work
+	int numWorkers = this->workers.size();
+	for (int i = 1; i < numWorkers; ++i) {
+		scanWorker& victim = *this->workers[(worker + i) % numWorkers];
+		boost::mutex::scoped_lock guard(victim.lock);
+		if (!victim.tasks.empty()) {
+			task = victim.tasks.front();
+			victim.tasks.pop_front();
+			++this->workers[worker]->statistics.steals;
+			return true;
+		}
+	}
+	return false;
+}
+
+void DedupScanner::finishTask() {
+	boost::mutex::scoped_lock guard(this->pendingLock);
+	if (--this->pendingTasks == 0) {
+		this->workAvailable.notify_all();
+	}
+}
+
+bool DedupScanner::flushBatch(int worker) {
+	scanWorker& self = *this->workers[worker];
+	if (self.batch.empty()) {
+		return false;
+	}
+	scanTask task;
+	task.type = CHUNK_BATCH;
+	task.files.swap(self.batch);
+	task.first = task.last = 0;
+	self.batchBytes = 0;
+	pushTask(worker, task, true); // the batch was counted when its first file was added
+	return true;
+}
+
+void DedupScanner::runWorker(int worker) {
+	scanTask task;
+	while (true) {
+		if (takeTask(worker, task)) {
+			switch (task.type) {
+			case LIST_DIRECTORY:
+				listDirectory(worker, task.path);
+				break;
+			case CHUNK_BATCH:
+				for (size_t f = 0; f < task.files.size(); ++f) {
+					chunkWholeFile(worker, task.files[f]);
+				}
+				++this->workers[worker]->statistics.batches;
+				break;
+			case CHUNK_FILE:
+				chunkWholeFile(worker, task.path);
+				break;
+			case CHUNK_RANGE:
+				chunkRange(worker, task);
+				break;
+			case HASH_CHUNKS:
+				recordChunks(worker, task.file->mapping.data, task.file->cuts, task.first, task.last);
+				break;
+			}
+			++this->workers[worker]->statistics.tasks;
+			task.file.reset(); // a large file is unmapped as soon as its last task is done
+			finishTask();
+			continue;
+		}
+		if (flushBatch(worker)) {
+			continue;
+		}
+		boost::mutex::scoped_lock guard(this->pendingLock);
+		if (this->pendingTasks == 0) {
+			return;
+		}
+		// tasks may still appear while others are listing directories or finishing ranges
+		this->workAvailable.timed_wait(guard, boost::posix_time::milliseconds(1));
+	}
+}
+
+void DedupScanner::listDirectory(int worker, const std::string& path) {
+	scanWorker& self = *this->workers[worker];
+	DIR* directory = opendir(path.c_str());
+	if (directory == NULL) {
+		++self.statistics.unreadable;
+		return;
+	}
+	++self.statistics.directories;
+	struct dirent* entry;
+	while ((entry = readdir(directory)) != NULL) {
+		if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) {
+			continue;
+		}
+		std::string child = path + "/" + entry->d_name;
+		struct stat childStat;
+		if (lstat(child.c_str(), &childStat) != 0) {
+			++self.statistics.unreadable;
+			continue;
+		}
+		// symbolic links and special files are not followed, so nothing is counted twice
+		if (S_ISDIR(childStat.st_mode)) {
+			scanTask task;
+			task.type = LIST_DIRECTORY;
+			task.path = child;
+			task.first = task.last = 0;
+			pushTask(worker, task, false);
+		} else if (S_ISREG(childStat.st_mode)) {
+			addFile(worker, child, childStat.st_size);
+		}
+	}
+	closedir(directory);
+}
+
+void DedupScanner::addFile(int worker, const std::string& path, OFFSET_64 size) {
+	scanWorker& self = *this->workers[worker];
+	if (size < (OFFSET_64) this->config.smallFileSize) {
+		if (self.batch.empty()) {
+			boost::mutex::scoped_lock guard(this->pendingLock);
+			++this->pendingTasks;
+		}
+		self.batch.push_back(path);
+		self.batchBytes += size;
+		if (self.batchBytes >= this->config.batchSize) {
+			flushBatch(worker);
+		}
+		return;
+	}
+
+	if (size <= (OFFSET_64) this->config.rangeSize) {
+		scanTask task;
+		task.type = CHUNK_FILE;
+		task.path = path;
+		task.first = task.last = 0;
+		pushTask(worker, task, false);
+		return;
+	}
+
+	boost::shared_ptr<scannedFile> file(new scannedFile());
+	if (!mapFile(path, file->mapping)) {
+		++self.statistics.unreadable;
+		return;
+	}
+	size_t numRanges = (file->mapping.size + this->config.rangeSize - 1) / this->config.rangeSize;
+	file->ranges.resize(numRanges);
+	file->rangesLeft = numRanges;
+	for (size_t r = 0; r < numRanges; ++r) {
+		scanTask task;
+		task.type = CHUNK_RANGE;
+		task.file = file;
+		task.first = r;
+		task.last = r + 1;
+		pushTask(worker, task, false);
+	}
+}
+
+void DedupScanner::chunkWholeFile(int worker, const std::string& path) {
+	scanWorker& self = *this->workers[worker];
+	int fd = open(path.c_str(), O_RDONLY);
+	struct stat fileStat;
+	if (fd < 0 || fstat(fd, &fileStat) != 0) {
+		if (fd >= 0) {
+			close(fd);
+		}
+		++self.statistics.unreadable;
+		return;
+	}
+	self.buffer.resize(fileStat.st_size);
+	size_t done = 0;
+	while (done < self.buffer.size()) {
+		ssize_t got = read(fd, &self.buffer[done], self.buffer.size() - done);
+		if (got <= 0) {
+			break;
+		}
+		done += got;
+	}
+	close(fd);
+	if (done != self.buffer.size()) {
+		++self.statistics.unreadable;
+		return;
+	}
+	chunkBuffer(worker, self.buffer.empty() ? NULL : &self.buffer[0], self.buffer.size());
+	++self.statistics.files;
+}
+
+void DedupScanner::chunkBuffer(int worker, const BYTE* data, OFFSET_64 length) {
+	if (length == 0) {
+		return;
+	}
+	std::vector<OFFSET_64> cuts;
+	chunkDataOnHost(&this->rabin, (BYTE*) data, length, this->config.ctx, this->config.policy, 1, cuts);
+	recordChunks(worker, data, cuts, 0, cuts.size());
+	this->workers[worker]->statistics.logicalBytes += length;
+}
+
+void DedupScanner::chunkRange(int worker, const scanTask& task) {
+	scannedFile& file = *task.file;
+	OFFSET_64 fileSize = file.mapping.size;
+	distributedRangeResult& result = file.ranges[task.first];
+	result.start = task.first * this->config.rangeSize;
+	result.end = std::min(result.start + (OFFSET_64) this->config.rangeSize, fileSize);
+
+	// find the candidates of the range, warming up the window with the bytes that precede it
+	OFFSET_64 warmUpStart = std::max(result.start - (OFFSET_64) this->rabin.winSize, (OFFSET_64) 0);
+	OFFSET_64 length = result.end - warmUpStart;
+	bool backup = this->config.policy == TTTD_MODE;
+	size_t numWords = getSizeOfBitArray(length);
+	std::vector<word32> breakpoints(numWords, 0);
+	std::vector<word32> backupBreakpoints(backup ? numWords : 0, 0);
+	findBreakPointsOnHost(&this->rabin, file.mapping.data + warmUpStart, length, &breakpoints[0], 1, this->config.ctx.D,
+			backup ? &backupBreakpoints[0] : NULL, this->config.ctx.Ddash);
+	collectBreakpointPositions(&breakpoints[0], result.start - warmUpStart, length, warmUpStart, result.mainPositions);
+	if (backup) {
+		collectBreakpointPositions(&backupBreakpoints[0], result.start - warmUpStart, length, warmUpStart, result.backupPositions);
+	}
+	buildChunkerStateAt(&this->rabin, file.mapping.data, 0, result.start, &result.startState);
+	buildChunkerStateAt(&this->rabin, file.mapping.data, 0, result.end, &result.endState);
+	++this->workers[worker]->statistics.ranges;
+
+	{
+		boost::mutex::scoped_lock guard(file.lock);
+		if (--file.rangesLeft > 0) {
+			return;
+		}
+	}
+
+	// the last range to finish selects the cuts of the whole file and hands out the hashing
+	if (!stitchDistributedResults(file.ranges, fileSize, this->config.ctx, this->config.policy, file.cuts)) {
+		++this->workers[worker]->statistics.unreadable;
+		return;
+	}
+	file.ranges.clear();
+	size_t first = 0;
+	for (size_t chunk = 0; chunk < file.cuts.size(); ++chunk) {
+		OFFSET_64 start = (first == 0) ? 0 : file.cuts[first - 1];
+		if (chunk == file.cuts.size() - 1 || file.cuts[chunk] - start >= (OFFSET_64) this->config.rangeSize) {
+			scanTask hash;
+			hash.type = HASH_CHUNKS;
+			hash.file = task.file;
+			hash.first = first;
+			hash.last = chunk + 1;
+			pushTask(worker, hash, false);
+			first = chunk + 1;
+		}
+	}
+	this->workers[worker]->statistics.logicalBytes += fileSize;
+	++this->workers[worker]->statistics.files;
+}
+
+void DedupScanner::recordChunks(int worker, const BYTE* data, const std::vector<OFFSET_64>& cuts, size_t first, size_t last) {
+	ScanStatistics& statistics = this->workers[worker]->statistics;
+	std::vector<BYTE> compressed;
+	for (size_t chunk = first; chunk < last; ++chunk) {
+		OFFSET_64 start = (chunk == 0) ? 0 : cuts[chunk - 1];
+		size_t length = cuts[chunk] - start;
+		ChunkDigest digest = computeChunkDigest(data + start, length);
+		digestShard& shard = this->shards[hash_value(digest) % SCAN_DIGEST_SHARDS];
+		bool isNew;
+		{
+			boost::mutex::scoped_lock guard(shard.lock);
+			isNew = shard.digests.insert(digest).second;
+		}
+		++statistics.chunks;
+		if (isNew) {
+			++statistics.uniqueChunks;
+			statistics.uniqueBytes += length;
+			if (this->config.codec != CODEC_NONE) {
+				statistics.storedBytes += (compressChunk(this->config.codec, data + start, length, compressed) == CODEC_NONE) ? length : compressed.size();
+			} else {
+				statistics.storedBytes += length;
+			}
+		}
+	}
+}
+
+ScanStatistics DedupScanner::scan(const std::vector<std::string>& paths) {
+	this->workers.clear();
+	for (int t = 0; t < this->config.threads; ++t) {
+		boost::shared_ptr<scanWorker> worker(new scanWorker());
+		worker->batchBytes = 0;
+		memset(&worker->statistics, 0, sizeof(ScanStatistics));
+		this->workers.push_back(worker);
+	}
+
+	// the roots are spread over the threads, anything else is found by stealing
+	for (size_t p = 0; p < paths.size(); ++p) {
+		int worker = p % this->config.threads;
+		struct stat rootStat;
+		if (stat(paths[p].c_str(), &rootStat) != 0) {
+			++this->workers[worker]->statistics.unreadable;
+		} else if (S_ISDIR(rootStat.st_mode)) {
+			scanTask task;
+			task.type = LIST_DIRECTORY;
+			task.path = paths[p];
+			task.first = task.last = 0;
+			pushTask(worker, task, false);
+		} else {
+			addFile(worker, paths[p], rootStat.st_size);
+		}
+	}
+	for (int t = 0; t < this->config.threads; ++t) {
+		flushBatch(t);
+	}
+
+	boost::thread_group threads;
+	for (int t = 1; t < this->config.threads; ++t) {
+		threads.create_thread(boost::bind(&DedupScanner::runWorker, this, t));
+	}
+	runWorker(0);
+	threads.join_all();
+
+	ScanStatistics total;
+	memset(&total, 0, sizeof(ScanStatistics));
+	for (size_t t = 0; t < this->workers.size(); ++t) {
+		const ScanStatistics& s = this->workers[t]->statistics;
+		total.files += s.files;
+		total.directories += s.directories;
+		total.unreadable += s.unreadable;
+		total.logicalBytes += s.logicalBytes;
+		total.uniqueBytes += s.uniqueBytes;
+		total.storedBytes += s.storedBytes;
+		total.chunks += s.chunks;
+		total.uniqueChunks += s.uniqueChunks;
+		total.batches += s.batches;
+		total.ranges += s.ranges;
+		total.tasks += s.tasks;
+		total.steals += s.steals;
+	}
+	return total;
+}
+
+int runDedupScan(int argc, char** argv) {
+	int threads = (int) boost::thread::hardware_concurrency();
+	ScanConfig config = getDefaultScanConfig((threads > 0) ? threads : 1);
+	std::vector<std::string> paths;
+
+	for (int i = 0; i < argc; ++i) {
+		std::string arg(argv[i]);
+		if (arg.compare(0, 10, "--threads=") == 0) {
+			config.threads = atoi(arg.c_str() + 10);
+		} else if (arg.compare(0, 8, "--codec=") == 0) {
+			if (!parseCodecName(arg.substr(8), config.codec)) {
+				fprintf(stderr, "Unknown codec %s\n", arg.c_str() + 8);
+				return 1;
+			}
+		} else if (arg.compare(0, 11, "--small-kb=") == 0) {
+			config.smallFileSize = (size_t) atoi(arg.c_str() + 11) << 10;
+		} else if (arg.compare(0, 11, "--batch-mb=") == 0) {
+			config.batchSize = (size_t) atoi(arg.c_str() + 11) << 20;
+		} else if (arg.compare(0, 11, "--range-mb=") == 0) {
+			config.rangeSize = (size_t) atoi(arg.c_str() + 11) << 20;
+		} else {
+			paths.push_back(arg);
+		}
+	}
+	if (paths.empty() || config.threads < 1 || config.rangeSize == 0) {
+		fprintf(stderr, "Usage: --scan [--threads=N] [--codec=none] [--small-kb=1024] [--batch-mb=16] [--range-mb=32] PATH...\n");
+		return 1;
+	}
+
+	DedupScanner scanner(config);
+	WallClockTimer timer("scan");
+	timer.start();
+	ScanStatistics statistics = scanner.scan(paths);
+	double seconds = timer.stop();
+
+	printf("files              %lu (%lu directories, %lu unreadable)\n", (unsigned long) statistics.files, (unsigned long) statistics.directories,
+			(unsigned long) statistics.unreadable);
+	printf("logical bytes      %lld\n", (long long) statistics.logicalBytes);
+	printf("unique bytes       %lld\n", (long long) statistics.uniqueBytes);
+	printf("dedup ratio        %.3f\n", (statistics.uniqueBytes > 0) ? (double) statistics.logicalBytes / statistics.uniqueBytes : 0.0);
+	if (config.codec != CODEC_NONE) {
+		printf("stored bytes       %lld (%s)\n", (long long) statistics.storedBytes, getCodecName(config.codec));
+		printf("total reduction    %.3f\n", (statistics.storedBytes > 0) ? (double) statistics.logicalBytes / statistics.storedBytes : 0.0);
+	}
+	printf("chunks             %lu (%lu unique)\n", (unsigned long) statistics.chunks, (unsigned long) statistics.uniqueChunks);
+	printf("small file batches %lu, large file ranges %lu\n", (unsigned long) statistics.batches, (unsigned long) statistics.ranges);
+	printf("tasks              %lu (%lu stolen) on %d threads\n", (unsigned long) statistics.tasks, (unsigned long) statistics.steals, config.threads);
+	printf("time               %.3f s (%.3f GB/s)\n", seconds, (seconds > 0) ? statistics.logicalBytes / seconds / 1e9 : 0.0);
+	return 0;
+}
@@ -0,0 +1,238 @@
+/**
+ * DedupScanner.h
+ *
+ * Estimates how well a dataset deduplicates before it is committed to storage: a directory tree
+ * is walked, every file is chunked and hashed, and the number of logical bytes is compared with
+ * the number of bytes in unique chunks (and, optionally, with what those would take compressed).
+ * Nothing is stored; only the digests of the chunks seen so far are kept, in a set that is split
+ * into shards so the threads rarely wait for each other.
+ *
+ * All the work is done by a pool of identical threads, each with a deque of tasks of its own. A
+ * thread takes the newest task from its own deque and, when that is empty, steals the oldest task
+ * of another thread, so both the walk and the chunking spread over all the threads however skewed
+ * the sizes of the files are. The tasks are:
+ *
+ * - listing a directory, which adds a task per subdirectory and per file;
+ * - chunking a batch of small files (smaller than smallFileSize), which are collected by the
+ *   thread that lists them until a batch holds batchSize bytes;
+ * - chunking a file of medium size as a whole;
+ * - finding the candidate breakpoints in a range of a large file (larger than rangeSize). The file
+ *   is mapped into memory and split into ranges, which are chunked independently, exactly as the
+ *   distributed chunker does it. The thread that finishes the last range selects the cuts and adds
+ *   tasks that hash the chunks, range by range.
+ *
+ * The chunks are the same as those of a single pass over every file.
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Zahari Dichev <zaharidichev@gmail.com>
+ */
+
+#ifndef DEDUPSCANNER_H_
+#define DEDUPSCANNER_H_
+
+#include "../concrete_elastic_kernels/Chunking_elastic/CPU_code/DistributedChunker.h"
+#include "ChunkDiff.h"
+#include "ChunkCompression.h"
+#include <string>
+#include <vector>
+#include <deque>
+#include <boost/thread.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/unordered_set.hpp>
+
+#define SCAN_DIGEST_SHARDS 64
+
+/**
+ * The parameters of a scan
+ */
+struct ScanConfig {
+	chunkingContext ctx; // D, D' and the thresholds
+	BreakpointPolicy policy;
+	int threads;
+	size_t smallFileSize; // files smaller than this are chunked in batches
+	size_t batchSize; // the number of bytes a batch of small files collects
+	size_t rangeSize; // files larger than this are split into ranges of this size
+	ChunkCodec codec; // the codec unique chunks are compressed with to estimate the stored size (CODEC_NONE for no estimate)
+};
+
+/**
+ * The results of a scan. Every thread keeps its own and they are added up at the end.
+ */
+struct ScanStatistics {
+	size_t files;
+	size_t directories;
+	size_t unreadable; // entries that could not be listed or read
+	OFFSET_64 logicalBytes;
+	OFFSET_64 uniqueBytes;
+	OFFSET_64 storedBytes; // the unique bytes after compression
+	size_t chunks;
+	size_t uniqueChunks;
+	size_t batches; // batches of small files
+	size_t ranges; // ranges of large files
+	size_t tasks;
+	size_t steals; // tasks taken from another thread
+};
+
+/**
+ * Returns a configuration with the chunking parameters of the deduplication, batches of 16 MiB of
+ * files smaller than 1 MiB and ranges of 32 MiB
+ *
+ * @param threads the number of threads
+ * @return the configuration
+ */
+inline ScanConfig getDefaultScanConfig(int threads) {
+	DedupConfig dedup = getDefaultDedupConfig(threads);
+	ScanConfig config;
+	config.ctx = dedup.ctx;
+	config.policy = dedup.policy;
+	config.threads = threads;
+	config.smallFileSize = 1 << 20;
+	config.batchSize = 16 << 20;
+	config.rangeSize = 32 << 20;
+	config.codec = CODEC_NONE;
+	return config;
+}
+
+class DedupScanner {
+private:
+	/**
+	 * A large file that is chunked in ranges
+	 */
+	struct scannedFile {
+		MappedFile mapping;
+		std::vector<distributedRangeResult> ranges;
+		size_t rangesLeft; // ranges whose candidates have not been found yet
+		std::vector<OFFSET_64> cuts;
+		boost::mutex lock;
+
+		~scannedFile() {
+			unmapFile(this->mapping);
+		}
+	};
+
+	enum scanTaskType {
+		LIST_DIRECTORY, CHUNK_BATCH, CHUNK_FILE, CHUNK_RANGE, HASH_CHUNKS
+	};
+
+	struct scanTask {
+		scanTaskType type;
+		std::string path; // the directory or the file
+		std::vector<std::string> files; // the files of a batch
+		boost::shared_ptr<scannedFile> file; // the large file of a range or of chunks to hash
+		size_t first; // the range, or the first chunk to hash
+		size_t last; // one past the last chunk to hash
+	};
+
+	/**
+	 * A thread of the pool, with its own tasks and counters
+	 */
+	struct scanWorker {
+		std::deque<scanTask> tasks; // the newest task is at the back
+		boost::mutex lock;
+		std::vector<std::string> batch; // small files collected for the next batch
+		size_t batchBytes;
+		ScanStatistics statistics;
+		std::vector<BYTE> buffer; // reused for reading files
+	};
+
+	/**
+	 * A shard of the set of digests seen so far
+	 */
+	struct digestShard {
+		boost::unordered_set<ChunkDigest> digests;
+		boost::mutex lock;
+	};
+
+	ScanConfig config;
+	rabinData rabin;
+	std::vector<boost::shared_ptr<scanWorker> > workers;
+	digestShard shards[SCAN_DIGEST_SHARDS];
+
+	// tasks that exist but are not done yet (a batch that is being collected counts as one)
+	size_t pendingTasks;
+	boost::mutex pendingLock;
+	boost::condition_variable workAvailable;
+
+	/**
+	 * Adds a task to the deque of a thread
+	 */
+	void pushTask(int worker, const scanTask& task, bool counted);
+
+	/**
+	 * Takes the newest task of a thread, or steals the oldest task of another one
+	 *
+	 * @param worker the thread
+	 * @param task receives the task
+	 * @return false if there was no task anywhere
+	 */
+	bool takeTask(int worker, scanTask& task);
+
+	/**
+	 * Marks a task as done and wakes the waiting threads when nothing is left
+	 */
+	void finishTask();
+
+	/**
+	 * Turns the small files collected by a thread into a batch task
+	 *
+	 * @return false if the thread had no files collected
+	 */
+	bool flushBatch(int worker);
+
+	/**
+	 * The loop every thread runs until all the tasks are done
+	 */
+	void runWorker(int worker);
+
+	void listDirectory(int worker, const std::string& path);
+	void addFile(int worker, const std::string& path, OFFSET_64 size);
+	void chunkWholeFile(int worker, const std::string& path);
+	void chunkRange(int worker, const scanTask& task);
+
+	/**
+	 * Chunks a buffer in a single pass and records its chunks
+	 */
+	void chunkBuffer(int worker, const BYTE* data, OFFSET_64 length);
+
+	/**
+	 * Hashes a range of chunks and adds the digests to the set, counting the chunks that are new
+	 *
+	 * @param worker the thread
+	 * @param data the data the cuts refer to
+	 * @param cuts the cut offsets
+	 * @param first the first chunk
+	 * @param last one past the last chunk
+	 */
+	void recordChunks(int worker, const BYTE* data, const std::vector<OFFSET_64>& cuts, size_t first, size_t last);
+
+public:
+	/**
+	 * Creates a scanner
+	 *
+	 * @param config the parameters
+	 */
+	DedupScanner(const ScanConfig& config);
+
+	/**
+	 * Scans directory trees (or single files) and adds up the results
+	 *
+	 * @param paths the roots of the scan
+	 * @return the results
+	 */
+	ScanStatistics scan(const std::vector<std::string>& paths);
+
+	virtual ~DedupScanner();
+};
+
+/**
+ * Command line front end of the scanner
+ *
+ * Usage: --scan [--threads=N] [--codec=none] [--small-kb=1024] [--batch-mb=16] [--range-mb=32] PATH...
+ *
+ * @param argc the number of arguments
+ * @param argv the arguments
+ * @return 0 on success
+ */
+int runDedupScan(int argc, char** argv);
+
+#endif /* DEDUPSCANNER_H_ */
@@ -0,0 +1,308 @@
+/**
+ * RestoreEngine.cpp
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Zahari Dichev <zaharidichev@gmail.com>
+ */
+
+#include "RestoreEngine.h"
+#include <fcntl.h>
+#include <unistd.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <deque>
+#include <algorithm>
+#include <boost/bind.hpp>
+#include <boost/unordered_map.hpp>
+
+#define RECIPE_HEADER_SIZE (sizeof(uint32_t) + sizeof(uint64_t))
+#define RECIPE_ENTRY_SIZE (5 * sizeof(uint32_t))
+
+/**
+ * Writes the lowest size bytes of a value in little endian byte order
+ */
+static BYTE* putRecipeField(BYTE* out, uint64_t value, int size) {
+	for (int b = 0; b < size; ++b) {
+		out[b] = (BYTE) (value >> (8 * b));
+	}
+	return out + size;
+}
+
+/**
+ * Reads a value of size bytes written with putRecipeField()
+ */
+static const BYTE* getRecipeField(const BYTE* in, uint64_t& value, int size) {
+	value = 0;
+	for (int b = 0; b < size; ++b) {
+		value |= (uint64_t) in[b] << (8 * b);
+	}
+	return in + size;
+}
+
+StoreContainerSource::StoreContainerSource(const ContainerStore* store) :
+		store(store) {
+}
+
+StoreContainerSource::~StoreContainerSource() {
+}
+
+bool StoreContainerSource::readRange(ContainerID id, size_t offset, size_t length, BYTE* out) {
+	return this->store->readContainerRange(id, offset, length, out);
+}
+
+DirectoryContainerSource::DirectoryContainerSource(const std::string& directory) :
+		directory(directory) {
+}
+
+DirectoryContainerSource::~DirectoryContainerSource() {
+}
+
+bool DirectoryContainerSource::readRange(ContainerID id, size_t offset, size_t length, BYTE* out) {
+	int fd = open(ContainerStore::getContainerFileName(this->directory, id).c_str(), O_RDONLY);
+	if (fd < 0) {
+		return false;
+	}
+	size_t done = 0;
+	while (done < length) {
+		ssize_t got = pread(fd, out + done, length - done, offset + done);
+		if (got <= 0) {
+			break;
+		}
+		done += got;
+	}
+	close(fd);
+	return done == length;
+}
+
+RestoreEngine::RestoreEngine(ContainerSource* source, const RestoreConfig& config) :
+		source(source), config(config), recipe(NULL) {
+	memset(&this->statistics, 0, sizeof(RestoreStatistics));
+	if (this->config.threads < 1) {
+		this->config.threads = 1;
+	}
+	if (this->config.readAhead < 0) {
+		this->config.readAhead = 0;
+	}
+}
+
+RestoreEngine::~RestoreEngine() {
+}
+
+// orders the chunks of a container by their offset in it
+struct chunkOffsetOrder {
+	const std::vector<ChunkLocation>* recipe;
+	bool operator()(size_t a, size_t b) const {
+		return (*recipe)[a].offset < (*recipe)[b].offset;
+	}
+};
+
+void RestoreEngine::planWindow(assemblyWindow& window) {
+	const std::vector<ChunkLocation>& recipe = *this->recipe;
+	window.chunkOffsets.resize(window.lastChunk - window.firstChunk);
+
+	// group the chunks by container, keeping the containers in the order they are first needed
+	std::vector<ContainerID> containers;
+	boost::unordered_map<ContainerID, std::vector<size_t> > chunksOf;
+	size_t offset = 0;
+	for (size_t chunk = window.firstChunk; chunk < window.lastChunk; ++chunk) {
+		window.chunkOffsets[chunk - window.firstChunk] = offset;
+		offset += recipe[chunk].length;
+		std::vector<size_t>& chunks = chunksOf[recipe[chunk].container];
+		if (chunks.empty()) {
+			containers.push_back(recipe[chunk].container);
+		}
+		chunks.push_back(chunk);
+	}
+	window.buffer.resize(offset);
+
+	chunkOffsetOrder order;
+	order.recipe = this->recipe;
+	for (size_t c = 0; c < containers.size(); ++c) {
+		std::vector<size_t>& chunks = chunksOf[containers[c]];
+		std::sort(chunks.begin(), chunks.end(), order);
+		for (size_t i = 0; i < chunks.size(); ++i) {
+			const ChunkLocation& location = recipe[chunks[i]];
+			size_t end = (size_t) location.offset + location.storedLength;
+			if (!window.reads.empty() && window.reads.back().container == containers[c]
+					&& location.offset <= window.reads.back().offset + window.reads.back().length + this->config.maxReadGap) {
+				containerRead& read = window.reads.back();
+				read.length = std::max(read.offset + read.length, end) - read.offset;
+				read.chunks.push_back(chunks[i]);
+			} else {
+				containerRead read;
+				read.container = containers[c];
+				read.offset = location.offset;
+				read.length = location.storedLength;
+				read.chunks.push_back(chunks[i]);
+				window.reads.push_back(read);
+			}
+		}
+	}
+	window.nextRead = 0;
+	window.failed = false;
+}
+
+void RestoreEngine::processReads(assemblyWindow* window) {
+	const std::vector<ChunkLocation>& recipe = *this->recipe;
+	std::vector<BYTE> data;
+	while (true) {
+		size_t r;
+		{
+			boost::mutex::scoped_lock guard(window->lock);
+			if (window->failed || window->nextRead == window->reads.size()) {
+				return;
+			}
+			r = window->nextRead++;
+		}
+		const containerRead& read = window->reads[r];
+		data.resize(read.length);
+		bool ok = this->source->readRange(read.container, read.offset, read.length, &data[0]);
+		for (size_t i = 0; ok && i < read.chunks.size(); ++i) {
+			const ChunkLocation& location = recipe[read.chunks[i]];
+			// the read only succeeds within the container, so a chunk inside the read lies in it too
+			if (location.offset < read.offset || (size_t) location.offset + location.storedLength > read.offset + read.length) {
+				ok = false;
+				break;
+			}
+			BYTE* out = &window->buffer[0] + window->chunkOffsets[read.chunks[i] - window->firstChunk];
+			ok = decompressChunk((ChunkCodec) location.codec, &data[location.offset - read.offset], location.storedLength, out, location.length);
+		}
+		if (!ok) {
+			boost::mutex::scoped_lock guard(window->lock);
+			window->failed = true;
+			return;
+		}
+	}
+}
+
+void RestoreEngine::assembleWindow(assemblyWindow* window) {
+	boost::thread_group readers;
+	for (int t = 1; t < this->config.threads; ++t) {
+		readers.create_thread(boost::bind(&RestoreEngine::processReads, this, window));
+	}
+	processReads(window);
+	readers.join_all();
+}
+
+bool RestoreEngine::restore(const std::vector<ChunkLocation>& recipe, FILE* output) {
+	this->recipe = &recipe;
+
+	// cut the recipe into windows, every window holds at least one chunk
+	std::vector<size_t> windowStarts;
+	size_t windowBytes = 0;
+	for (size_t chunk = 0; chunk < recipe.size(); ++chunk) {
+		if (windowStarts.empty() || windowBytes + recipe[chunk].length > this->config.windowSize) {
+			windowStarts.push_back(chunk);
+			windowBytes = 0;
+		}
+		windowBytes += recipe[chunk].length;
+	}
+	windowStarts.push_back(recipe.size());
+
+	std::deque<boost::shared_ptr<assemblyWindow> > inFlight;
+	size_t nextWindow = 0;
+	size_t numWindows = windowStarts.size() - 1;
+	bool ok = true;
+	for (size_t w = 0; w < numWindows; ++w) {
+		// keep the current window and readAhead more in flight
+		while (nextWindow < numWindows && inFlight.size() <= (size_t) this->config.readAhead) {
+			boost::shared_ptr<assemblyWindow> window(new assemblyWindow());
+			window->firstChunk = windowStarts[nextWindow];
+			window->lastChunk = windowStarts[nextWindow + 1];
+			planWindow(*window);
+			window->assembler.reset(new boost::thread(boost::bind(&RestoreEngine::assembleWindow, this, window.get())));
+			inFlight.push_back(window);
+			++nextWindow;
+		}
+
+		boost::shared_ptr<assemblyWindow> window = inFlight.front();
+		inFlight.pop_front();
+		window->assembler->join();
+		if (window->failed) {
+			ok = false;
+			break;
+		}
+		if (!window->buffer.empty() && fwrite(&window->buffer[0], 1, window->buffer.size(), output) != window->buffer.size()) {
+			ok = false;
+			break;
+		}
+
+		for (size_t r = 0; r < window->reads.size(); ++r) {
+			this->statistics.fetchedBytes += window->reads[r].length;
+		}
+		this->statistics.containerReads += window->reads.size();
+		this->statistics.restoredBytes += window->buffer.size();
+		this->statistics.chunks += window->lastChunk - window->firstChunk;
+		++this->statistics.windows;
+	}
+
+	// on failure let the windows still in flight finish before they are released
+	for (size_t w = 0; w < inFlight.size(); ++w) {
+		inFlight[w]->assembler->join();
+	}
+	this->recipe = NULL;
+	return ok;
+}
+
+const RestoreStatistics& RestoreEngine::getStatistics() const {
+	return this->statistics;
+}
+
+bool writeRecipe(const std::string& path, const std::vector<ChunkLocation>& recipe) {
+	FILE* file = fopen(path.c_str(), "wb");
+	if (file == NULL) {
+		return false;
+	}
+	std::vector<BYTE> bytes(RECIPE_HEADER_SIZE + recipe.size() * RECIPE_ENTRY_SIZE);
+	BYTE* out = putRecipeField(&bytes[0], RECIPE_MAGIC, 4);
+	out = putRecipeField(out, recipe.size(), 8);
+	for (size_t chunk = 0; chunk < recipe.size(); ++chunk) {
+		const ChunkLocation& location = recipe[chunk];
+		out = putRecipeField(out, location.container, 4);
+		out = putRecipeField(out, location.offset, 4);
+		out = putRecipeField(out, location.length, 4);
+		out = putRecipeField(out, location.storedLength, 4);
+		out = putRecipeField(out, location.codec, 4);
+	}
+	bool ok = fwrite(&bytes[0], 1, bytes.size(), file) == bytes.size();
+	return (fclose(file) == 0) && ok;
+}
+
+bool readRecipe(const std::string& path, std::vector<ChunkLocation>& recipe) {
+	FILE* file = fopen(path.c_str(), "rb");
+	if (file == NULL) {
+		return false;
+	}
+	BYTE header[RECIPE_HEADER_SIZE];
+	uint64_t magic = 0;
+	uint64_t count = 0;
+	struct stat status;
+	bool ok = fread(header, 1, RECIPE_HEADER_SIZE, file) == RECIPE_HEADER_SIZE && fstat(fileno(file), &status) == 0;
+	if (ok) {
+		getRecipeField(getRecipeField(header, magic, 4), count, 8);
+		// the count has to match the entries the file actually holds
+		ok = magic == RECIPE_MAGIC && count == ((uint64_t) status.st_size - RECIPE_HEADER_SIZE) / RECIPE_ENTRY_SIZE;
+	}
+	std::vector<BYTE> bytes;
+	if (ok) {
+		bytes.resize(count * RECIPE_ENTRY_SIZE);
+		ok = count == 0 || fread(&bytes[0], 1, bytes.size(), file) == bytes.size();
+	}
+	recipe.clear();
+	for (size_t chunk = 0; ok && chunk < count; ++chunk) {
+		const BYTE* in = &bytes[chunk * RECIPE_ENTRY_SIZE];
+		uint64_t fields[5];
+		for (int f = 0; f < 5; ++f) {
+			in = getRecipeField(in, fields[f], 4);
+		}
+		ChunkLocation location;
+		location.container = fields[0];
+		location.offset = fields[1];
+		location.length = fields[2];
+		location.storedLength = fields[3];
+		location.codec = fields[4];
+		recipe.push_back(location);
+	}
+	fclose(file);
+	return ok;
+}
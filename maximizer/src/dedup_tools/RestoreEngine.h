@@ -0,0 +1,209 @@
+/**
+ * RestoreEngine.h
+ *
+ * Reassembles data from its recipe (the location of every chunk, in order). Chunks of
+ * deduplicated data are scattered over many containers, so reading them one by one in recipe
+ * order means a seek per chunk and reading the same container over and over. Instead the output
+ * is produced in windows through a forward assembly buffer: for every window all the chunk reads
+ * are grouped by container and merged into a few sequential reads, the containers are read by a
+ * number of threads in parallel and every chunk is decompressed straight into its place in the
+ * window. Several windows are assembled ahead of the one that is being written, so the output
+ * is written strictly sequentially while the reads for what follows are already in flight.
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Zahari Dichev <zaharidichev@gmail.com>
+ */
+
+#ifndef RESTOREENGINE_H_
+#define RESTOREENGINE_H_
+
+#include "ContainerStore.h"
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include <boost/thread.hpp>
+#include <boost/shared_ptr.hpp>
+
+#define RECIPE_MAGIC 0x52435031 // "RCP1"
+
+/**
+ * Where the restore engine reads containers from. Reads can be issued by several threads at once.
+ */
+class ContainerSource {
+public:
+	/**
+	 * Reads a contiguous range of the data section of a container
+	 *
+	 * @param id the container
+	 * @param offset the start of the range
+	 * @param length the length of the range
+	 * @param out the buffer that receives the range
+	 * @return false if the range cannot be read
+	 */
+	virtual bool readRange(ContainerID id, size_t offset, size_t length, BYTE* out) = 0;
+
+	virtual ~ContainerSource() {
+	}
+};
+
+/**
+ * Reads containers that are kept in memory by a ContainerStore
+ */
+class StoreContainerSource: public ContainerSource {
+private:
+	const ContainerStore* store;
+
+public:
+	StoreContainerSource(const ContainerStore* store);
+	bool readRange(ContainerID id, size_t offset, size_t length, BYTE* out);
+	virtual ~StoreContainerSource();
+};
+
+/**
+ * Reads containers from the files written by ContainerStore::saveContainers()
+ */
+class DirectoryContainerSource: public ContainerSource {
+private:
+	std::string directory;
+
+public:
+	DirectoryContainerSource(const std::string& directory);
+	bool readRange(ContainerID id, size_t offset, size_t length, BYTE* out);
+	virtual ~DirectoryContainerSource();
+};
+
+/**
+ * The parameters of a restore
+ */
+struct RestoreConfig {
+	int threads; // the number of threads reading containers for every window
+	size_t windowSize; // the size of the forward assembly buffer
+	int readAhead; // the number of windows assembled ahead of the one being written
+	size_t maxReadGap; // chunks of a container closer than this are fetched with a single read
+};
+
+/**
+ * Counters that show how a restore went
+ */
+struct RestoreStatistics {
+	OFFSET_64 restoredBytes; // the size of the output
+	OFFSET_64 fetchedBytes; // the bytes read from containers (including the gaps that were read over)
+	size_t chunks;
+	size_t containerReads; // the number of sequential reads
+	size_t windows;
+};
+
+/**
+ * Returns a configuration with windows of 32 MiB, two of them assembled ahead
+ *
+ * @param threads the number of threads per window
+ * @return the configuration
+ */
+inline RestoreConfig getDefaultRestoreConfig(int threads) {
+	RestoreConfig config;
+	config.threads = threads;
+	config.windowSize = 32 << 20;
+	config.readAhead = 2;
+	config.maxReadGap = 256 << 10;
+	return config;
+}
+
+class RestoreEngine {
+private:
+	/**
+	 * A sequential read from a container and the chunks it delivers
+	 */
+	struct containerRead {
+		ContainerID container;
+		size_t offset;
+		size_t length;
+		std::vector<size_t> chunks; // indices into the recipe
+	};
+
+	/**
+	 * Everything needed to assemble one window of the output
+	 */
+	struct assemblyWindow {
+		size_t firstChunk;
+		size_t lastChunk; // one past the last chunk
+		std::vector<size_t> chunkOffsets; // where every chunk goes in the buffer
+		std::vector<containerRead> reads;
+		std::vector<BYTE> buffer;
+		size_t nextRead; // the next read to be taken by a thread
+		bool failed;
+		boost::mutex lock;
+		boost::shared_ptr<boost::thread> assembler;
+	};
+
+	ContainerSource* source;
+	RestoreConfig config;
+	RestoreStatistics statistics;
+	const std::vector<ChunkLocation>* recipe; // the recipe being restored
+
+	/**
+	 * Plans the reads of a window: groups its chunks by container and merges the chunks of every
+	 * container that lie close to each other into single reads
+	 *
+	 * @param window the window, with the chunk range already set
+	 */
+	void planWindow(assemblyWindow& window);
+
+	/**
+	 * Takes reads of a window one after the other and decompresses their chunks into the buffer.
+	 * This is what every thread assembling a window runs.
+	 *
+	 * @param window the window
+	 */
+	void processReads(assemblyWindow* window);
+
+	/**
+	 * Assembles a window by running processReads() on a number of threads
+	 *
+	 * @param window the window
+	 */
+	void assembleWindow(assemblyWindow* window);
+
+public:
+	/**
+	 * Creates an engine
+	 *
+	 * @param source where the containers are read from
+	 * @param config the parameters
+	 */
+	RestoreEngine(ContainerSource* source, const RestoreConfig& config);
+
+	/**
+	 * Restores data and writes it into a file
+	 *
+	 * @param recipe the location of every chunk of the data, in order
+	 * @param output the file the data is written into, strictly sequentially
+	 * @return false if a container could not be read, a chunk could not be decompressed or the output could not be written
+	 */
+	bool restore(const std::vector<ChunkLocation>& recipe, FILE* output);
+
+	const RestoreStatistics& getStatistics() const;
+
+	virtual ~RestoreEngine();
+};
+
+/**
+ * Writes a recipe into a file. Every field is written in little endian byte order: the magic (4
+ * bytes), the number of chunks (8) and then the container, the offset, the length, the stored length
+ * and the codec (4 each) of every chunk.
+ *
+ * @param path the path of the file
+ * @param recipe the recipe
+ * @return false on failure
+ */
+bool writeRecipe(const std::string& path, const std::vector<ChunkLocation>& recipe);
+
+/**
+ * Reads a recipe from a file
+ *
+ * @param path the path of the file
+ * @param recipe receives the recipe
+ * @return false on failure or if the number of chunks does not match the size of the file
+ */
+bool readRecipe(const std::string& path, std::vector<ChunkLocation>& recipe);
+
+#endif /* RESTOREENGINE_H_ */
@@ -0,0 +1,253 @@
+/**
+ * SparseIndex.cpp
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Zahari Dichev <zaharidichev@gmail.com>
+ */
+
+#include "SparseIndex.h"
+#include <unistd.h>
+#include <algorithm>
+#include <boost/unordered_set.hpp>
+
+#define MAX_SAMPLING_BITS 32
+#define MANIFEST_ENTRY_SIZE (DIGEST_SIZE + 5 * sizeof(uint32_t))
+
+/**
+ * Writes a 32 bit value in little endian byte order
+ */
+static BYTE* putManifestField(BYTE* out, uint32_t value) {
+	for (int b = 0; b < 4; ++b) {
+		out[b] = (BYTE) (value >> (8 * b));
+	}
+	return out + 4;
+}
+
+/**
+ * Reads a 32 bit value written with putManifestField()
+ */
+static const BYTE* getManifestField(const BYTE* in, uint32_t& value) {
+	value = 0;
+	for (int b = 0; b < 4; ++b) {
+		value |= (uint32_t) in[b] << (8 * b);
+	}
+	return in + 4;
+}
+
+SparseIndex::SparseIndex(const SparseIndexConfig& config, const std::string& manifestDirectory) :
+		config(config), hookMemory(0), manifestFile(NULL), manifestFileSize(0), manifestError(false), peakChampionMemory(0) {
+	memset(&this->statistics, 0, sizeof(SparseIndexStatistics));
+	if (manifestDirectory.empty()) {
+		this->manifestFile = tmpfile();
+	} else {
+		this->manifestFile = fopen((manifestDirectory + "/segments.manifest").c_str(), "w+b");
+	}
+	this->config.samplingBits = std::max(0, std::min(this->config.samplingBits, MAX_SAMPLING_BITS));
+	if (this->config.maxChampions == 0) {
+		this->config.maxChampions = 1;
+	}
+	if (this->config.maxSegmentsPerHook == 0) {
+		this->config.maxSegmentsPerHook = 1;
+	}
+}
+
+SparseIndex::~SparseIndex() {
+	if (this->manifestFile != NULL) {
+		fclose(this->manifestFile);
+	}
+}
+
+size_t SparseIndex::getHookEntryMemory(size_t segments) {
+	// the digest, the vector of segments and what the hash table keeps per entry (a node link and a bucket)
+	return sizeof(ChunkDigest) + sizeof(std::vector<SegmentID>) + 2 * sizeof(void*) + segments * sizeof(SegmentID);
+}
+
+bool SparseIndex::isHook(const ChunkDigest& digest) const {
+	if (this->config.samplingBits == 0) {
+		return true;
+	}
+	uint32_t prefix = ((uint32_t) digest.bytes[0] << 24) | ((uint32_t) digest.bytes[1] << 16) | ((uint32_t) digest.bytes[2] << 8)
+			| (uint32_t) digest.bytes[3];
+	return (prefix >> (MAX_SAMPLING_BITS - this->config.samplingBits)) == 0;
+}
+
+void SparseIndex::enforceMemoryLimit() {
+	while (this->hookMemory > this->config.memoryLimit && this->config.samplingBits < MAX_SAMPLING_BITS) {
+		++this->config.samplingBits;
+		++this->statistics.downsamples;
+		boost::unordered_map<ChunkDigest, std::vector<SegmentID> >::iterator it = this->hooks.begin();
+		while (it != this->hooks.end()) {
+			if (isHook(it->first)) {
+				++it;
+				continue;
+			}
+			this->hookMemory -= getHookEntryMemory(it->second.size());
+			it = this->hooks.erase(it);
+		}
+	}
+}
+
+size_t SparseIndex::getChampionMemory() const {
+	// as for the hooks, a hash table entry is the key, the value, a node link and a bucket
+	return this->champions.size() * (sizeof(ChunkDigest) + sizeof(ChunkLocation) + 2 * sizeof(void*));
+}
+
+void SparseIndex::loadManifest(SegmentID segment) {
+	const segmentExtent& extent = this->segments[segment];
+	size_t length = (size_t) extent.chunks * MANIFEST_ENTRY_SIZE;
+	std::vector<BYTE> manifest(length);
+	if (this->manifestFile == NULL || this->manifestError
+			|| (length > 0 && pread(fileno(this->manifestFile), &manifest[0], length, extent.offset) != (ssize_t) length)) {
+		this->manifestError = true;
+		return;
+	}
+	++this->statistics.manifestLoads;
+	this->statistics.manifestBytesRead += length;
+	const BYTE* in = manifest.empty() ? NULL : &manifest[0];
+	for (uint32_t i = 0; i < extent.chunks; ++i) {
+		ChunkDigest digest;
+		ChunkLocation location;
+		memcpy(digest.bytes, in, DIGEST_SIZE);
+		in = getManifestField(in + DIGEST_SIZE, location.container);
+		in = getManifestField(in, location.offset);
+		in = getManifestField(in, location.length);
+		in = getManifestField(in, location.storedLength);
+		in = getManifestField(in, location.codec);
+		this->champions.insert(std::make_pair(digest, location));
+	}
+}
+
+void SparseIndex::selectChampions(const std::vector<ChunkDigest>& digests, size_t first, size_t last) {
+	++this->statistics.superChunks;
+	this->champions.clear();
+
+	// every candidate segment with the hooks of the super chunk it contains
+	boost::unordered_set<ChunkDigest> seen;
+	std::vector<bool> covered;
+	boost::unordered_map<SegmentID, std::vector<size_t> > candidates;
+	for (size_t chunk = first; chunk <= last; ++chunk) {
+		if (!isHook(digests[chunk]) || !seen.insert(digests[chunk]).second) {
+			continue;
+		}
+		boost::unordered_map<ChunkDigest, std::vector<SegmentID> >::const_iterator hook = this->hooks.find(digests[chunk]);
+		if (hook == this->hooks.end()) {
+			continue;
+		}
+		for (size_t s = 0; s < hook->second.size(); ++s) {
+			candidates[hook->second[s]].push_back(covered.size());
+		}
+		covered.push_back(false);
+	}
+
+	for (size_t c = 0; c < this->config.maxChampions && !candidates.empty(); ++c) {
+		boost::unordered_map<SegmentID, std::vector<size_t> >::iterator best = candidates.end();
+		size_t bestScore = 0;
+		for (boost::unordered_map<SegmentID, std::vector<size_t> >::iterator it = candidates.begin(); it != candidates.end(); ++it) {
+			size_t score = 0;
+			for (size_t h = 0; h < it->second.size(); ++h) {
+				score += covered[it->second[h]] ? 0 : 1;
+			}
+			if (score > bestScore || (score == bestScore && score > 0 && it->first > best->first)) {
+				best = it;
+				bestScore = score;
+			}
+		}
+		if (best == candidates.end()) {
+			break; // every hook is covered already
+		}
+		for (size_t h = 0; h < best->second.size(); ++h) {
+			covered[best->second[h]] = true;
+		}
+		loadManifest(best->first);
+		++this->statistics.champions;
+		candidates.erase(best);
+	}
+	this->peakChampionMemory = std::max(this->peakChampionMemory, getChampionMemory());
+}
+
+bool SparseIndex::lookup(const ChunkDigest& digest, ChunkLocation& location) {
+	++this->statistics.lookups;
+	boost::unordered_map<ChunkDigest, ChunkLocation>::iterator it = this->champions.find(digest);
+	if (it == this->champions.end()) {
+		return false;
+	}
+	++this->statistics.hits;
+	location = it->second;
+	return true;
+}
+
+void SparseIndex::addSegment(const std::vector<ChunkDigest>& digests, const std::vector<ChunkLocation>& locations, size_t first) {
+	SegmentID id = this->segments.size();
+	segmentExtent extent;
+	extent.offset = this->manifestFileSize;
+	extent.chunks = locations.size();
+	this->segments.push_back(extent);
+
+	std::vector<BYTE> manifest(locations.size() * MANIFEST_ENTRY_SIZE);
+	BYTE* out = manifest.empty() ? NULL : &manifest[0];
+	for (size_t i = 0; i < locations.size(); ++i) {
+		memcpy(out, digests[first + i].bytes, DIGEST_SIZE);
+		out = putManifestField(out + DIGEST_SIZE, locations[i].container);
+		out = putManifestField(out, locations[i].offset);
+		out = putManifestField(out, locations[i].length);
+		out = putManifestField(out, locations[i].storedLength);
+		out = putManifestField(out, locations[i].codec);
+	}
+	if (this->manifestFile == NULL
+			|| (!manifest.empty()
+					&& pwrite(fileno(this->manifestFile), &manifest[0], manifest.size(), extent.offset) != (ssize_t) manifest.size())) {
+		this->manifestError = true;
+	}
+	this->manifestFileSize += manifest.size();
+
+	for (size_t i = 0; i < locations.size(); ++i) {
+		const ChunkDigest& digest = digests[first + i];
+		if (!isHook(digest)) {
+			continue;
+		}
+		std::vector<SegmentID>& hookSegments = this->hooks[digest];
+		if (!hookSegments.empty() && hookSegments.back() == id) {
+			continue; // the hook is repeated within the segment
+		}
+		this->hookMemory += (hookSegments.empty() ? getHookEntryMemory(1) : sizeof(SegmentID));
+		hookSegments.push_back(id);
+		if (hookSegments.size() > this->config.maxSegmentsPerHook) {
+			// only the newest segments are kept
+			hookSegments.erase(hookSegments.begin());
+			this->hookMemory -= sizeof(SegmentID);
+		}
+	}
+	enforceMemoryLimit();
+}
+
+size_t SparseIndex::getNumHooks() const {
+	return this->hooks.size();
+}
+
+size_t SparseIndex::getNumSegments() const {
+	return this->segments.size();
+}
+
+bool SparseIndex::isGood() const {
+	return this->manifestFile != NULL && !this->manifestError;
+}
+
+size_t SparseIndex::getResidentManifestMemory() const {
+	return this->segments.capacity() * sizeof(segmentExtent) + this->peakChampionMemory;
+}
+
+OFFSET_64 SparseIndex::getManifestFileSize() const {
+	return this->manifestFileSize;
+}
+
+size_t SparseIndex::getHookMemory() const {
+	return this->hookMemory;
+}
+
+int SparseIndex::getSamplingBits() const {
+	return this->config.samplingBits;
+}
+
+const SparseIndexStatistics& SparseIndex::getStatistics() const {
+	return this->statistics;
+}
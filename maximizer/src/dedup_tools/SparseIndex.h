@@ -0,0 +1,198 @@
+/**
+ * SparseIndex.h
+ *
+ * An index for data sets whose digests do not fit into memory (sparse indexing). Instead of every
+ * digest, only the hooks are kept in memory: the digests whose first samplingBits bits are zero,
+ * about one in 2^samplingBits. Every super chunk that is deduplicated becomes a segment, and its
+ * manifest (the digests and locations of all its chunks, duplicates included) is appended to a
+ * manifest file, where the full index would be. Only the offset and the number of chunks of every
+ * segment stay in memory, and every hook maps to the last few segments that contain it.
+ *
+ * An incoming super chunk is deduplicated only against a few champion segments. The segments that
+ * share hooks with it are candidates, and the champions are picked greedily: the candidate with
+ * the most hooks that no champion covers yet comes next, the newest one on a tie. The manifests of
+ * the champions are read back from the manifest file, and every chunk that is not in them is treated as new, even if it is
+ * stored somewhere else. That is where sparse indexing loses deduplication, in exchange for
+ * memory that is a small fraction of a full index.
+ *
+ * A manifest takes 40 bytes per chunk in the file: the digest and the container, the offset, the
+ * length, the stored length and the codec of the location, in little endian byte order.
+ *
+ * The memory the hooks take is bounded. When it grows over the limit, samplingBits is increased
+ * and the hooks that are no longer sampled are dropped, which halves their number.
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Zahari Dichev <zaharidichev@gmail.com>
+ */
+
+#ifndef SPARSEINDEX_H_
+#define SPARSEINDEX_H_
+
+#include "ChunkDigest.h"
+#include "ContainerStore.h"
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include <boost/unordered_map.hpp>
+
+typedef uint32_t SegmentID;
+
+/**
+ * The parameters of a sparse index
+ */
+struct SparseIndexConfig {
+	int samplingBits; // a digest is a hook if its first samplingBits bits are zero
+	size_t maxChampions; // the segments an incoming super chunk is deduplicated against
+	size_t maxSegmentsPerHook; // the newest segments kept for every hook
+	size_t memoryLimit; // the bytes the hooks can take in memory
+};
+
+/**
+ * Counters that show how well the index does
+ */
+struct SparseIndexStatistics {
+	size_t lookups;
+	size_t hits; // lookups that found the chunk in a champion
+	size_t superChunks; // super chunks for which champions were selected
+	size_t champions; // champions selected, over all the super chunks
+	size_t manifestLoads; // manifests read back from where they are stored
+	OFFSET_64 manifestBytesRead; // the bytes of the manifests read back
+	size_t downsamples; // times samplingBits was increased to stay within the memory limit
+};
+
+/**
+ * Returns a configuration that samples one digest in 64, with 4 champions, 4 segments per hook and
+ * 64 MiB for the hooks
+ *
+ * @return the configuration
+ */
+inline SparseIndexConfig getDefaultSparseIndexConfig() {
+	SparseIndexConfig config;
+	config.samplingBits = 6;
+	config.maxChampions = 4;
+	config.maxSegmentsPerHook = 4;
+	config.memoryLimit = 64 << 20;
+	return config;
+}
+
+class SparseIndex {
+private:
+	/**
+	 * Where the manifest of a segment is in the manifest file
+	 */
+	struct segmentExtent {
+		OFFSET_64 offset;
+		uint32_t chunks;
+	};
+
+	SparseIndexConfig config;
+	boost::unordered_map<ChunkDigest, std::vector<SegmentID> > hooks;
+	size_t hookMemory; // an estimate of what the hooks take
+	std::vector<segmentExtent> segments;
+
+	FILE* manifestFile; // the manifests of all the segments, one after the other
+	OFFSET_64 manifestFileSize;
+	bool manifestError; // a manifest could not be written or read back
+
+	// the chunks of the champions of the current super chunk
+	boost::unordered_map<ChunkDigest, ChunkLocation> champions;
+	size_t peakChampionMemory; // the most the chunks of the champions of a super chunk took
+
+	SparseIndexStatistics statistics;
+
+	/**
+	 * Returns the memory a hook with a number of segments takes
+	 */
+	static size_t getHookEntryMemory(size_t segments);
+
+	/**
+	 * Returns the memory the loaded chunks of the champions take
+	 */
+	size_t getChampionMemory() const;
+
+	/**
+	 * Increases samplingBits and drops the hooks that are no longer sampled, until the hooks fit
+	 * into the memory limit
+	 */
+	void enforceMemoryLimit();
+
+	/**
+	 * Reads the manifest of a segment from the manifest file into the chunks of the champions
+	 *
+	 * @param segment the segment
+	 */
+	void loadManifest(SegmentID segment);
+
+public:
+	/**
+	 * Creates an empty index
+	 *
+	 * @param config the parameters
+	 * @param manifestDirectory the directory the manifest file (segments.manifest) is written into; if
+	 *        empty, an anonymous temporary file is used
+	 */
+	SparseIndex(const SparseIndexConfig& config, const std::string& manifestDirectory = "");
+
+	/**
+	 * Tells whether a digest is sampled as a hook
+	 *
+	 * @param digest the digest
+	 * @return true if its first samplingBits bits are zero
+	 */
+	bool isHook(const ChunkDigest& digest) const;
+
+	/**
+	 * Selects the champions of an incoming super chunk and loads their manifests, replacing the
+	 * champions of the previous super chunk
+	 *
+	 * @param digests the digests of all the chunks
+	 * @param first the index of the first chunk of the super chunk
+	 * @param last the index of the last chunk of the super chunk
+	 */
+	void selectChampions(const std::vector<ChunkDigest>& digests, size_t first, size_t last);
+
+	/**
+	 * Looks up a chunk in the champions of the current super chunk
+	 *
+	 * @param digest the digest of the chunk
+	 * @param location receives the location of the chunk if it is found
+	 * @return true if the chunk is a duplicate
+	 */
+	bool lookup(const ChunkDigest& digest, ChunkLocation& location);
+
+	/**
+	 * Appends the manifest of a super chunk that has been deduplicated to the manifest file as a new
+	 * segment and maps its hooks to it
+	 *
+	 * @param digests the digests of all the chunks
+	 * @param locations the locations of the chunks of the super chunk, in order
+	 * @param first the index of the first chunk of the super chunk in digests
+	 */
+	void addSegment(const std::vector<ChunkDigest>& digests, const std::vector<ChunkLocation>& locations, size_t first);
+
+	/**
+	 * Tells whether the manifest file could be created and every manifest written to and read back from it
+	 *
+	 * @return false if the deduplication done against the index cannot be trusted
+	 */
+	bool isGood() const;
+
+	/**
+	 * Returns the memory the manifests take: the extents of the segments and the most that the
+	 * loaded manifests of the champions of a super chunk took
+	 *
+	 * @return the bytes
+	 */
+	size_t getResidentManifestMemory() const;
+
+	size_t getNumHooks() const;
+	size_t getNumSegments() const;
+	size_t getHookMemory() const;
+	OFFSET_64 getManifestFileSize() const;
+	int getSamplingBits() const;
+	const SparseIndexStatistics& getStatistics() const;
+
+	virtual ~SparseIndex();
+};
+
+#endif /* SPARSEINDEX_H_ */
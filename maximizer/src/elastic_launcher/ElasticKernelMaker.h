@@ -22,7 +22,7 @@
 #include "string.h"
 #include <string>
 enum KernelType {
-	CHUNKING, BLACK_SCHOLES, SCALAR_PRODUCT, VECTOR_ADD, MATRIX_MULT
+	CHUNKING, BLACK_SCHOLES, SCALAR_PRODUCT, VECTOR_ADD, MATRIX_MULT, FIXED_BLOCK_CHUNKING // chunking in fixed-size blocks instead of by content
 };
 
 /**
@@ -35,7 +35,7 @@ enum KernelType {
  * @param problemSize
  * @return
  */
-boost::shared_ptr<AbstractElasticKernel> makeElasticKernel(size_t threadsPerBlock, size_t blocksPerGrid, KernelType type, std::string name, int problemSize) {
+boost::shared_ptr<AbstractElasticKernel> makeElasticKernel(size_t threadsPerBlock, size_t blocksPerGrid, KernelType type, std::string name, size_t problemSize) {
 	LaunchParameters parameters = LaunchParameters(threadsPerBlock, blocksPerGrid);
 	AbstractElasticKernel* result;
 
@@ -59,6 +59,10 @@ boost::shared_ptr<AbstractElasticKernel> makeElasticKernel(size_t threadsPerBloc
 		return boost::shared_ptr<AbstractElasticKernel>(new ElasticMatrixMultiplication(parameters, name, problemSize));
 
 	}
+	if (type == 5) {
+		return boost::shared_ptr<AbstractElasticKernel>(new ElasticChunker(parameters, name, problemSize, FIXED_BLOCKS));
+
+	}
 
 }
 
@@ -8,12 +8,65 @@
 #include "KernelExecutionQueue.h"
 
 size_t KernelExecutionQueue::getFreeGPUMemory() {
-	size_t total;
-	size_t free;
-	// we just use the nvidia API here to get that...
-	cudaMemGetInfo(&free, &total);
+	// the nvidia API, or the whole memory of the device profile in use, less a little bit of a buffer for paging...
+	return getAvailableDeviceMemory();
+}
+
+const KernelDemand& KernelExecutionQueue::getDemand(const boost::shared_ptr<AbstractElasticKernel>& kernel) {
+	boost::unordered_map<AbstractElasticKernel*, KernelDemand>::const_iterator cached = this->kernelDemands.find(kernel.get());
+	if (cached != this->kernelDemands.end()) {
+		return cached->second;
+	}
+	return this->kernelDemands[kernel.get()] = getKernelDemand(kernel);
+}
+
+double KernelExecutionQueue::getCombinationChange(const std::vector<boost::shared_ptr<AbstractElasticKernel> >& combination) {
+	std::vector<KernelDemand> demands;
+	for (std::vector<boost::shared_ptr<AbstractElasticKernel> >::const_iterator it = combination.begin(); it != combination.end(); ++it) {
+		demands.push_back(getDemand(*it));
+	}
+	// split the resources according to what the kernels ask for
+	std::vector<KernelLimits> limits = partitionResources(demands, getGPUConfiguration());
+	std::vector<LaunchParameters> params;
+	std::vector<KernelDemand> newDemands;
+	for (size_t i = 0; i < combination.size(); ++i) {
+		// use the kernel limiter algorithm in order to fit the kernel in the resources avaible to it
+		params.push_back(combination[i].get()->getLaunchParams());
+		LaunchParameters newParams = limitUsage(demands[i], params.back(), limits[i]);
+		newDemands.push_back(demands[i]);
+		newDemands.back().blocks = min2(demands[i].blocks, newParams.getBlocksPerGrid());
+	}
+	// the blocks that fit on the SMs next to the blocks of the other kernels
+	CoResidency residency = getCoResidency(newDemands, getGPUConfiguration());
+	double change = 0;
+	for (size_t i = 0; i < combination.size(); ++i) {
+		int newThrCount = residency.residentBlocks[i] * params[i].getThreadsPerBlock();
+		//Calculate how much the kernel changes in terms of threadcount
+		double currentThrs = (double) params[i].getNumTotalThreads();
+		change = change + std::abs((double) (newThrCount - currentThrs) / currentThrs);
+	}
+	return change / (double) combination.size();
+}
 
-	return free - (64 * (1 << 20)); // give a little bit of a buffer for paging...
+double KernelExecutionQueue::getCombinationTimeRatio(const std::vector<boost::shared_ptr<AbstractElasticKernel> >& combination) {
+	std::vector<KernelDemand> demands;
+	std::vector<KernelWork> work;
+	double sequential = 0;
+	for (std::vector<boost::shared_ptr<AbstractElasticKernel> >::const_iterator it = combination.begin(); it != combination.end(); ++it) {
+		demands.push_back(getDemand(*it));
+		work.push_back(getKernelWork(*it));
+		sequential += predictKernelTime(getGPUConfiguration(), demands.back(), work.back()).time;
+	}
+	// the kernels get the share of the resources they would get when paired
+	std::vector<KernelLimits> limits = partitionResources(demands, getGPUConfiguration());
+	for (size_t i = 0; i < combination.size(); ++i) {
+		LaunchParameters newParams = limitUsage(demands[i], combination[i].get()->getLaunchParams(), limits[i]);
+		demands[i].blocks = min2(demands[i].blocks, newParams.getBlocksPerGrid());
+	}
+	if (sequential <= 0) {
+		return 1;
+	}
+	return predictGroupTime(getGPUConfiguration(), demands, work).time / sequential;
 }
 
 void KernelExecutionQueue::generateKernelCombinations(int offset, int k, std::vector<boost::shared_ptr<AbstractElasticKernel> >& combination,
@@ -21,20 +74,8 @@ void KernelExecutionQueue::generateKernelCombinations(int offset, int k, std::ve
 		std::vector<std::pair<std::vector<boost::shared_ptr<AbstractElasticKernel> >, double> >& results) {
 
 	if (k == 0) {
-		// here we calculate how much the kernels need to change in order to run them concurrently
-		double changeIndex = 0;
-		double resourceFraction = 1 / (double) combination.size(); // Calculate the resource fraction based on the size of the combination
-		for (std::vector<boost::shared_ptr<AbstractElasticKernel> >::iterator it = combination.begin(); it != combination.end(); ++it) {
-			// use the kernel limiter algorithm in order to fit the kernel in the resources avaible to it
-			int newThrCount =
-					limitKernel((*it), KernelLimits(resourceFraction, resourceFraction, resourceFraction, resourceFraction, getGPUConfiguration())).getNumTotalThreads();
-			//Calculate how much the kernel changes in terms of threadcount
-			double currentThrs = (double) (*it).get()->getLaunchParams().getNumTotalThreads();
-			double delta = std::abs((double) (newThrCount - currentThrs) / currentThrs);
-			changeIndex = changeIndex + delta;
-		}
-		//calcualte the average change index and put it in a pair together with the combination
-		changeIndex = changeIndex / (double) combination.size();
+		// here we calculate how much the kernels need to change in order to run them concurrently, on average
+		double changeIndex = (this->objective == MINIMUM_MAKESPAN) ? getCombinationTimeRatio(combination) : getCombinationChange(combination);
 		results.push_back(std::make_pair(combination, changeIndex));
 		return;
 	}
@@ -47,19 +88,23 @@ void KernelExecutionQueue::generateKernelCombinations(int offset, int k, std::ve
 }
 
 std::vector<boost::shared_ptr<AbstractElasticKernel> > KernelExecutionQueue::extractKernelSequenceWithMinModification(
-		std::vector<std::pair<std::vector<boost::shared_ptr<AbstractElasticKernel> >, double> > combinations) {
+		std::vector<std::pair<std::vector<boost::shared_ptr<AbstractElasticKernel> >, double> >& combinations) {
 	ConcurencyVectorComparator comparator; // Create comparator object to sort the combinations according to change index (decreasing order)
 	std::sort(combinations.begin(), combinations.end(), comparator);
 	std::vector<boost::shared_ptr<AbstractElasticKernel> > results; // create results vector - this is where final kenrel order will be created
+	boost::unordered_set<AbstractElasticKernel*> placed; // the kernels in the results vector, for constant time lookups
 
 	for (std::vector<std::pair<std::vector<boost::shared_ptr<AbstractElasticKernel> >, double> >::const_iterator it = combinations.begin();
 			it != combinations.end(); ++it) {
 		// wal thorugh all combination
 
-		if (!this->doVectorsContainCommonElem(results, (*it).first)) {
+		if (!this->doContainCommonElem(placed, (*it).first)) {
 			// iff non of the kenrels in the combination are already in the result vector, scale then dodown and add them
 			this->limitKernels((*it).first);
 			results.insert(results.end(), (*it).first.begin(), (*it).first.end());
+			for (std::vector<boost::shared_ptr<AbstractElasticKernel> >::const_iterator it2 = (*it).first.begin(); it2 != (*it).first.end(); ++it2) {
+				placed.insert((*it2).get());
+			}
 			continue;
 		}
 
@@ -71,8 +116,9 @@ std::vector<boost::shared_ptr<AbstractElasticKernel> > KernelExecutionQueue::ext
 
 			for (std::vector<boost::shared_ptr<AbstractElasticKernel> >::const_iterator it2 = (*it).first.begin(); it2 != (*it).first.end(); ++it2) {
 
-				if (!this->isKernelInVector(results, (*it2))) {
+				if (!this->isKernelInSet(placed, (*it2))) {
 					results.push_back((*it2));
+					placed.insert((*it2).get());
 				}
 
 			}
@@ -83,40 +129,31 @@ std::vector<boost::shared_ptr<AbstractElasticKernel> > KernelExecutionQueue::ext
 	return results;
 }
 
-bool KernelExecutionQueue::isKernelInVector(std::vector<boost::shared_ptr<AbstractElasticKernel> > kernelVector,
-		boost::shared_ptr<AbstractElasticKernel> vector) {
-	for (std::vector<boost::shared_ptr<AbstractElasticKernel> >::const_iterator it = kernelVector.begin(); it != kernelVector.end(); ++it) {
-		if ((*it) == vector) {
-			// simply check whether the kernel is in the vector... we can compare shared pointers just like raw ones.. (thanks boost...)
-			return true;
-		}
-	}
-	return false;
+bool KernelExecutionQueue::isKernelInSet(const boost::unordered_set<AbstractElasticKernel*>& kernelSet,
+		const boost::shared_ptr<AbstractElasticKernel>& kernel) {
+	// the set holds the raw pointers of the kernels, so this is a hash lookup instead of a walk through a vector
+	return kernelSet.find(kernel.get()) != kernelSet.end();
 }
 
-bool KernelExecutionQueue::doVectorsContainCommonElem(std::vector<boost::shared_ptr<AbstractElasticKernel> > kernelVector_x,
-		std::vector<boost::shared_ptr<AbstractElasticKernel> > kernelVector_y) {
-
-	// this method is a tad expensive.... but what can we do.. ?
-	// simply do intersection of vectors
-	for (std::vector<boost::shared_ptr<AbstractElasticKernel> >::const_iterator it = kernelVector_x.begin(); it != kernelVector_x.end(); ++it) {
-		if (this->isKernelInVector(kernelVector_y, (*it))) {
+bool KernelExecutionQueue::doContainCommonElem(const boost::unordered_set<AbstractElasticKernel*>& kernelSet,
+		const std::vector<boost::shared_ptr<AbstractElasticKernel> >& kernelVector) {
+	for (std::vector<boost::shared_ptr<AbstractElasticKernel> >::const_iterator it = kernelVector.begin(); it != kernelVector.end(); ++it) {
+		if (this->isKernelInSet(kernelSet, (*it))) {
 			return true;
 		}
 	}
 	return false;
 }
 
-void KernelExecutionQueue::limitKernels(std::vector<boost::shared_ptr<AbstractElasticKernel> > kernels) {
+void KernelExecutionQueue::limitKernels(const std::vector<boost::shared_ptr<AbstractElasticKernel> >& kernels) {
 
-	double resoruceFraction = 1.0 / (double) kernels.size(); // calculate limit fraction
-	KernelLimits limit = KernelLimits(resoruceFraction, resoruceFraction, resoruceFraction, resoruceFraction, getGPUConfiguration());
+	// split the resources according to what the kernels ask for, instead of an equal share of everything
+	std::vector<KernelLimits> limits = partitionResources(kernels, getGPUConfiguration());
 	// just iterate through all kernels and limit their occupancy in order to fit in the hardware constraints imposed
-	for (std::vector<boost::shared_ptr<AbstractElasticKernel> >::const_iterator it = kernels.begin(); it != kernels.end(); ++it) {
-		LaunchParameters currentParams = (*it).get()->getLaunchParams();
-		LaunchParameters newParams = limitKernel((*it), limit);
+	for (size_t i = 0; i < kernels.size(); ++i) {
+		LaunchParameters newParams = limitKernel(kernels[i], limits[i]);
 
-		(*it).get()->setLaunchParams(newParams);
+		kernels[i].get()->setLaunchParams(newParams);
 	}
 
 }
@@ -125,16 +162,28 @@ KernelExecutionQueue::KernelExecutionQueue() {
 
 	this->maxGlobalMem = getFreeGPUMemory();  // just grab the free memory on initiation
 	this->memoryUsed = 0;
+	this->objective = POLICY_DEFAULT;
 }
 
 KernelExecutionQueue::~KernelExecutionQueue() {
 }
 
+bool KernelExecutionQueue::canFitKernel(boost::shared_ptr<AbstractElasticKernel> kernel) {
+	return kernel.get()->getMemoryConsumption() < (this->maxGlobalMem - this->memoryUsed);
+}
+
+size_t KernelExecutionQueue::getMemoryCapacity() {
+	return this->maxGlobalMem;
+}
+
 bool KernelExecutionQueue::addKernel(boost::shared_ptr<AbstractElasticKernel> kernel) {
 
-	if (kernel.get()->getMemoryConsumption() < (this->maxGlobalMem - this->memoryUsed)) { // check whether we can fit the kernel in here
-		cudaStream_t streamForKernel;
-		cudaStreamCreate(&streamForKernel);
+	if (this->canFitKernel(kernel)) { // check whether we can fit the kernel in here
+		cudaStream_t streamForKernel = 0;
+		if (!isOfflineDeviceProfile()) {
+			// a queue that is only planned against a device profile never runs, so it needs no streams
+			cudaStreamCreate(&streamForKernel);
+		}
 		this->kernelsAndStreams.push_back(std::make_pair(kernel, streamForKernel)); // associate kernel with a stream
 		this->memoryUsed = this->memoryUsed + kernel.get()->getMemoryConsumption(); // modify memory consumtion of the whole queue
 		return true;
@@ -163,15 +212,20 @@ void KernelExecutionQueue::disposeQueue() {
 	for (std::vector<std::pair<boost::shared_ptr<AbstractElasticKernel>, cudaStream_t> >::iterator it = this->kernelsAndStreams.begin();
 			it != this->kernelsAndStreams.end(); ++it) {
 		(*it).first.get()->freeResources();
-		cudaStreamDestroy((*it).second);
+		if ((*it).second != 0) {
+			cudaStreamDestroy((*it).second);
+		}
+	}
+	if (!isOfflineDeviceProfile()) {
+		cudaDeviceSynchronize();
 	}
-	cudaDeviceSynchronize();
 	this->kernelsAndStreams.clear();
 	this->memoryUsed = 0;
 	this->kernelsAndStreams.begin();
 }
 
-void KernelExecutionQueue::moldQueueForMaximumConcurency() {
+void KernelExecutionQueue::moldQueueForMaximumConcurency(SchedulingObjective objective) {
+	this->objective = objective;
 	if (this->kernelsAndStreams.size() > 1) {
 		std::vector<boost::shared_ptr<AbstractElasticKernel> > kernels;
 
@@ -182,6 +236,7 @@ void KernelExecutionQueue::moldQueueForMaximumConcurency() {
 		//clear up the queue
 		this->kernelsAndStreams.clear();
 		this->memoryUsed = 0;
+		this->kernelDemands.clear(); // the launch parameters may have changed since the last time
 		std::vector<boost::shared_ptr<AbstractElasticKernel> > comb; // the combination vector
 		std::vector<std::pair<std::vector<boost::shared_ptr<AbstractElasticKernel> >, double> > results; // the combination matrix along with scaling factor
 		this->generateKernelCombinations(0, 2, comb, kernels, results); // generate combinations of 2
@@ -197,13 +252,13 @@ void KernelExecutionQueue::moldQueueForMaximumConcurency() {
 }
 
 double KernelExecutionQueue::getComputeOccupancyForQueue() {
-	double result = 0;
+	std::vector<boost::shared_ptr<AbstractElasticKernel> > kernels;
 	for (std::vector<std::pair<boost::shared_ptr<AbstractElasticKernel>, cudaStream_t> >::const_iterator it = kernelsAndStreams.begin();
 			it != kernelsAndStreams.end(); ++it) {
-		// jsut calcualte average theoretical occupancy for the queue (COMPUTE)
-		result = result + getOccupancyForKernel((*it).first);
+		kernels.push_back((*it).first);
 	}
-	return result / (double) this->kernelsAndStreams.size();
+	// the kernels of the queue run at the same time, so they share the SMs (COMPUTE)
+	return getCoResidency(kernels, getGPUConfiguration()).occupancy;
 }
 
 double KernelExecutionQueue::getStorageOccupancyForQueue() {
@@ -219,6 +274,16 @@ double KernelExecutionQueue::getStorageOccupancyForQueue() {
 	return result / gpuMem;
 }
 
+double KernelExecutionQueue::getPredictedTimeForQueue() {
+	std::vector<boost::shared_ptr<AbstractElasticKernel> > kernels;
+	for (std::vector<std::pair<boost::shared_ptr<AbstractElasticKernel>, cudaStream_t> >::const_iterator it = kernelsAndStreams.begin();
+			it != kernelsAndStreams.end(); ++it) {
+		kernels.push_back((*it).first);
+	}
+	// the kernels of the queue share the SMs, the bandwidth and the pipelines
+	return predictGroupTime(kernels, getGPUConfiguration()).time;
+}
+
 std::ostream& operator <<(std::ostream& output, const KernelExecutionQueue& q) {
 
 	for (std::vector<std::pair<boost::shared_ptr<AbstractElasticKernel>, cudaStream_t> >::const_iterator it = q.kernelsAndStreams.begin();
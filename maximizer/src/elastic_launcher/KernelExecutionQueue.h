@@ -20,14 +20,34 @@
 
 #include <vector>
 #include <boost/shared_ptr.hpp>
+#include <boost/unordered_map.hpp>
+#include <boost/unordered_set.hpp>
 #include "../abstract_elastic_kernel/AbstractElasticKernel.hpp"
 #include "../misc/Macros.h"
 #include "../occupancy_tools/OccupancyCalculator.h"
+#include "../occupancy_tools/ResourcePartitioning.h"
+#include "../occupancy_tools/CoResidency.h"
+#include "../occupancy_tools/RooflinePredictor.h"
 #include <cmath>
 
+/**
+ * What the policies optimise when they place kernels into queues and mold them
+ */
+enum SchedulingObjective {
+	/**
+	 * What every policy optimises by itself: the memory the queues hold, the occupancy of the kernels
+	 * and the change to their launch parameters
+	 */
+	POLICY_DEFAULT,
+	/**
+	 * The time the roofline model predicts for all the queues, one after the other (see RooflinePredictor.h)
+	 */
+	MINIMUM_MAKESPAN
+};
+
 struct ConcurencyVectorComparator {
-	inline bool operator()(std::pair<std::vector<boost::shared_ptr<AbstractElasticKernel> >, double> i,
-			std::pair<std::vector<boost::shared_ptr<AbstractElasticKernel> >, double> j) {
+	inline bool operator()(const std::pair<std::vector<boost::shared_ptr<AbstractElasticKernel> >, double>& i,
+			const std::pair<std::vector<boost::shared_ptr<AbstractElasticKernel> >, double>& j) {
 		return (i.second < j.second);
 	}
 };
@@ -42,12 +62,47 @@ private:
 	// a vector that holds pairs of kernels and cuda streams, so each kernel is associated with a stream to run in
 	std::vector<std::pair<boost::shared_ptr<AbstractElasticKernel>, cudaStream_t> > kernelsAndStreams;
 
+	// what every kernel asks of the device with its current launch parameters, computed once per kernel
+	boost::unordered_map<AbstractElasticKernel*, KernelDemand> kernelDemands;
+
+	SchedulingObjective objective; // what the combinations of kernels are chosen for
+
 	/**
 	 * Returns the total free memory on the GPU
 	 * @return the free memory on the GPU
 	 */
 	size_t getFreeGPUMemory();
 
+	/**
+	 * Returns what a kernel asks of the device with its current launch parameters. This is the same for every
+	 * combination the kernel is in, so it is computed once per kernel and kept in kernelDemands.
+	 *
+	 * @param kernel the kernel
+	 * @return the demand of the kernel
+	 */
+	const KernelDemand& getDemand(const boost::shared_ptr<AbstractElasticKernel>& kernel);
+
+	/**
+	 * Returns how much the thread counts of the kernels of a combination change, relative to their current
+	 * thread counts and on average, when the resources of the device are split among them according to their
+	 * demands (see ResourcePartitioning.h). Only the threads of the blocks that are resident on the SMs
+	 * together with the blocks of the other kernels count (see CoResidency.h).
+	 *
+	 * @param combination the kernels that share the device
+	 * @return the average relative change of the thread count
+	 */
+	double getCombinationChange(const std::vector<boost::shared_ptr<AbstractElasticKernel> >& combination);
+
+	/**
+	 * Returns the time the kernels of a combination are predicted to take at the same time, with the resources
+	 * split among them as getCombinationChange() does, over the time they take one after the other. The lower it
+	 * is, the more the kernels gain from running together.
+	 *
+	 * @param combination the kernels that share the device
+	 * @return the ratio of the predicted times
+	 */
+	double getCombinationTimeRatio(const std::vector<boost::shared_ptr<AbstractElasticKernel> >& combination);
+
 	/**
 	 * Method used in the recursive generation of unique kernel combinations of length N from a set of kernels.
 	 * This methods creates all possible combinations and produces a matrix that contains them along with the
@@ -78,34 +133,35 @@ private:
 	 * @return a vector of extracted kernels that can be added back to the queue
 	 */
 	std::vector<boost::shared_ptr<AbstractElasticKernel> > extractKernelSequenceWithMinModification(
-			std::vector<std::pair<std::vector<boost::shared_ptr<AbstractElasticKernel> >, double> > combinations);
+			std::vector<std::pair<std::vector<boost::shared_ptr<AbstractElasticKernel> >, double> >& combinations);
 
 	/**
-	 * Given a kernel and a vector, the method finds out whether the kernel is contained in the vector
+	 * Given a kernel and a set of kernels, the method finds out whether the kernel is contained in the set
 	 *
-	 * @param kernelVector a vector of kernel pointers
-	 * @param vector a pointer to a kernel
+	 * @param kernelSet a set of kernel pointers
+	 * @param kernel a pointer to a kernel
 	 * @return
 	 */
-	bool isKernelInVector(std::vector<boost::shared_ptr<AbstractElasticKernel> > kernelVector, boost::shared_ptr<AbstractElasticKernel> kernel);
+	bool isKernelInSet(const boost::unordered_set<AbstractElasticKernel*>& kernelSet, const boost::shared_ptr<AbstractElasticKernel>& kernel);
 
 	/**
-	 * Given two vectors of kernel pointers, the method finds out whether they contain a common element
+	 * Given a set and a vector of kernel pointers, the method finds out whether they contain a common element
 	 *
-	 * @param kernelVector_x the first vector
-	 * @param kernelVector_y the second vector
+	 * @param kernelSet the set
+	 * @param kernelVector the vector
 	 *
 	 * @return bool
 	 */
-	bool doVectorsContainCommonElem(std::vector<boost::shared_ptr<AbstractElasticKernel> > kernelVector_x,
-			std::vector<boost::shared_ptr<AbstractElasticKernel> > kernelVector_y);
+	bool doContainCommonElem(const boost::unordered_set<AbstractElasticKernel*>& kernelSet,
+			const std::vector<boost::shared_ptr<AbstractElasticKernel> >& kernelVector);
 	/**
-	 * Given a vector of kernels, limit their resource usage in order to promote concurrency between them.
+	 * Given a vector of kernels, limit their resource usage in order to promote concurrency between them. Every
+	 * kernel gets the share of the resources that its demand gives it (see ResourcePartitioning.h).
 	 *
 	 * @param kernels vector of shared pointers to kernels
 	 */
 
-	void limitKernels(std::vector<boost::shared_ptr<AbstractElasticKernel> > kernels);
+	void limitKernels(const std::vector<boost::shared_ptr<AbstractElasticKernel> >& kernels);
 public:
 	/**
 	 * Default constructor
@@ -124,6 +180,21 @@ public:
 	 */
 	bool addKernel(boost::shared_ptr<AbstractElasticKernel> kernel);
 
+	/**
+	 * Returns whether a kernel fits into the queue, without adding it
+	 *
+	 * @param kernel the kernel
+	 * @return true if the memory left in the queue is enough for the kernel
+	 */
+	bool canFitKernel(boost::shared_ptr<AbstractElasticKernel> kernel);
+
+	/**
+	 * Returns the global memory the kernels of the queue can take together
+	 *
+	 * @return the memory in bytes
+	 */
+	size_t getMemoryCapacity();
+
 	/**
 	 * Initializes all the kernels within the queue. This is usually allocating memory on the card
 	 */
@@ -132,9 +203,12 @@ public:
 	/**
 	 * Modifies the order of the kernels within the queue in order to promote concurrency
 	 * between two kernels. This method ensures that the maximum level of concurrency is
-	 * achieved with the minimum amount of modification to launch parameters of the kernels
+	 * achieved with the minimum amount of modification to launch parameters of the kernels, or with the lowest
+	 * predicted time if that is the objective
+	 *
+	 * @param objective what the pairs of kernels are chosen for
 	 */
-	void moldQueueForMaximumConcurency();
+	void moldQueueForMaximumConcurency(SchedulingObjective objective = POLICY_DEFAULT);
 
 	/**
 	 * Runs all the kernels within the queue
@@ -147,7 +221,8 @@ public:
 	void disposeQueue();
 
 	/**
-	 * Returns the average compute utilization for this queue
+	 * Returns the compute utilization for this queue: the occupancy that the kernels of the queue give together,
+	 * as they all run at the same time (see CoResidency.h)
 	 *
 	 * @return double
 	 */
@@ -160,6 +235,14 @@ public:
 	 */
 	double getStorageOccupancyForQueue();
 
+	/**
+	 * Returns the time the roofline model predicts for the kernels of the queue, which all run at the same
+	 * time (see RooflinePredictor.h)
+	 *
+	 * @return the time, in seconds
+	 */
+	double getPredictedTimeForQueue();
+
 	// jsut a friend for enable pumping the object into an ostream
 	friend std::ostream &operator<<(std::ostream &output, const KernelExecutionQueue &q);
 }
@@ -6,6 +6,7 @@
  */
 
 #include "KernelScheduler.h"
+#include <stdio.h>
 
 void KernelScheduler::sortKernelByMemoryConsumption() {
 	// just using the comparator object to sort them in decreasing order
@@ -16,18 +17,48 @@ void KernelScheduler::sortKernelByMemoryConsumption() {
 
 void KernelScheduler::moldKernelLaunchConfigForMaximumOccupancy(boost::shared_ptr<AbstractElasticKernel> kernel) {
 
-	size_t newBlockSize = getOptimalBlockSize(kernel); // get the optimal block size
-
 	LaunchParameters parameters = kernel.get()->getLaunchParams();
 
+	if (this->gridSizing == WAVE_QUANTIZED) {
+		// size block and grid together, so the grid fills whole waves of the device
+		cudaFuncAttributes kernelProps = kernel.get()->getKernelProperties();
+		const OccupancyCurve& curve = getOccupancyCurve(kernelProps, parameters);
+		if (parameters.hasMultiDimensionalBlock()) {
+			// the block is a tile of the algorithm, only the grid is sized and it keeps its shape
+			GridSizing sizing = chooseGridSize(getGPUProperties(), curve, kernel.get()->getProblemSize(), parameters.getThreadsPerBlock());
+			if (sizing.blockSize != 0) {
+				parameters.setBlocks(sizing.gridSize);
+				kernel.get()->setLaunchParams(parameters);
+			}
+			return;
+		}
+		GridSizing sizing = chooseGridSizing(getGPUProperties(), curve, kernelProps, kernel.get()->getProblemSize());
+		if (sizing.blockSize != 0) {
+			parameters.setThreads(sizing.blockSize);
+			parameters.setBlocks(sizing.gridSize); // a two dimensional grid keeps its shape
+			kernel.get()->setLaunchParams(parameters);
+		}
+		return;
+	}
+	if (parameters.hasMultiDimensionalBlock()) {
+		return; // the block is a tile of the algorithm, and the threads stay the same, so there is nothing to change
+	}
+
+	size_t newBlockSize = getOptimalBlockSize(kernel); // get the optimal block size
+	if (newBlockSize == 0) {
+		return; // no block size can be launched (too much shared memory), so there is nothing better to pick
+	}
+
 	size_t totalThreads = parameters.getNumTotalThreads();
 	// make sure we ahve the same amount of threads overall, by decreasing the block size
 	size_t newBlockNum = totalThreads / newBlockSize;
 	if (totalThreads % newBlockSize) {
 		++newBlockNum;
 	}
-	//set the new configuration
-	kernel.get()->setLaunchParams(LaunchParameters(newBlockSize, newBlockNum));
+	//set the new configuration, a two dimensional grid keeps its shape and the dynamic shared memory follows the block size if it depends on it
+	parameters.setThreads(newBlockSize);
+	parameters.setBlocks(newBlockNum);
+	kernel.get()->setLaunchParams(parameters);
 
 }
 
@@ -36,14 +67,17 @@ void KernelScheduler::optimiseQueuesForMaximumConcurency() {
 	// All the details around that are handled within the execution queue itself
 	for (std::vector<KernelExecutionQueue>::iterator it = this->kernelQueues.begin(); it != this->kernelQueues.end(); ++it) {
 
-		(*it).moldQueueForMaximumConcurency();
+		(*it).moldQueueForMaximumConcurency(this->objective);
 	}
 
 }
 
 void KernelScheduler::orderKernelsInQueues_FAIR_() {
+	if (this->objective == MINIMUM_MAKESPAN) {
+		this->orderKernelsInQueues_MINIMUM_MAKESPAN_(true);
+		return;
+	}
 	this->kernelQueues.push_back(KernelExecutionQueue()); // create a new queue
-
 	for (std::vector<boost::shared_ptr<AbstractElasticKernel> >::iterator it = this->kernelsToRun.begin(); it != this->kernelsToRun.end(); ++it) {
 		// iterate through all the kernels
 		//std::cout << "HO HO HO " << std::endl;;
@@ -65,6 +99,10 @@ void KernelScheduler::orderKernelsInQueues_FAIR_() {
  */
 void KernelScheduler::orderKernelsInQueues_MINIMUM_QUEUES_() {
 	this->sortKernelByMemoryConsumption(); // sort kernels in decreasing order
+	if (this->objective == MINIMUM_MAKESPAN) {
+		this->orderKernelsInQueues_MINIMUM_MAKESPAN_(false);
+		return;
+	}
 	this->kernelQueues.push_back(KernelExecutionQueue()); // create a new queue
 	for (std::vector<boost::shared_ptr<AbstractElasticKernel> >::iterator it = this->kernelsToRun.begin(); it != this->kernelsToRun.end(); ++it) {
 		// iterate through all the kernels
@@ -88,9 +126,99 @@ void KernelScheduler::orderKernelsInQueues_MINIMUM_QUEUES_() {
 
 }
 
+double KernelScheduler::planQueues(bool inArrivalOrder, bool forMakespan,
+		std::vector<std::vector<boost::shared_ptr<AbstractElasticKernel> > >& plan) {
+	cudaDeviceProp props = getGPUConfiguration();
+	size_t capacity = KernelExecutionQueue().getMemoryCapacity();
+	std::vector<KernelGroup> queues; // the kernels of every queue and its predicted time
+	std::vector<size_t> memoryUsed;
+	for (std::vector<boost::shared_ptr<AbstractElasticKernel> >::iterator it = this->kernelsToRun.begin(); it != this->kernelsToRun.end(); ++it) {
+		size_t memory = (*it).get()->getMemoryConsumption();
+		KernelDemand demand = getKernelDemand(*it);
+		KernelWork work = getKernelWork(*it);
+		// the queue the kernel adds the least time to, with the rounds the kernels of the queue run in
+		size_t best = queues.size();
+		double bestTime = 0;
+		for (size_t q = (inArrivalOrder && !queues.empty()) ? queues.size() - 1 : 0; q < queues.size(); ++q) {
+			if (memoryUsed[q] + memory >= capacity) {
+				continue; // the queue has to stay below its capacity, as in KernelExecutionQueue::canFitKernel()
+			}
+			double time = predictGroupTimeWithKernel(props, queues[q], demand, work);
+			if (best == queues.size() || time - queues[q].time < bestTime - queues[best].time) {
+				best = q;
+				bestTime = time;
+			}
+			if (!forMakespan) {
+				break; // the first queue it fits in
+			}
+		}
+		// unless it is faster in a queue of its own. A tie, which is what a kernel that runs in a round of
+		// its own gives, is left to the queue.
+		KernelGroup ownQueue = getEmptyKernelGroup();
+		double alone = predictGroupTimeWithKernel(props, ownQueue, demand, work);
+		if (best == queues.size() || (forMakespan && bestTime - queues[best].time > alone * (1 + 1e-9))) {
+			best = queues.size();
+			bestTime = alone;
+			queues.push_back(ownQueue);
+			memoryUsed.push_back(0);
+			plan.push_back(std::vector<boost::shared_ptr<AbstractElasticKernel> >());
+		}
+		addKernelToGroup(queues[best], demand, work, bestTime);
+		memoryUsed[best] += memory;
+		plan[best].push_back(*it);
+	}
+
+	double makespan = 0;
+	for (size_t q = 0; q < queues.size(); ++q) {
+		makespan += queues[q].time; // the queues run one after the other
+	}
+	return makespan;
+}
+
+void KernelScheduler::orderKernelsInQueues_MINIMUM_MAKESPAN_(bool inArrivalOrder) {
+	// a kernel that does not fit even an empty queue can not be placed at all
+	KernelExecutionQueue emptyQueue;
+	for (std::vector<boost::shared_ptr<AbstractElasticKernel> >::iterator it = this->kernelsToRun.begin(); it != this->kernelsToRun.end();) {
+		if (emptyQueue.canFitKernel(*it)) {
+			++it;
+			continue;
+		}
+		fprintf(stderr, "A kernel needs %lu bytes of device memory, a queue holds less than %lu, so it is not scheduled\n",
+				(unsigned long) (*it).get()->getMemoryConsumption(), (unsigned long) emptyQueue.getMemoryCapacity());
+		it = this->kernelsToRun.erase(it);
+	}
+	std::vector<std::vector<boost::shared_ptr<AbstractElasticKernel> > > policyPlan;
+	std::vector<std::vector<boost::shared_ptr<AbstractElasticKernel> > > makespanPlan;
+	double policyMakespan = this->planQueues(inArrivalOrder, false, policyPlan);
+	double makespan = this->planQueues(inArrivalOrder, true, makespanPlan);
+	const std::vector<std::vector<boost::shared_ptr<AbstractElasticKernel> > >& plan = (makespan < policyMakespan) ? makespanPlan : policyPlan;
+
+	for (size_t q = 0; q < plan.size(); ++q) {
+		KernelExecutionQueue queue;
+		for (size_t k = 0; k < plan[q].size(); ++k) {
+			if (!queue.addKernel(plan[q][k])) {
+				fprintf(stderr, "A planned kernel does not fit its queue and is not scheduled\n");
+			}
+		}
+		this->kernelQueues.push_back(queue);
+	}
+
+}
+
 void KernelScheduler::moldKernels_MAXIMUM_OCCUPANCY_() {
 	// iterate through all the kernels and apply launch parameter transformation in order to promote maximum occupancy
 	for (std::vector<boost::shared_ptr<AbstractElasticKernel> >::iterator it = this->kernelsToRun.begin(); it != this->kernelsToRun.end(); ++it) {
+		if (this->objective == MINIMUM_MAKESPAN) {
+			// keep the launch parameters if the molded ones are predicted to be slower
+			LaunchParameters original = (*it).get()->getLaunchParams();
+			double before = predictKernelTime((*it), getGPUConfiguration()).time;
+			moldKernelLaunchConfigForMaximumOccupancy((*it));
+			double after = predictKernelTime((*it), getGPUConfiguration()).time;
+			if (before > 0 && (after <= 0 || after > before)) {
+				(*it).get()->setLaunchParams(original);
+			}
+			continue;
+		}
 		moldKernelLaunchConfigForMaximumOccupancy((*it));
 	}
 
@@ -136,7 +264,17 @@ void KernelScheduler::applyOptimisationPolicy(OptimizationPolicy policy) {
 
 // we do not need anything in the default constructor
 KernelScheduler::KernelScheduler() {
+	this->gridSizing = KEEP_TOTAL_THREADS;
+	this->objective = POLICY_DEFAULT;
+
+}
+
+void KernelScheduler::setGridSizingPolicy(GridSizingPolicy policy) {
+	this->gridSizing = policy;
+}
 
+void KernelScheduler::setSchedulingObjective(SchedulingObjective objective) {
+	this->objective = objective;
 }
 
 void KernelScheduler::addKernel(boost::shared_ptr<AbstractElasticKernel> kernel) {
@@ -193,11 +331,14 @@ GPUUtilization KernelScheduler::getGPUOccupancyForPolicy(OptimizationPolicy poli
 	GPUUtilization result;
 	result.averageComputeOccupancy = 0;
 	result.averageStorageOccupancy = 0;
+	result.predictedMakespan = 0;
 	if (policy == 0) {
 		//if native policy
 		for (std::vector<boost::shared_ptr<AbstractElasticKernel> >::iterator it = this->kernelsToRun.begin(); it != this->kernelsToRun.end(); ++it) {
 			result.averageStorageOccupancy += getMemoryOccupancyForKernel((*it));
-			result.averageComputeOccupancy += getOccupancyForKernel((*it));
+			// the kernels run one after the other, so every kernel has the device to itself
+			result.averageComputeOccupancy += getResidentOccupancyForKernel((*it), getGPUConfiguration());
+			result.predictedMakespan += predictKernelTime((*it), getGPUConfiguration()).time;
 		}
 		//compute statistics for every kernel
 		result.averageComputeOccupancy = result.averageComputeOccupancy / (double) this->kernelsToRun.size();
@@ -211,6 +352,7 @@ GPUUtilization KernelScheduler::getGPUOccupancyForPolicy(OptimizationPolicy poli
 		for (std::vector<KernelExecutionQueue>::iterator it = this->kernelQueues.begin(); it != this->kernelQueues.end(); ++it) {
 			result.averageStorageOccupancy += (*it).getStorageOccupancyForQueue();
 			result.averageComputeOccupancy += (*it).getComputeOccupancyForQueue();
+			result.predictedMakespan += (*it).getPredictedTimeForQueue(); // the queues run one after the other
 		}
 
 		result.averageComputeOccupancy = result.averageComputeOccupancy / (double) this->kernelQueues.size();
@@ -222,6 +364,15 @@ GPUUtilization KernelScheduler::getGPUOccupancyForPolicy(OptimizationPolicy poli
 
 }
 
+void KernelScheduler::printPredictedTimes() {
+	printRooflinePredictions(this->kernelsToRun, getGPUConfiguration());
+	int queueNum = 1;
+	for (std::vector<KernelExecutionQueue>::iterator it = this->kernelQueues.begin(); it != this->kernelQueues.end(); ++it) {
+		printf("Queue %d: %.1f us\n", queueNum, (*it).getPredictedTimeForQueue() * 1e6);
+		++queueNum;
+	}
+}
+
 std::ostream& operator <<(std::ostream& output, const KernelScheduler& sch) {
 	int qNum = 1;
 	// when given to the oastream, this object shoud print all the queues and their content
@@ -21,6 +21,9 @@
 #include "../abstract_elastic_kernel/AbstractElasticKernel.hpp"
 #include "KernelExecutionQueue.h"
 #include "../occupancy_tools/OccupancyCalculator.h"
+#include "../occupancy_tools/WaveQuantization.h"
+#include "../occupancy_tools/CoResidency.h"
+#include "../occupancy_tools/RooflinePredictor.h"
 #include "cuda_runtime.h"
 #include "../misc/SimpleTimer.h"
 
@@ -77,6 +80,22 @@ enum OptimizationPolicy {
 
 };
 
+/**
+ * How the policies that mold kernels for maximum occupancy size the grid
+ */
+enum GridSizingPolicy {
+	/**
+	 * The block size with the highest occupancy, and as many blocks as keep the total number of
+	 * threads of the kernel
+	 */
+	KEEP_TOTAL_THREADS,
+	/**
+	 * The block and grid size with the lowest time the wave model predicts for the problem size of
+	 * the kernel (see WaveQuantization.h), which sizes grids to whole waves
+	 */
+	WAVE_QUANTIZED
+};
+
 /**
  * This data structure is used for containing the measures of compute and storage
  * utilization of the whole kernel scheduling configuration for a particular policy
@@ -84,6 +103,7 @@ enum OptimizationPolicy {
 struct GPUUtilization {
 	double averageComputeOccupancy;
 	double averageStorageOccupancy;
+	double predictedMakespan; // the time the roofline model predicts for all the queues, in seconds
 };
 
 /**
@@ -102,6 +122,8 @@ class KernelScheduler {
 private:
 	std::vector<boost::shared_ptr<AbstractElasticKernel> > kernelsToRun; // kernels that are enqueues go here...
 	std::vector<KernelExecutionQueue> kernelQueues; // kernel queues go here
+	GridSizingPolicy gridSizing; // how molding for maximum occupancy sizes the grid
+	SchedulingObjective objective; // what the policies optimise
 
 	/**
 	 * Method is used to sort the added to the scheduler kernels in decreasing order
@@ -135,6 +157,29 @@ private:
 	 */
 	void orderKernelsInQueues_MINIMUM_QUEUES_();
 
+	/**
+	 * Works out which queue every kernel goes to, without creating the queues. The kernels are placed in
+	 * the order they are in, either the way the policies place them (in the first queue they fit in) or for
+	 * the makespan: in the queue whose predicted time (see predictGroupTime()) they add the least to, or in
+	 * a queue of their own if they add more than that takes.
+	 *
+	 * @param inArrivalOrder whether only the last queue can take a kernel, as in the fair policies
+	 * @param forMakespan whether the kernels are placed for the makespan
+	 * @param plan receives the kernels of every queue, in launch order
+	 * @return the predicted makespan of the queues
+	 */
+	double planQueues(bool inArrivalOrder, bool forMakespan, std::vector<std::vector<boost::shared_ptr<AbstractElasticKernel> > >& plan);
+
+	/**
+	 * This method orders kernels in execution queues for the lowest predicted makespan. The placement
+	 * for the makespan is greedy, so the kernels are placed the way the policy places them when that is
+	 * predicted to be faster. A kernel that needs more memory than a queue holds is reported and removed
+	 * from the kernels to run.
+	 *
+	 * @param inArrivalOrder whether only the last queue can take a kernel, as in the fair policies
+	 */
+	void orderKernelsInQueues_MINIMUM_MAKESPAN_(bool inArrivalOrder);
+
 	/**
 	 * The method simply iterates through all the enqueued kernels and endures each launch
 	 * configuration is optimized for the particular GPU that is being used in the system
@@ -155,6 +200,25 @@ public:
 	 */
 	KernelScheduler();
 
+	/**
+	 * Sets how the policies that mold kernels for maximum occupancy size the grid. The default
+	 * is KEEP_TOTAL_THREADS.
+	 *
+	 * @param policy the grid sizing policy
+	 */
+	void setGridSizingPolicy(GridSizingPolicy policy);
+
+	/**
+	 * Sets what the policies optimise. With MINIMUM_MAKESPAN, a kernel keeps its launch parameters if
+	 * molding it for maximum occupancy would make it slower in the roofline model, the fair and minimum queues
+	 * policies place the kernels for the lowest predicted makespan (the fair ones keeping them in order, see
+	 * orderKernelsInQueues_MINIMUM_MAKESPAN_()), and the maximum concurrency policy pairs the kernels that gain
+	 * the most from running together. The default is POLICY_DEFAULT.
+	 *
+	 * @param objective the scheduling objective
+	 */
+	void setSchedulingObjective(SchedulingObjective objective);
+
 	/**
 	 * Enqueues kernel into the scheduler (optimization is not applied at this point)
 	 *
@@ -179,13 +243,21 @@ public:
 	/**
 	 * This method is sort of a dry run of the policy and is used in performance testing.
 	 * Its purpose is to deliver data regarding the storage and theoretical compute occupancy of
-	 * the kernels for a particular policy
+	 * the kernels for a particular policy. The compute occupancy of a queue is the one its kernels give
+	 * together, as they share the SMs (see CoResidency.h). The predicted makespan is the time the roofline
+	 * model predicts for the queues, one after the other (see RooflinePredictor.h).
 	 *
 	 * @param policy the policy being applied
-	 * @return a structure containing the average storage and compute utilization of each queue
+	 * @return a structure containing the average storage and compute utilization of each queue and the predicted makespan
 	 */
 	GPUUtilization getGPUOccupancyForPolicy(OptimizationPolicy policy);
 
+	/**
+	 * Prints the time the roofline model predicts for every kernel on its own, and for every queue the
+	 * last policy that was applied put together (see RooflinePredictor.h)
+	 */
+	void printPredictedTimes();
+
 	//Default destructor
 	virtual ~KernelScheduler();
 	friend std::ostream &operator<<(std::ostream &output, const KernelScheduler &sch);
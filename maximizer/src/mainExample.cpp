@@ -16,7 +16,17 @@
 #include "misc/Macros.h"
 #include "misc/SimpleTimer.h"
 #include "occupancy_tools/OccupancyCalculator.h"
+#include "occupancy_tools/OccupancyReference.h"
 #include "misc/workloadGeneration.h"
+#include "benchmarks/ChunkingBenchmark.h"
+#include "benchmarks/LargeOffsetCheck.h"
+#include "benchmarks/ChunkingTuner.h"
+#include "benchmarks/SchedulingBenchmark.h"
+#include "dedup_tools/DedupPipeline.h"
+#include "dedup_tools/ChunkDiff.h"
+#include "dedup_tools/DedupScanner.h"
+#include "concrete_elastic_kernels/Chunking_elastic/CPU_code/DistributedChunker.h"
+#include <string.h>
 
 /**
  * Runs an experiment with the supplied set of kernels and the specified optimization policy.
@@ -44,10 +54,15 @@ double RunExperimentWithPolicy(OptimizationPolicy policy, int samples) {
  * kernels
  *
  * @param policy the policy
+ * @param gridSizing how the policies that mold for maximum occupancy size the grid
+ * @param objective what the policies optimise
  */
-void printGPUUtilisationForPolicy(OptimizationPolicy policy) {
+void printGPUUtilisationForPolicy(OptimizationPolicy policy, GridSizingPolicy gridSizing = KEEP_TOTAL_THREADS,
+		SchedulingObjective objective = POLICY_DEFAULT) {
 
 	KernelScheduler schl = KernelScheduler();
+	schl.setGridSizingPolicy(gridSizing);
+	schl.setSchedulingObjective(objective);
 
 	addChunkingKernelsToScheduler(schl);
 
@@ -55,35 +70,39 @@ void printGPUUtilisationForPolicy(OptimizationPolicy policy) {
 
 	printf("Compute Occupancy: %.6f              |\n", ut1.averageComputeOccupancy);
 	printf("Storage Occupancy: %.6f              |\n", ut1.averageStorageOccupancy);
+	printf("Predicted Makespan: %.3f ms          |\n", ut1.predictedMakespan * 1e3);
 
 }
 
 /**
  * Prints GPU occupancy details for all the policies
+ *
+ * @param gridSizing how the policies that mold for maximum occupancy size the grid
+ * @param objective what the policies optimise
  */
-void printOptimisationPolicyDetails() {
+void printOptimisationPolicyDetails(GridSizingPolicy gridSizing = KEEP_TOTAL_THREADS, SchedulingObjective objective = POLICY_DEFAULT) {
 	std::cout << "------------------NATIVE------------------" << std::endl;
-	printGPUUtilisationForPolicy(NATIVE);
+	printGPUUtilisationForPolicy(NATIVE, gridSizing, objective);
 	std::cout << "------------------------------------------" << std::endl << std::endl;
 
 	std::cout << "--------------------FAIR------------------" << std::endl;
-	printGPUUtilisationForPolicy(FAIR);
+	printGPUUtilisationForPolicy(FAIR, gridSizing, objective);
 	std::cout << "------------------------------------------" << std::endl << std::endl;
 
 	std::cout << "---------FAIR_MAXIMUM_OCCUPANCY-----------" << std::endl;
-	printGPUUtilisationForPolicy(FAIR_MAXIMUM_OCCUPANCY);
+	printGPUUtilisationForPolicy(FAIR_MAXIMUM_OCCUPANCY, gridSizing, objective);
 	std::cout << "------------------------------------------" << std::endl << std::endl;
 
 	std::cout << "--------------MINIMUM_QUEUES--------------" << std::endl;
-	printGPUUtilisationForPolicy(MINIMUM_QUEUES);
+	printGPUUtilisationForPolicy(MINIMUM_QUEUES, gridSizing, objective);
 	std::cout << "------------------------------------------" << std::endl << std::endl;
 
 	std::cout << "-----MINIMUM_QUEUES_MAXIMUM_OCCUPANCY-----" << std::endl;
-	printGPUUtilisationForPolicy(MINIMUM_QUEUES_MAXIMUM_OCCUPANCY);
+	printGPUUtilisationForPolicy(MINIMUM_QUEUES_MAXIMUM_OCCUPANCY, gridSizing, objective);
 	std::cout << "------------------------------------------" << std::endl << std::endl;
 
 	std::cout << "-------------MAXIMUM_CONCURENCY-----------" << std::endl;
-	printGPUUtilisationForPolicy(MAXIMUM_CONCURENCY);
+	printGPUUtilisationForPolicy(MAXIMUM_CONCURENCY, gridSizing, objective);
 	std::cout << "------------------------------------------" << std::endl << std::endl;
 }
 
@@ -116,7 +135,127 @@ void printQueueConfigurationForPolicy(OptimizationPolicy policy) {
 	std::cout << schl << std::endl;
 }
 
-int main() {
+/**
+ * Prints the occupancy details of all the policies against a device profile, so the scheduling
+ * can be planned on a machine without a GPU
+ *
+ * With --waves the policies that mold for maximum occupancy size grids to whole waves (see
+ * WaveQuantization.h), and the grid sizes the wave model chooses for a range of problem sizes are
+ * printed first.
+ *
+ * With --makespan the policies optimise the makespan the roofline model predicts instead (see
+ * RooflinePredictor.h), and the predicted time of every kernel of the workload is printed first.
+ *
+ * Usage: --plan [--device=NAME|PATH] [--save-device=PATH] [--list-devices] [--validate] [--waves] [--makespan]
+ *
+ * @param argc the number of arguments
+ * @param argv the arguments
+ * @return 0 on success
+ */
+int runOfflinePlan(int argc, char** argv) {
+	std::string device;
+	std::string savePath;
+	GridSizingPolicy gridSizing = KEEP_TOTAL_THREADS;
+	SchedulingObjective objective = POLICY_DEFAULT;
+	for (int i = 0; i < argc; ++i) {
+		std::string arg(argv[i]);
+		if (arg.compare(0, 9, "--device=") == 0) {
+			device = arg.substr(9);
+		} else if (arg.compare(0, 14, "--save-device=") == 0) {
+			savePath = arg.substr(14);
+		} else if (arg == "--list-devices") {
+			printDeviceProfiles();
+			return 0;
+		} else if (arg == "--validate") {
+			// the resource model against the occupancy calculator
+			int mismatches = validateOccupancyModel(true);
+			printf("%d of %lu reference cases differ\n", mismatches, (unsigned long) NUM_OCCUPANCY_REFERENCE_CASES);
+			return (mismatches == 0) ? 0 : 1;
+		} else if (arg == "--waves") {
+			gridSizing = WAVE_QUANTIZED;
+		} else if (arg == "--makespan") {
+			objective = MINIMUM_MAKESPAN;
+		} else {
+			fprintf(stderr, "Usage: --plan [--device=NAME|PATH] [--save-device=PATH] [--list-devices] [--validate] [--waves] [--makespan]\n");
+			return 1;
+		}
+	}
+	if (!device.empty() && !setActiveDeviceProfile(device)) {
+		fprintf(stderr, "No device profile or valid profile file %s (--list-devices shows the profiles)\n", device.c_str());
+		return 1;
+	}
+	cudaDeviceProp props = getGPUConfiguration();
+	if (!savePath.empty()) {
+		// also the way to take the profile of a real device to a machine without one
+		if (!saveDeviceProfile(savePath, props)) {
+			fprintf(stderr, "Cannot write %s\n", savePath.c_str());
+			return 1;
+		}
+		return 0;
+	}
+	printf("Device: %s (compute capability %d.%d, %d SMs)%s\n", props.name, props.major, props.minor, props.multiProcessorCount,
+			isOfflineDeviceProfile() ? " [profile]" : "");
+	if (gridSizing == WAVE_QUANTIZED) {
+		printGridSizingTable(props, getDefaultKernelAttributes());
+	}
+	if (objective == MINIMUM_MAKESPAN) {
+		KernelScheduler schl = KernelScheduler();
+		addChunkingKernelsToScheduler(schl);
+		schl.printPredictedTimes();
+	}
+	printOptimisationPolicyDetails(gridSizing, objective);
+	return 0;
+}
+
+int main(int argc, char** argv) {
+	if (argc > 1 && strcmp(argv[1], "--chunking-benchmark") == 0) {
+		// benchmark of the chunking path on the host (does not need a GPU)
+		return runChunkingBenchmark(argc - 2, argv + 2);
+	}
+	if (argc > 1 && strcmp(argv[1], "--check-large-offsets") == 0) {
+		// the breakpoints past 4 GiB and 8 GiB against a serial run (does not need a GPU)
+		return runLargeOffsetCheck(argc - 2, argv + 2);
+	}
+	if (argc > 1 && strcmp(argv[1], "--scheduling-benchmark") == 0) {
+		// how long the policies take to schedule large workloads, with and without the query cache
+		return runSchedulingBenchmark(argc - 2, argv + 2);
+	}
+	if (argc > 1 && strcmp(argv[1], "--tune-chunking") == 0) {
+		// measures how chunking should be split between threads and saves the profile
+		return runChunkingTuner(argc - 2, argv + 2);
+	}
+	if (argc > 1 && strcmp(argv[1], "--generate-corpus") == 0) {
+		// writes a base image and its generations into a directory
+		return runCorpusGenerator(argc - 2, argv + 2);
+	}
+	if (argc > 1 && strcmp(argv[1], "--dedup") == 0) {
+		// deduplicates a list of files and reports the index behaviour
+		return runDedupReport(argc - 2, argv + 2);
+	}
+	if (argc > 1 && strcmp(argv[1], "--restore") == 0) {
+		// restores a file from the containers written by --dedup --store=DIR
+		return runRestore(argc - 2, argv + 2);
+	}
+	if (argc > 1 && strcmp(argv[1], "--distributed-chunking") == 0) {
+		// chunks a file with a number of worker processes
+		return runDistributedChunking(argc - 2, argv + 2);
+	}
+	if (argc > 1 && strcmp(argv[1], "--chunking-worker") == 0) {
+		// a worker for a coordinator that was started separately
+		return runChunkingWorkerMode(argc - 2, argv + 2);
+	}
+	if (argc > 1 && strcmp(argv[1], "--chunk-diff") == 0) {
+		// manifests, patches and patch application for synchronising files
+		return runChunkDiff(argc - 2, argv + 2);
+	}
+	if (argc > 1 && strcmp(argv[1], "--scan") == 0) {
+		// estimate how well a directory tree deduplicates
+		return runDedupScan(argc - 2, argv + 2);
+	}
+	if (argc > 1 && strcmp(argv[1], "--plan") == 0) {
+		// occupancy of the policies against a device profile (does not need a GPU)
+		return runOfflinePlan(argc - 2, argv + 2);
+	}
 	////printQueueConfigurationForPolicy(FAIR);
 	printOptimisationPolicyDetails();
 	//runAllPolicies(1);
@@ -0,0 +1,493 @@
+/**
+ * CorpusGenerator.h
+ *
+ * A generator of synthetic data sets for deduplication experiments. The generator produces a
+ * base image, made out of blocks of which a configurable fraction are exact copies of earlier
+ * blocks, and any number of generations that are derived from the previous one by inserting,
+ * deleting and modifying data at configurable rates. The compressibility of the content can
+ * be controlled as well.
+ *
+ * All the randomness comes from a counter based generator, meaning that every random number
+ * is a hash of the seed, a stream identifier and a counter. Because of that any byte of the
+ * corpus can be computed independently of all others, the generation is split between as many
+ * threads as there are cores and the result is exactly the same no matter how many are used.
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Zahari Dichev <zaharidichev@gmail.com>
+ */
+
+#ifndef CORPUSGENERATOR_H_
+#define CORPUSGENERATOR_H_
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <boost/thread.hpp>
+#include <boost/bind.hpp>
+
+#define CORPUS_RUN_SIZE 32 // the granularity at which compressibility is decided
+#define CORPUS_NUM_PHRASES 16 // the number of distinct runs that redundant content is made of
+
+/*
+ * Identifiers of the different random streams, so that the decisions made for different
+ * purposes are independent of each other
+ */
+#define CORPUS_STREAM_DUPLICATES 0x1ULL
+#define CORPUS_STREAM_CONTENT 0x2ULL
+#define CORPUS_STREAM_RUN_BYTES 0x3ULL
+#define CORPUS_STREAM_EDITS 0x4ULL
+#define CORPUS_STREAM_PHRASES 0x5ULL
+
+/**
+ * All the parameters of a corpus
+ */
+struct CorpusConfig {
+	uint64_t seed; // the whole corpus is a function of this value
+	size_t baseSize; // the size of the base image in bytes
+	size_t blockSize; // the granularity of duplicate content in the base image
+	double duplicateRatio; // the fraction of blocks that are copies of earlier blocks
+	double compressibility; // the fraction of the content that is redundant
+	int generations; // the number of generations derived from the base image
+	size_t editRegionSize; // one edit decision is made for every region of this size
+	double insertRate; // the probability that new data is inserted in a region
+	double deleteRate; // the probability that data is deleted from a region
+	double modifyRate; // the probability that data is overwritten in a region
+	size_t maxEditLength; // the maximum length of a single edit
+	int threads; // the number of threads used for the generation (0 means all the cores)
+};
+
+/**
+ * Returns a configuration with sensible defaults
+ *
+ * @param seed the seed of the corpus
+ * @param baseSize the size of the base image
+ * @return the configuration
+ */
+inline CorpusConfig getDefaultCorpusConfig(uint64_t seed, size_t baseSize) {
+	CorpusConfig config;
+	config.seed = seed;
+	config.baseSize = baseSize;
+	config.blockSize = 4096;
+	config.duplicateRatio = 0.3;
+	config.compressibility = 0.3;
+	config.generations = 0;
+	config.editRegionSize = 65536;
+	config.insertRate = 0.02;
+	config.deleteRate = 0.02;
+	config.modifyRate = 0.05;
+	config.maxEditLength = 8192;
+	config.threads = 0;
+	return config;
+}
+
+/**
+ * This is the finalizer of SplitMix64, which is a good enough hash to turn consecutive counters
+ * into independent random numbers.
+ *
+ * @param x the value to be mixed
+ * @return the mixed value
+ */
+inline uint64_t mix64(uint64_t x) {
+	x += 0x9E3779B97F4A7C15ULL;
+	x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+	x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+	return x ^ (x >> 31);
+}
+
+/**
+ * The counter based random number generator. The result only depends on the arguments.
+ *
+ * @param seed the seed of the corpus
+ * @param stream the purpose of the number
+ * @param id the entity the number is generated for
+ * @param counter the index of the number for that entity
+ * @return a random 64 bit number
+ */
+inline uint64_t corpusRandom(uint64_t seed, uint64_t stream, uint64_t id, uint64_t counter) {
+	return mix64(mix64(mix64(seed ^ (stream << 56)) ^ id) ^ counter);
+}
+
+/**
+ * Turns a random number into a double in [0, 1)
+ *
+ * @param r the random number
+ * @return the fraction
+ */
+inline double corpusFraction(uint64_t r) {
+	return (double) (r >> 11) / 9007199254740992.0;
+}
+
+/**
+ * Hashes a string (FNV-1a). Useful to derive different seeds for differently named entities.
+ *
+ * @param str the string
+ * @return the hash
+ */
+inline uint64_t hashCorpusName(const std::string& str) {
+	uint64_t hash = 0xCBF29CE484222325ULL;
+	for (size_t i = 0; i < str.size(); ++i) {
+		hash ^= (unsigned char) str[i];
+		hash *= 0x100000001B3ULL;
+	}
+	return hash;
+}
+
+/**
+ * A piece of a generation. It is either copied from the previous generation or it is new content.
+ */
+struct CorpusSegment {
+	bool fresh; // whether this is new content
+	uint64_t source; // offset in the previous generation, or the id of the new content
+	size_t length;
+	size_t outputOffset; // where the segment starts in the generation
+};
+
+class CorpusGenerator {
+private:
+	CorpusConfig config;
+	unsigned char phrases[CORPUS_NUM_PHRASES][CORPUS_RUN_SIZE]; // the building blocks of redundant content
+
+	int getNumThreads() {
+		if (this->config.threads > 0) {
+			return this->config.threads;
+		}
+		int cores = (int) boost::thread::hardware_concurrency();
+		return (cores > 0) ? cores : 1;
+	}
+
+	/**
+	 * Resolves which block of the base image is the original of a particular block. A block
+	 * that is a duplicate copies a random earlier one, which might be a duplicate as well.
+	 */
+	uint64_t resolveOriginalBlock(uint64_t block) {
+		while (block > 0) {
+			uint64_t r = corpusRandom(this->config.seed, CORPUS_STREAM_DUPLICATES, block, 0);
+			if (corpusFraction(r) >= this->config.duplicateRatio) {
+				break;
+			}
+			block = corpusRandom(this->config.seed, CORPUS_STREAM_DUPLICATES, block, 1) % block;
+		}
+		return block;
+	}
+
+	/**
+	 * Fills a range of the base image. This is run by every one of the threads.
+	 */
+	void fillBaseImageRange(unsigned char* image, size_t from, size_t to) {
+		size_t pos = from;
+		while (pos < to) {
+			uint64_t block = pos / this->config.blockSize;
+			size_t inBlock = pos % this->config.blockSize;
+			size_t len = std::min(to - pos, this->config.blockSize - inBlock);
+			fillContent(resolveOriginalBlock(block), inBlock, image + pos, len);
+			pos += len;
+		}
+	}
+
+	/**
+	 * Fills a range of a generation, given the segments it is made of
+	 */
+	void fillGenerationRange(const std::vector<CorpusSegment>* segments, const unsigned char* previous, unsigned char* output, size_t from,
+			size_t to) {
+		// find the first segment that overlaps the range
+		size_t lo = 0, hi = segments->size();
+		while (hi - lo > 1) {
+			size_t mid = (lo + hi) / 2;
+			if ((*segments)[mid].outputOffset <= from) {
+				lo = mid;
+			} else {
+				hi = mid;
+			}
+		}
+		for (size_t s = lo; s < segments->size() && (*segments)[s].outputOffset < to; ++s) {
+			const CorpusSegment& seg = (*segments)[s];
+			size_t start = std::max(seg.outputOffset, from);
+			size_t end = std::min(seg.outputOffset + seg.length, to);
+			if (start >= end) {
+				continue;
+			}
+			if (seg.fresh) {
+				fillContent(seg.source, start - seg.outputOffset, output + start, end - start);
+			} else {
+				memcpy(output + start, previous + seg.source + (start - seg.outputOffset), end - start);
+			}
+		}
+	}
+
+public:
+	CorpusGenerator(const CorpusConfig& config) {
+		this->config = config;
+		if (this->config.blockSize == 0) {
+			this->config.blockSize = 4096;
+		}
+		if (this->config.editRegionSize == 0) {
+			this->config.editRegionSize = 65536;
+		}
+		if (this->config.maxEditLength == 0) {
+			this->config.maxEditLength = 1;
+		}
+		for (int p = 0; p < CORPUS_NUM_PHRASES; ++p) {
+			for (int i = 0; i < CORPUS_RUN_SIZE; i += 8) {
+				uint64_t r = corpusRandom(config.seed, CORPUS_STREAM_PHRASES, p, i);
+				memcpy(&this->phrases[p][i], &r, 8);
+			}
+		}
+	}
+
+	virtual ~CorpusGenerator() {
+	}
+
+	/**
+	 * Fills a range of the content with a particular id. Content is an endless stream of runs
+	 * which are either random or one of the phrases, depending on the compressibility. Any range
+	 * of it can be produced without producing what precedes it.
+	 *
+	 * @param contentId the id of the content
+	 * @param from the offset in the content
+	 * @param out where to put the bytes
+	 * @param len how many bytes are needed
+	 */
+	void fillContent(uint64_t contentId, size_t from, unsigned char* out, size_t len) {
+		size_t pos = from;
+		size_t end = from + len;
+		unsigned char run[CORPUS_RUN_SIZE];
+		while (pos < end) {
+			uint64_t runIndex = pos / CORPUS_RUN_SIZE;
+			size_t inRun = pos % CORPUS_RUN_SIZE;
+			size_t n = std::min(end - pos, (size_t) CORPUS_RUN_SIZE - inRun);
+
+			uint64_t r = corpusRandom(this->config.seed, CORPUS_STREAM_CONTENT, contentId, runIndex);
+			if (corpusFraction(r) < this->config.compressibility) {
+				memcpy(out, &this->phrases[r % CORPUS_NUM_PHRASES][inRun], n);
+			} else {
+				for (int i = 0; i < CORPUS_RUN_SIZE; i += 8) {
+					uint64_t bytes = corpusRandom(this->config.seed, CORPUS_STREAM_RUN_BYTES, contentId, runIndex * CORPUS_RUN_SIZE + i);
+					memcpy(&run[i], &bytes, 8);
+				}
+				memcpy(out, &run[inRun], n);
+			}
+			out += n;
+			pos += n;
+		}
+	}
+
+	/**
+	 * Generates the base image in parallel
+	 *
+	 * @param image the buffer to be filled (at least baseSize bytes)
+	 */
+	void generateBaseImage(unsigned char* image) {
+		generateBaseImage(image, 0, this->config.baseSize);
+	}
+
+	/**
+	 * Generates a range of the base image in parallel. Since any byte of the image can be
+	 * computed on its own, this can be used for producing an image piece by piece.
+	 *
+	 * @param image the buffer where the range is put
+	 * @param from the offset of the range in the image
+	 * @param len the length of the range
+	 */
+	void generateBaseImage(unsigned char* image, size_t from, size_t len) {
+		int threads = getNumThreads();
+		size_t perThread = ((len / threads) / this->config.blockSize + 1) * this->config.blockSize;
+		boost::thread_group workers;
+		for (size_t start = 0; start < len; start += perThread) {
+			size_t end = std::min(start + perThread, len);
+			workers.create_thread(boost::bind(&CorpusGenerator::fillBaseImageRange, this, image - from, from + start, from + end));
+		}
+		workers.join_all();
+	}
+
+	/**
+	 * Creates the edit script that turns one generation into the next one. The script is a list
+	 * of segments that are either copied from the previous generation or are new content.
+	 *
+	 * @param generation the number of the generation being created (1 for the first one after the base)
+	 * @param previousLength the length of the previous generation
+	 * @param segments the vector where the segments are put
+	 * @return the length of the new generation
+	 */
+	size_t createEditScript(int generation, size_t previousLength, std::vector<CorpusSegment>& segments) {
+		size_t outputLength = 0;
+		uint64_t editId = 0;
+		size_t copyFrom = 0; // the offset in the previous generation up to which everything is handled
+		size_t regionSize = this->config.editRegionSize;
+
+		for (size_t regionStart = 0; regionStart < previousLength; regionStart += regionSize) {
+			size_t regionEnd = std::min(regionStart + regionSize, previousLength);
+			uint64_t id = ((uint64_t) generation << 40) | (regionStart / regionSize);
+			double op = corpusFraction(corpusRandom(this->config.seed, CORPUS_STREAM_EDITS, id, 0));
+			size_t offset = regionStart + corpusRandom(this->config.seed, CORPUS_STREAM_EDITS, id, 1) % (regionEnd - regionStart);
+			size_t length = 1 + corpusRandom(this->config.seed, CORPUS_STREAM_EDITS, id, 2) % this->config.maxEditLength;
+
+			bool insert = op < this->config.insertRate;
+			bool remove = !insert && op < this->config.insertRate + this->config.deleteRate;
+			bool modify = !insert && !remove && op < this->config.insertRate + this->config.deleteRate + this->config.modifyRate;
+			if (!(insert || remove || modify) || offset < copyFrom) {
+				continue; // the region stays as it is
+			}
+
+			// copy everything up to the edit
+			if (offset > copyFrom) {
+				CorpusSegment copy = { false, copyFrom, offset - copyFrom, outputLength };
+				segments.push_back(copy);
+				outputLength += copy.length;
+			}
+			copyFrom = offset;
+
+			if (remove || modify) {
+				length = std::min(length, regionEnd - offset);
+				copyFrom = offset + length;
+			}
+			if (insert || modify) {
+				uint64_t contentId = ((uint64_t) 1 << 63) | ((uint64_t) generation << 40) | editId++;
+				CorpusSegment fresh = { true, contentId, length, outputLength };
+				segments.push_back(fresh);
+				outputLength += length;
+			}
+		}
+		if (copyFrom < previousLength) {
+			CorpusSegment copy = { false, copyFrom, previousLength - copyFrom, outputLength };
+			segments.push_back(copy);
+			outputLength += copy.length;
+		}
+		return outputLength;
+	}
+
+	/**
+	 * Creates a generation out of the previous one. The edit script is created sequentially (it is
+	 * small) and the data is then filled in parallel.
+	 *
+	 * @param generation the number of the generation (starting from 1)
+	 * @param previous the previous generation
+	 * @param previousLength the length of the previous generation
+	 * @param output the vector that receives the new generation
+	 */
+	void generateGeneration(int generation, const unsigned char* previous, size_t previousLength, std::vector<unsigned char>& output) {
+		std::vector<CorpusSegment> segments;
+		size_t length = createEditScript(generation, previousLength, segments);
+		output.resize(length);
+		if (length == 0) {
+			return;
+		}
+
+		int threads = getNumThreads();
+		size_t perThread = length / threads + 1;
+		boost::thread_group workers;
+		for (size_t start = 0; start < length; start += perThread) {
+			size_t end = std::min(start + perThread, length);
+			workers.create_thread(boost::bind(&CorpusGenerator::fillGenerationRange, this, &segments, previous, &output[0], start, end));
+		}
+		workers.join_all();
+	}
+
+	/**
+	 * Generates the base image and all the generations and writes them as files into a directory.
+	 * The files are called base.img, gen_1.img, gen_2.img and so on.
+	 *
+	 * @param directory the directory (it has to exist)
+	 * @return false if a file could not be written
+	 */
+	bool writeCorpus(const std::string& directory) {
+		std::vector<unsigned char> previous(this->config.baseSize);
+		std::vector<unsigned char> current;
+		if (!previous.empty()) {
+			generateBaseImage(&previous[0]);
+		}
+		if (!writeCorpusFile(directory + "/base.img", previous)) {
+			return false;
+		}
+		for (int gen = 1; gen <= this->config.generations; ++gen) {
+			generateGeneration(gen, previous.empty() ? NULL : &previous[0], previous.size(), current);
+			char name[64];
+			snprintf(name, sizeof(name), "/gen_%d.img", gen);
+			if (!writeCorpusFile(directory + name, current)) {
+				return false;
+			}
+			previous.swap(current);
+		}
+		return true;
+	}
+
+	/**
+	 * Writes a buffer into a file
+	 *
+	 * @param path the path of the file
+	 * @param data the data
+	 * @return false on failure
+	 */
+	static bool writeCorpusFile(const std::string& path, const std::vector<unsigned char>& data) {
+		FILE* file = fopen(path.c_str(), "wb");
+		if (file == NULL) {
+			fprintf(stderr, "Cannot write %s\n", path.c_str());
+			return false;
+		}
+		size_t written = data.empty() ? 0 : fwrite(&data[0], 1, data.size(), file);
+		fclose(file);
+		return written == data.size();
+	}
+};
+
+/**
+ * Command line front end for the generator.
+ *
+ * Usage: --generate-corpus --output=DIR [--size-mb=1024] [--generations=4] [--seed=1]
+ *                          [--dup=0.3] [--compress=0.3] [--insert=0.02] [--delete=0.02]
+ *                          [--modify=0.05] [--block=4096] [--threads=0]
+ *
+ * @param argc the number of arguments
+ * @param argv the arguments
+ * @return 0 on success
+ */
+inline int runCorpusGenerator(int argc, char** argv) {
+	CorpusConfig config = getDefaultCorpusConfig(1, (size_t) 1024 * (1 << 20));
+	config.generations = 4;
+	std::string output;
+
+	for (int i = 0; i < argc; ++i) {
+		std::string arg(argv[i]);
+		size_t eq = arg.find('=');
+		std::string key = arg.substr(0, eq);
+		const char* value = (eq == std::string::npos) ? "" : argv[i] + eq + 1;
+
+		if (key == "--output") {
+			output = value;
+		} else if (key == "--size-mb") {
+			config.baseSize = (size_t) atol(value) * (1 << 20);
+		} else if (key == "--generations") {
+			config.generations = atoi(value);
+		} else if (key == "--seed") {
+			config.seed = strtoull(value, NULL, 0);
+		} else if (key == "--dup") {
+			config.duplicateRatio = atof(value);
+		} else if (key == "--compress") {
+			config.compressibility = atof(value);
+		} else if (key == "--insert") {
+			config.insertRate = atof(value);
+		} else if (key == "--delete") {
+			config.deleteRate = atof(value);
+		} else if (key == "--modify") {
+			config.modifyRate = atof(value);
+		} else if (key == "--block") {
+			config.blockSize = (size_t) atol(value);
+		} else if (key == "--threads") {
+			config.threads = atoi(value);
+		} else {
+			fprintf(stderr, "Unknown argument %s\n", arg.c_str());
+			return 1;
+		}
+	}
+	if (output.empty()) {
+		fprintf(stderr, "The output directory needs to be specified with --output=DIR\n");
+		return 1;
+	}
+
+	CorpusGenerator generator(config);
+	return generator.writeCorpus(output) ? 0 : 1;
+}
+
+#endif /* CORPUSGENERATOR_H_ */
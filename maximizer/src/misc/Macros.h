@@ -11,6 +11,7 @@
 #ifndef MACROS_H_
 #define MACROS_H_
 #include <stdlib.h>
+#include "../occupancy_tools/DeviceProfiles.h"
 
 /**
  * This macro checks return value of the CUDA runtime call and exits
@@ -41,14 +42,13 @@ inline void gpuAssert(cudaError_t code, char *file, int line, bool abort = true)
 }
 
 /**
- * Returns the configuration properties of the particular GPU running on the machine
+ * Returns the configuration properties of the particular GPU running on the machine, or of the
+ * device profile in use (see DeviceProfiles.h). The runtime is only asked once.
  *
  * @return the gpu configuration
  */
-inline cudaDeviceProp getGPUConfiguration() {
-	cudaDeviceProp props;
-	cudaGetDeviceProperties(&props, 0);
-	return props;
+inline const cudaDeviceProp& getGPUConfiguration() {
+	return getActiveDeviceProperties();
 }
 
 /**
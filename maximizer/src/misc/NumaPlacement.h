@@ -0,0 +1,233 @@
+/**
+ * NumaPlacement.h
+ *
+ * Helpers for placing host worker threads and the data they work on onto NUMA nodes. Linux puts
+ * a page on the node of the thread that touches it first, so a buffer that is filled by a single
+ * thread ends up on a single node and every worker on another socket reads it remotely. The
+ * functions here read the topology from sysfs (no libnuma needed), pin threads to CPUs and let
+ * every pinned worker first-touch its own segment of a buffer.
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Zahari Dichev <zaharidichev@gmail.com>
+ */
+
+#ifndef NUMAPLACEMENT_H_
+#define NUMAPLACEMENT_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <boost/thread.hpp>
+#include <boost/bind.hpp>
+
+/**
+ * A NUMA node and the CPUs that belong to it
+ */
+struct NumaNode {
+	int id;
+	std::vector<int> cpus;
+};
+
+/**
+ * Parses a CPU list in the format used by sysfs, e.g. "0-3,8-11"
+ *
+ * @param list the list
+ * @return the CPUs
+ */
+inline std::vector<int> parseCpuList(const std::string& list) {
+	std::vector<int> cpus;
+	size_t start = 0;
+	while (start < list.size()) {
+		size_t end = list.find(',', start);
+		if (end == std::string::npos) {
+			end = list.size();
+		}
+		std::string range = list.substr(start, end - start);
+		size_t dash = range.find('-');
+		if (!range.empty() && range[0] >= '0' && range[0] <= '9') {
+			int first = atoi(range.c_str());
+			int last = (dash == std::string::npos) ? first : atoi(range.c_str() + dash + 1);
+			for (int cpu = first; cpu <= last; ++cpu) {
+				cpus.push_back(cpu);
+			}
+		}
+		start = end + 1;
+	}
+	return cpus;
+}
+
+/**
+ * Reads the NUMA topology of the machine. If it cannot be read, the whole machine is reported
+ * as a single node.
+ *
+ * @return the nodes that have CPUs
+ */
+inline std::vector<NumaNode> getNumaTopology() {
+	std::vector<NumaNode> nodes;
+	for (int id = 0; id < 1024; ++id) {
+		char path[128];
+		snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/cpulist", id);
+		FILE* file = fopen(path, "r");
+		if (file == NULL) {
+			continue; // node ids do not have to be contiguous
+		}
+		char line[4096];
+		if (fgets(line, sizeof(line), file) != NULL) {
+			NumaNode node;
+			node.id = id;
+			node.cpus = parseCpuList(std::string(line, strcspn(line, "\n")));
+			if (!node.cpus.empty()) {
+				nodes.push_back(node);
+			}
+		}
+		fclose(file);
+	}
+
+	if (nodes.empty()) {
+		NumaNode node;
+		node.id = 0;
+		long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+		for (int cpu = 0; cpu < ((cpus > 0) ? cpus : 1); ++cpu) {
+			node.cpus.push_back(cpu);
+		}
+		nodes.push_back(node);
+	}
+	return nodes;
+}
+
+/**
+ * Decides on which CPU each worker runs. Workers get contiguous segments of the data, so the first
+ * workers go to the first node, the next ones to the second node and so on. Within a node the
+ * CPUs are used round robin.
+ *
+ * @param topology the NUMA nodes
+ * @param threads the number of workers
+ * @return the CPU of every worker
+ */
+inline std::vector<int> getWorkerCpus(const std::vector<NumaNode>& topology, int threads) {
+	std::vector<int> cpus;
+	std::vector<int> usedOnNode(topology.size(), 0);
+	for (int t = 0; t < threads; ++t) {
+		size_t node = ((size_t) t * topology.size()) / threads;
+		const std::vector<int>& nodeCpus = topology[node].cpus;
+		cpus.push_back(nodeCpus[usedOnNode[node]++ % nodeCpus.size()]);
+	}
+	return cpus;
+}
+
+/**
+ * Returns the node a CPU belongs to
+ *
+ * @param topology the NUMA nodes
+ * @param cpu the CPU
+ * @return the id of the node or -1 if the CPU is unknown
+ */
+inline int getNodeOfCpu(const std::vector<NumaNode>& topology, int cpu) {
+	for (size_t n = 0; n < topology.size(); ++n) {
+		if (std::find(topology[n].cpus.begin(), topology[n].cpus.end(), cpu) != topology[n].cpus.end()) {
+			return topology[n].id;
+		}
+	}
+	return -1;
+}
+
+/**
+ * Counts the nodes that a set of workers is spread over
+ *
+ * @param topology the NUMA nodes
+ * @param cpus the CPUs of the workers
+ * @return the number of distinct nodes
+ */
+inline int countNodesUsed(const std::vector<NumaNode>& topology, const std::vector<int>& cpus) {
+	std::vector<int> nodes;
+	for (size_t c = 0; c < cpus.size(); ++c) {
+		int node = getNodeOfCpu(topology, cpus[c]);
+		if (std::find(nodes.begin(), nodes.end(), node) == nodes.end()) {
+			nodes.push_back(node);
+		}
+	}
+	return nodes.size();
+}
+
+/**
+ * Pins the calling thread to a CPU
+ *
+ * @param cpu the CPU
+ * @return false if the thread could not be pinned
+ */
+inline bool pinCurrentThreadToCpu(int cpu) {
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	CPU_SET(cpu, &set);
+	return pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &set) == 0;
+}
+
+/**
+ * Allocates a buffer without touching it, so that its pages are placed on the node of whoever
+ * writes to them first. The buffer has to be released with releaseUntouchedBuffer().
+ *
+ * @param size the size in bytes
+ * @return the buffer or NULL
+ */
+inline unsigned char* allocateUntouchedBuffer(size_t size) {
+	void* buffer = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+	return (buffer == MAP_FAILED) ? NULL : (unsigned char*) buffer;
+}
+
+/**
+ * Releases a buffer allocated with allocateUntouchedBuffer()
+ *
+ * @param buffer the buffer
+ * @param size its size
+ */
+inline void releaseUntouchedBuffer(unsigned char* buffer, size_t size) {
+	if (buffer != NULL) {
+		munmap(buffer, size);
+	}
+}
+
+/**
+ * Pins itself and then fills a segment. This is run by every thread in firstTouchSegments().
+ */
+inline void firstTouchSegment(unsigned char* buffer, const unsigned char* source, size_t from, size_t to, int cpu) {
+	if (cpu >= 0) {
+		pinCurrentThreadToCpu(cpu);
+	}
+	if (source != NULL) {
+		memcpy(buffer + from, source + from, to - from);
+	} else {
+		memset(buffer + from, 0, to - from);
+	}
+}
+
+/**
+ * Fills a buffer segment by segment, every segment by a thread pinned to the CPU of the worker that
+ * will later process it. This way the pages of every segment land on the node of its worker.
+ *
+ * @param buffer the (untouched) buffer
+ * @param source the data to copy into the buffer (NULL to fill it with zeros)
+ * @param size the size of the buffer
+ * @param segmentSize the size of every segment (the last one gets what is left)
+ * @param cpus the CPU of the worker of every segment
+ */
+inline void firstTouchSegments(unsigned char* buffer, const unsigned char* source, size_t size, size_t segmentSize, const std::vector<int>& cpus) {
+	boost::thread_group threads;
+	for (size_t s = 0; s < cpus.size(); ++s) {
+		size_t from = std::min(s * segmentSize, size);
+		size_t to = (s == cpus.size() - 1) ? size : std::min(from + segmentSize, size);
+		if (from < to) {
+			threads.create_thread(boost::bind(&firstTouchSegment, buffer, source, from, to, cpus[s]));
+		}
+	}
+	threads.join_all();
+}
+
+#endif /* NUMAPLACEMENT_H_ */
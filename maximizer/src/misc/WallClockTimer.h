@@ -0,0 +1,104 @@
+/**
+ * WallClockTimer.h
+ *
+ * A timer with the same interface as SimpleTimer, which measures elapsed real time
+ * instead of processor time. The processor time of a multithreaded run is the sum of
+ * the time of all threads, so SimpleTimer cannot be used when measuring throughput of
+ * host code that runs on several cores. Along with the time, the timer also records
+ * the number of elapsed time stamp counter ticks, which is used to report cycles per byte.
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Zahari Dichev <zaharidichev@gmail.com>
+ */
+
+#ifndef WALLCLOCKTIMER_H_
+#define WALLCLOCKTIMER_H_
+#include <time.h>
+#include <string>
+#include <stdint.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+/**
+ * Reads the time stamp counter of the processor. On architectures where it is not
+ * available, 0 is returned.
+ *
+ * @return the current value of the counter
+ */
+inline uint64_t readCycleCounter() {
+#if defined(__x86_64__) || defined(__i386__)
+	return __rdtsc();
+#else
+	return 0;
+#endif
+}
+
+class WallClockTimer {
+private:
+	timespec start_;
+	timespec end_;
+	uint64_t startCycles;
+	uint64_t endCycles;
+	double elapsedTime;
+	std::string name;
+
+public:
+	/**
+	 * Initializes the private variables and assigns a name to the timer
+	 *
+	 * @param name
+	 */
+	WallClockTimer(std::string name) {
+		this->name = name;
+		this->start_.tv_sec = this->start_.tv_nsec = 0;
+		this->end_ = this->start_;
+		this->startCycles = 0;
+		this->endCycles = 0;
+		this->elapsedTime = 0;
+	}
+
+	virtual ~WallClockTimer() {
+	}
+
+	/**
+	 * Starts the timer
+	 */
+	void start() {
+		clock_gettime(CLOCK_MONOTONIC, &this->start_);
+		this->startCycles = readCycleCounter();
+	}
+
+	/**
+	 * Stop the timer and calculate elapsed time since start
+	 *
+	 * @return the elapsed time in seconds
+	 */
+	double stop() {
+		this->endCycles = readCycleCounter();
+		clock_gettime(CLOCK_MONOTONIC, &this->end_);
+		this->elapsedTime = (double) (this->end_.tv_sec - this->start_.tv_sec) + (double) (this->end_.tv_nsec - this->start_.tv_nsec) / 1e9;
+		return this->elapsedTime;
+	}
+
+	/**
+	 * Returns the elapsed time
+	 *
+	 * @return elapsed time
+	 */
+	double getElapsedTime() {
+		return this->elapsedTime;
+	}
+
+	/**
+	 * Returns the number of time stamp counter ticks between start() and stop()
+	 *
+	 * @return elapsed cycles (0 if the counter is not available)
+	 */
+	uint64_t getElapsedCycles() {
+		return this->endCycles - this->startCycles;
+	}
+
+};
+
+#endif /* WALLCLOCKTIMER_H_ */
@@ -0,0 +1,196 @@
+/**
+ * CoResidency.h
+ *
+ * The blocks of kernels that run at the same time share the register file, the shared memory, the
+ * warps and the block slots of every SM. This works out how many blocks of each kernel are resident
+ * on an SM together, instead of looking at every kernel on its own, and the occupancy they give
+ * together.
+ *
+ * The block scheduler spreads the blocks of a grid over the SMs, one SM after the other, and gives
+ * the blocks of a kernel that was launched later only what the earlier ones leave. So the kernels
+ * are placed in launch order, a block on every SM it still fits on at a time, with a grid that does
+ * not cover all of those going to the least busy SMs. SMs that end up with the same blocks are kept
+ * as a group, so the work grows with the number of kernels and not with the number of SMs.
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Zahari Dichev <zaharidichev@gmail.com>
+ */
+
+#ifndef CORESIDENCY_H_
+#define CORESIDENCY_H_
+
+#include "OccupancyLimits.h"
+#include "ResourcePartitioning.h"
+#include "../abstract_elastic_kernel/AbstractElasticKernel.hpp"
+#include <cuda_runtime.h>
+#include <boost/shared_ptr.hpp>
+#include <vector>
+#include <algorithm>
+
+/**
+ * The blocks of kernels that are resident together, and the occupancy they give
+ */
+struct CoResidency {
+	std::vector<size_t> blocksPerSM; // of every kernel, on the SM with the most of them
+	std::vector<size_t> residentBlocks; // of every kernel, on the whole device
+	double smOccupancy; // the threads on the busiest SM over the threads it runs
+	double occupancy; // the threads on the device over the threads it runs
+};
+
+/**
+ * SMs that hold the same blocks, and what is left of each of them
+ */
+struct residentSMGroup {
+	size_t numSMs;
+	size_t sharedMem;
+	size_t warps;
+	size_t registers;
+	size_t blocks;
+	size_t threads; // of the resident blocks
+	size_t kernelBlocks; // of the kernel that is being placed
+
+	/**
+	 * Returns whether another block of a kernel fits
+	 */
+	inline bool fits(const KernelDemand& demand, size_t warpsPerBlock, size_t maxKernelBlocks) const {
+		return this->kernelBlocks < maxKernelBlocks && this->blocks > 0 && this->sharedMem >= demand.perBlock[0] && this->warps >= warpsPerBlock
+				&& this->registers >= demand.perBlock[2];
+	}
+
+	/**
+	 * Places a block of a kernel on every SM of the group
+	 */
+	inline void place(const KernelDemand& demand, size_t warpsPerBlock) {
+		this->sharedMem -= demand.perBlock[0];
+		this->warps -= warpsPerBlock;
+		this->registers -= demand.perBlock[2];
+		this->blocks -= 1;
+		this->threads += demand.perBlock[1];
+		this->kernelBlocks += 1;
+	}
+};
+
+/**
+ * Orders groups of SMs with the most warps left first, which the block scheduler fills first
+ */
+struct residentSMGroupComparator {
+	inline bool operator()(const residentSMGroup& i, const residentSMGroup& j) const {
+		return i.warps > j.warps;
+	}
+};
+
+/**
+ * Works out the blocks of kernels that are resident together
+ *
+ * @param demands what every kernel asks for, in launch order (see getKernelDemand())
+ * @param deviceProps the device properties
+ * @return the blocks of every kernel, in the order of the demands, and the combined occupancy
+ */
+inline CoResidency getCoResidency(const std::vector<KernelDemand>& demands, const cudaDeviceProp& deviceProps) {
+	CoResidency result;
+	result.smOccupancy = 0;
+	result.occupancy = 0;
+	size_t numSMs = (deviceProps.multiProcessorCount > 0) ? deviceProps.multiProcessorCount : 1;
+	size_t warpSize = (deviceProps.warpSize > 0) ? deviceProps.warpSize : 32;
+	SMResources resources = getSMResources(deviceProps);
+
+	// all SMs start out empty, and are split into groups as the blocks of a kernel land on some of them only
+	residentSMGroup empty = { numSMs, (size_t) resources.sharedMem, (size_t) resources.maxWarps, (size_t) resources.registers,
+			(size_t) resources.maxBlocks, 0, 0 };
+	std::vector<residentSMGroup> groups(1, empty);
+	residentSMGroupComparator comparator;
+
+	for (std::vector<KernelDemand>::const_iterator it = demands.begin(); it != demands.end(); ++it) {
+		const KernelDemand& demand = (*it);
+		size_t warpsPerBlock = ceilTo((demand.perBlock[1] + warpSize - 1) / warpSize, resources.warpAllocationGranularity);
+		size_t maxKernelBlocks = demand.residentBlocks / numSMs; // what an SM holds of them on its own
+		size_t remaining = demand.blocks;
+		for (std::vector<residentSMGroup>::iterator group = groups.begin(); group != groups.end(); ++group) {
+			(*group).kernelBlocks = 0;
+		}
+
+		// the blocks go out one per SM at a time, to the SMs they still fit on
+		while (remaining > 0) {
+			size_t eligible = 0;
+			for (std::vector<residentSMGroup>::const_iterator group = groups.begin(); group != groups.end(); ++group) {
+				if ((*group).fits(demand, warpsPerBlock, maxKernelBlocks)) {
+					eligible += (*group).numSMs;
+				}
+			}
+			if (eligible == 0) {
+				break;
+			}
+			if (remaining >= eligible) {
+				for (std::vector<residentSMGroup>::iterator group = groups.begin(); group != groups.end(); ++group) {
+					if ((*group).fits(demand, warpsPerBlock, maxKernelBlocks)) {
+						(*group).place(demand, warpsPerBlock);
+					}
+				}
+				remaining -= eligible;
+				continue;
+			}
+			// the last blocks go to the least busy SMs, which splits a group if they only land on some of its SMs
+			std::stable_sort(groups.begin(), groups.end(), comparator);
+			for (size_t g = 0; g < groups.size() && remaining > 0; ++g) {
+				if (!groups[g].fits(demand, warpsPerBlock, maxKernelBlocks)) {
+					continue;
+				}
+				if (groups[g].numSMs > remaining) {
+					residentSMGroup rest = groups[g];
+					rest.numSMs -= remaining;
+					groups[g].numSMs = remaining;
+					groups.push_back(rest);
+				}
+				groups[g].place(demand, warpsPerBlock);
+				remaining -= groups[g].numSMs;
+			}
+		}
+
+		size_t busiest = 0;
+		for (std::vector<residentSMGroup>::const_iterator group = groups.begin(); group != groups.end(); ++group) {
+			busiest = std::max(busiest, (*group).kernelBlocks);
+		}
+		result.blocksPerSM.push_back(busiest);
+		result.residentBlocks.push_back(demand.blocks - remaining);
+	}
+
+	if (deviceProps.maxThreadsPerMultiProcessor > 0) {
+		double threads = 0;
+		for (std::vector<residentSMGroup>::const_iterator group = groups.begin(); group != groups.end(); ++group) {
+			threads += (double) (*group).threads * (*group).numSMs;
+			result.smOccupancy = std::max(result.smOccupancy, (double) (*group).threads / deviceProps.maxThreadsPerMultiProcessor);
+		}
+		result.occupancy = threads / ((double) deviceProps.maxThreadsPerMultiProcessor * numSMs);
+	}
+	return result;
+}
+
+/**
+ * Works out the blocks of kernels that are resident together with their current launch parameters
+ *
+ * @param kernels the kernels, in launch order
+ * @param deviceProps the device properties
+ * @return the blocks of every kernel, in the order of the kernels, and the combined occupancy
+ */
+inline CoResidency getCoResidency(const std::vector<boost::shared_ptr<AbstractElasticKernel> >& kernels, const cudaDeviceProp& deviceProps) {
+	std::vector<KernelDemand> demands;
+	for (std::vector<boost::shared_ptr<AbstractElasticKernel> >::const_iterator it = kernels.begin(); it != kernels.end(); ++it) {
+		demands.push_back(getKernelDemand(*it));
+	}
+	return getCoResidency(demands, deviceProps);
+}
+
+/**
+ * Returns the occupancy a kernel gives on its own with its grid: the threads of its resident blocks over
+ * the threads the device runs
+ *
+ * @param kernel a pointer to the kernel
+ * @param deviceProps the device properties
+ * @return the occupancy, from 0 to 1
+ */
+inline double getResidentOccupancyForKernel(boost::shared_ptr<AbstractElasticKernel> kernel, const cudaDeviceProp& deviceProps) {
+	std::vector<KernelDemand> demands(1, getKernelDemand(kernel));
+	return getCoResidency(demands, deviceProps).occupancy;
+}
+
+#endif /* CORESIDENCY_H_ */
@@ -0,0 +1,614 @@
+/**
+ * DeviceProfiles.h
+ *
+ * Device profiles, so that occupancy calculation, kernel limiting and scheduling can run on a
+ * machine without a GPU (capacity planning for GPU clusters). A profile holds the fields of
+ * cudaDeviceProp that the occupancy tools and the scheduler read. There is a built-in database of
+ * profiles from Fermi to Hopper, and a profile can also be read from a key=value text file whose
+ * keys are the names of the cudaDeviceProp fields. A file can start from a built-in profile
+ * (base=NAME) and change only some of its fields.
+ *
+ * When a profile is active, getGPUConfiguration() and getGPUProperties() return it instead of
+ * asking the runtime, and the execution queues take the free memory from it and create no
+ * streams. The function attributes of the kernels (registers, static shared memory) cannot be
+ * queried without a device either, so the profile also holds them, by the name of the kernel
+ * function: kernel.NAME.numRegs=N and so on. Kernels that are not listed get
+ * DEFAULT_OFFLINE_KERNEL_REGS registers and no shared memory.
+ *
+ * The profile is selected on the first call from ELASTIC_DEVICE_PROFILE (a name or a path), or
+ * with setActiveDeviceProfile().
+ *
+ * Without a profile, the same state caches what the runtime returns: the device properties are
+ * queried once per process and the attributes once per kernel function, since the scheduler asks
+ * for them for every kernel and in every step of its loops and each cudaGetDeviceProperties()
+ * takes milliseconds. setDeviceQueryCaching(false) turns that off (to measure what it saves).
+ * None of it is locked; the scheduling runs on one thread.
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Zahari Dichev <zaharidichev@gmail.com>
+ */
+
+#ifndef DEVICEPROFILES_H_
+#define DEVICEPROFILES_H_
+
+#include "cuda_runtime.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <string>
+#include <map>
+
+#define DEFAULT_OFFLINE_KERNEL_REGS 32
+#define GPU_MEMORY_RESERVE (64 * (1 << 20))
+
+/**
+ * A device as the built-in database describes it
+ */
+struct deviceProfileEntry {
+	const char* id; // the short name the profile is selected by
+	const char* name; // the name the device reports
+	int major;
+	int minor;
+	int multiProcessorCount;
+	int clockRate; // kHz
+	int memoryClockRate; // kHz
+	int memoryBusWidth; // bits
+	size_t totalGlobalMem;
+	int l2CacheSize;
+	size_t sharedMemPerBlock;
+	size_t sharedMemPerMultiprocessor;
+	size_t sharedMemPerBlockOptin;
+	int regsPerBlock;
+	int regsPerMultiprocessor;
+	int maxThreadsPerMultiProcessor;
+	int maxBlocksPerMultiProcessor;
+	int asyncEngineCount;
+};
+
+#define GIB(n) ((size_t) (n) << 30)
+
+static const deviceProfileEntry BUILTIN_DEVICE_PROFILES[] = {
+		{ "c2050", "Tesla C2050", 2, 0, 14, 1150000, 1500000, 384, GIB(3), 786432, 49152, 49152, 49152, 32768, 32768, 1536, 8, 2 },
+		{ "gtx480", "GeForce GTX 480", 2, 0, 15, 1401000, 1848000, 384, GIB(3) / 2, 786432, 49152, 49152, 49152, 32768, 32768, 1536, 8, 1 },
+		{ "gtx680", "GeForce GTX 680", 3, 0, 8, 1058000, 3004000, 256, GIB(2), 524288, 49152, 49152, 49152, 65536, 65536, 2048, 16, 1 },
+		{ "k20", "Tesla K20c", 3, 5, 13, 706000, 2600000, 320, GIB(5), 1310720, 49152, 49152, 49152, 65536, 65536, 2048, 16, 2 },
+		{ "k40", "Tesla K40c", 3, 5, 15, 745000, 3004000, 384, GIB(12), 1572864, 49152, 49152, 49152, 65536, 65536, 2048, 16, 2 },
+		{ "gtx980", "GeForce GTX 980", 5, 2, 16, 1216000, 3505000, 256, GIB(4), 2097152, 49152, 98304, 49152, 65536, 65536, 2048, 32, 2 },
+		{ "p100", "Tesla P100-PCIE-16GB", 6, 0, 56, 1328500, 715000, 4096, GIB(16), 4194304, 49152, 65536, 49152, 65536, 65536, 2048, 32, 2 },
+		{ "v100", "Tesla V100-SXM2-16GB", 7, 0, 80, 1530000, 877000, 4096, GIB(16), 6291456, 49152, 98304, 98304, 65536, 65536, 2048, 32, 6 },
+		{ "t4", "Tesla T4", 7, 5, 40, 1590000, 5001000, 256, GIB(16), 4194304, 49152, 65536, 65536, 65536, 65536, 1024, 16, 3 },
+		{ "a100", "A100-SXM4-40GB", 8, 0, 108, 1410000, 1215000, 5120, GIB(40), 41943040, 49152, 167936, 166912, 65536, 65536, 2048, 32, 3 },
+		{ "rtx3090", "GeForce RTX 3090", 8, 6, 82, 1695000, 9751000, 384, GIB(24), 6291456, 49152, 102400, 101376, 65536, 65536, 1536, 16, 2 },
+		{ "l4", "NVIDIA L4", 8, 9, 58, 2040000, 6251000, 192, GIB(24), 50331648, 49152, 102400, 101376, 65536, 65536, 1536, 24, 2 },
+		{ "h100", "NVIDIA H100 80GB HBM3", 9, 0, 132, 1980000, 2619000, 5120, GIB(80), 52428800, 49152, 233472, 232448, 65536, 65536, 2048, 32,
+				3 } };
+
+#undef GIB
+
+#define NUM_BUILTIN_DEVICE_PROFILES (sizeof(BUILTIN_DEVICE_PROFILES) / sizeof(deviceProfileEntry))
+
+/**
+ * The profile in use and the attributes of the kernel functions that come with it
+ */
+struct deviceProfileState {
+	bool offline; // false when the runtime is asked
+	bool queried; // props holds what the runtime returned
+	bool caching; // whether the answers of the runtime are kept
+	size_t runtimeQueries; // the times the runtime was asked for properties or attributes
+	unsigned int version; // changes whenever another profile is selected, so what was derived from the last one can be dropped
+	cudaDeviceProp props;
+	std::map<std::string, cudaFuncAttributes> kernels; // by the name of the kernel function
+};
+
+/**
+ * Turns an entry of the database into device properties
+ *
+ * @param entry the entry
+ * @return the properties, with the fields the database has no column for filled in as every
+ * device since Fermi has them
+ */
+inline cudaDeviceProp makeDeviceProfile(const deviceProfileEntry& entry) {
+	cudaDeviceProp props;
+	memset(&props, 0, sizeof(cudaDeviceProp));
+	strncpy(props.name, entry.name, sizeof(props.name) - 1);
+	props.major = entry.major;
+	props.minor = entry.minor;
+	props.multiProcessorCount = entry.multiProcessorCount;
+	props.clockRate = entry.clockRate;
+	props.memoryClockRate = entry.memoryClockRate;
+	props.memoryBusWidth = entry.memoryBusWidth;
+	props.totalGlobalMem = entry.totalGlobalMem;
+	props.l2CacheSize = entry.l2CacheSize;
+	props.sharedMemPerBlock = entry.sharedMemPerBlock;
+	props.regsPerBlock = entry.regsPerBlock;
+	props.maxThreadsPerMultiProcessor = entry.maxThreadsPerMultiProcessor;
+	props.asyncEngineCount = entry.asyncEngineCount;
+#if CUDART_VERSION >= 6000
+	props.sharedMemPerMultiprocessor = entry.sharedMemPerMultiprocessor;
+	props.regsPerMultiprocessor = entry.regsPerMultiprocessor;
+#endif
+#if CUDART_VERSION >= 9000
+	props.sharedMemPerBlockOptin = entry.sharedMemPerBlockOptin;
+#endif
+#if CUDART_VERSION >= 11000
+	props.maxBlocksPerMultiProcessor = entry.maxBlocksPerMultiProcessor;
+	props.reservedSharedMemPerBlock = (entry.major >= 8) ? 1024 : 0;
+#endif
+	props.warpSize = 32;
+	props.maxThreadsPerBlock = 1024;
+	props.maxThreadsDim[0] = 1024;
+	props.maxThreadsDim[1] = 1024;
+	props.maxThreadsDim[2] = 64;
+	props.maxGridSize[0] = (entry.major >= 3) ? 2147483647 : 65535;
+	props.maxGridSize[1] = 65535;
+	props.maxGridSize[2] = 65535;
+	props.totalConstMem = 65536;
+	props.memPitch = 2147483647;
+	props.textureAlignment = 512;
+	props.deviceOverlap = 1;
+	props.concurrentKernels = 1;
+	props.canMapHostMemory = 1;
+	props.unifiedAddressing = 1;
+	return props;
+}
+
+/**
+ * Compares two names ignoring case, spaces and dashes ("Tesla K40c" matches "tesla-k40c")
+ */
+inline bool isSameDeviceName(const char* a, const char* b) {
+	while (*a != '\0' || *b != '\0') {
+		if (*a == ' ' || *a == '-') {
+			++a;
+			continue;
+		}
+		if (*b == ' ' || *b == '-') {
+			++b;
+			continue;
+		}
+		if (tolower((unsigned char) *a) != tolower((unsigned char) *b)) {
+			return false;
+		}
+		++a;
+		++b;
+	}
+	return true;
+}
+
+/**
+ * Finds a profile of the built-in database
+ *
+ * @param name the short name of the profile (k40, v100, ...) or the name the device reports
+ * @param props receives the profile
+ * @return false if there is no such profile
+ */
+inline bool findDeviceProfile(const std::string& name, cudaDeviceProp& props) {
+	for (size_t i = 0; i < NUM_BUILTIN_DEVICE_PROFILES; ++i) {
+		if (isSameDeviceName(name.c_str(), BUILTIN_DEVICE_PROFILES[i].id) || isSameDeviceName(name.c_str(), BUILTIN_DEVICE_PROFILES[i].name)) {
+			props = makeDeviceProfile(BUILTIN_DEVICE_PROFILES[i]);
+			return true;
+		}
+	}
+	return false;
+}
+
+/**
+ * Returns the attributes a kernel function is assumed to have when a profile does not list it
+ */
+inline cudaFuncAttributes getDefaultKernelAttributes() {
+	cudaFuncAttributes attributes;
+	memset(&attributes, 0, sizeof(cudaFuncAttributes));
+	attributes.numRegs = DEFAULT_OFFLINE_KERNEL_REGS;
+	attributes.maxThreadsPerBlock = 1024;
+	return attributes;
+}
+
+/**
+ * Sets a field of the device properties or of the attributes of a kernel function from a line of
+ * a profile file
+ *
+ * @return false if the key is not known
+ */
+inline bool setDeviceProfileField(deviceProfileState& state, const char* key, const char* value) {
+	cudaDeviceProp& props = state.props;
+	long number = strtol(value, NULL, 10);
+	if (strncmp(key, "kernel.", 7) == 0) {
+		// kernel.NAME.FIELD
+		const char* field = strrchr(key, '.');
+		if (field <= key + 7) {
+			return false;
+		}
+		std::string function(key + 7, field - key - 7);
+		if (state.kernels.find(function) == state.kernels.end()) {
+			state.kernels[function] = getDefaultKernelAttributes();
+		}
+		cudaFuncAttributes& attributes = state.kernels[function];
+		if (strcmp(field, ".numRegs") == 0) {
+			attributes.numRegs = (int) number;
+		} else if (strcmp(field, ".sharedSizeBytes") == 0) {
+			attributes.sharedSizeBytes = (size_t) number;
+		} else if (strcmp(field, ".constSizeBytes") == 0) {
+			attributes.constSizeBytes = (size_t) number;
+		} else if (strcmp(field, ".localSizeBytes") == 0) {
+			attributes.localSizeBytes = (size_t) number;
+		} else if (strcmp(field, ".maxThreadsPerBlock") == 0) {
+			attributes.maxThreadsPerBlock = (int) number;
+		} else {
+			return false;
+		}
+		return true;
+	}
+	if (strcmp(key, "name") == 0) {
+		memset(props.name, 0, sizeof(props.name));
+		strncpy(props.name, value, sizeof(props.name) - 1);
+	} else if (strcmp(key, "major") == 0) {
+		props.major = (int) number;
+	} else if (strcmp(key, "minor") == 0) {
+		props.minor = (int) number;
+	} else if (strcmp(key, "multiProcessorCount") == 0) {
+		props.multiProcessorCount = (int) number;
+	} else if (strcmp(key, "clockRate") == 0) {
+		props.clockRate = (int) number;
+	} else if (strcmp(key, "memoryClockRate") == 0) {
+		props.memoryClockRate = (int) number;
+	} else if (strcmp(key, "memoryBusWidth") == 0) {
+		props.memoryBusWidth = (int) number;
+	} else if (strcmp(key, "totalGlobalMem") == 0) {
+		props.totalGlobalMem = (size_t) strtoull(value, NULL, 10);
+	} else if (strcmp(key, "l2CacheSize") == 0) {
+		props.l2CacheSize = (int) number;
+	} else if (strcmp(key, "sharedMemPerBlock") == 0) {
+		props.sharedMemPerBlock = (size_t) number;
+	} else if (strcmp(key, "regsPerBlock") == 0) {
+		props.regsPerBlock = (int) number;
+	} else if (strcmp(key, "warpSize") == 0) {
+		props.warpSize = (int) number;
+	} else if (strcmp(key, "maxThreadsPerBlock") == 0) {
+		props.maxThreadsPerBlock = (int) number;
+	} else if (strcmp(key, "maxThreadsPerMultiProcessor") == 0) {
+		props.maxThreadsPerMultiProcessor = (int) number;
+	} else if (strcmp(key, "totalConstMem") == 0) {
+		props.totalConstMem = (size_t) number;
+	} else if (strcmp(key, "concurrentKernels") == 0) {
+		props.concurrentKernels = (int) number;
+	} else if (strcmp(key, "asyncEngineCount") == 0) {
+		props.asyncEngineCount = (int) number;
+#if CUDART_VERSION >= 6000
+	} else if (strcmp(key, "sharedMemPerMultiprocessor") == 0) {
+		props.sharedMemPerMultiprocessor = (size_t) number;
+	} else if (strcmp(key, "regsPerMultiprocessor") == 0) {
+		props.regsPerMultiprocessor = (int) number;
+#endif
+#if CUDART_VERSION >= 9000
+	} else if (strcmp(key, "sharedMemPerBlockOptin") == 0) {
+		props.sharedMemPerBlockOptin = (size_t) number;
+#endif
+#if CUDART_VERSION >= 11000
+	} else if (strcmp(key, "maxBlocksPerMultiProcessor") == 0) {
+		props.maxBlocksPerMultiProcessor = (int) number;
+	} else if (strcmp(key, "reservedSharedMemPerBlock") == 0) {
+		props.reservedSharedMemPerBlock = (size_t) number;
+#endif
+	} else {
+		return false;
+	}
+	return true;
+}
+
+/**
+ * Reads a profile file. The keys are the names of the cudaDeviceProp fields, base=NAME starts from
+ * a built-in profile (it has to come first) and kernel.NAME.FIELD sets an attribute of a kernel
+ * function.
+ *
+ * @param path the path of the file
+ * @param state receives the profile and the kernel attributes
+ * @return false if the file cannot be read, has an unknown key or base, or leaves out the fields
+ * the occupancy calculation needs
+ */
+inline bool loadDeviceProfile(const std::string& path, deviceProfileState& state) {
+	FILE* file = fopen(path.c_str(), "r");
+	if (file == NULL) {
+		return false;
+	}
+	memset(&state.props, 0, sizeof(cudaDeviceProp));
+	state.kernels.clear();
+	bool valid = true;
+	char line[512];
+	while (fgets(line, sizeof(line), file) != NULL) {
+		line[strcspn(line, "\r\n")] = '\0';
+		char* value = strchr(line, '=');
+		if (line[0] == '#' || value == NULL) {
+			continue;
+		}
+		*value++ = '\0';
+		if (strcmp(line, "base") == 0) {
+			valid = findDeviceProfile(value, state.props) && valid;
+		} else if (!setDeviceProfileField(state, line, value)) {
+			fprintf(stderr, "%s: unknown key %s\n", path.c_str(), line);
+			valid = false;
+		}
+	}
+	fclose(file);
+	state.offline = true;
+	return valid && state.props.major > 0 && state.props.multiProcessorCount > 0 && state.props.warpSize > 0
+			&& state.props.maxThreadsPerMultiProcessor > 0 && state.props.regsPerBlock > 0 && state.props.totalGlobalMem > 0;
+}
+
+/**
+ * Writes device properties as a profile file, e.g. to take the profile of a device to a machine
+ * that has none
+ *
+ * @param path the path of the file
+ * @param props the properties
+ * @return false if the file cannot be written
+ */
+inline bool saveDeviceProfile(const std::string& path, const cudaDeviceProp& props) {
+	FILE* file = fopen(path.c_str(), "w");
+	if (file == NULL) {
+		return false;
+	}
+	fprintf(file, "# written by --save-device\n");
+	fprintf(file, "name=%s\n", props.name);
+	fprintf(file, "major=%d\n", props.major);
+	fprintf(file, "minor=%d\n", props.minor);
+	fprintf(file, "multiProcessorCount=%d\n", props.multiProcessorCount);
+	fprintf(file, "clockRate=%d\n", props.clockRate);
+	fprintf(file, "memoryClockRate=%d\n", props.memoryClockRate);
+	fprintf(file, "memoryBusWidth=%d\n", props.memoryBusWidth);
+	fprintf(file, "totalGlobalMem=%llu\n", (unsigned long long) props.totalGlobalMem);
+	fprintf(file, "l2CacheSize=%d\n", props.l2CacheSize);
+	fprintf(file, "sharedMemPerBlock=%lu\n", (unsigned long) props.sharedMemPerBlock);
+	fprintf(file, "regsPerBlock=%d\n", props.regsPerBlock);
+	fprintf(file, "warpSize=%d\n", props.warpSize);
+	fprintf(file, "maxThreadsPerBlock=%d\n", props.maxThreadsPerBlock);
+	fprintf(file, "maxThreadsPerMultiProcessor=%d\n", props.maxThreadsPerMultiProcessor);
+	fprintf(file, "totalConstMem=%lu\n", (unsigned long) props.totalConstMem);
+	fprintf(file, "concurrentKernels=%d\n", props.concurrentKernels);
+	fprintf(file, "asyncEngineCount=%d\n", props.asyncEngineCount);
+#if CUDART_VERSION >= 6000
+	fprintf(file, "sharedMemPerMultiprocessor=%lu\n", (unsigned long) props.sharedMemPerMultiprocessor);
+	fprintf(file, "regsPerMultiprocessor=%d\n", props.regsPerMultiprocessor);
+#endif
+#if CUDART_VERSION >= 9000
+	fprintf(file, "sharedMemPerBlockOptin=%lu\n", (unsigned long) props.sharedMemPerBlockOptin);
+#endif
+#if CUDART_VERSION >= 11000
+	fprintf(file, "maxBlocksPerMultiProcessor=%d\n", props.maxBlocksPerMultiProcessor);
+	fprintf(file, "reservedSharedMemPerBlock=%lu\n", (unsigned long) props.reservedSharedMemPerBlock);
+#endif
+	return fclose(file) == 0;
+}
+
+/**
+ * Selects a profile by the name of a built-in profile or by the path of a profile file
+ *
+ * @param nameOrPath the name or the path
+ * @param state receives the profile
+ * @return false if there is neither such a profile nor a valid file
+ */
+inline bool selectDeviceProfile(const std::string& nameOrPath, deviceProfileState& state) {
+	state.kernels.clear();
+	if (findDeviceProfile(nameOrPath, state.props)) {
+		state.offline = true;
+		return true;
+	}
+	return loadDeviceProfile(nameOrPath, state);
+}
+
+/**
+ * Reads the profile named in ELASTIC_DEVICE_PROFILE. Without it, the runtime is asked.
+ */
+inline deviceProfileState readEnvironmentDeviceProfile() {
+	deviceProfileState state;
+	state.offline = false;
+	state.queried = false;
+	state.caching = true;
+	state.runtimeQueries = 0;
+	state.version = 0;
+	const char* selected = getenv("ELASTIC_DEVICE_PROFILE");
+	if (selected != NULL && selected[0] != '\0' && !selectDeviceProfile(selected, state)) {
+		fprintf(stderr, "ELASTIC_DEVICE_PROFILE: no profile or valid profile file %s, using the device\n", selected);
+		state.offline = false;
+	}
+	return state;
+}
+
+/**
+ * Returns the profile in use, which is selected on the first call
+ */
+inline deviceProfileState& getActiveDeviceProfile() {
+	static deviceProfileState active = readEnvironmentDeviceProfile();
+	return active;
+}
+
+/**
+ * Makes the occupancy tools and the scheduler use a profile instead of the device
+ *
+ * @param nameOrPath the name of a built-in profile or the path of a profile file
+ * @return false if there is no such profile (the one in use is kept)
+ */
+inline bool setActiveDeviceProfile(const std::string& nameOrPath) {
+	deviceProfileState state;
+	if (!selectDeviceProfile(nameOrPath, state)) {
+		return false;
+	}
+	state.queried = false;
+	state.caching = getActiveDeviceProfile().caching;
+	state.runtimeQueries = getActiveDeviceProfile().runtimeQueries;
+	state.version = getActiveDeviceProfile().version + 1;
+	getActiveDeviceProfile() = state;
+	return true;
+}
+
+/**
+ * Goes back to asking the runtime
+ */
+inline void clearActiveDeviceProfile() {
+	getActiveDeviceProfile().offline = false;
+	getActiveDeviceProfile().queried = false;
+	getActiveDeviceProfile().kernels.clear();
+	++getActiveDeviceProfile().version;
+}
+
+/**
+ * Turns the caching of the device properties and the kernel attributes on or off. Turning it
+ * off drops what was cached (but not what a profile holds).
+ *
+ * @param enabled true to query the runtime only once
+ */
+inline void setDeviceQueryCaching(bool enabled) {
+	deviceProfileState& state = getActiveDeviceProfile();
+	state.caching = enabled;
+	if (!enabled && !state.offline) {
+		state.queried = false;
+		state.kernels.clear();
+	}
+}
+
+/**
+ * Returns the number of times the runtime was asked for the device properties or the attributes
+ * of a kernel function
+ */
+inline size_t getNumRuntimeQueries() {
+	return getActiveDeviceProfile().runtimeQueries;
+}
+
+/**
+ * Returns a number that changes whenever another profile (or the device) is selected
+ */
+inline unsigned int getDeviceProfileVersion() {
+	return getActiveDeviceProfile().version;
+}
+
+/**
+ * Tells whether a profile is in use instead of the device
+ */
+inline bool isOfflineDeviceProfile() {
+	return getActiveDeviceProfile().offline;
+}
+
+/**
+ * Returns the properties of the device, from the profile in use if there is one. The runtime is
+ * only asked on the first call.
+ *
+ * @return the properties, valid until the profile is changed
+ */
+inline const cudaDeviceProp& getActiveDeviceProperties() {
+	deviceProfileState& state = getActiveDeviceProfile();
+	if (!state.offline && (!state.queried || !state.caching)) {
+		cudaGetDeviceProperties(&state.props, 0);
+		state.queried = true;
+		++state.runtimeQueries;
+	}
+	return state.props;
+}
+
+/**
+ * Returns the attributes of a kernel function: those the profile in use lists (or the default
+ * ones), or those the runtime returned the first time they were asked for. The
+ * get*KernelProperties() function of every elastic kernel goes through here, so each kernel
+ * function is queried at most once per process, and not at all with a device profile.
+ *
+ * @param function the name of the kernel function
+ * @param query asks the runtime for the attributes
+ * @return the attributes
+ */
+inline cudaFuncAttributes getKernelAttributes(const char* function, cudaFuncAttributes (*query)()) {
+	deviceProfileState& state = getActiveDeviceProfile();
+	if (!state.offline && !state.caching) {
+		++state.runtimeQueries;
+		return query();
+	}
+	std::map<std::string, cudaFuncAttributes>::const_iterator it = state.kernels.find(function);
+	if (it != state.kernels.end()) {
+		return it->second;
+	}
+	if (state.offline) {
+		return getDefaultKernelAttributes();
+	}
+	cudaFuncAttributes attributes = query();
+	++state.runtimeQueries;
+	state.kernels[function] = attributes;
+	return attributes;
+}
+
+/**
+ * Returns the free global memory, less a reserve for paging. With a profile, nothing is in use yet.
+ *
+ * @return the free memory in bytes
+ */
+inline size_t getAvailableDeviceMemory() {
+	size_t total;
+	size_t free;
+	if (isOfflineDeviceProfile()) {
+		free = getActiveDeviceProfile().props.totalGlobalMem;
+	} else {
+		cudaMemGetInfo(&free, &total);
+	}
+	return (free > GPU_MEMORY_RESERVE) ? free - GPU_MEMORY_RESERVE : 0;
+}
+
+/**
+ * Returns the single precision cores of an SM, which the device properties do not have
+ *
+ * @param props the device properties
+ * @return the cores per SM
+ */
+inline int getCoresPerSM(const cudaDeviceProp& props) {
+	if (props.major <= 1) {
+		return 8;
+	}
+	if (props.major == 2) {
+		return (props.minor == 0) ? 32 : 48;
+	}
+	if (props.major == 3) {
+		return 192;
+	}
+	if (props.major == 6 && props.minor == 0) {
+		return 64;
+	}
+	if (props.major == 7 || (props.major == 8 && props.minor == 0)) {
+		return 64;
+	}
+	return 128; // Maxwell, the other Pascals, the other Amperes, Ada and Hopper
+}
+
+/**
+ * Returns the peak bandwidth of the global memory: the memory clock, twice per cycle, times the
+ * width of the bus
+ *
+ * @param props the device properties
+ * @return the bandwidth in bytes per second, 0 if the properties have no memory clock
+ */
+inline double getPeakMemoryBandwidth(const cudaDeviceProp& props) {
+	return 2.0 * props.memoryClockRate * 1000.0 * (props.memoryBusWidth / 8.0);
+}
+
+/**
+ * Returns the peak rate of single precision operations: a fused multiply-add, two operations, per
+ * core and cycle
+ *
+ * @param props the device properties
+ * @return the operations per second, 0 if the properties have no clock
+ */
+inline double getPeakOperationRate(const cudaDeviceProp& props) {
+	return 2.0 * getCoresPerSM(props) * props.multiProcessorCount * props.clockRate * 1000.0;
+}
+
+/**
+ * Prints the built-in profiles
+ */
+inline void printDeviceProfiles() {
+	printf("%-8s %-24s %-5s %5s %9s %9s %8s %8s %8s %8s\n", "id", "name", "cc", "SMs", "thr/SM", "blk/SM", "smem/SM", "mem GiB", "GB/s",
+			"GFLOP/s");
+	for (size_t i = 0; i < NUM_BUILTIN_DEVICE_PROFILES; ++i) {
+		const deviceProfileEntry& entry = BUILTIN_DEVICE_PROFILES[i];
+		cudaDeviceProp props = makeDeviceProfile(entry);
+		printf("%-8s %-24s %d.%-3d %5d %9d %9d %8lu %8.1f %8.0f %8.0f\n", entry.id, entry.name, entry.major, entry.minor,
+				entry.multiProcessorCount, entry.maxThreadsPerMultiProcessor, entry.maxBlocksPerMultiProcessor,
+				(unsigned long) entry.sharedMemPerMultiprocessor, (double) entry.totalGlobalMem / (1 << 30), getPeakMemoryBandwidth(props) / 1e9,
+				getPeakOperationRate(props) / 1e9);
+	}
+}
+
+#endif /* DEVICEPROFILES_H_ */
@@ -17,6 +17,8 @@
 #define OCCUPANCYCALCULATOR_HPP_
 #include "OccupancyData.h"
 #include "OccupancyLimits.h"
+#include "DeviceProfiles.h"
+#include "OccupancyCurve.h"
 #include <cuda_runtime.h>
 #include <iostream>
 #include <cmath>
@@ -30,52 +32,13 @@ struct OccupancyInformation {
 
 /**
  *
- * Function to obtain the hardware configuration information for the device
+ * Function to obtain the hardware configuration information for the device, or for the
+ * device profile in use when there is one. The device is only queried once per process.
  *
  * @return cudaDeviceProp
  */
-inline cudaDeviceProp getGPUProperties() {
-	cudaDeviceProp props;
-	cudaGetDeviceProperties(&props, 0);
-	return props;
-}
-
-/**
- * This function calculates the maximum resident blocks per SM for a particular kernel
- * The function takes into account the limitations imposed by register pressure,
- * shared memory and raw hardware specifications
- *
- * @param deviceProps the properties of the device
- * @param kernelProps the properties of the kernel
- * @param blockSize the block size of the kernel
- *
- * @return maximum active blocks per SM
- */
-inline size_t getMaxResidentBlocksPerSM(const cudaDeviceProp &deviceProps, const cudaFuncAttributes &kernelProps, size_t blockSize) {
-
-	size_t hardwareLimit = getHardwareLimit(deviceProps, blockSize);
-	size_t sMemLimit = getSharedMemLimit(deviceProps, kernelProps);
-	size_t registerLimit = getRegisterLimit(deviceProps, kernelProps, blockSize);
-
-	//std::cout << hardwareLimit << " " << sMemLimit << " " << registerLimit << std::endl;
-
-	return min3(hardwareLimit, sMemLimit, registerLimit);
-}
-
-/**
- * This function retrieves the number of registers that are needed for a block
- *
- * @param deviceProps the device properties
- * @param kernelProps the kernel properties
- * @param blockSize the size of the block
- * @return the number of registers needed per block
- */
-inline size_t getNumRegistersPerBlock(const cudaDeviceProp &deviceProps, const cudaFuncAttributes &kernelProps, size_t blockSize) {
-
-	size_t numerWarpsNeeded = (blockSize + (deviceProps.warpSize - 1)) / deviceProps.warpSize; // we need to devide and round UP to warpsize
-	numerWarpsNeeded = ceilTo(numerWarpsNeeded, getWarpAllocationGranularity(deviceProps)); // again CEIL up to the war allocation granularity, depending on architecture;
-
-	return kernelProps.numRegs * deviceProps.warpSize * numerWarpsNeeded;
+inline const cudaDeviceProp& getGPUProperties() {
+	return getActiveDeviceProperties();
 }
 
 /**
@@ -85,22 +48,25 @@ inline size_t getNumRegistersPerBlock(const cudaDeviceProp &deviceProps, const c
  * @param deviceProps the properties of the device
  * @param kernelProps the kernel properties
  * @param blockSize the blck size for the kernel
+ * @param dynamicSharedMem the shared memory allocated at launch, per block
  * @return
  */
-inline BlockUsage getBlockUsageStats(const cudaDeviceProp &deviceProps, const cudaFuncAttributes &kernelProps, size_t blockSize) {
+inline BlockUsage getBlockUsageStats(const cudaDeviceProp &deviceProps, const cudaFuncAttributes &kernelProps, size_t blockSize,
+		size_t dynamicSharedMem = 0) {
 
 	BlockUsage usage;
 	size_t numThreads = blockSize;
-	size_t blocksPerSM = getMaxResidentBlocksPerSM(deviceProps, kernelProps, blockSize);
+	size_t blocksPerSM = getMaxResidentBlocksPerSM(deviceProps, kernelProps, blockSize, dynamicSharedMem);
 	size_t numRegisters = getNumRegistersPerBlock(deviceProps, kernelProps, blockSize);
-	size_t sharedMemory = getSharedMemNeeded(kernelProps, deviceProps);
+	size_t sharedMemory = getSharedMemNeeded(kernelProps, deviceProps, dynamicSharedMem);
 
 	return BlockUsage(sharedMemory, numThreads, numRegisters, blocksPerSM);
 }
 
 /**
  * Given a limits value and a usage value, this function molds the execution parameters
- * of the block in order to fit it into the limit.
+ * of the block in order to fit it into the limit. A two dimensional grid is scaled down in
+ * both dimensions, so it keeps its shape.
  *
  * @param usagePerBlock the usage value
  * @param limitPerGPU the limit value
@@ -124,6 +90,33 @@ inline void reduceBlocksToFitOnGPU(size_t usagePerBlock, size_t limitPerGPU, Lau
 	}
 }
 
+/**
+ * Given the usage of a block, the resident blocks on the whole GPU, launch parameters and kernel limits,
+ * this function molds the configuration of the kernel in order to fit it into the limits provided.
+ * Those limits are shared memory, registers , total number of threads
+ *
+ * @param usage the resources a block of the launch takes
+ * @param maximumResidentBLocks the blocks of that size that fit on the GPU at once
+ * @param lParams the launch parameters for the kernel
+ * @param limits the limits on the kernel
+ *
+ * @return the molded launch parameters, which ensure that the kernel fits into the limits imposed
+ */
+inline LaunchParameters limitUsage(BlockUsage usage, size_t maximumResidentBLocks, LaunchParameters lParams, KernelLimits limits) {
+	// constructing physical configuration... based on calculated number of blocks :)
+	size_t blocksPhysical = min3(lParams.getBlocksPerGrid(), maximumResidentBLocks, limits.getNumBlocks());
+	LaunchParameters result = lParams; // keeps the shape of the block and the grid, and the dynamic shared memory
+	result.setBlocks(blocksPhysical);
+
+	// now we need to further limit this physical  configuration, which of course is pain
+
+	reduceBlocksToFitOnGPU(usage.getSharedMem(), limits.getSharedMem(), result);
+	reduceBlocksToFitOnGPU(usage.getNumThreads(), limits.getNumThreads(), result);
+	reduceBlocksToFitOnGPU(usage.getNumRegisters(), limits.getNumRegisters(), result);
+
+	return result;
+}
+
 /**
  *
  * Given kernel properties, device properties , launch parameters and kernel limits,
@@ -139,22 +132,25 @@ inline void reduceBlocksToFitOnGPU(size_t usagePerBlock, size_t limitPerGPU, Lau
  */
 inline LaunchParameters limitUsage(const cudaDeviceProp &deviceProps, const cudaFuncAttributes &kernelProps, LaunchParameters lParams, KernelLimits limits) {
 	// we get the occupancy information for the particular block
-	BlockUsage usage = getBlockUsageStats(deviceProps, kernelProps, lParams.getThreadsPerBlock());
+	BlockUsage usage = getBlockUsageStats(deviceProps, kernelProps, lParams.getThreadsPerBlock(), lParams.getDynamicSharedMem());
 	// we calculate the maximum number of resident blocks of this size on the GPU
 	size_t maximumResidentBLocks = usage.getNumBlocksPerSM() * deviceProps.multiProcessorCount;
+	return limitUsage(usage, maximumResidentBLocks, lParams, limits);
+}
 
-	// constructing physical configuration... based on calculated number of blocks :)
-	size_t blocksPhysical = min3(lParams.getBlocksPerGrid(), maximumResidentBLocks, limits.getNumBlocks());
-	size_t threadsPhysical = lParams.getThreadsPerBlock();
-	LaunchParameters result = LaunchParameters(threadsPhysical, blocksPhysical);
-
-	// now we need to further limit this physical  configuration, which of course is pain
-
-	reduceBlocksToFitOnGPU(usage.getSharedMem(), limits.getSharedMem(), result);
-	reduceBlocksToFitOnGPU(usage.getNumThreads(), limits.getNumThreads(), result);
-	reduceBlocksToFitOnGPU(usage.getNumRegisters(), limits.getNumRegisters(), result);
-
-	return result;
+/**
+ * Molds the launch parameters of a kernel to fit into the limits, reading the usage of a block
+ * from the occupancy curve of the kernel
+ *
+ * @param curve the occupancy curve of the kernel on the device
+ * @param lParams the launch parameters for the kernel
+ * @param limits the limits on the kernel
+ *
+ * @return the molded launch parameters
+ */
+inline LaunchParameters limitUsage(const OccupancyCurve& curve, LaunchParameters lParams, KernelLimits limits) {
+	BlockUsage usage = curve.getBlockUsage(lParams.getThreadsPerBlock());
+	return limitUsage(usage, usage.getNumBlocksPerSM() * curve.getNumSMs(), lParams, limits);
 }
 
 /**
@@ -168,9 +164,7 @@ inline LaunchParameters limitUsage(const cudaDeviceProp &deviceProps, const cuda
  */
 inline LaunchParameters limitKernel(boost::shared_ptr<AbstractElasticKernel> kernel, KernelLimits limits) {
 	LaunchParameters params = kernel.get()->getLaunchParams();
-	cudaFuncAttributes attrs = kernel.get()->getKernelProperties();
-	cudaDeviceProp props = getGPUProperties();
-	return limitUsage(props, attrs, params, limits);
+	return limitUsage(getOccupancyCurve(kernel.get()->getKernelProperties(), params), params, limits);
 
 }
 
@@ -183,15 +177,13 @@ inline LaunchParameters limitKernel(boost::shared_ptr<AbstractElasticKernel> ker
  * @return
  */
 inline double getOccupancyForKernel(boost::shared_ptr<AbstractElasticKernel> kernel) {
-	cudaDeviceProp gpuConfiguration = getGPUProperties();
-	size_t max_occupancy = gpuConfiguration.maxThreadsPerMultiProcessor;
-	size_t threadNum = min3(kernel.get()->getKernelProperties().maxThreadsPerBlock, gpuConfiguration.maxThreadsPerMultiProcessor,
+	const cudaDeviceProp& gpuConfiguration = getGPUProperties();
+	cudaFuncAttributes kernelProps = kernel.get()->getKernelProperties();
+	size_t threadNum = min3(kernelProps.maxThreadsPerBlock, gpuConfiguration.maxThreadsPerMultiProcessor,
 			kernel.get()->getLaunchParams().getThreadsPerBlock());
 
-	size_t maxBlocksPerSm = getMaxResidentBlocksPerSM(gpuConfiguration, kernel.get()->getKernelProperties(), threadNum);
-	size_t occupancy = threadNum * maxBlocksPerSm;
-
-	return (double) occupancy / max_occupancy;
+	// a lookup in the curve of the kernel function, which is shared by all its instances
+	return getOccupancyCurve(kernelProps, kernel.get()->getLaunchParams()).getOccupancy(threadNum);
 
 }
 
@@ -204,7 +196,7 @@ inline double getOccupancyForKernel(boost::shared_ptr<AbstractElasticKernel> ker
  * @return the memory occupancy (global memory)
  */
 inline double getMemoryOccupancyForKernel(boost::shared_ptr<AbstractElasticKernel> kernel) {
-	cudaDeviceProp deviceProps = getGPUConfiguration();
+	const cudaDeviceProp& deviceProps = getGPUConfiguration();
 	double totalGPUmem = (double) deviceProps.totalGlobalMem;
 	double result = (double) kernel.get()->getMemoryConsumption() / totalGPUmem;
 
@@ -213,43 +205,16 @@ inline double getMemoryOccupancyForKernel(boost::shared_ptr<AbstractElasticKerne
 
 /**
  *
- * This function applies a brute force iterative approach to finding the optimal threadblock size
- * for a particular kernel based on the kernel characteristics as well as the device hardware
- * capabilities.
+ * This function returns the optimal threadblock size for a particular kernel based on the kernel
+ * characteristics as well as the device hardware capabilities: the largest block size with the
+ * highest theoretical occupancy, as found in the occupancy curve of the kernel (see OccupancyCurve.h).
  *
  * @param kernel a pointer to the kernel.
  * @return
  */
 inline size_t getOptimalBlockSize(boost::shared_ptr<AbstractElasticKernel> kernel) {
-
-	cudaDeviceProp gpuConfiguration = getGPUProperties();
-	size_t maxOccupancy = gpuConfiguration.maxThreadsPerMultiProcessor;
-	size_t largestThrNum = min2(kernel.get()->getKernelProperties().maxThreadsPerBlock, gpuConfiguration.maxThreadsPerMultiProcessor);
-	size_t threadGranularity = gpuConfiguration.warpSize;
-
-	size_t maxBLockSize = 0;
-	size_t highestOcc = 0;
-
-	for (size_t blocksize = largestThrNum; blocksize != 0; blocksize -= threadGranularity) {
-
-		size_t maxBlocksPerSm = getMaxResidentBlocksPerSM(gpuConfiguration, kernel.get()->getKernelProperties(), blocksize);
-		size_t occupancy = blocksize * maxBlocksPerSm;
-
-		//std::cout << "Trying blocksize "  << blocksize << " " << occupancy  << " " << highestOcc  <<  " " << (double)occupancy / max_occupancy << std::endl;
-
-		if (occupancy > highestOcc) {
-			maxBLockSize = blocksize;
-			highestOcc = occupancy;
-		}
-
-		// early out, can't do better
-		if (highestOcc == maxOccupancy)
-			break;
-	}
-	//printf("Blocksize %d\n", highestOcc);
-
-	return maxBLockSize;
-
+	// the search over the block sizes is done once per kernel function, when its curve is computed
+	return getOccupancyCurve(kernel.get()->getKernelProperties(), kernel.get()->getLaunchParams()).getOptimalBlockSize();
 }
 
 #endif /* OCCUPANCYCALCULATOR_HPP_ */
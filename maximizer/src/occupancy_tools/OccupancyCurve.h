@@ -0,0 +1,270 @@
+/**
+ * OccupancyCurve.h
+ *
+ * The occupancy of a kernel function on a device as a function of the block size. The resident
+ * blocks per SM only change with the number of warps in a block, so the curve holds them (and the
+ * registers a block takes) for every block size from one warp up to the largest block the device
+ * runs, along with the block size that gives the highest occupancy. Looking up a block size is
+ * then an index into a table instead of working out the three limits of OccupancyLimits.h.
+ *
+ * A curve depends on the attributes of the kernel function, the device and the dynamic shared
+ * memory of a block (fixed, or a function of the block size), and nothing else, so
+ * getOccupancyCurve() computes it once per kernel function (or rather, per set of attributes,
+ * which functions with the same attributes share) and keeps it until another device profile is
+ * selected. When the dynamic shared memory is a function of the block size, the tables hold it for
+ * whole warps, and block sizes that are not a multiple of the warp size are worked out directly.
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Zahari Dichev <zaharidichev@gmail.com>
+ */
+
+#ifndef OCCUPANCYCURVE_H_
+#define OCCUPANCYCURVE_H_
+
+#include "OccupancyData.h"
+#include "OccupancyLimits.h"
+#include "DeviceProfiles.h"
+#include "../abstract_elastic_kernel/LaunchParameters.hpp"
+#include <cuda_runtime.h>
+#include <vector>
+#include <map>
+#include <algorithm>
+#include <functional>
+
+class OccupancyCurve {
+private:
+	cudaDeviceProp deviceProps;
+	cudaFuncAttributes kernelProps;
+	size_t dynamicSharedMem;
+	DynamicSharedMemFunction dynamicSharedMemFunction;
+	size_t warpSize;
+	std::vector<size_t> residentBlocks; // per SM, by the number of warps in a block
+	std::vector<size_t> registersPerBlock; // by the number of warps in a block
+	std::vector<size_t> sharedMemPerBlock; // static and dynamic, by the number of warps in a block
+	size_t optimalBlockSize;
+	double optimalOccupancy;
+
+	/**
+	 * Returns the index of a block size in the tables, which is past the end for block sizes
+	 * the device does not run
+	 */
+	inline size_t getIndex(size_t blockSize) const {
+		if (this->dynamicSharedMemFunction != NULL && blockSize % this->warpSize != 0) {
+			return this->residentBlocks.size(); // the shared memory is not the one of the whole warps
+		}
+		return (blockSize + this->warpSize - 1) / this->warpSize;
+	}
+
+	/**
+	 * Returns the dynamic shared memory of a block size
+	 */
+	inline size_t getDynamicSharedMem(size_t blockSize) const {
+		return (this->dynamicSharedMemFunction != NULL) ? this->dynamicSharedMemFunction(blockSize) : this->dynamicSharedMem;
+	}
+
+public:
+	/**
+	 * Computes the curve of a kernel function on a device
+	 *
+	 * @param deviceProps the device properties
+	 * @param kernelProps the kernel properties
+	 * @param dynamicSharedMem the shared memory every block allocates at launch, in bytes
+	 * @param dynamicSharedMemFunction gives the dynamic shared memory for a block size instead, if not NULL
+	 */
+	inline OccupancyCurve(const cudaDeviceProp& deviceProps, const cudaFuncAttributes& kernelProps, size_t dynamicSharedMem = 0,
+			DynamicSharedMemFunction dynamicSharedMemFunction = NULL) :
+			deviceProps(deviceProps), kernelProps(kernelProps), dynamicSharedMem(dynamicSharedMem), dynamicSharedMemFunction(
+					dynamicSharedMemFunction) {
+		this->warpSize = (deviceProps.warpSize > 0) ? deviceProps.warpSize : 32;
+
+		size_t largestBlock = std::max(deviceProps.maxThreadsPerBlock, deviceProps.maxThreadsPerMultiProcessor);
+		size_t maxWarps = (largestBlock + this->warpSize - 1) / this->warpSize;
+		this->residentBlocks.resize(maxWarps + 1, 0);
+		this->registersPerBlock.resize(maxWarps + 1, 0);
+		this->sharedMemPerBlock.resize(maxWarps + 1, 0);
+		for (size_t warps = 1; warps <= maxWarps; ++warps) {
+			size_t blockSize = warps * this->warpSize;
+			size_t dynamic = getDynamicSharedMem(blockSize);
+			this->residentBlocks[warps] = getMaxResidentBlocksPerSM(deviceProps, this->kernelProps, blockSize, dynamic);
+			this->registersPerBlock[warps] = getNumRegistersPerBlock(deviceProps, this->kernelProps, blockSize);
+			this->sharedMemPerBlock[warps] = getSharedMemNeeded(this->kernelProps, deviceProps, dynamic);
+		}
+
+		// the largest block size with the highest occupancy, as getOptimalBlockSize() always picked it
+		size_t maxOccupancy = deviceProps.maxThreadsPerMultiProcessor;
+		size_t largestThrNum = min2(this->kernelProps.maxThreadsPerBlock, deviceProps.maxThreadsPerMultiProcessor);
+		size_t highestOcc = 0;
+		this->optimalBlockSize = 0;
+		for (size_t blocksize = largestThrNum; blocksize != 0 && blocksize <= largestThrNum; blocksize -= this->warpSize) {
+			size_t occupancy = blocksize * getResidentBlocks(blocksize);
+			if (occupancy > highestOcc) {
+				this->optimalBlockSize = blocksize;
+				highestOcc = occupancy;
+			}
+			if (highestOcc == maxOccupancy) {
+				break; // can't do better
+			}
+		}
+		this->optimalOccupancy = (maxOccupancy == 0) ? 0 : (double) highestOcc / maxOccupancy;
+	}
+
+	/**
+	 * Returns the resident blocks per SM for a block size
+	 *
+	 * @param blockSize the size of the block
+	 * @return the blocks per SM, 0 if blocks of that size cannot run
+	 */
+	inline size_t getResidentBlocks(size_t blockSize) const {
+		size_t index = getIndex(blockSize);
+		if (index < this->residentBlocks.size()) {
+			return this->residentBlocks[index];
+		}
+		return getMaxResidentBlocksPerSM(this->deviceProps, this->kernelProps, blockSize, getDynamicSharedMem(blockSize));
+	}
+
+	/**
+	 * Returns the fraction of the threads of an SM that blocks of a size keep busy
+	 *
+	 * @param blockSize the size of the block
+	 * @return the occupancy, from 0 to 1
+	 */
+	inline double getOccupancy(size_t blockSize) const {
+		if (this->deviceProps.maxThreadsPerMultiProcessor <= 0) {
+			return 0;
+		}
+		return (double) (blockSize * getResidentBlocks(blockSize)) / this->deviceProps.maxThreadsPerMultiProcessor;
+	}
+
+	/**
+	 * Returns the registers a block takes, rounded up to the allocation unit
+	 *
+	 * @param blockSize the size of the block
+	 * @return the number of registers
+	 */
+	inline size_t getRegistersPerBlock(size_t blockSize) const {
+		size_t index = getIndex(blockSize);
+		if (index < this->registersPerBlock.size()) {
+			return this->registersPerBlock[index];
+		}
+		return getNumRegistersPerBlock(this->deviceProps, this->kernelProps, blockSize);
+	}
+
+	/**
+	 * Returns the shared memory a block takes, static and dynamic, rounded up to the allocation unit
+	 *
+	 * @param blockSize the size of the block
+	 * @return the bytes per block
+	 */
+	inline size_t getSharedMemPerBlock(size_t blockSize) const {
+		size_t index = getIndex(blockSize);
+		if (index < this->sharedMemPerBlock.size()) {
+			return this->sharedMemPerBlock[index];
+		}
+		return getSharedMemNeeded(this->kernelProps, this->deviceProps, getDynamicSharedMem(blockSize));
+	}
+
+	/**
+	 * Returns the resources a block of a size takes, as getBlockUsageStats() does
+	 *
+	 * @param blockSize the size of the block
+	 * @return the block usage
+	 */
+	inline BlockUsage getBlockUsage(size_t blockSize) const {
+		return BlockUsage(getSharedMemPerBlock(blockSize), blockSize, getRegistersPerBlock(blockSize), getResidentBlocks(blockSize));
+	}
+
+	/**
+	 * Returns the largest block size with the highest occupancy
+	 */
+	inline size_t getOptimalBlockSize() const {
+		return this->optimalBlockSize;
+	}
+
+	/**
+	 * Returns the occupancy of the optimal block size
+	 */
+	inline double getOptimalOccupancy() const {
+		return this->optimalOccupancy;
+	}
+
+	/**
+	 * Returns the number of SMs of the device the curve is for
+	 */
+	inline size_t getNumSMs() const {
+		return this->deviceProps.multiProcessorCount;
+	}
+};
+
+/**
+ * What a curve depends on besides the device
+ */
+struct occupancyCurveKey {
+	int numRegs;
+	size_t sharedSizeBytes;
+	int maxThreadsPerBlock;
+	size_t dynamicSharedMem;
+	DynamicSharedMemFunction dynamicSharedMemFunction;
+
+	inline bool operator<(const occupancyCurveKey& other) const {
+		if (this->numRegs != other.numRegs) {
+			return this->numRegs < other.numRegs;
+		}
+		if (this->sharedSizeBytes != other.sharedSizeBytes) {
+			return this->sharedSizeBytes < other.sharedSizeBytes;
+		}
+		if (this->maxThreadsPerBlock != other.maxThreadsPerBlock) {
+			return this->maxThreadsPerBlock < other.maxThreadsPerBlock;
+		}
+		if (this->dynamicSharedMem != other.dynamicSharedMem) {
+			return this->dynamicSharedMem < other.dynamicSharedMem;
+		}
+		return std::less<DynamicSharedMemFunction>()(this->dynamicSharedMemFunction, other.dynamicSharedMemFunction);
+	}
+};
+
+/**
+ * The curves computed for the device profile in use
+ */
+struct occupancyCurveCache {
+	unsigned int profileVersion;
+	std::map<occupancyCurveKey, OccupancyCurve> curves;
+};
+
+/**
+ * Returns the curve of a kernel function on the device (or the device profile in use), which is
+ * computed on the first call and kept until another profile is selected
+ *
+ * @param kernelProps the kernel properties
+ * @param dynamicSharedMem the shared memory every block allocates at launch, in bytes
+ * @param dynamicSharedMemFunction gives the dynamic shared memory for a block size instead, if not NULL
+ * @return the curve
+ */
+inline const OccupancyCurve& getOccupancyCurve(const cudaFuncAttributes& kernelProps, size_t dynamicSharedMem = 0,
+		DynamicSharedMemFunction dynamicSharedMemFunction = NULL) {
+	static occupancyCurveCache cache = { getDeviceProfileVersion(), std::map<occupancyCurveKey, OccupancyCurve>() };
+	if (cache.profileVersion != getDeviceProfileVersion()) {
+		cache.curves.clear();
+		cache.profileVersion = getDeviceProfileVersion();
+	}
+	occupancyCurveKey key = { kernelProps.numRegs, kernelProps.sharedSizeBytes, kernelProps.maxThreadsPerBlock, dynamicSharedMem,
+			dynamicSharedMemFunction };
+	std::map<occupancyCurveKey, OccupancyCurve>::iterator it = cache.curves.find(key);
+	if (it == cache.curves.end()) {
+		OccupancyCurve curve(getActiveDeviceProperties(), kernelProps, dynamicSharedMem, dynamicSharedMemFunction);
+		it = cache.curves.insert(std::make_pair(key, curve)).first;
+	}
+	return it->second;
+}
+
+/**
+ * Returns the curve of a kernel function with the dynamic shared memory of its launch parameters
+ *
+ * @param kernelProps the kernel properties
+ * @param params the launch parameters
+ * @return the curve
+ */
+inline const OccupancyCurve& getOccupancyCurve(const cudaFuncAttributes& kernelProps, const LaunchParameters& params) {
+	return getOccupancyCurve(kernelProps, params.getFixedDynamicSharedMem(), params.getDynamicSharedMemFunction());
+}
+
+#endif /* OCCUPANCYCURVE_H_ */
@@ -11,11 +11,11 @@
 
 #ifndef OCCUPANCYDATA_HPP_
 #define OCCUPANCYDATA_HPP_
-#define MAX_BLOCKS_PER_SM 8
 #include "stdio.h"
 #include <iostream>
 #include <cmath>
 #include "cuda_runtime.h"
+#include "OccupancyUtils.h"
 
 /**
  * This class stores the amount of resources that are used by a particular block of
@@ -124,11 +124,12 @@ public:
 	 * @param GPUConf .. the GPU configuration for the particular card
 	 */
 	inline KernelLimits(double shMemFrac, double threadsFrac, double regsFrac, double blocksFrac, const cudaDeviceProp& GPUConf) {
-		// constructing limits based on data provided by the GPU hardware characteristics
-		this->sharedMem = roundToSize_t((GPUConf.sharedMemPerBlock * GPUConf.multiProcessorCount) * shMemFrac);
-		this->threads = roundToSize_t((GPUConf.maxThreadsPerMultiProcessor * GPUConf.multiProcessorCount) * threadsFrac);
-		this->registers = roundToSize_t(((GPUConf.regsPerBlock * GPUConf.multiProcessorCount) * regsFrac));
-		this->blocks = roundToSize_t(((GPUConf.maxThreadsPerBlock * MAX_BLOCKS_PER_SM * GPUConf.multiProcessorCount) * blocksFrac));
+		// constructing limits based on data provided by the GPU hardware characteristics (per SM, not per block)
+		SMResources resources = getSMResources(GPUConf);
+		this->sharedMem = roundToSize_t(((double) resources.sharedMem * GPUConf.multiProcessorCount) * shMemFrac);
+		this->threads = roundToSize_t(((double) GPUConf.maxThreadsPerMultiProcessor * GPUConf.multiProcessorCount) * threadsFrac);
+		this->registers = roundToSize_t((((double) resources.registers * GPUConf.multiProcessorCount) * regsFrac));
+		this->blocks = roundToSize_t((((double) resources.maxBlocks * GPUConf.multiProcessorCount) * blocksFrac));
 
 	}
 
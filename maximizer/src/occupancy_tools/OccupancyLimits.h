@@ -22,7 +22,7 @@
  * returns the maximum number of active blocks of this particular configuration for the particular
  * kernel per SM. This function take into consideration the limit that is imposed by the register count.
  * The implementation takes into account the different ways resources are allocated for different
- * architectures. This function should work properly no matter the GPU model.
+ * architectures (see getSMResources()). This function should work properly no matter the GPU model.
  *
  * @param deviceProps the device properties
  * @param kernelProps the kernel properties
@@ -36,8 +36,9 @@ inline size_t getRegisterLimit(const cudaDeviceProp &deviceProps, const cudaFunc
 	 */
 
 	// we first get the register allocation granularity and the warp allocation one
-	size_t registerAlocationGranularity = getRegisterAllocationGranularity(deviceProps);
-	size_t warpAllocationGranularity = (deviceProps.major > 1) ? 1 : 2;
+	SMResources resources = getSMResources(deviceProps);
+	size_t registerAlocationGranularity = resources.registerAllocationUnit;
+	size_t warpAllocationGranularity = resources.warpAllocationGranularity;
 
 	/*
 	 * We here calculate the number of warps needed for this number of threads per CTA.
@@ -50,45 +51,41 @@ inline size_t getRegisterLimit(const cudaDeviceProp &deviceProps, const cudaFunc
 	 */
 	numerWarpsNeeded = ceilTo(numerWarpsNeeded, warpAllocationGranularity); // again CEIL up to the war allocation granularity, depending on architecture;
 
+	if (kernelProps.numRegs <= 0) {
+		// if we do not need any registers, simply set the max to the max of blocks per SM
+		return resources.maxBlocks;
+	}
+	if (kernelProps.numRegs > resources.maxRegistersPerThread || numerWarpsNeeded == 0) {
+		return 0; // such a kernel cannot be launched
+	}
+
 	size_t maxBlocksRegisterLimit = 0;
 
-	if (deviceProps.major <= 1) {
+	if (resources.registersPerBlock) {
 		/*
 		 * We know that devices of compute capability of 1.x allocate registers per block.
 		 * THerefore, number of registers per block would be the number of warps times
 		 * times the num of registers per thread, all of that CEILED up to the register
-		 * allocation size.
+		 * allocation size. The available registers are those of the whole SM.
 		 */
 		size_t registersNeeded = kernelProps.numRegs * deviceProps.warpSize * numerWarpsNeeded;
 		registersNeeded = ceilTo(registersNeeded, registerAlocationGranularity);
-		if (registersNeeded > 0) {
-			/*if the needed registers is more than 0  we get the limit of maximum blocks
-			 *with respect to the register pressure, simply by dividing the avaible
-			 *registers per block by the number of registers we need to see how many
-			 *we can fit in.
-			 *
-			 */
-
-			maxBlocksRegisterLimit = deviceProps.regsPerBlock / registersNeeded;
-		} else {
-			// if we do not need any registers, simply set the max to the max of blocks per SM
-			maxBlocksRegisterLimit = getMaxSMBlocks(deviceProps);
-		}
+		maxBlocksRegisterLimit = resources.registers / registersNeeded;
 	} else {
 		/*
 		 * In case our device is of higher compute capability than one, we need to consider that
 		 * registers are allocated per warps. So the number of registers per warp would be the number of
 		 * registers per thread * number of threads per warp  CEILED_UP to the register
-		 * allocation unit
+		 * allocation unit. The register file of the SM (not the per block limit) is split between
+		 * the warp schedulers and a warp takes its registers from the part of one scheduler.
 		 */
 		size_t registersPerWarp = ceilTo(kernelProps.numRegs * deviceProps.warpSize, registerAlocationGranularity);
-		size_t numberOfWarpSchedulersPerSM = getNumWarpSchedulers(deviceProps); // depending on architecture (Kepler has a quad warp scheduler)
-		size_t registersPerScheduler = deviceProps.regsPerBlock / numberOfWarpSchedulersPerSM;
-		if (registersPerWarp > 0) {
-			maxBlocksRegisterLimit = ((registersPerScheduler / registersPerWarp) * numberOfWarpSchedulersPerSM) / numerWarpsNeeded;
-		} else {
-			maxBlocksRegisterLimit = getMaxSMBlocks(deviceProps);
+		if (registersPerWarp * numerWarpsNeeded > (size_t) resources.maxRegistersPerBlock) {
+			return 0; // the block does not fit within the registers a single block may have
 		}
+		size_t numberOfWarpSchedulersPerSM = resources.registerPartitions;
+		size_t registersPerScheduler = resources.registers / numberOfWarpSchedulersPerSM;
+		maxBlocksRegisterLimit = ((registersPerScheduler / registersPerWarp) * numberOfWarpSchedulersPerSM) / numerWarpsNeeded;
 	}
 	return maxBlocksRegisterLimit;
 
@@ -100,22 +97,27 @@ inline size_t getRegisterLimit(const cudaDeviceProp &deviceProps, const cudaFunc
  *
  * @param deviceProps the device properties
  * @param kernelProps the kernel properties
+ * @param dynamicSharedMem the shared memory allocated at launch, per block
  * @return max number of active blocks per SM
  */
-inline size_t getSharedMemLimit(const cudaDeviceProp &deviceProps, const cudaFuncAttributes &kernelProps) {
+inline size_t getSharedMemLimit(const cudaDeviceProp &deviceProps, const cudaFuncAttributes &kernelProps, size_t dynamicSharedMem = 0) {
 
 	/*
 	 * Now we need to consider how many blocks can we really have active due to the limit of our shared memory that is requested.
 	 */
 
-	size_t sharedMemoryNeeded = getSharedMemNeeded(kernelProps, deviceProps);
+	SMResources resources = getSMResources(deviceProps);
+	size_t sharedMemoryNeeded = getSharedMemNeeded(kernelProps, deviceProps, dynamicSharedMem);
 
 	size_t maxBlocksSMLimit = 0; // now we are ready to check out limit posed by shared memory
-	if (sharedMemoryNeeded > 0) {
-		maxBlocksSMLimit = deviceProps.sharedMemPerBlock / sharedMemoryNeeded;
+	if (sharedMemoryNeeded > (size_t) (resources.maxSharedMemPerBlock + resources.reservedSharedMemPerBlock)) {
+		maxBlocksSMLimit = 0; // more than a single block may have
+	} else if (sharedMemoryNeeded > 0) {
+		// the shared memory of the whole SM is shared by its resident blocks
+		maxBlocksSMLimit = resources.sharedMem / sharedMemoryNeeded;
 	} else {
 		// else we know we do not have any limit on that, so we set the max to be the maximum num of active blocks per SM
-		maxBlocksSMLimit = getMaxSMBlocks(deviceProps);
+		maxBlocksSMLimit = resources.maxBlocks;
 	}
 
 	return maxBlocksSMLimit;
@@ -137,14 +139,9 @@ inline size_t getHardwareLimit(const cudaDeviceProp &deviceProps, size_t blockSi
 	 * size N per SM....
 	 */
 
-	// we first need the maximum number of resident threads per SM
-	size_t maximumThreadsPerMultiprocessor = deviceProps.maxThreadsPerMultiProcessor;
-
-	/*we also determine the maximum resident blocks per SM. On
-	 *architectures that are newer than 2.0 CC, we have 16 maximum
-	 *architectures  resident blocks per SM, otherwise 8
-	 */
-	size_t maxBlocksPerMultiprocessor = (deviceProps.major > 2) ? 16 : 8;
+	// we first need the maximum number of resident warps and blocks per SM, which depend on the architecture
+	SMResources resources = getSMResources(deviceProps);
+	size_t maxBlocksPerMultiprocessor = resources.maxBlocks;
 
 	/*
 	 * now we simply need to obtain the limit active blocks per SM with
@@ -152,11 +149,12 @@ inline size_t getHardwareLimit(const cudaDeviceProp &deviceProps, size_t blockSi
 	 */
 
 	size_t threadCountLimit = 0;
-	if (blockSize > deviceProps.maxThreadsPerBlock) {
+	if (blockSize == 0 || blockSize > deviceProps.maxThreadsPerBlock) {
 		threadCountLimit = 0; // obviously if we have more threads per block than the device allows, we cannot run any blocks....
 	} else {
-		//if this is not the case
-		threadCountLimit = maximumThreadsPerMultiprocessor / blockSize; // we simply see how many blocks of this size will fit on an SM
+		// if this is not the case we see how many blocks of this size will fit on an SM; a block takes whole warps
+		size_t warpsPerBlock = ceilTo((blockSize + deviceProps.warpSize - 1) / deviceProps.warpSize, resources.warpAllocationGranularity);
+		threadCountLimit = resources.maxWarps / warpsPerBlock;
 	}
 
 	/*
@@ -167,4 +165,28 @@ inline size_t getHardwareLimit(const cudaDeviceProp &deviceProps, size_t blockSi
 	return maxBlocksDeviceLimit;
 }
 
+/**
+ * This function calculates the maximum resident blocks per SM for a particular kernel
+ * The function takes into account the limitations imposed by register pressure,
+ * shared memory and raw hardware specifications
+ *
+ * @param deviceProps the properties of the device
+ * @param kernelProps the properties of the kernel
+ * @param blockSize the block size of the kernel
+ * @param dynamicSharedMem the shared memory allocated at launch, per block
+ *
+ * @return maximum active blocks per SM
+ */
+inline size_t getMaxResidentBlocksPerSM(const cudaDeviceProp &deviceProps, const cudaFuncAttributes &kernelProps, size_t blockSize,
+		size_t dynamicSharedMem = 0) {
+
+	size_t hardwareLimit = getHardwareLimit(deviceProps, blockSize);
+	size_t sMemLimit = getSharedMemLimit(deviceProps, kernelProps, dynamicSharedMem);
+	size_t registerLimit = getRegisterLimit(deviceProps, kernelProps, blockSize);
+
+	//std::cout << hardwareLimit << " " << sMemLimit << " " << registerLimit << std::endl;
+
+	return min3(hardwareLimit, sMemLimit, registerLimit);
+}
+
 #endif /* OCCUPANCYLIMITS_HPP_ */
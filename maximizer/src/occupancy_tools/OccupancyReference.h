@@ -0,0 +1,97 @@
+/**
+ * OccupancyReference.h
+ *
+ * Launch configurations with the number of resident blocks per SM that the CUDA occupancy
+ * calculator gives for them, one or more per architecture, and a check of the resource model of
+ * OccupancyUtils.h and OccupancyLimits.h against them (--plan --validate). Every case names the
+ * limit that decides it, so a wrong row of the resource table shows up as the case that breaks.
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Zahari Dichev <zaharidichev@gmail.com>
+ */
+
+#ifndef OCCUPANCYREFERENCE_H_
+#define OCCUPANCYREFERENCE_H_
+
+#include "OccupancyLimits.h"
+#include "DeviceProfiles.h"
+#include <stdio.h>
+
+/**
+ * A launch configuration and what the occupancy calculator gives for it
+ */
+struct occupancyReferenceCase {
+	const char* device; // a built-in device profile
+	int blockSize;
+	int numRegs;
+	int sharedSizeBytes; // static shared memory per block
+	int residentBlocks; // blocks per SM
+	const char* limiter;
+};
+
+static const occupancyReferenceCase OCCUPANCY_REFERENCE_CASES[] = {
+		{ "c2050", 256, 20, 0, 6, "warps" },
+		{ "c2050", 128, 32, 12288, 4, "shared memory" },
+		{ "c2050", 256, 40, 0, 3, "registers" },
+		{ "gtx680", 128, 32, 0, 16, "blocks" },
+		{ "k40", 192, 63, 0, 5, "registers" },
+		{ "k40", 64, 16, 0, 16, "blocks" },
+		{ "gtx980", 32, 16, 0, 32, "blocks" },
+		{ "gtx980", 256, 32, 16384, 6, "shared memory" },
+		{ "p100", 256, 40, 0, 6, "registers" },
+		{ "p100", 128, 32, 0, 16, "warps" },
+		{ "v100", 256, 32, 0, 8, "warps" },
+		{ "v100", 256, 64, 0, 4, "registers" },
+		{ "t4", 1024, 32, 0, 1, "warps" },
+		{ "t4", 64, 32, 0, 16, "blocks" },
+		{ "a100", 128, 32, 49152, 3, "shared memory" },
+		{ "a100", 96, 168, 0, 4, "registers" },
+		{ "rtx3090", 128, 32, 0, 12, "warps" },
+		{ "l4", 32, 32, 0, 24, "blocks" },
+		{ "h100", 64, 128, 0, 8, "registers" },
+		{ "h100", 1024, 64, 0, 1, "registers" },
+		{ "h100", 256, 255, 0, 1, "registers" },
+		{ "h100", 1024, 128, 0, 0, "registers" } };
+
+#define NUM_OCCUPANCY_REFERENCE_CASES (sizeof(OCCUPANCY_REFERENCE_CASES) / sizeof(occupancyReferenceCase))
+
+/**
+ * Checks the resident blocks per SM of the occupancy model against the reference cases and
+ * prints the cases that differ
+ *
+ * @param verbose print every case, not only the ones that differ
+ * @return the number of cases that differ
+ */
+inline int validateOccupancyModel(bool verbose) {
+	int mismatches = 0;
+	for (size_t i = 0; i < NUM_OCCUPANCY_REFERENCE_CASES; ++i) {
+		const occupancyReferenceCase& reference = OCCUPANCY_REFERENCE_CASES[i];
+		cudaDeviceProp props;
+		if (!findDeviceProfile(reference.device, props)) {
+			fprintf(stderr, "No device profile %s\n", reference.device);
+			++mismatches;
+			continue;
+		}
+		cudaFuncAttributes attributes = getDefaultKernelAttributes();
+		attributes.numRegs = reference.numRegs;
+		attributes.sharedSizeBytes = reference.sharedSizeBytes;
+
+		size_t hardware = getHardwareLimit(props, reference.blockSize);
+		size_t sharedMem = getSharedMemLimit(props, attributes);
+		size_t registers = getRegisterLimit(props, attributes, reference.blockSize);
+		size_t blocks = min3(hardware, sharedMem, registers);
+		bool matches = (blocks == (size_t) reference.residentBlocks);
+		if (!matches) {
+			++mismatches;
+		}
+		if (verbose || !matches) {
+			printf("%-8s block %4d regs %3d smem %6d: %2lu blocks/SM (expected %2d, %s limited; hardware %lu, smem %lu, regs %lu)%s\n",
+					reference.device, reference.blockSize, reference.numRegs, reference.sharedSizeBytes, (unsigned long) blocks,
+					reference.residentBlocks, reference.limiter, (unsigned long) hardware, (unsigned long) sharedMem, (unsigned long) registers,
+					matches ? "" : " MISMATCH");
+		}
+	}
+	return mismatches;
+}
+
+#endif /* OCCUPANCYREFERENCE_H_ */
@@ -13,16 +13,6 @@
 #pragma once
 #include <cuda_runtime.h>
 
-/**
- * Returns the warp allocation granularity depending on the architecture of the device
- *
- * @param properties cudaDeviceProp device properties
- * @return the warp allocation granularity
- */
-inline size_t getWarpAllocationGranularity(const cudaDeviceProp &properties) {
-	return (properties.major <= 1) ? 2 : 1;
-}
-
 /**
  * Returns the minimum of two numbers
  *
@@ -74,6 +64,109 @@ inline int floorTo(int x, int y) {
 	return y * (x / y);
 }
 
+/**
+ * The resources of a streaming multiprocessor and the units they are allocated in, for one
+ * compute capability, as the CUDA occupancy calculator lists them
+ */
+struct SMResources {
+	int major;
+	int minor;
+	int maxWarps; // resident warps
+	int maxBlocks; // resident blocks
+	int registers; // 32-bit registers
+	int maxRegistersPerBlock;
+	int maxRegistersPerThread;
+	int registerAllocationUnit;
+	bool registersPerBlock; // 1.x allocates the registers of a whole block at once, later parts per warp
+	int registerPartitions; // the parts of the register file, one per warp scheduler; a warp takes its registers from one
+	int warpAllocationGranularity; // 1.x allocates warps in pairs
+	int sharedMem; // bytes, with the largest carveout
+	int maxSharedMemPerBlock; // bytes, with opt-in
+	int sharedMemAllocationUnit;
+	int reservedSharedMemPerBlock; // bytes the system takes from every block
+};
+
+static const SMResources SM_RESOURCE_TABLE[] = {
+		{ 1, 0, 24, 8, 8192, 8192, 124, 256, true, 1, 2, 16384, 16384, 512, 0 },
+		{ 1, 2, 32, 8, 16384, 16384, 124, 512, true, 1, 2, 16384, 16384, 512, 0 },
+		{ 2, 0, 48, 8, 32768, 32768, 63, 64, false, 2, 1, 49152, 49152, 128, 0 },
+		{ 3, 0, 64, 16, 65536, 65536, 63, 256, false, 4, 1, 49152, 49152, 256, 0 },
+		{ 3, 2, 64, 16, 65536, 65536, 255, 256, false, 4, 1, 49152, 49152, 256, 0 },
+		{ 3, 7, 64, 16, 131072, 65536, 255, 256, false, 4, 1, 114688, 49152, 256, 0 },
+		{ 5, 0, 64, 32, 65536, 65536, 255, 256, false, 4, 1, 65536, 49152, 256, 0 },
+		{ 5, 2, 64, 32, 65536, 65536, 255, 256, false, 4, 1, 98304, 49152, 256, 0 },
+		{ 5, 3, 64, 32, 65536, 32768, 255, 256, false, 4, 1, 65536, 49152, 256, 0 },
+		{ 6, 0, 64, 32, 65536, 65536, 255, 256, false, 2, 1, 65536, 49152, 256, 0 },
+		{ 6, 1, 64, 32, 65536, 65536, 255, 256, false, 4, 1, 98304, 49152, 256, 0 },
+		{ 6, 2, 64, 32, 65536, 32768, 255, 256, false, 4, 1, 65536, 49152, 256, 0 },
+		{ 7, 0, 64, 32, 65536, 65536, 255, 256, false, 4, 1, 98304, 98304, 256, 0 },
+		{ 7, 5, 32, 16, 65536, 65536, 255, 256, false, 4, 1, 65536, 65536, 256, 0 },
+		{ 8, 0, 64, 32, 65536, 65536, 255, 256, false, 4, 1, 167936, 166912, 128, 1024 },
+		{ 8, 6, 48, 16, 65536, 65536, 255, 256, false, 4, 1, 102400, 101376, 128, 1024 },
+		{ 8, 7, 48, 16, 65536, 65536, 255, 256, false, 4, 1, 167936, 166912, 128, 1024 },
+		{ 8, 9, 48, 24, 65536, 65536, 255, 256, false, 4, 1, 102400, 101376, 128, 1024 },
+		{ 9, 0, 64, 32, 65536, 65536, 255, 256, false, 4, 1, 233472, 232448, 128, 1024 } };
+
+#define SM_RESOURCE_TABLE_SIZE (sizeof(SM_RESOURCE_TABLE) / sizeof(SMResources))
+
+/**
+ * Returns the resources of a multiprocessor of a device. The row of the table is the one of the
+ * compute capability, or of the closest older one (so 7.2 gets the row of 7.0 and an unknown newer
+ * part the row of the newest). The capacities the device reports itself (threads, registers and
+ * shared memory per SM, blocks per SM, reserved shared memory) replace those of the table.
+ *
+ * @param devProps the device properties
+ * @return the resources
+ */
+inline SMResources getSMResources(const cudaDeviceProp &devProps) {
+	size_t row = 0;
+	for (size_t i = 0; i < SM_RESOURCE_TABLE_SIZE; ++i) {
+		const SMResources& entry = SM_RESOURCE_TABLE[i];
+		if (entry.major < devProps.major || (entry.major == devProps.major && entry.minor <= devProps.minor)) {
+			row = i;
+		}
+	}
+	SMResources resources = SM_RESOURCE_TABLE[row];
+	if (devProps.maxThreadsPerMultiProcessor > 0 && devProps.warpSize > 0) {
+		resources.maxWarps = devProps.maxThreadsPerMultiProcessor / devProps.warpSize;
+	}
+	if (devProps.major >= 2 && devProps.regsPerBlock > 0) {
+		resources.maxRegistersPerBlock = devProps.regsPerBlock;
+	}
+#if CUDART_VERSION >= 6000
+	if (devProps.regsPerMultiprocessor > 0) {
+		resources.registers = devProps.regsPerMultiprocessor;
+	}
+	if (devProps.sharedMemPerMultiprocessor > 0) {
+		resources.sharedMem = (int) devProps.sharedMemPerMultiprocessor;
+	}
+#endif
+#if CUDART_VERSION >= 9000
+	if (devProps.sharedMemPerBlockOptin > 0) {
+		resources.maxSharedMemPerBlock = (int) devProps.sharedMemPerBlockOptin;
+	}
+#endif
+#if CUDART_VERSION >= 11000
+	if (devProps.maxBlocksPerMultiProcessor > 0) {
+		resources.maxBlocks = devProps.maxBlocksPerMultiProcessor;
+	}
+	if (devProps.major >= 8) {
+		resources.reservedSharedMemPerBlock = (int) devProps.reservedSharedMemPerBlock;
+	}
+#endif
+	return resources;
+}
+
+/**
+ * Returns the warp allocation granularity depending on the architecture of the device
+ *
+ * @param properties cudaDeviceProp device properties
+ * @return the warp allocation granularity
+ */
+inline size_t getWarpAllocationGranularity(const cudaDeviceProp &properties) {
+	return getSMResources(properties).warpAllocationGranularity;
+}
+
 /**
  * Depending on the particular GPU architecture, returns the shared memory allocation granularity
  * @param devProps the device configuration
@@ -86,27 +179,18 @@ inline size_t getsharedMemoryGranularity(const cudaDeviceProp &devProps) {
 	 * in batches of certain size. We need to know this size
 	 * in order to round up to it.
 	 */
-	switch (devProps.major) {
-	case 1:
-		return 512;
-	case 2:
-		return 128;
-	case 3:
-		return 256;
-	default:
-		return 128;
-	}
+	return getSMResources(devProps).sharedMemAllocationUnit;
 }
 
 /**
- * Returns the numebr of warp schedulers per SM
+ * Returns the numebr of warp schedulers per SM, each of which has its own part of the register file
  *
  * @param devProps
  * @return
  */
 // number of "sides" into which the multiprocessor is partitioned
 inline size_t getNumWarpSchedulers(const cudaDeviceProp &devProps) {
-	return (devProps.major < 3) ? devProps.major : 4;
+	return getSMResources(devProps).registerPartitions;
 
 }
 
@@ -117,7 +201,7 @@ inline size_t getNumWarpSchedulers(const cudaDeviceProp &devProps) {
  * @return
  */
 inline size_t getMaxSMBlocks(const cudaDeviceProp &devProps) {
-	return (devProps.major > 2) ? 16 : 8;
+	return getSMResources(devProps).maxBlocks;
 }
 
 /**
@@ -128,32 +212,46 @@ inline size_t getMaxSMBlocks(const cudaDeviceProp &devProps) {
  */
 // granularity of register allocation
 inline size_t getRegisterAllocationGranularity(const cudaDeviceProp &devProps) {
-	switch (devProps.major) {
-	case 1:
-		return (devProps.minor <= 1) ? 256 : 512;
-	case 2:
-		return 64;
-
-		/* no break */
-	case 3:
-		return 256;
-	default:
-		return 256; // unknown GPU; have to guess
-	}
+	return getSMResources(devProps).registerAllocationUnit;
 }
 
 /**
  * Returns the shared memory needed by a particular kernel (per thread block)
  * @param kernelProps
  * @param deviceProps
+ * @param dynamicSharedMem the shared memory allocated at launch, per block
  * @return
  */
-inline size_t getSharedMemNeeded(const cudaFuncAttributes &kernelProps, const cudaDeviceProp &deviceProps) {
+inline size_t getSharedMemNeeded(const cudaFuncAttributes &kernelProps, const cudaDeviceProp &deviceProps, size_t dynamicSharedMem = 0) {
 
-	// first we need to get the exact number of bytes statically allocated by the kernel (per block..)
-	size_t sharedMemoryNeeded = kernelProps.sharedSizeBytes;
-	size_t gran = getsharedMemoryGranularity(deviceProps); // we after that get the shared memory allocation granularity
-	sharedMemoryNeeded = ceilTo(sharedMemoryNeeded, gran); // we now need to CEIL up to a multiple of that number
+	// first we need to get the exact number of bytes statically allocated by the kernel (per block..) and those allocated at launch
+	size_t sharedMemoryNeeded = kernelProps.sharedSizeBytes + dynamicSharedMem;
+	SMResources resources = getSMResources(deviceProps);
+	// since 8.0 the system reserves some shared memory in every block
+	sharedMemoryNeeded += resources.reservedSharedMemPerBlock;
+	sharedMemoryNeeded = ceilTo(sharedMemoryNeeded, resources.sharedMemAllocationUnit); // we now need to CEIL up to a multiple of the allocation granularity
 	return sharedMemoryNeeded;
 }
+
+/**
+ * This function retrieves the number of registers that are needed for a block
+ *
+ * @param deviceProps the device properties
+ * @param kernelProps the kernel properties
+ * @param blockSize the size of the block
+ * @return the number of registers needed per block
+ */
+inline size_t getNumRegistersPerBlock(const cudaDeviceProp &deviceProps, const cudaFuncAttributes &kernelProps, size_t blockSize) {
+
+	size_t numerWarpsNeeded = (blockSize + (deviceProps.warpSize - 1)) / deviceProps.warpSize; // we need to devide and round UP to warpsize
+	numerWarpsNeeded = ceilTo(numerWarpsNeeded, getWarpAllocationGranularity(deviceProps)); // again CEIL up to the war allocation granularity, depending on architecture;
+
+	// registers are given out in units, per warp (or per block on 1.x)
+	size_t granularity = getRegisterAllocationGranularity(deviceProps);
+	if (getSMResources(deviceProps).registersPerBlock) {
+		return ceilTo(kernelProps.numRegs * deviceProps.warpSize * numerWarpsNeeded, granularity);
+	}
+	return ceilTo(kernelProps.numRegs * deviceProps.warpSize, granularity) * numerWarpsNeeded;
+}
+
 #endif /* OCCUPANCYUTILS_HPP_ */
@@ -0,0 +1,219 @@
+/**
+ * ResourcePartitioning.h
+ *
+ * Splits the resources of the device among kernels that run at the same time according to what
+ * each of them asks for, instead of giving every kernel an equal share of every resource. The
+ * demand of a kernel is what its launch configuration takes when it has the device to itself:
+ * the blocks of its grid that fit on the device at once, times the shared memory, threads and
+ * registers of a block.
+ *
+ * Since a kernel only grows or shrinks by whole blocks, its shares of the four resources move
+ * together, so the split is max-min fair on the dominant share of every kernel (the largest
+ * fraction of a resource of the device its blocks take). The dominant shares are raised together
+ * until a resource of the device runs out, and a kernel whose demand is met stops there, leaving
+ * what it does not need to the others. With kernels that all ask for more than an equal share of
+ * the same resource, this is the equal split; a register-heavy kernel next to a light one gets the
+ * registers the light one leaves.
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Zahari Dichev <zaharidichev@gmail.com>
+ */
+
+#ifndef RESOURCEPARTITIONING_H_
+#define RESOURCEPARTITIONING_H_
+
+#include "OccupancyData.h"
+#include "OccupancyLimits.h"
+#include "OccupancyCurve.h"
+#include "OccupancyCalculator.h"
+#include "../abstract_elastic_kernel/AbstractElasticKernel.hpp"
+#include <cuda_runtime.h>
+#include <boost/shared_ptr.hpp>
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#define NUM_PARTITIONED_RESOURCES 4
+
+/**
+ * What a kernel asks of the device: a number of blocks and what every one of them takes
+ */
+struct KernelDemand {
+	size_t blocks; // the blocks the kernel runs at once: its grid, capped at residentBlocks
+	size_t residentBlocks; // what the device holds of its blocks when it runs alone, however large its grid is
+	size_t perBlock[NUM_PARTITIONED_RESOURCES]; // shared memory, threads, registers and the block slot of a block
+};
+
+/**
+ * Returns what the device has of every resource, in the order of KernelDemand::perBlock
+ *
+ * @param deviceProps the device properties
+ * @param capacity receives the totals
+ */
+inline void getPartitionedCapacity(const cudaDeviceProp& deviceProps, double capacity[NUM_PARTITIONED_RESOURCES]) {
+	SMResources resources = getSMResources(deviceProps);
+	capacity[0] = (double) resources.sharedMem * deviceProps.multiProcessorCount;
+	capacity[1] = (double) deviceProps.maxThreadsPerMultiProcessor * deviceProps.multiProcessorCount;
+	capacity[2] = (double) resources.registers * deviceProps.multiProcessorCount;
+	capacity[3] = (double) resources.maxBlocks * deviceProps.multiProcessorCount;
+}
+
+/**
+ * Returns the demand of a launch configuration
+ *
+ * @param curve the occupancy curve of the kernel on the device
+ * @param params the launch parameters
+ * @return the demand, with no blocks if blocks of that size cannot run
+ */
+inline KernelDemand getKernelDemand(const OccupancyCurve& curve, LaunchParameters params) {
+	BlockUsage usage = curve.getBlockUsage(params.getThreadsPerBlock());
+	KernelDemand demand;
+	demand.residentBlocks = usage.getNumBlocksPerSM() * curve.getNumSMs();
+	demand.blocks = min2(params.getBlocksPerGrid(), demand.residentBlocks);
+	demand.perBlock[0] = usage.getSharedMem();
+	demand.perBlock[1] = usage.getNumThreads();
+	demand.perBlock[2] = usage.getNumRegisters();
+	demand.perBlock[3] = 1;
+	return demand;
+}
+
+/**
+ * Returns the demand of a kernel with its current launch parameters
+ *
+ * @param kernel a pointer to the kernel
+ * @return the demand
+ */
+inline KernelDemand getKernelDemand(boost::shared_ptr<AbstractElasticKernel> kernel) {
+	LaunchParameters params = kernel.get()->getLaunchParams();
+	return getKernelDemand(getOccupancyCurve(kernel.get()->getKernelProperties(), params), params);
+}
+
+/**
+ * Returns the blocks a kernel gets at a dominant share: as many as keep its dominant share under
+ * it, but no more than it asks for
+ */
+inline double getBlocksAtDominantShare(const KernelDemand& demand, double dominantPerBlock, double dominantShare) {
+	if (dominantPerBlock <= 0) {
+		return (double) demand.blocks;
+	}
+	if (dominantShare >= demand.blocks * dominantPerBlock) {
+		return (double) demand.blocks;
+	}
+	// a little slack, so a share of exactly a number of blocks does not lose one to rounding
+	return std::floor(dominantShare / dominantPerBlock + 1e-9);
+}
+
+/**
+ * Orders kernels by the dominant share at which their demand is met
+ */
+struct demandSaturationComparator {
+	const std::vector<double>* saturation;
+
+	inline bool operator()(size_t i, size_t j) const {
+		return (*saturation)[i] < (*saturation)[j];
+	}
+};
+
+/**
+ * Splits the resources of the device among kernels that run at the same time, max-min fair on
+ * their dominant shares (see above)
+ *
+ * @param demands what every kernel asks for
+ * @param deviceProps the device properties
+ * @return the limits of every kernel, in the order of the demands, for limitUsage()
+ */
+inline std::vector<KernelLimits> partitionResources(const std::vector<KernelDemand>& demands, const cudaDeviceProp& deviceProps) {
+	double capacity[NUM_PARTITIONED_RESOURCES];
+	getPartitionedCapacity(deviceProps, capacity);
+
+	// the fraction of the dominant resource of every kernel that a block takes, and the dominant share at which
+	// the demand of the kernel is met
+	std::vector<double> dominantPerBlock(demands.size(), 0);
+	std::vector<double> saturation(demands.size(), 0);
+	std::vector<size_t> order;
+	for (size_t i = 0; i < demands.size(); ++i) {
+		for (size_t r = 0; r < NUM_PARTITIONED_RESOURCES; ++r) {
+			if (capacity[r] > 0) {
+				dominantPerBlock[i] = std::max(dominantPerBlock[i], demands[i].perBlock[r] / capacity[r]);
+			}
+		}
+		saturation[i] = demands[i].blocks * dominantPerBlock[i];
+		order.push_back(i);
+	}
+	demandSaturationComparator comparator = { &saturation };
+	std::sort(order.begin(), order.end(), comparator);
+
+	// raise the dominant share until a resource runs out. Between two saturation points the use of every
+	// resource grows linearly with the share: the kernels whose demand is met use a fixed amount, the others
+	// use their share divided by the dominant share of a block times what a block takes.
+	double fixed[NUM_PARTITIONED_RESOURCES] = { 0, 0, 0, 0 };
+	double slope[NUM_PARTITIONED_RESOURCES] = { 0, 0, 0, 0 };
+	for (size_t i = 0; i < demands.size(); ++i) {
+		for (size_t r = 0; r < NUM_PARTITIONED_RESOURCES && dominantPerBlock[i] > 0; ++r) {
+			slope[r] += demands[i].perBlock[r] / dominantPerBlock[i];
+		}
+	}
+	double share = std::numeric_limits<double>::max(); // every demand is met, unless a resource runs out first
+	for (size_t n = 0; n < order.size(); ++n) {
+		size_t i = order[n];
+		double runsOut = std::numeric_limits<double>::max();
+		for (size_t r = 0; r < NUM_PARTITIONED_RESOURCES; ++r) {
+			if (slope[r] > 0) {
+				runsOut = std::min(runsOut, (capacity[r] - fixed[r]) / slope[r]);
+			}
+		}
+		if (runsOut < saturation[i]) {
+			share = std::max(runsOut, 0.0);
+			break;
+		}
+		for (size_t r = 0; r < NUM_PARTITIONED_RESOURCES && dominantPerBlock[i] > 0; ++r) {
+			fixed[r] += (double) demands[i].blocks * demands[i].perBlock[r];
+			slope[r] -= demands[i].perBlock[r] / dominantPerBlock[i];
+		}
+	}
+
+	std::vector<KernelLimits> limits;
+	for (size_t i = 0; i < demands.size(); ++i) {
+		size_t blocks = (size_t) getBlocksAtDominantShare(demands[i], dominantPerBlock[i], share);
+		if (blocks == 0 && demands[i].blocks > 0) {
+			blocks = 1; // every kernel runs, even if it has to wait for a block slot
+		}
+		limits.push_back(KernelLimits(blocks * demands[i].perBlock[0], blocks * demands[i].perBlock[1], blocks * demands[i].perBlock[2], blocks));
+	}
+	return limits;
+}
+
+/**
+ * Splits the resources of the device among kernels that run at the same time, according to the
+ * demand of their current launch parameters
+ *
+ * @param kernels the kernels
+ * @param deviceProps the device properties
+ * @return the limits of every kernel, in the order of the kernels
+ */
+inline std::vector<KernelLimits> partitionResources(const std::vector<boost::shared_ptr<AbstractElasticKernel> >& kernels,
+		const cudaDeviceProp& deviceProps) {
+	std::vector<KernelDemand> demands;
+	for (std::vector<boost::shared_ptr<AbstractElasticKernel> >::const_iterator it = kernels.begin(); it != kernels.end(); ++it) {
+		demands.push_back(getKernelDemand(*it));
+	}
+	return partitionResources(demands, deviceProps);
+}
+
+/**
+ * Molds the launch parameters of a kernel to fit into the limits, with the usage of a block kept in
+ * its demand, as limitKernel() does without looking the kernel up again
+ *
+ * @param demand the demand of the launch parameters
+ * @param lParams the launch parameters for the kernel
+ * @param limits the limits on the kernel
+ *
+ * @return the molded launch parameters
+ */
+inline LaunchParameters limitUsage(const KernelDemand& demand, LaunchParameters lParams, KernelLimits limits) {
+	BlockUsage usage(demand.perBlock[0], demand.perBlock[1], demand.perBlock[2], 0);
+	return limitUsage(usage, demand.residentBlocks, lParams, limits);
+}
+
+#endif /* RESOURCEPARTITIONING_H_ */
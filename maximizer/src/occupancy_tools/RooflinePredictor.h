@@ -0,0 +1,305 @@
+/**
+ * RooflinePredictor.h
+ *
+ * Predicts the time kernels take from the work they do rather than from their occupancy alone. A
+ * kernel moves a number of bytes to and from global memory and does a number of operations, and
+ * it cannot go faster than the peak bandwidth and operation rate of the device (DeviceProfiles.h)
+ * allow for either: its time is the larger of the two, which also says whether it is memory or
+ * compute bound.
+ *
+ * The peaks are only reached with enough warps on the SMs to hide the latency of the memory and the
+ * pipelines. Below the occupancy at which an SM saturates (the one of the wave model in
+ * WaveQuantization.h) both rates drop with the occupancy, which is what makes a kernel with few
+ * threads latency bound. Kernels that run at the same time share the bandwidth and the pipelines,
+ * and hide the latency for each other with the warps they have on the SMs together (CoResidency.h),
+ * so a group takes the time of all of its work at the occupancy of the group, and no less than its
+ * slowest kernel takes with the blocks it gets. The kernels that get no block on the SMs next to
+ * the others run after them, together again, in the next round.
+ *
+ * The times are in seconds, but the work counts of the kernels are estimates, so they are better
+ * used to compare configurations than taken as they are.
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Zahari Dichev <zaharidichev@gmail.com>
+ */
+
+#ifndef ROOFLINEPREDICTOR_H_
+#define ROOFLINEPREDICTOR_H_
+
+#include "DeviceProfiles.h"
+#include "ResourcePartitioning.h"
+#include "CoResidency.h"
+#include "WaveQuantization.h"
+#include "../abstract_elastic_kernel/AbstractElasticKernel.hpp"
+#include <cuda_runtime.h>
+#include <boost/shared_ptr.hpp>
+#include <vector>
+#include <algorithm>
+
+/**
+ * The work of a run of a kernel
+ */
+struct KernelWork {
+	double bytes; // moved to and from global memory
+	double operations;
+};
+
+/**
+ * The time the model predicts for a kernel or a group of kernels
+ */
+struct RooflinePrediction {
+	double memoryTime; // to move the bytes, in seconds
+	double computeTime; // to do the operations, in seconds
+	double time; // the larger of the two, 0 if the kernels cannot run
+	double efficiency; // the fraction of the peaks the occupancy reaches
+	bool memoryBound;
+};
+
+/**
+ * Returns the work of a kernel, as it declares it
+ *
+ * @param kernel a pointer to the kernel
+ * @return the work
+ */
+inline KernelWork getKernelWork(boost::shared_ptr<AbstractElasticKernel> kernel) {
+	KernelWork work = { (double) kernel.get()->getBytesMoved(), (double) kernel.get()->getNumOperations() };
+	return work;
+}
+
+/**
+ * Returns the fraction of the peaks an occupancy reaches: all of them from the saturation occupancy
+ * up, and less with fewer warps to hide the latency with
+ *
+ * @param occupancy the occupancy, from 0 to 1
+ * @param saturationOccupancy the occupancy from which an SM is busy all the time
+ * @return the efficiency, from 0 to 1
+ */
+inline double getLatencyHidingEfficiency(double occupancy, double saturationOccupancy = DEFAULT_SATURATION_OCCUPANCY) {
+	if (saturationOccupancy <= 0) {
+		return 1;
+	}
+	return std::min(1.0, std::max(occupancy, 0.0) / saturationOccupancy);
+}
+
+/**
+ * Predicts the time of some work at an occupancy
+ *
+ * @param deviceProps the device properties
+ * @param work the bytes and operations
+ * @param occupancy the occupancy the work runs at
+ * @param saturationOccupancy the occupancy from which an SM is busy all the time
+ * @return the prediction, with a time of 0 if nothing runs at that occupancy
+ */
+inline RooflinePrediction predictRooflineTime(const cudaDeviceProp& deviceProps, const KernelWork& work, double occupancy,
+		double saturationOccupancy = DEFAULT_SATURATION_OCCUPANCY) {
+	RooflinePrediction prediction;
+	prediction.memoryTime = 0;
+	prediction.computeTime = 0;
+	prediction.time = 0;
+	prediction.efficiency = getLatencyHidingEfficiency(occupancy, saturationOccupancy);
+	prediction.memoryBound = false;
+	double bandwidth = getPeakMemoryBandwidth(deviceProps) * prediction.efficiency;
+	double operationRate = getPeakOperationRate(deviceProps) * prediction.efficiency;
+	if (bandwidth <= 0 || operationRate <= 0) {
+		return prediction;
+	}
+	prediction.memoryTime = work.bytes / bandwidth;
+	prediction.computeTime = work.operations / operationRate;
+	prediction.time = std::max(prediction.memoryTime, prediction.computeTime);
+	prediction.memoryBound = prediction.memoryTime >= prediction.computeTime;
+	return prediction;
+}
+
+/**
+ * Returns the occupancy a number of resident blocks of a kernel gives on the device
+ */
+inline double getOccupancyOfBlocks(const cudaDeviceProp& deviceProps, const KernelDemand& demand, size_t blocks) {
+	if (deviceProps.maxThreadsPerMultiProcessor <= 0 || deviceProps.multiProcessorCount <= 0) {
+		return 0;
+	}
+	return (double) (blocks * demand.perBlock[1]) / ((double) deviceProps.maxThreadsPerMultiProcessor * deviceProps.multiProcessorCount);
+}
+
+/**
+ * Predicts the time of a kernel that has the device to itself
+ *
+ * @param deviceProps the device properties
+ * @param demand what the kernel asks of the device (see getKernelDemand())
+ * @param work the work of the kernel
+ * @param saturationOccupancy the occupancy from which an SM is busy all the time
+ * @return the prediction
+ */
+inline RooflinePrediction predictKernelTime(const cudaDeviceProp& deviceProps, const KernelDemand& demand, const KernelWork& work,
+		double saturationOccupancy = DEFAULT_SATURATION_OCCUPANCY) {
+	std::vector<KernelDemand> demands(1, demand);
+	return predictRooflineTime(deviceProps, work, getCoResidency(demands, deviceProps).occupancy, saturationOccupancy);
+}
+
+/**
+ * Predicts the time of a kernel with its current launch parameters when it has the device to itself
+ *
+ * @param kernel a pointer to the kernel
+ * @param deviceProps the device properties
+ * @return the prediction
+ */
+inline RooflinePrediction predictKernelTime(boost::shared_ptr<AbstractElasticKernel> kernel, const cudaDeviceProp& deviceProps) {
+	return predictKernelTime(deviceProps, getKernelDemand(kernel), getKernelWork(kernel));
+}
+
+/**
+ * Predicts the time of kernels that are launched at the same time (see above)
+ *
+ * @param deviceProps the device properties
+ * @param demands what every kernel asks for, in launch order
+ * @param work the work of every kernel, in the same order
+ * @param saturationOccupancy the occupancy from which an SM is busy all the time
+ * @return the prediction for the whole group, with the times of its rounds added up
+ */
+inline RooflinePrediction predictGroupTime(const cudaDeviceProp& deviceProps, const std::vector<KernelDemand>& demands,
+		const std::vector<KernelWork>& work, double saturationOccupancy = DEFAULT_SATURATION_OCCUPANCY) {
+	RooflinePrediction prediction;
+	prediction.memoryTime = 0;
+	prediction.computeTime = 0;
+	prediction.time = 0;
+	prediction.efficiency = 0;
+	prediction.memoryBound = false;
+
+	std::vector<size_t> waiting; // the kernels that have not run, in launch order
+	for (size_t i = 0; i < demands.size(); ++i) {
+		if (demands[i].blocks > 0) {
+			waiting.push_back(i); // a kernel that cannot run at all takes no time
+		}
+	}
+	// the kernels on the SMs run together, and the ones that get no block run in the next round. The first
+	// kernel of a round has empty SMs, so every round runs at least one.
+	bool firstRound = true;
+	while (!waiting.empty()) {
+		std::vector<KernelDemand> round;
+		for (std::vector<size_t>::const_iterator it = waiting.begin(); it != waiting.end(); ++it) {
+			round.push_back(demands[*it]);
+		}
+		CoResidency residency = getCoResidency(round, deviceProps);
+		KernelWork together = { 0, 0 };
+		double slowest = 0; // of the kernels of the round, with the blocks they get
+		std::vector<size_t> next;
+		for (size_t i = 0; i < waiting.size(); ++i) {
+			if (residency.residentBlocks[i] == 0) {
+				next.push_back(waiting[i]);
+				continue;
+			}
+			together.bytes += work[waiting[i]].bytes;
+			together.operations += work[waiting[i]].operations;
+			double occupancy = getOccupancyOfBlocks(deviceProps, demands[waiting[i]], residency.residentBlocks[i]);
+			slowest = std::max(slowest, predictRooflineTime(deviceProps, work[waiting[i]], occupancy, saturationOccupancy).time);
+		}
+		RooflinePrediction roundPrediction = predictRooflineTime(deviceProps, together, residency.occupancy, saturationOccupancy);
+		prediction.memoryTime += roundPrediction.memoryTime;
+		prediction.computeTime += roundPrediction.computeTime;
+		prediction.time += std::max(roundPrediction.time, slowest);
+		if (firstRound) {
+			prediction.efficiency = roundPrediction.efficiency;
+			firstRound = false;
+		}
+		if (next.size() == waiting.size()) {
+			break; // cannot happen, see above
+		}
+		waiting.swap(next);
+	}
+	prediction.memoryBound = prediction.memoryTime >= prediction.computeTime;
+	return prediction;
+}
+
+/**
+ * Predicts the time of kernels that are launched at the same time with their current launch parameters
+ *
+ * @param kernels the kernels, in launch order
+ * @param deviceProps the device properties
+ * @return the prediction for the whole group
+ */
+inline RooflinePrediction predictGroupTime(const std::vector<boost::shared_ptr<AbstractElasticKernel> >& kernels,
+		const cudaDeviceProp& deviceProps) {
+	std::vector<KernelDemand> demands;
+	std::vector<KernelWork> work;
+	for (std::vector<boost::shared_ptr<AbstractElasticKernel> >::const_iterator it = kernels.begin(); it != kernels.end(); ++it) {
+		demands.push_back(getKernelDemand(*it));
+		work.push_back(getKernelWork(*it));
+	}
+	return predictGroupTime(deviceProps, demands, work);
+}
+
+/**
+ * A group of kernels that is being put together, with the time predicted for it, so that the time the
+ * group takes with one more kernel can be compared to it
+ */
+struct KernelGroup {
+	std::vector<KernelDemand> demands; // in launch order
+	std::vector<KernelWork> work;
+	double time; // of the whole group, see predictGroupTime()
+};
+
+/**
+ * Returns an empty group
+ */
+inline KernelGroup getEmptyKernelGroup() {
+	KernelGroup group;
+	group.time = 0;
+	return group;
+}
+
+/**
+ * Predicts the time of a group with a kernel launched after the others. The kernel runs in the round
+ * in which it first gets blocks on the SMs (see predictGroupTime()), so it can add anything from a
+ * little to more than its own time, when it pushes kernels that were resident into a later round.
+ *
+ * @param deviceProps the device properties
+ * @param group the group
+ * @param demand what the kernel asks of the device
+ * @param work the work of the kernel
+ * @return the time of the group with the kernel
+ */
+inline double predictGroupTimeWithKernel(const cudaDeviceProp& deviceProps, KernelGroup& group, const KernelDemand& demand,
+		const KernelWork& work) {
+	group.demands.push_back(demand);
+	group.work.push_back(work);
+	double time = predictGroupTime(deviceProps, group.demands, group.work).time;
+	group.demands.pop_back();
+	group.work.pop_back();
+	return time;
+}
+
+/**
+ * Adds a kernel to a group
+ *
+ * @param group the group
+ * @param demand what the kernel asks of the device
+ * @param work the work of the kernel
+ * @param time the time of the group with the kernel, see predictGroupTimeWithKernel()
+ */
+inline void addKernelToGroup(KernelGroup& group, const KernelDemand& demand, const KernelWork& work, double time) {
+	group.demands.push_back(demand);
+	group.work.push_back(work);
+	group.time = time;
+}
+
+/**
+ * Prints the prediction of every kernel on its own, and of all of them at the same time
+ *
+ * @param kernels the kernels
+ * @param deviceProps the device properties
+ */
+inline void printRooflinePredictions(const std::vector<boost::shared_ptr<AbstractElasticKernel> >& kernels, const cudaDeviceProp& deviceProps) {
+	printf("%-24s %12s %12s %8s %12s %12s %8s\n", "kernel", "MB", "MFLOP", "occ", "memory us", "compute us", "bound");
+	double sequential = 0;
+	for (std::vector<boost::shared_ptr<AbstractElasticKernel> >::const_iterator it = kernels.begin(); it != kernels.end(); ++it) {
+		KernelWork work = getKernelWork(*it);
+		double occupancy = getResidentOccupancyForKernel(*it, deviceProps);
+		RooflinePrediction prediction = predictRooflineTime(deviceProps, work, occupancy);
+		sequential += prediction.time;
+		printf("%-24.24s %12.3f %12.3f %8.3f %12.1f %12.1f %8s\n", (*it).get()->getName().c_str(), work.bytes / 1e6, work.operations / 1e6, occupancy,
+				prediction.memoryTime * 1e6, prediction.computeTime * 1e6, prediction.memoryBound ? "memory" : "compute");
+	}
+	RooflinePrediction together = predictGroupTime(kernels, deviceProps);
+	printf("One after the other: %.1f us, at the same time: %.1f us\n", sequential * 1e6, together.time * 1e6);
+}
+
+#endif /* ROOFLINEPREDICTOR_H_ */
@@ -0,0 +1,208 @@
+/**
+ * WaveQuantization.h
+ *
+ * Grid sizing that accounts for the waves a grid runs in. The device runs at most
+ * (resident blocks per SM x SMs) blocks at once, a wave; a grid of 1.05 waves takes two, the
+ * second of which keeps 5% of the device busy. The elastic kernels share their work items among
+ * however many threads they are launched with, so the grid can be sized to whole waves instead.
+ *
+ * The model predicts the time of a launch in units of the time a thread takes for one work item
+ * when it has an SM to itself. Every thread does ceil(items / threads) items, and an SM gets
+ * through them at the latency of a single thread until it has enough warps to saturate its
+ * pipelines (saturationOccupancy of its threads); above that the time grows with the threads it
+ * runs. A wave therefore takes items per thread x max(1, threads on the busiest SM / saturation
+ * threads), and a launch takes the sum of its waves, the last one possibly partial. Only the
+ * device properties and the occupancy curve are needed, so a device profile is enough.
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Zahari Dichev <zaharidichev@gmail.com>
+ */
+
+#ifndef WAVEQUANTIZATION_H_
+#define WAVEQUANTIZATION_H_
+
+#include "OccupancyCurve.h"
+#include <cuda_runtime.h>
+#include <algorithm>
+#include <stdio.h>
+
+#define DEFAULT_SATURATION_OCCUPANCY 0.5
+#define MAX_CANDIDATE_WAVES 32
+
+/**
+ * A launch configuration and what the model predicts for it
+ */
+struct GridSizing {
+	size_t blockSize;
+	size_t gridSize;
+	size_t blocksPerWave; // resident blocks per SM x SMs
+	size_t numWaves;
+	double waveEfficiency; // the blocks of the grid over the blocks its waves could hold
+	size_t workPerThread; // work items per thread
+	double predictedTime; // in the time of one work item of a single thread
+};
+
+/**
+ * Predicts the time of a launch
+ *
+ * @param deviceProps the device properties
+ * @param curve the occupancy curve of the kernel
+ * @param problemSize the work items the threads share
+ * @param blockSize the threads per block
+ * @param gridSize the blocks of the grid
+ * @param saturationOccupancy the occupancy from which an SM is busy all the time
+ * @return the prediction, with a predictedTime of 0 if blocks of that size cannot run
+ */
+inline GridSizing predictGridSizing(const cudaDeviceProp& deviceProps, const OccupancyCurve& curve, size_t problemSize, size_t blockSize,
+		size_t gridSize, double saturationOccupancy = DEFAULT_SATURATION_OCCUPANCY) {
+	GridSizing sizing;
+	sizing.blockSize = blockSize;
+	sizing.gridSize = gridSize;
+	sizing.blocksPerWave = curve.getResidentBlocks(blockSize) * deviceProps.multiProcessorCount;
+	sizing.numWaves = 0;
+	sizing.waveEfficiency = 0;
+	sizing.workPerThread = 0;
+	sizing.predictedTime = 0;
+	if (sizing.blocksPerWave == 0 || blockSize == 0 || gridSize == 0) {
+		return sizing;
+	}
+
+	size_t threads = blockSize * gridSize;
+	sizing.workPerThread = (problemSize + threads - 1) / threads;
+	sizing.numWaves = (gridSize + sizing.blocksPerWave - 1) / sizing.blocksPerWave;
+	sizing.waveEfficiency = (double) gridSize / (double) (sizing.numWaves * sizing.blocksPerWave);
+
+	double saturationThreads = std::max(saturationOccupancy * deviceProps.maxThreadsPerMultiProcessor, 1.0);
+	size_t fullWaves = gridSize / sizing.blocksPerWave;
+	size_t tailBlocks = gridSize % sizing.blocksPerWave;
+	double fullWaveThreads = (double) (curve.getResidentBlocks(blockSize) * blockSize); // on every SM
+	double tailThreads = (double) (((tailBlocks + deviceProps.multiProcessorCount - 1) / deviceProps.multiProcessorCount) * blockSize); // on the busiest SM
+
+	double time = fullWaves * std::max(1.0, fullWaveThreads / saturationThreads);
+	if (tailBlocks > 0) {
+		time += std::max(1.0, tailThreads / saturationThreads);
+	}
+	sizing.predictedTime = time * sizing.workPerThread;
+	return sizing;
+}
+
+/**
+ * Tells whether a prediction is better than another: faster, then with fewer blocks, then with
+ * larger blocks
+ */
+inline bool isBetterGridSizing(const GridSizing& candidate, const GridSizing& best) {
+	if (candidate.predictedTime <= 0) {
+		return false;
+	}
+	if (best.predictedTime <= 0 || candidate.predictedTime < best.predictedTime) {
+		return true;
+	}
+	if (candidate.predictedTime > best.predictedTime) {
+		return false;
+	}
+	if (candidate.gridSize != best.gridSize) {
+		return candidate.gridSize < best.gridSize;
+	}
+	return candidate.blockSize > best.blockSize;
+}
+
+/**
+ * Chooses the grid size with the lowest predicted time for a problem and a block size, which is
+ * kept as it is (the block of a multi-dimensional kernel, for one). Grids of whole waves are tried,
+ * up to the grid in which every thread has a single item, and that grid itself.
+ *
+ * @param deviceProps the device properties
+ * @param curve the occupancy curve of the kernel
+ * @param problemSize the work items the threads share
+ * @param blockSize the threads per block
+ * @param saturationOccupancy the occupancy from which an SM is busy all the time
+ * @return the best configuration, with a blockSize of 0 if blocks of that size cannot run
+ */
+inline GridSizing chooseGridSize(const cudaDeviceProp& deviceProps, const OccupancyCurve& curve, size_t problemSize, size_t blockSize,
+		double saturationOccupancy = DEFAULT_SATURATION_OCCUPANCY) {
+	GridSizing best;
+	best.blockSize = 0;
+	best.gridSize = 0;
+	best.predictedTime = 0;
+	problemSize = std::max(problemSize, (size_t) 1);
+	size_t maxGrid = (deviceProps.maxGridSize[0] > 0) ? deviceProps.maxGridSize[0] : 65535;
+	size_t blocksPerWave = curve.getResidentBlocks(blockSize) * deviceProps.multiProcessorCount;
+	if (blocksPerWave == 0 || blockSize == 0) {
+		return best;
+	}
+	size_t singleItemGrid = min2((problemSize + blockSize - 1) / blockSize, maxGrid);
+	size_t maxWaves = min2((singleItemGrid + blocksPerWave - 1) / blocksPerWave, MAX_CANDIDATE_WAVES);
+	for (size_t waves = 1; waves <= maxWaves; ++waves) {
+		size_t gridSize = min2(waves * blocksPerWave, maxGrid);
+		GridSizing candidate = predictGridSizing(deviceProps, curve, problemSize, blockSize, gridSize, saturationOccupancy);
+		if (isBetterGridSizing(candidate, best)) {
+			best = candidate;
+		}
+	}
+	GridSizing candidate = predictGridSizing(deviceProps, curve, problemSize, blockSize, singleItemGrid, saturationOccupancy);
+	if (isBetterGridSizing(candidate, best)) {
+		best = candidate;
+	}
+	return best;
+}
+
+/**
+ * Chooses the block size and the grid size with the lowest predicted time for a problem. Every
+ * block size in whole warps that can run is tried with the grids of chooseGridSize().
+ *
+ * @param deviceProps the device properties
+ * @param curve the occupancy curve of the kernel
+ * @param kernelProps the kernel properties
+ * @param problemSize the work items the threads share
+ * @param saturationOccupancy the occupancy from which an SM is busy all the time
+ * @return the best configuration, with a blockSize of 0 if no block size can run
+ */
+inline GridSizing chooseGridSizing(const cudaDeviceProp& deviceProps, const OccupancyCurve& curve, const cudaFuncAttributes& kernelProps,
+		size_t problemSize, double saturationOccupancy = DEFAULT_SATURATION_OCCUPANCY) {
+	GridSizing best;
+	best.blockSize = 0;
+	best.gridSize = 0;
+	best.predictedTime = 0;
+	size_t warpSize = (deviceProps.warpSize > 0) ? deviceProps.warpSize : 32;
+	size_t largestBlock = min2(kernelProps.maxThreadsPerBlock, deviceProps.maxThreadsPerBlock);
+
+	for (size_t blockSize = warpSize; blockSize <= largestBlock; blockSize += warpSize) {
+		GridSizing candidate = chooseGridSize(deviceProps, curve, problemSize, blockSize, saturationOccupancy);
+		if (isBetterGridSizing(candidate, best)) {
+			best = candidate;
+		}
+	}
+	return best;
+}
+
+/**
+ * Prints, for problems just over and well over a number of full waves of threads, the
+ * configuration the model chooses next to the one that keeps the threads of the problem with the
+ * block size of the highest occupancy
+ *
+ * @param deviceProps the device properties
+ * @param kernelProps the kernel properties
+ */
+inline void printGridSizingTable(const cudaDeviceProp& deviceProps, const cudaFuncAttributes& kernelProps) {
+	const OccupancyCurve& curve = getOccupancyCurve(kernelProps);
+	size_t blockSize = curve.getOptimalBlockSize();
+	if (blockSize == 0) {
+		printf("No block size of the kernel can run\n");
+		return;
+	}
+	size_t waveThreads = curve.getResidentBlocks(blockSize) * deviceProps.multiProcessorCount * blockSize;
+	const double multiples[] = { 0.5, 1.0, 1.05, 1.5, 2.05, 10.3, 100.1 };
+	printf("%10s | %6s %8s %6s %6s %10s | %6s %8s %6s %6s %10s | %7s\n", "items", "block", "grid", "waves", "eff", "time", "block", "grid", "waves",
+			"eff", "time", "gain");
+	for (size_t i = 0; i < sizeof(multiples) / sizeof(double); ++i) {
+		size_t problemSize = (size_t) (multiples[i] * waveThreads);
+		GridSizing kept = predictGridSizing(deviceProps, curve, problemSize, blockSize, (problemSize + blockSize - 1) / blockSize);
+		GridSizing chosen = chooseGridSizing(deviceProps, curve, kernelProps, problemSize);
+		printf("%10lu | %6lu %8lu %6lu %6.2f %10.1f | %6lu %8lu %6lu %6.2f %10.1f | %6.1f%%\n", (unsigned long) problemSize,
+				(unsigned long) kept.blockSize, (unsigned long) kept.gridSize, (unsigned long) kept.numWaves, kept.waveEfficiency, kept.predictedTime,
+				(unsigned long) chosen.blockSize, (unsigned long) chosen.gridSize, (unsigned long) chosen.numWaves, chosen.waveEfficiency,
+				chosen.predictedTime, 100.0 * (kept.predictedTime - chosen.predictedTime) / std::max(kept.predictedTime, 1.0));
+	}
+}
+
+#endif /* WAVEQUANTIZATION_H_ */